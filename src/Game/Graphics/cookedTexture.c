@@ -0,0 +1,288 @@
+#include "cookedTexture.h"
+
+#include <assert.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <SDL_stdinc.h>
+
+#include "glPlatform.h"
+#include "glDebugging.h"
+#include "../System/memory.h"
+#include "../System/platformLog.h"
+
+// Gets the name of the cooked version of an image file, the same name with the extension swapped out.
+//  Returns false if it won't fit in outFileName.
+bool ctex_GetCookedFileName( const char* fileName, char* outFileName, size_t outFileNameSize )
+{
+	assert( fileName != NULL );
+	assert( outFileName != NULL );
+
+	// only look for the extension in the file name, not the directories
+	size_t baseLen = strlen( fileName );
+	for( size_t i = baseLen; i > 0; --i ) {
+		char c = fileName[i - 1];
+		if( c == '.' ) {
+			baseLen = i - 1;
+			break;
+		}
+		if( ( c == '/' ) || ( c == '\\' ) ) {
+			break;
+		}
+	}
+
+	size_t extLen = strlen( COOKED_TEXTURE_EXTENSION );
+	if( ( baseLen + extLen + 1 ) > outFileNameSize ) {
+		return false;
+	}
+
+	memcpy( outFileName, fileName, baseLen );
+	memcpy( outFileName + baseLen, COOKED_TEXTURE_EXTENSION, extLen + 1 );
+	return true;
+}
+
+// Whether the cooked file is older than the image it was cooked from, in which case the image should be used instead.
+//  If either file's modification time can't be found, like with files packed into the app, it isn't treated as stale.
+bool ctex_IsStale( const char* cookedFileName, const char* sourceFileName )
+{
+	assert( cookedFileName != NULL );
+	assert( sourceFileName != NULL );
+
+	struct stat cookedStat;
+	struct stat sourceStat;
+	if( ( stat( cookedFileName, &cookedStat ) != 0 ) || ( stat( sourceFileName, &sourceStat ) != 0 ) ) {
+		return false;
+	}
+
+	return ( sourceStat.st_mtime > cookedStat.st_mtime );
+}
+
+static bool rangeInFile( const MappedFile* file, size_t offset, size_t size )
+{
+	return ( offset <= file->size ) && ( size <= ( file->size - offset ) );
+}
+
+// Expands one run length encoded row, returns the number of bytes read from src or 0 if the data is bad.
+static size_t expandRow( const uint8_t* src, size_t srcSize, uint8_t* dest, uint32_t width )
+{
+	size_t read = 0;
+	uint32_t written = 0;
+	while( written < width ) {
+		if( read >= srcSize ) {
+			return 0;
+		}
+
+		uint8_t control = src[read++];
+		uint32_t count = ( control & 0x7F ) + 1;
+		if( count > ( width - written ) ) {
+			return 0;
+		}
+
+		if( control & 0x80 ) {
+			if( ( srcSize - read ) < 4 ) {
+				return 0;
+			}
+			for( uint32_t i = 0; i < count; ++i ) {
+				memcpy( dest + ( ( written + i ) * 4 ), src + read, 4 );
+			}
+			read += 4;
+		} else {
+			if( ( srcSize - read ) < ( count * 4 ) ) {
+				return 0;
+			}
+			memcpy( dest + ( written * 4 ), src + read, count * 4 );
+			read += count * 4;
+		}
+		written += count;
+	}
+
+	return read;
+}
+
+static int expandMips( CookedImage* image, const char* fileName )
+{
+	size_t totalSize = 0;
+	for( uint32_t i = 0; i < image->header->numMips; ++i ) {
+		totalSize += (size_t)image->mips[i].width * (size_t)image->mips[i].height * 4;
+	}
+
+	image->expanded = mem_Allocate( totalSize );
+	if( image->expanded == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate memory to expand cooked texture %s", fileName );
+		return -1;
+	}
+
+	uint8_t* dest = image->expanded;
+	for( uint32_t i = 0; i < image->header->numMips; ++i ) {
+		const CookedTextureMip* mip = &( image->mips[i] );
+		const uint8_t* src = image->file.data + mip->offset;
+		size_t srcLeft = mip->size;
+
+		image->mipData[i] = dest;
+		for( uint32_t r = 0; r < mip->height; ++r ) {
+			size_t rowSize = expandRow( src, srcLeft, dest, mip->width );
+			if( rowSize == 0 ) {
+				llog( LOG_ERROR, "Bad compressed data in cooked texture %s", fileName );
+				return -1;
+			}
+			src += rowSize;
+			srcLeft -= rowSize;
+			dest += mip->width * 4;
+		}
+	}
+
+	return 0;
+}
+
+// Opens and validates a cooked texture file. Doesn't touch the GPU, so it's safe to call from any thread.
+//  Returns >= 0 on success, < 0 on failure. Nothing is logged if the file doesn't exist.
+int ctex_Load( const char* fileName, CookedImage* outImage )
+{
+	assert( outImage != NULL );
+
+	memset( outImage, 0, sizeof( *outImage ) );
+
+	if( mf_Open( fileName, &( outImage->file ) ) < 0 ) {
+		return -1;
+	}
+	const MappedFile* file = &( outImage->file );
+
+	if( !rangeInFile( file, 0, sizeof( CookedTextureHeader ) ) ) {
+		llog( LOG_ERROR, "Cooked texture %s is too small.", fileName );
+		goto failure;
+	}
+	outImage->header = (const CookedTextureHeader*)file->data;
+	const CookedTextureHeader* header = outImage->header;
+
+	if( ( header->magic != COOKED_TEXTURE_MAGIC ) || ( header->version != COOKED_TEXTURE_VERSION ) ) {
+		llog( LOG_ERROR, "Cooked texture %s is not a supported version.", fileName );
+		goto failure;
+	}
+
+	if( ( header->width == 0 ) || ( header->height == 0 ) || ( header->width > COOKED_TEXTURE_MAX_SIZE ) || ( header->height > COOKED_TEXTURE_MAX_SIZE ) ) {
+		llog( LOG_ERROR, "Cooked texture %s has a bad size: %u x %u", fileName, header->width, header->height );
+		goto failure;
+	}
+
+	if( ( header->numMips == 0 ) || ( header->numMips > COOKED_TEXTURE_MAX_MIPS ) ) {
+		llog( LOG_ERROR, "Cooked texture %s has a bad number of mip levels: %u", fileName, header->numMips );
+		goto failure;
+	}
+
+	size_t mipsOffset = sizeof( CookedTextureHeader );
+	if( !rangeInFile( file, mipsOffset, sizeof( CookedTextureMip ) * header->numMips ) ) {
+		llog( LOG_ERROR, "Cooked texture %s is truncated.", fileName );
+		goto failure;
+	}
+	outImage->mips = (const CookedTextureMip*)( file->data + mipsOffset );
+
+	bool compressed = ( header->flags & CTF_ROW_COMPRESSED ) != 0;
+	for( uint32_t i = 0; i < header->numMips; ++i ) {
+		const CookedTextureMip* mip = &( outImage->mips[i] );
+		uint32_t expectedWidth = SDL_max( header->width >> i, 1 );
+		uint32_t expectedHeight = SDL_max( header->height >> i, 1 );
+		if( ( mip->width != expectedWidth ) || ( mip->height != expectedHeight ) || !rangeInFile( file, mip->offset, mip->size ) ||
+			( !compressed && ( mip->size != ( mip->width * mip->height * 4 ) ) ) ) {
+			llog( LOG_ERROR, "Cooked texture %s has a bad mip level %u.", fileName, i );
+			goto failure;
+		}
+		outImage->mipData[i] = file->data + mip->offset;
+	}
+
+	if( compressed && ( expandMips( outImage, fileName ) < 0 ) ) {
+		goto failure;
+	}
+
+	return 0;
+
+failure:
+	ctex_Release( outImage );
+	return -1;
+}
+
+// Uploads all the mip levels of the image into a new texture, has to be called on the main thread.
+//  Returns >= 0 on success, < 0 on failure.
+int ctex_CreateTexture( CookedImage* image, Texture* outTexture )
+{
+	assert( image != NULL );
+	assert( image->header != NULL );
+	assert( outTexture != NULL );
+
+	GL( glGenTextures( 1, &( outTexture->textureID ) ) );
+
+	if( outTexture->textureID == 0 ) {
+		llog( LOG_INFO, "Unable to create texture object." );
+		return -1;
+	}
+
+	GL( glBindTexture( GL_TEXTURE_2D, outTexture->textureID ) );
+
+	uint32_t numMips = image->header->numMips;
+#if defined( __ANDROID__ ) || defined( __EMSCRIPTEN__ )
+	// GLES2 has no GL_TEXTURE_MAX_LEVEL and doesn't allow mips on non power of two textures, anything else would sample
+	//  black, so only use the mips if the chain is complete, otherwise just use the full size image
+	uint32_t width = image->header->width;
+	uint32_t height = image->header->height;
+	bool powerOfTwo = ( ( width & ( width - 1 ) ) == 0 ) && ( ( height & ( height - 1 ) ) == 0 );
+	const CookedTextureMip* lastMip = &( image->mips[numMips - 1] );
+	if( !powerOfTwo || ( lastMip->width != 1 ) || ( lastMip->height != 1 ) ) {
+		numMips = 1;
+	}
+#endif
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, ( numMips > 1 ) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR ) );
+#if !defined( __ANDROID__ ) && !defined( __EMSCRIPTEN__ )
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)( numMips - 1 ) ) );
+#endif
+
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE ) );
+	GL( glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE ) );
+
+	for( uint32_t i = 0; i < numMips; ++i ) {
+		GL( glTexImage2D( GL_TEXTURE_2D, (GLint)i, GL_RGBA, (GLsizei)image->mips[i].width, (GLsizei)image->mips[i].height, 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, image->mipData[i] ) );
+	}
+
+	outTexture->width = (int)image->header->width;
+	outTexture->height = (int)image->header->height;
+	outTexture->flags = 0;
+	if( image->header->flags & CTF_TRANSPARENT ) {
+		outTexture->flags |= TF_IS_TRANSPARENT;
+	}
+
+	return 0;
+}
+
+void ctex_Release( CookedImage* image )
+{
+	assert( image != NULL );
+
+	mem_Release( image->expanded );
+	mf_Close( &( image->file ) );
+	memset( image, 0, sizeof( *image ) );
+}
+
+// If there's an up to date cooked version of the image file load it into outTexture.
+//  Returns >= 0 on success, < 0 if there's no cooked version, it's stale, or it couldn't be loaded.
+int ctex_LoadCookedTexture( const char* fileName, Texture* outTexture )
+{
+	char cookedFileName[512];
+	if( !ctex_GetCookedFileName( fileName, cookedFileName, sizeof( cookedFileName ) ) ) {
+		return -1;
+	}
+
+	if( ctex_IsStale( cookedFileName, fileName ) ) {
+		llog( LOG_WARN, "Cooked texture %s is older than %s, loading the image instead. Run the TextureCooker to update it.", cookedFileName, fileName );
+		return -1;
+	}
+
+	CookedImage image;
+	if( ctex_Load( cookedFileName, &image ) < 0 ) {
+		return -1;
+	}
+
+	int result = ctex_CreateTexture( &image, outTexture );
+	ctex_Release( &image );
+
+	return result;
+}
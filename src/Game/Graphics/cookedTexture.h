@@ -0,0 +1,45 @@
+#ifndef COOKED_TEXTURE_H
+#define COOKED_TEXTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "gfxUtil.h"
+#include "cookedTextureFormat.h"
+#include "../System/mappedFile.h"
+
+// Textures that have been run through the TextureCooker tool. The texel data is stored ready to upload, so there's
+//  nothing to decode when loading them.
+
+typedef struct {
+	MappedFile file;
+	const CookedTextureHeader* header;
+	const CookedTextureMip* mips;
+
+	uint8_t* expanded; // if the rows were compressed this holds the uncompressed texels for all the mips
+	const uint8_t* mipData[COOKED_TEXTURE_MAX_MIPS];
+} CookedImage;
+
+// Gets the name of the cooked version of an image file, the same name with the extension swapped out.
+//  Returns false if it won't fit in outFileName.
+bool ctex_GetCookedFileName( const char* fileName, char* outFileName, size_t outFileNameSize );
+
+// Whether the cooked file is older than the image it was cooked from, in which case the image should be used instead.
+//  If either file's modification time can't be found, like with files packed into the app, it isn't treated as stale.
+bool ctex_IsStale( const char* cookedFileName, const char* sourceFileName );
+
+// Opens and validates a cooked texture file. Doesn't touch the GPU, so it's safe to call from any thread.
+//  Returns >= 0 on success, < 0 on failure. Nothing is logged if the file doesn't exist.
+int ctex_Load( const char* fileName, CookedImage* outImage );
+
+// Uploads all the mip levels of the image into a new texture, has to be called on the main thread.
+//  Returns >= 0 on success, < 0 on failure.
+int ctex_CreateTexture( CookedImage* image, Texture* outTexture );
+
+void ctex_Release( CookedImage* image );
+
+// If there's an up to date cooked version of the image file load it into outTexture.
+//  Returns >= 0 on success, < 0 if there's no cooked version, it's stale, or it couldn't be loaded.
+int ctex_LoadCookedTexture( const char* fileName, Texture* outTexture );
+
+#endif /* inclusion guard */
@@ -0,0 +1,50 @@
+#ifndef COOKED_TEXTURE_FORMAT_H
+#define COOKED_TEXTURE_FORMAT_H
+
+#include <stdint.h>
+
+/*
+Layout of the cooked texture files written by the TextureCooker tool. Everything is little endian and already in the
+ form the GPU wants it, so loading is just mapping the file and uploading each mip level.
+ File layout:
+  CookedTextureHeader
+  CookedTextureMip[numMips], largest first
+  padding to COOKED_TEXTURE_DATA_ALIGNMENT
+  texel data for each mip, RGBA8
+
+ If CTF_ROW_COMPRESSED is set each row of each mip is run length encoded on its own. Each packet starts with a control
+ byte, if the high bit is set the next pixel is repeated ( control & 0x7F ) + 1 times, otherwise ( control + 1 ) pixels
+ follow as is.
+
+ Where the sprites are in sprite sheets isn't stored here, that comes from the sprite sheet's own index.
+*/
+
+#define COOKED_TEXTURE_MAGIC 0x58455443 // "CTEX"
+#define COOKED_TEXTURE_VERSION 2
+#define COOKED_TEXTURE_EXTENSION ".ctex"
+#define COOKED_TEXTURE_DATA_ALIGNMENT 16
+#define COOKED_TEXTURE_MAX_MIPS 16
+#define COOKED_TEXTURE_MAX_SIZE 16384
+
+enum CookedTextureFlags {
+	CTF_TRANSPARENT = 0x1, // has pixels that aren't completely clear or solid
+	CTF_ROW_COMPRESSED = 0x4
+};
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t flags;
+	uint32_t numMips;
+} CookedTextureHeader;
+
+typedef struct {
+	uint32_t width;
+	uint32_t height;
+	uint32_t offset; // from the start of the file
+	uint32_t size; // bytes stored in the file, uncompressed it's always width * height * 4
+} CookedTextureMip;
+
+#endif /* inclusion guard */
@@ -19,6 +19,7 @@
 #include <stb_rect_pack.h>
 
 #include "glDebugging.h"
+#include "cookedTexture.h"
 
 #include "../System/platformLog.h"
 
@@ -157,6 +158,11 @@ int gfxUtil_LoadTexture( const char* fileName, Texture* outTexture )
 		goto clean_up;
 	}
 
+	// use the cooked version of the image if there is one and it's up to date, it doesn't need to be decoded
+	if( ctex_LoadCookedTexture( fileName, outTexture ) >= 0 ) {
+		goto clean_up;
+	}
+
 	if( gfxUtil_LoadImage( fileName, &image ) < 0 ) {
 		llog( LOG_INFO, "Unable to load image %s! STB Error: %s", fileName, stbi_failure_reason( ) );
 		returnCode = -1;
@@ -286,6 +292,34 @@ clean_up:
 	return returnCode;
 }
 
+// Replaces rows of a texture created with gfxUtil_CreateTextureFromAlphaBitmap. The data is the full bitmap for the
+//  texture, only the rows from firstRow to firstRow + numRows are uploaded.
+//  Returns >= 0 on success, < 0 on failure.
+int gfxUtil_UpdateAlphaBitmapRows( Texture* texture, uint8_t* data, int firstRow, int numRows )
+{
+	assert( texture != NULL );
+	assert( data != NULL );
+	assert( firstRow >= 0 );
+	assert( ( firstRow + numRows ) <= texture->height );
+
+	if( numRows <= 0 ) {
+		return 0;
+	}
+
+	GLenum texFormat;
+#if defined( __ANDROID__ ) || defined( __EMSCRIPTEN__ )
+	texFormat = GL_ALPHA;
+#else
+	texFormat = GL_RED;
+#endif
+
+	GL( glBindTexture( GL_TEXTURE_2D, texture->textureID ) );
+	GL( glTexSubImage2D( GL_TEXTURE_2D, 0, 0, firstRow, texture->width, numRows, texFormat, GL_UNSIGNED_BYTE,
+		data + ( (size_t)firstRow * (size_t)texture->width ) ) );
+
+	return 0;
+}
+
 // Unloads the passed in texture. After doing this the texture will be invalid and should not be used anymore.
 void gfxUtil_UnloadTexture( Texture* texture )
 {
@@ -60,6 +60,11 @@ int gfxUtil_CreateTextureFromRGBABitmap( uint8_t* data, int width, int height, T
 //  Returns >= 0 on success, < 0 on failure.
 int gfxUtil_CreateTextureFromAlphaBitmap( uint8_t* data, int width, int height, Texture* outTexture );
 
+// Replaces rows of a texture created with gfxUtil_CreateTextureFromAlphaBitmap. The data is the full bitmap for the
+//  texture, only the rows from firstRow to firstRow + numRows are uploaded.
+//  Returns >= 0 on success, < 0 on failure.
+int gfxUtil_UpdateAlphaBitmapRows( Texture* texture, uint8_t* data, int firstRow, int numRows );
+
 // Unloads the passed in texture. After doing this the texture will be invalid and should not be used anymore.
 void gfxUtil_UnloadTexture( Texture* texture );
 
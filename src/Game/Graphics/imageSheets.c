@@ -7,32 +7,251 @@
 
 #include "images.h"
 #include "gfxUtil.h"
+#include "spriteSheetFormat.h"
 
 #include "../Utils/stretchyBuffer.h"
 #include "../System/platformLog.h"
+#include "../System/memory.h"
+#include "../System/mappedFile.h"
 #include "../Utils/helpers.h"
 
-// TODO: Convert this from a text format to binary.
-
 typedef enum {
 	RS_VERSION,
+	RS_PAGE_COUNT,
 	RS_FILENAME,
 	RS_SPRITES,
 	RS_FINISHED
 } ReadState;
 
+/*
+The image file name is stored relative to the sprite sheet definition, so we need to rip the file name off the definition
+ and append the image file name to it.
+*/
+static void getImagePath( const char* sheetFileName, const char* imageName, char* outPath, size_t outPathSize )
+{
+	SDL_strlcpy( outPath, sheetFileName, outPathSize );
+	char* fileNameLoc = SDL_strrchr( outPath, '/' );
+	if( fileNameLoc != NULL ) {
+		++fileNameLoc;
+	} else {
+		fileNameLoc = outPath;
+	}
+	(*fileNameLoc) = 0; // move the null terminator
+	SDL_strlcat( outPath, imageName, outPathSize );
+}
+
+/*
+Gets the name of the binary index for the sprite sheet definition, the same name with the extension swapped out.
+ Returns false if it won't fit in outFileName.
+*/
+static bool getIndexFileName( const char* fileName, char* outFileName, size_t outFileNameSize )
+{
+	size_t baseLen = SDL_strlen( fileName );
+	for( size_t i = baseLen; i > 0; --i ) {
+		char c = fileName[i - 1];
+		if( c == '.' ) {
+			baseLen = i - 1;
+			break;
+		}
+		if( ( c == '/' ) || ( c == '\\' ) ) {
+			break;
+		}
+	}
+
+	size_t extLen = SDL_strlen( SPRITE_SHEET_INDEX_EXTENSION );
+	if( ( baseLen + extLen + 1 ) > outFileNameSize ) {
+		return false;
+	}
+
+	SDL_memcpy( outFileName, fileName, baseLen );
+	SDL_memcpy( outFileName + baseLen, SPRITE_SHEET_INDEX_EXTENSION, extLen + 1 );
+	return true;
+}
+
+typedef struct {
+	int page;
+	Vector2 trimPos; // where the top-left of the trimmed sprite was in the original image
+	Vector2 sourceSize; // size of the original image
+	bool rotated;
+} SpriteLayout;
+
+/*
+Creates the images for all the sprites, the sprites have to be grouped by page. Each page is split separately and
+ then the images have the trimming and rotation the generator did undone.
+ Returns the number of images loaded if it was successful, otherwise returns -1.
+*/
+static int createSprites( const char* fileName, const char** pageNames, int numPages, int count, ShaderType shaderType,
+	Vector2* mins, Vector2* maxes, char** ids, SpriteLayout* layouts, int** imgOutArray )
+{
+	for( int i = 0; i < count; ++i ) {
+		if( ( layouts[i].page < 0 ) || ( layouts[i].page >= numPages ) || ( ( i > 0 ) && ( layouts[i].page < layouts[i - 1].page ) ) ) {
+			llog( LOG_ERROR, "Sprite sheet %s has sprites with bad pages.", fileName );
+			return -1;
+		}
+	}
+
+	int* outIDs = sb_Add( *imgOutArray, count );
+
+	int start = 0;
+	while( start < count ) {
+		int end = start + 1;
+		while( ( end < count ) && ( layouts[end].page == layouts[start].page ) ) {
+			++end;
+		}
+
+		char imagePath[256];
+		getImagePath( fileName, pageNames[layouts[start].page], imagePath, ARRAY_SIZE( imagePath ) );
+		if( img_SplitImageFile( imagePath, end - start, shaderType, mins + start, maxes + start, ids + start, outIDs + start ) < 0 ) {
+			llog( LOG_ERROR, "Problem splitting image for sprite sheet: %s", fileName );
+			for( int i = 0; i < start; ++i ) {
+				img_Clean( outIDs[i] );
+			}
+			sb_Release( *imgOutArray );
+			return -1;
+		}
+
+		start = end;
+	}
+
+	for( int i = 0; i < count; ++i ) {
+		if( layouts[i].rotated ) {
+			img_SetRotatedInTexture( outIDs[i] );
+		}
+
+		img_SetTrim( outIDs[i], layouts[i].trimPos, layouts[i].sourceSize );
+	}
+
+	return count;
+}
+
+/*
+Loads the sprite sheet using the binary index. The whole index is read in one go and used in place, the ids point
+ into it until they're added to the image id map.
+ Returns the number of images loaded if it was successful, -1 if splitting the images failed, and -2 if there's no
+ index or it couldn't be used, in which case the text definition should be loaded instead.
+*/
+static int loadSpriteSheetIndex( const char* fileName, ShaderType shaderType, int** imgOutArray )
+{
+	int returnVal = -2;
+	MappedFile file;
+	Vector2* mins = NULL;
+	char** ids = NULL;
+	SpriteLayout* layouts = NULL;
+	const char** pageNames = NULL;
+
+	char indexFileName[256];
+	if( !getIndexFileName( fileName, indexFileName, ARRAY_SIZE( indexFileName ) ) || ( mf_Open( indexFileName, &file ) < 0 ) ) {
+		return -2;
+	}
+
+	if( file.size < sizeof( SpriteSheetIndexHeader ) ) {
+		llog( LOG_ERROR, "Sprite sheet index %s is too small.", indexFileName );
+		goto clean_up;
+	}
+
+	const SpriteSheetIndexHeader* header = (const SpriteSheetIndexHeader*)file.data;
+	if( ( header->magic != SPRITE_SHEET_INDEX_MAGIC ) || ( header->version != SPRITE_SHEET_INDEX_VERSION ) ) {
+		llog( LOG_ERROR, "Sprite sheet index %s is not a supported version.", indexFileName );
+		goto clean_up;
+	}
+
+	size_t pagesSize = sizeof( SpriteSheetIndexPage ) * (size_t)header->numPages;
+	size_t rectsSize = sizeof( SpriteSheetIndexRect ) * (size_t)header->numSprites;
+	size_t rectsOffset = sizeof( SpriteSheetIndexHeader ) + pagesSize;
+	size_t stringsOffset = rectsOffset + rectsSize;
+	if( ( pagesSize > ( file.size - sizeof( SpriteSheetIndexHeader ) ) ) || ( rectsSize > ( file.size - rectsOffset ) ) ||
+		( header->stringsSize == 0 ) || ( header->stringsSize > ( file.size - stringsOffset ) ) ) {
+		llog( LOG_ERROR, "Sprite sheet index %s is truncated.", indexFileName );
+		goto clean_up;
+	}
+
+	const SpriteSheetIndexPage* pages = (const SpriteSheetIndexPage*)( file.data + sizeof( SpriteSheetIndexHeader ) );
+	const SpriteSheetIndexRect* rects = (const SpriteSheetIndexRect*)( file.data + rectsOffset );
+	const char* strings = (const char*)( file.data + stringsOffset );
+	if( strings[header->stringsSize - 1] != 0 ) {
+		llog( LOG_ERROR, "Sprite sheet index %s has bad strings.", indexFileName );
+		goto clean_up;
+	}
+
+	int numPages = (int)header->numPages;
+	pageNames = mem_Allocate( sizeof( pageNames[0] ) * numPages );
+	if( ( numPages > 0 ) && ( pageNames == NULL ) ) {
+		llog( LOG_ERROR, "Unable to allocate memory for sprite sheet %s.", indexFileName );
+		goto clean_up;
+	}
+	for( int i = 0; i < numPages; ++i ) {
+		if( pages[i].imageNameOffset >= header->stringsSize ) {
+			llog( LOG_ERROR, "Sprite sheet index %s has a bad page name.", indexFileName );
+			goto clean_up;
+		}
+		pageNames[i] = strings + pages[i].imageNameOffset;
+	}
+
+	int count = (int)header->numSprites;
+	mins = mem_Allocate( sizeof( mins[0] ) * 2 * count );
+	ids = mem_Allocate( sizeof( ids[0] ) * count );
+	layouts = mem_Allocate( sizeof( layouts[0] ) * count );
+	if( ( count > 0 ) && ( ( mins == NULL ) || ( ids == NULL ) || ( layouts == NULL ) ) ) {
+		llog( LOG_ERROR, "Unable to allocate memory for sprite sheet %s.", indexFileName );
+		goto clean_up;
+	}
+	Vector2* maxes = mins + count;
+
+	for( int i = 0; i < count; ++i ) {
+		if( rects[i].nameOffset >= header->stringsSize ) {
+			llog( LOG_ERROR, "Sprite sheet index %s has a bad sprite name.", indexFileName );
+			goto clean_up;
+		}
+		ids[i] = (char*)( strings + rects[i].nameOffset );
+		mins[i].x = (float)rects[i].x;
+		mins[i].y = (float)rects[i].y;
+		maxes[i].x = (float)( rects[i].x + rects[i].w );
+		maxes[i].y = (float)( rects[i].y + rects[i].h );
+		layouts[i].page = (int)rects[i].page;
+		layouts[i].trimPos.x = (float)rects[i].trimX;
+		layouts[i].trimPos.y = (float)rects[i].trimY;
+		layouts[i].sourceSize.x = (float)rects[i].sourceW;
+		layouts[i].sourceSize.y = (float)rects[i].sourceH;
+		layouts[i].rotated = ( rects[i].flags & SSRF_ROTATED ) != 0;
+
+		if( ( layouts[i].page < 0 ) || ( layouts[i].page >= numPages ) || ( ( i > 0 ) && ( layouts[i].page < layouts[i - 1].page ) ) ) {
+			llog( LOG_ERROR, "Sprite sheet index %s has sprites with bad pages.", indexFileName );
+			goto clean_up;
+		}
+	}
+
+	returnVal = createSprites( indexFileName, pageNames, numPages, count, shaderType, mins, maxes, ids, layouts, imgOutArray );
+
+clean_up:
+	mem_Release( mins );
+	mem_Release( ids );
+	mem_Release( layouts );
+	mem_Release( (void*)pageNames );
+	mf_Close( &file );
+
+	return returnVal;
+}
+
 /*
 This opens up the sprite sheet file and loads all the images, putting the ids into imgOutArray. The returned array
  uses the stretchy buffer file, so you can use that to find the size, but you shouldn't do anything that modifies
- the size of it.
+ the size of it. If the binary index for the sprite sheet exists that's used instead of the text definition, if the
+ index is corrupt or from an older version the text definition is loaded instead.
  Returns the number of images loaded if it was successful, otherwise returns -1.
 */
 int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArray )
 {
+	int indexResult = loadSpriteSheetIndex( fileName, shaderType, imgOutArray );
+	if( indexResult != -2 ) {
+		return indexResult;
+	}
+
 	int returnVal = 0;
 	Vector2* sbMins = NULL;
 	Vector2* sbMaxes = NULL;
 	char** sbIDs = NULL;
+	SpriteLayout* sbLayouts = NULL;
+	const char** sbPageNames = NULL;
 	char* fileText = NULL;
 
 	char buffer[512];
@@ -47,7 +266,12 @@ int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArra
 	//  image file name
 	//  spriteID rect.x rect.y rect.w rect.h
 	//  final blank line
-	int version;
+	// format version 3
+	//  number of pages
+	//  image file name for each page
+	//  spriteID page rect.x rect.y rect.w rect.h trimX trimY sourceW sourceH rotated
+	int version = 0;
+	int numPages = 0;
 	int numSpritesRead = 0;
 
 	ReadState currentState = RS_VERSION;
@@ -64,38 +288,42 @@ int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArra
 
 	const char* delim = "\r\n";
 	char* line = strtok( fileText, delim );
-	char* fileNameLoc;
 	char* idEndLoc;
 	char* rectStart;
-	char workingBuffer[256] = { 0 };
 	size_t idLen;
 	char* id;
 	Vector2 min, max;
+	SpriteLayout layout;
 
 	// now go through individual lines, parsing stuff as necessary
 	while( line != NULL ) {
 		switch( currentState ) {
 		case RS_VERSION:
 			version = SDL_strtol( line, NULL, 10 );
-			currentState = RS_FILENAME;
+			if( version >= SPRITE_SHEET_TEXT_VERSION ) {
+				currentState = RS_PAGE_COUNT;
+			} else {
+				numPages = 1;
+				currentState = RS_FILENAME;
+			}
+			break;
+		case RS_PAGE_COUNT:
+			numPages = SDL_strtol( line, NULL, 10 );
+			currentState = ( numPages > 0 ) ? RS_FILENAME : RS_SPRITES;
 			break;
 		case RS_FILENAME:
-			// assuming the file name will be local the .ss file, so we need to rip the directory off it and
-			//  append the file name to it
-			// line will be the file name for the image, attempt to create the texture
-			SDL_strlcpy( workingBuffer, fileName, ARRAY_SIZE( workingBuffer ) );
-			fileNameLoc = SDL_strrchr( workingBuffer, '/' );
-
-			if( fileNameLoc != NULL ) {
-				++fileNameLoc;
-				(*fileNameLoc) = 0; // move the null terminator
-				SDL_strlcat( workingBuffer, line, ARRAY_SIZE( workingBuffer ) );
+			// line will be the file name for the image of the page, the lines are used in place
+			sb_Push( sbPageNames, line );
+			if( sb_Count( sbPageNames ) >= (size_t)numPages ) {
+				currentState = RS_SPRITES;
 			}
-			currentState = RS_SPRITES;
 			break;
 		case RS_SPRITES:
 			// id
 			idEndLoc = SDL_strchr( line, ' ' );
+			if( idEndLoc == NULL ) {
+				break;
+			}
 			idLen = (uintptr_t)idEndLoc - (uintptr_t)line + 1;
 			id = mem_Allocate( idLen );
 			SDL_strlcpy( id, line, idLen );
@@ -104,17 +332,33 @@ int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArra
 
 			rectStart = idEndLoc + 1;
 
+			layout.page = 0;
+			if( version >= SPRITE_SHEET_TEXT_VERSION ) {
+				layout.page = SDL_strtol( rectStart, &rectStart, 10 );
+			}
+
 			// x, y, w, h
 			min.x = (float)SDL_strtol( rectStart, &rectStart, 10 );
-			++rectStart;
 			min.y = (float)SDL_strtol( rectStart, &rectStart, 10 );
-			++rectStart;
 			max.x = min.x + ( (float)SDL_strtol( rectStart, &rectStart, 10 ) );
-			++rectStart;
 			max.y = min.y + ( (float)SDL_strtol( rectStart, &rectStart, 10 ) );
 
+			if( version >= SPRITE_SHEET_TEXT_VERSION ) {
+				layout.trimPos.x = (float)SDL_strtol( rectStart, &rectStart, 10 );
+				layout.trimPos.y = (float)SDL_strtol( rectStart, &rectStart, 10 );
+				layout.sourceSize.x = (float)SDL_strtol( rectStart, &rectStart, 10 );
+				layout.sourceSize.y = (float)SDL_strtol( rectStart, &rectStart, 10 );
+				layout.rotated = SDL_strtol( rectStart, &rectStart, 10 ) != 0;
+			} else {
+				layout.trimPos = VEC2_ZERO;
+				layout.sourceSize.x = max.x - min.x;
+				layout.sourceSize.y = max.y - min.y;
+				layout.rotated = false;
+			}
+
 			sb_Push( sbMins, min );
 			sb_Push( sbMaxes, max );
+			sb_Push( sbLayouts, layout );
 
 			++numSpritesRead;
 
@@ -123,24 +367,23 @@ int img_LoadSpriteSheet( char* fileName, ShaderType shaderType, int** imgOutArra
 		line = strtok( NULL, delim );
 	}
 
-	sb_Add( *imgOutArray, numSpritesRead );
-
-	// now go through and create all the images
-	if( img_SplitImageFile( workingBuffer, numSpritesRead, shaderType, sbMins, sbMaxes, sbIDs, ( *imgOutArray ) ) < 0 ) {
-		sb_Release( *imgOutArray );
+	if( sb_Count( sbPageNames ) != (size_t)numPages ) {
 		returnVal = -1;
-		llog( LOG_ERROR, "Problem splitting image for sprite sheet definition file: %s", fileName );
+		llog( LOG_ERROR, "Sprite sheet definition file %s is missing pages.", fileName );
 		goto clean_up;
 	}
 
-	returnVal = numSpritesRead;
+	// now go through and create all the images
+	returnVal = createSprites( fileName, sbPageNames, numPages, numSpritesRead, shaderType, sbMins, sbMaxes, sbIDs, sbLayouts, imgOutArray );
 
 clean_up:
 
+	sb_Release( sbPageNames );
 	sb_Release( fileText );
 
 	sb_Release( sbMins );
 	sb_Release( sbMaxes );
+	sb_Release( sbLayouts );
 	for( size_t i = 0; i < sb_Count( sbIDs ); ++i ) {
 		mem_Release( sbIDs[i] );
 	}
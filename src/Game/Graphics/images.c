@@ -8,12 +8,14 @@
 
 #include "../Math/matrix4.h"
 #include "gfxUtil.h"
+#include "cookedTexture.h"
 #include "../System/platformLog.h"
 #include "../Math/mathUtil.h"
 
 #include "../System/jobQueue.h"
 #include "../System/jobRingQueue.h"
 #include "../System/memory.h"
+#include "../System/assetManager.h"
 
 #include "../Utils/hashMap.h"
 
@@ -23,14 +25,17 @@
 enum {
 	IMGFLAG_IN_USE = 0x1,
 	IMGFLAG_HAS_TRANSPARENCY = 0x2,
+	IMGFLAG_ROTATED = 0x4, // stored rotated 90 degrees clockwise in the texture
 };
 
 typedef struct {
 	GLuint textureObj;
 	Vector2 uvMin;
 	Vector2 uvMax;
-	Vector2 size;
+	Vector2 size; // size of the part of the texture that's drawn
+	Vector2 sourceSize; // size of the image before any clear border was trimmed off, what img_GetSize gives
 	Vector2 offset;
+	Vector2 trimOffset; // moves the trimmed part to where it was in the original image, added to the offset
 	int flags;
 	int packageID;
 	int nextInPackage;
@@ -92,12 +97,12 @@ int img_Init( void )
 }
 
 /*
-Finds the first unused image index.
+Finds the first unused image index at or after start.
  Returns a postive value on success, a negative on failure.
 */
-static int findAvailableImageIndex( )
+static int findAvailableImageIndexFrom( int start )
 {
-	int newIdx = 0;
+	int newIdx = start;
 
 	while( ( newIdx < MAX_IMAGES ) && ( images[newIdx].flags & IMGFLAG_IN_USE ) ) {
 		++newIdx;
@@ -110,6 +115,15 @@ static int findAvailableImageIndex( )
 	return newIdx;
 }
 
+/*
+Finds the first unused image index.
+ Returns a postive value on success, a negative on failure.
+*/
+static int findAvailableImageIndex( )
+{
+	return findAvailableImageIndexFrom( 0 );
+}
+
 /*
 Loads the image stored at file name.
  Returns the index of the image on success.
@@ -141,7 +155,9 @@ int img_Load( const char* fileName, ShaderType shaderType )
 	images[newIdx].textureObj = texture.textureID;
 	images[newIdx].size.v[0] = (float)texture.width;
 	images[newIdx].size.v[1] = (float)texture.height;
+	images[newIdx].sourceSize = images[newIdx].size;
 	images[newIdx].offset = VEC2_ZERO;
+	images[newIdx].trimOffset = VEC2_ZERO;
 	images[newIdx].packageID = -1;
 	images[newIdx].flags = IMGFLAG_IN_USE;
 	images[newIdx].nextInPackage = -1;
@@ -176,7 +192,9 @@ int img_CreateFromLoadedImage( LoadedImage* loadedImg, ShaderType shaderType, co
 	images[newIdx].textureObj = texture.textureID;
 	images[newIdx].size.v[0] = (float)texture.width;
 	images[newIdx].size.v[1] = (float)texture.height;
+	images[newIdx].sourceSize = images[newIdx].size;
 	images[newIdx].offset = VEC2_ZERO;
+	images[newIdx].trimOffset = VEC2_ZERO;
 	images[newIdx].packageID = -1;
 	images[newIdx].flags = IMGFLAG_IN_USE;
 	images[newIdx].nextInPackage = -1;
@@ -207,7 +225,9 @@ int img_CreateFromTexture( Texture* texture, ShaderType shaderType, const char*
 	images[newIdx].textureObj = texture->textureID;
 	images[newIdx].size.v[0] = (float)texture->width;
 	images[newIdx].size.v[1] = (float)texture->height;
+	images[newIdx].sourceSize = images[newIdx].size;
 	images[newIdx].offset = VEC2_ZERO;
+	images[newIdx].trimOffset = VEC2_ZERO;
 	images[newIdx].packageID = -1;
 	images[newIdx].flags = IMGFLAG_IN_USE;
 	images[newIdx].nextInPackage = -1;
@@ -228,112 +248,133 @@ int img_CreateFromTexture( Texture* texture, ShaderType shaderType, const char*
 typedef struct {
 	char* fileName;
 	ShaderType shaderType;
-	int* outIdx;
 	LoadedImage loadedImage;
+	CookedImage cookedImage;
+	bool isCooked;
 } ThreadedLoadImageData;
 
-static void bindImageJob( void* data )
+static int imageAssetType = -1;
+
+static void* createImageLoad( const char* fileName, const void* params )
 {
+	ThreadedLoadImageData* data = mem_Allocate( sizeof( ThreadedLoadImageData ) );
 	if( data == NULL ) {
-		llog( LOG_INFO, "No data, unable to bind." );
-		return;
+		llog( LOG_WARN, "Unable to create data for threaded image load for file %s", fileName );
+		return NULL;
 	}
 
-	ThreadedLoadImageData* loadData = (ThreadedLoadImageData*)data;
+	size_t fileNameSize = strlen( fileName ) + 1;
+	data->fileName = mem_Allocate( fileNameSize );
+	if( data->fileName == NULL ) {
+		llog( LOG_WARN, "Unable to create file name storage for threaded image load for file %s", fileName );
+		mem_Release( data );
+		return NULL;
+	}
+	SDL_strlcpy( data->fileName, fileName, fileNameSize );
 
-	(*(loadData->outIdx)) = -1;
+	data->shaderType = *( (const ShaderType*)params );
+	data->loadedImage.data = NULL;
+	memset( &( data->cookedImage ), 0, sizeof( data->cookedImage ) );
+	data->isCooked = false;
+
+	return data;
+}
 
-	if( loadData->loadedImage.data == NULL ) {
-		llog( LOG_INFO, "Failed to load image %s", loadData->fileName );
-		goto clean_up;
+static bool loadImageJob( void* data )
+{
+	ThreadedLoadImageData* loadData = (ThreadedLoadImageData*)data;
+
+	// use the cooked version of the image if there is one and it's up to date, it doesn't need to be decoded
+	char cookedFileName[512];
+	if( ctex_GetCookedFileName( loadData->fileName, cookedFileName, sizeof( cookedFileName ) ) ) {
+		if( ctex_IsStale( cookedFileName, loadData->fileName ) ) {
+			llog( LOG_WARN, "Cooked texture %s is older than %s, loading the image instead. Run the TextureCooker to update it.", cookedFileName, loadData->fileName );
+		} else if( ctex_Load( cookedFileName, &( loadData->cookedImage ) ) >= 0 ) {
+			loadData->isCooked = true;
+			return true;
+		}
 	}
 
-	// find the first empty spot, make sure we won't go over our maximum
-	int newIdx = findAvailableImageIndex( );
-	if( newIdx < 0 ) {
-		llog( LOG_INFO, "Unable to bind image %s! Image storage full.", loadData->fileName );
-		goto clean_up;
+	return ( gfxUtil_LoadImage( loadData->fileName, &( loadData->loadedImage ) ) >= 0 );
+}
+
+static int bindImageJob( void* data )
+{
+	ThreadedLoadImageData* loadData = (ThreadedLoadImageData*)data;
+
+	int newIdx = -1;
+	if( loadData->isCooked ) {
+		Texture texture;
+		if( ctex_CreateTexture( &( loadData->cookedImage ), &texture ) >= 0 ) {
+			newIdx = img_CreateFromTexture( &texture, loadData->shaderType, NULL );
+			if( newIdx < 0 ) {
+				gfxUtil_UnloadTexture( &texture );
+			}
+		}
+	} else {
+		newIdx = img_CreateFromLoadedImage( &( loadData->loadedImage ), loadData->shaderType, NULL );
 	}
 
-	Texture texture;
-	if( gfxUtil_CreateTextureFromLoadedImage( GL_RGBA, &( loadData->loadedImage ), &texture ) < 0 ) {
+	if( newIdx < 0 ) {
 		llog( LOG_INFO, "Unable to bind image %s!", loadData->fileName );
-		goto clean_up;
 	}
 
-	images[newIdx].textureObj = texture.textureID;
-	images[newIdx].size.v[0] = (float)texture.width;
-	images[newIdx].size.v[1] = (float)texture.height;
-	images[newIdx].offset = VEC2_ZERO;
-	images[newIdx].packageID = -1;
-	images[newIdx].flags = IMGFLAG_IN_USE;
-	images[newIdx].nextInPackage = -1;
-	images[newIdx].uvMin = VEC2_ZERO;
-	images[newIdx].uvMax = VEC2_ONE;
-	images[newIdx].shaderType = loadData->shaderType;
-	if( texture.flags & TF_IS_TRANSPARENT ) {
-		images[newIdx].flags |= IMGFLAG_HAS_TRANSPARENCY;
-	}
-	(*(loadData->outIdx)) = newIdx;
+	return newIdx;
+}
 
-	llog( LOG_INFO, "Setting outIdx to %i", newIdx );
+static void destroyImageLoad( void* data )
+{
+	ThreadedLoadImageData* loadData = (ThreadedLoadImageData*)data;
 
-clean_up:
 	gfxUtil_ReleaseLoadedImage( &( loadData->loadedImage ) );
+	ctex_Release( &( loadData->cookedImage ) );
 	mem_Release( loadData->fileName );
 	mem_Release( loadData );
 }
 
-static void loadImageJob( void* data )
+// Registers images with the asset manager the first time it's needed.
+static int getImageAssetType( void )
 {
-	if( data == NULL ) {
-		llog( LOG_INFO, "No data, unable to load." );
-		return;
+	if( imageAssetType < 0 ) {
+		AssetLoader loader;
+		loader.create = createImageLoad;
+		loader.load = loadImageJob;
+		loader.bind = bindImageJob;
+		loader.destroy = destroyImageLoad;
+		loader.unload = img_Clean;
+		loader.paramsSize = sizeof( ShaderType );
+		loader.usesGPU = true;
+		imageAssetType = asset_RegisterType( &loader );
 	}
 
-	ThreadedLoadImageData* loadData = (ThreadedLoadImageData*)data;
-	// will worry about handling a bad load when we get back to the main thread
-	gfxUtil_LoadImage( loadData->fileName, &( loadData->loadedImage ) );
-
-	// binding needs to be done on the main thread
-	jq_AddMainThreadJob( bindImageJob, data );
+	return imageAssetType;
 }
 
 /*
-Loads the image in a seperate thread. Puts the resulting image index into outIdx.
- Returns -1 if there was an issue, 0 otherwise.
+Requests the image be loaded on a job thread, the texture is created on the main thread by asset_ProcessUploads.
+ Use asset_Get with the handle to get the image index, it will return the placeholder set for images until the image
+ is ready. Release the handle with asset_Release when it's no longer needed.
 */
-void img_ThreadedLoad( const char* fileName, ShaderType shaderType, int* outIdx )
+AssetHandle img_ThreadedLoad( const char* fileName, ShaderType shaderType, AssetPriority priority )
 {
 	assert( fileName != NULL );
 
-	// set it to something that won't draw anything
-	(*outIdx) = -1;
-
-	// this isn't something that should be happening all the time, so allocating and freeing
-	//  should be fine, if we want to do continous streaming it would probably be better to
-	//  make a specialty queue for it
-	ThreadedLoadImageData* data = mem_Allocate( sizeof( ThreadedLoadImageData ) );
-	if( data == NULL ) {
-		llog( LOG_WARN, "Unable to create data for threaded image load for file %s", fileName );
-		return;
-	}
-
-	size_t fileNameLen = strlen( fileName );
-	data->fileName = mem_Allocate( fileNameLen + 1 );
-	if( data->fileName == NULL ) {
-		llog( LOG_WARN, "Unable to create file name storage for threaded image lead for fle %s", fileName );
-		mem_Release( data );
-		return;
+	int type = getImageAssetType( );
+	if( type < 0 ) {
+		return INVALID_ASSET_HANDLE;
 	}
-	SDL_strlcpy( data->fileName, fileName, fileNameLen );
 
-	data->shaderType = shaderType;
-	data->outIdx = outIdx;
-	data->loadedImage.data = NULL;
+	return asset_Request( type, fileName, &shaderType, priority );
+}
 
-	if( !jq_AddJob( loadImageJob, data ) ) {
-		mem_Release( data );
+/*
+Sets the image asset_Get returns for images loaded with img_ThreadedLoad until they're ready.
+*/
+void img_SetThreadedLoadPlaceholder( int placeholderIdx )
+{
+	int type = getImageAssetType( );
+	if( type >= 0 ) {
+		asset_SetPlaceholder( type, placeholderIdx );
 	}
 }
 
@@ -359,7 +400,9 @@ int img_Create( SDL_Surface* surface, ShaderType shaderType, const char* id )
 	} else {
 		images[newIdx].size.v[0] = (float)texture.width;
 		images[newIdx].size.v[1] = (float)texture.height;
+		images[newIdx].sourceSize = images[newIdx].size;
 		images[newIdx].offset = VEC2_ZERO;
+		images[newIdx].trimOffset = VEC2_ZERO;
 		images[newIdx].packageID = -1;
 		images[newIdx].flags = IMGFLAG_IN_USE;
 		images[newIdx].nextInPackage = -1;
@@ -417,6 +460,8 @@ void img_Clean( int idx )
 		glDeleteTextures( 1, &( images[idx].textureObj ) );
 	}
 	images[idx].size = VEC2_ZERO;
+	images[idx].sourceSize = VEC2_ZERO;
+	images[idx].trimOffset = VEC2_ZERO;
 	images[idx].flags = 0;
 	images[idx].packageID = -1;
 	images[idx].nextInPackage = -1;
@@ -450,8 +495,21 @@ int split( Texture* texture, int packageID, ShaderType shaderType, int count, Ve
 	inverseSize.x = 1.0f / (float)texture->width;
 	inverseSize.y = 1.0f / (float)texture->height;
 
+	// add all the ids at once so the map only has to grow once
+	if( imgIDs != NULL ) {
+		size_t keyBytes = 0;
+		for( int i = 0; i < count; ++i ) {
+			if( imgIDs[i] != NULL ) {
+				keyBytes += SDL_strlen( imgIDs[i] ) + 1;
+			}
+		}
+		hashMap_Reserve( &imgIDMap, (size_t)count, keyBytes );
+	}
+
+	// everything before the last index we used is in use, so there's no need to search through it again
+	int newIdx = -1;
 	for( int i = 0; i < count; ++i ) {
-		int newIdx = findAvailableImageIndex( );
+		newIdx = findAvailableImageIndexFrom( newIdx + 1 );
 		if( newIdx < 0 ) {
 			llog( LOG_ERROR, "Problem finding available image to split into." );
 			img_CleanPackage( packageID );
@@ -460,7 +518,9 @@ int split( Texture* texture, int packageID, ShaderType shaderType, int count, Ve
 
 		images[newIdx].textureObj = texture->textureID;
 		vec2_Subtract( &( maxes[i] ), &( mins[i] ), &( images[newIdx].size ) );
+		images[newIdx].sourceSize = images[newIdx].size;
 		images[newIdx].offset = VEC2_ZERO;
+		images[newIdx].trimOffset = VEC2_ZERO;
 		images[newIdx].packageID = packageID;
 		images[newIdx].flags = IMGFLAG_IN_USE;
 		vec2_HadamardProd( &( mins[i] ), &inverseSize, &( images[newIdx].uvMin ) );
@@ -570,6 +630,49 @@ void img_SetOffset( int idx, Vector2 offset )
 	images[idx].offset = offset;
 }
 
+/*
+Sets the size the image had before the SpriteSheetGenerator trimmed the clear border off of it, and where the top-left
+ of what's left was in it. img_GetSize will give the source size and draws will place the trimmed part where it was in
+ the original image, so the image acts as if it was never trimmed.
+*/
+void img_SetTrim( int idx, Vector2 trimPos, Vector2 sourceSize )
+{
+	assert( idx < MAX_IMAGES );
+	assert( idx >= 0 );
+
+	if( ( idx < 0 ) || ( !( images[idx].flags & IMGFLAG_IN_USE ) ) || ( idx >= MAX_IMAGES ) ) {
+		return;
+	}
+
+	images[idx].sourceSize = sourceSize;
+	images[idx].trimOffset.x = trimPos.x + ( ( images[idx].size.x - sourceSize.x ) * 0.5f );
+	images[idx].trimOffset.y = trimPos.y + ( ( images[idx].size.y - sourceSize.y ) * 0.5f );
+}
+
+/*
+Marks the image as being stored rotated 90 degrees clockwise in its texture, the SpriteSheetGenerator does this when it
+ packs better. The size is swapped back to the size of the image before it was rotated. Clears any trim, so
+ img_SetTrim has to be called after this.
+*/
+void img_SetRotatedInTexture( int idx )
+{
+	assert( idx < MAX_IMAGES );
+	assert( idx >= 0 );
+
+	if( ( idx < 0 ) || ( !( images[idx].flags & IMGFLAG_IN_USE ) ) || ( idx >= MAX_IMAGES ) ) {
+		return;
+	}
+
+	if( !( images[idx].flags & IMGFLAG_ROTATED ) ) {
+		images[idx].flags |= IMGFLAG_ROTATED;
+		float temp = images[idx].size.x;
+		images[idx].size.x = images[idx].size.y;
+		images[idx].size.y = temp;
+		images[idx].sourceSize = images[idx].size;
+		images[idx].trimOffset = VEC2_ZERO;
+	}
+}
+
 #include "../Utils/helpers.h"
 void img_ForceTransparency( int idx, bool transparent )
 {
@@ -588,7 +691,8 @@ void img_ForceTransparency( int idx, bool transparent )
 }
 
 /*
-Gets the size of the image, putting it into the out Vector2. Returns a negative number if there's an issue.
+Gets the size of the image, putting it into the out Vector2. For trimmed sprites this is the size before the trim.
+ Returns a negative number if there's an issue.
 */
 int img_GetSize( int idx, Vector2* out )
 {
@@ -598,7 +702,7 @@ int img_GetSize( int idx, Vector2* out )
 		return -1;
 	}
 
-	(*out) = images[idx].size;
+	(*out) = images[idx].sourceSize;
 	return 0;
 }
 
@@ -618,6 +722,30 @@ int img_GetTextureID( int idx, GLuint* out )
 	return 0;
 }
 
+/*
+Gets everything needed to draw the image as a quad directly through the triangle renderer, used when drawing a lot of
+ simple images where going through the draw instructions would be too much overhead.
+ Returns a negative number if there's an issue.
+*/
+int img_GetQuadData( int idx, ImageQuadData* out )
+{
+	assert( out != NULL );
+
+	if( ( idx < 0 ) || ( idx >= MAX_IMAGES ) || ( !( images[idx].flags & IMGFLAG_IN_USE ) ) ) {
+		return -1;
+	}
+
+	out->textureObj = images[idx].textureObj;
+	out->shaderType = images[idx].shaderType;
+	out->transparent = ( images[idx].flags & IMGFLAG_HAS_TRANSPARENCY ) != 0;
+	out->size = images[idx].size;
+	vec2_Add( &( images[idx].offset ), &( images[idx].trimOffset ), &( out->offset ) );
+	out->uvMin = images[idx].uvMin;
+	out->uvMax = images[idx].uvMax;
+	out->rotated = ( images[idx].flags & IMGFLAG_ROTATED ) != 0;
+	return 0;
+}
+
 // Retrieves a loaded image by it's id, for images loaded from files this will be the local path, for sprite sheet images 
 int img_GetExistingByID( const char* id )
 {
@@ -628,6 +756,35 @@ int img_GetExistingByID( const char* id )
 	return idx;
 }
 
+/*
+Sets the uvs for each corner of the draw, corners are in the order top-left, bottom-left, top-right, bottom-right.
+*/
+static void setDrawUVs( DrawInstruction* ri, const Image* img )
+{
+	if( img->flags & IMGFLAG_ROTATED ) {
+		// the top-left of the image is at the top-right of where it's stored
+		ri->uvs[0].x = img->uvMax.x;
+		ri->uvs[0].y = img->uvMin.y;
+
+		ri->uvs[1] = img->uvMin;
+
+		ri->uvs[2] = img->uvMax;
+
+		ri->uvs[3].x = img->uvMin.x;
+		ri->uvs[3].y = img->uvMax.y;
+	} else {
+		ri->uvs[0] = img->uvMin;
+
+		ri->uvs[1].x = img->uvMin.x;
+		ri->uvs[1].y = img->uvMax.y;
+
+		ri->uvs[2].x = img->uvMax.x;
+		ri->uvs[2].y = img->uvMin.y;
+
+		ri->uvs[3] = img->uvMax;
+	}
+}
+
 /*
 initializes the structure so only what's used needs to be set, also fill in
   some stuff that all of the queueRenderImage functions use, returns the pointer
@@ -666,8 +823,8 @@ static DrawInstruction* GetNextRenderInstruction( int imgObj, uint32_t camFlags,
 	ri->end.color = CLR_WHITE;
 	ri->start.rotation = 0.0f;
 	ri->end.rotation = 0.0f;
-	ri->start.offset = images[imgObj].offset;
-	ri->end.offset = images[imgObj].offset;
+	vec2_Add( &( images[imgObj].offset ), &( images[imgObj].trimOffset ), &( ri->start.offset ) );
+	ri->end.offset = ri->start.offset;
 	ri->start.floatVal0 = 0.0f;
 	ri->end.floatVal0 = 0.0f;
 	ri->flags = images[imgObj].flags;
@@ -676,17 +833,7 @@ static DrawInstruction* GetNextRenderInstruction( int imgObj, uint32_t camFlags,
 	ri->depth = depth;
 	ri->stencilID = -1;
 	ri->isStencil = false;
-	memcpy( ri->uvs, DEFAULT_DRAW_INSTRUCTION.uvs, sizeof( ri->uvs ) );
-
-	ri->uvs[0] = images[imgObj].uvMin;
-
-	ri->uvs[1].x = images[imgObj].uvMin.x;
-	ri->uvs[1].y = images[imgObj].uvMax.y;
-
-	ri->uvs[2].x = images[imgObj].uvMax.x;
-	ri->uvs[2].y = images[imgObj].uvMin.y;
-
-	ri->uvs[3] = images[imgObj].uvMax;
+	setDrawUVs( ri, &( images[imgObj] ) );
 
 	return ri;
 }
@@ -723,8 +870,8 @@ int img_CreateDraw( int imgID, uint32_t camFlags, Vector2 startPos, Vector2 endP
 	ri->end.color = CLR_WHITE;
 	ri->start.rotation = 0.0f;
 	ri->end.rotation = 0.0f;
-	ri->start.offset = images[imgID].offset;
-	ri->end.offset = images[imgID].offset;
+	vec2_Add( &( images[imgID].offset ), &( images[imgID].trimOffset ), &( ri->start.offset ) );
+	ri->end.offset = ri->start.offset;
 	ri->start.floatVal0 = 0.0f;
 	ri->end.floatVal0 = 0.0f;
 	ri->flags = images[imgID].flags;
@@ -733,17 +880,7 @@ int img_CreateDraw( int imgID, uint32_t camFlags, Vector2 startPos, Vector2 endP
 	ri->depth = depth;
 	ri->stencilID = -1;
 	ri->isStencil = false;
-	memcpy( ri->uvs, DEFAULT_DRAW_INSTRUCTION.uvs, sizeof( ri->uvs ) );
-
-	ri->uvs[0] = images[imgID].uvMin;
-
-	ri->uvs[1].x = images[imgID].uvMin.x;
-	ri->uvs[1].y = images[imgID].uvMax.y;
-
-	ri->uvs[2].x = images[imgID].uvMax.x;
-	ri->uvs[2].y = images[imgID].uvMin.y;
-
-	ri->uvs[3] = images[imgID].uvMax;
+	setDrawUVs( ri, &( images[imgID] ) );
 
 	return lastDrawInstruction;
 }
@@ -843,14 +980,19 @@ void img_SetDrawSize( int drawID, Vector2 start, Vector2 end )
 		return;
 	}
 
-	// reset the size
+	// reset the size, the size is for the whole image so trimmed sprites are scaled by how much of it they cover
+	Image* img = &( images[renderBuffer[drawID].imageObj] );
+	Vector2 trimScale;
+	trimScale.x = img->size.x / img->sourceSize.x;
+	trimScale.y = img->size.y / img->sourceSize.y;
+
 	Vector2 startScale;
-	startScale.x = start.x / renderBuffer[drawID].start.scaledSize.x;
-	startScale.y = start.y / renderBuffer[drawID].start.scaledSize.y;
+	startScale.x = ( start.x * trimScale.x ) / renderBuffer[drawID].start.scaledSize.x;
+	startScale.y = ( start.y * trimScale.y ) / renderBuffer[drawID].start.scaledSize.y;
 
 	Vector2 endScale;
-	endScale.x = start.x / renderBuffer[drawID].end.scaledSize.x;
-	endScale.y = start.y / renderBuffer[drawID].end.scaledSize.y;
+	endScale.x = ( end.x * trimScale.x ) / renderBuffer[drawID].end.scaledSize.x;
+	endScale.y = ( end.y * trimScale.y ) / renderBuffer[drawID].end.scaledSize.y;
 
 	img_SetDrawScaleV( drawID, startScale, endScale );
 }
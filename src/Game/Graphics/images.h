@@ -8,14 +8,31 @@
 #include "color.h"
 #include "triRendering.h"
 #include "gfxUtil.h"
+#include "../System/assetManager.h"
+
+typedef struct {
+	GLuint textureObj;
+	ShaderType shaderType;
+	bool transparent;
+	Vector2 size; // size of the quad to draw, for trimmed sprites this is smaller than img_GetSize
+	Vector2 offset; // includes the offset that puts trimmed sprites where they were in the original image
+	Vector2 uvMin;
+	Vector2 uvMax;
+	bool rotated; // stored rotated 90 degrees clockwise between uvMin and uvMax
+} ImageQuadData;
 
 // Initializes images.
 //  Returns < 0 on an error.
 int img_Init( void );
 
 //************ Threaded functions
-// Loads the image in a seperate thread. Puts the resulting image index into outIdx.
-void img_ThreadedLoad( const char* fileName, ShaderType shaderType, int* outIdx );
+// Requests the image be loaded on a job thread, the texture is created on the main thread by asset_ProcessUploads.
+//  Use asset_Get with the handle to get the image index, it will return the placeholder set for images until the image
+//  is ready. Release the handle with asset_Release when it's no longer needed.
+AssetHandle img_ThreadedLoad( const char* fileName, ShaderType shaderType, AssetPriority priority );
+
+// Sets the image asset_Get returns for images loaded with img_ThreadedLoad until they're ready.
+void img_SetThreadedLoadPlaceholder( int placeholderIdx );
 
 //************ End threaded functions
 
@@ -54,15 +71,30 @@ void img_CleanPackage( int packageID );
 // Sets an offset to render the image from. The default is the center of the image.
 void img_SetOffset( int idx, Vector2 offset );
 
+// Sets the size the image had before the SpriteSheetGenerator trimmed the clear border off of it, and where the top-left
+//  of what's left was in it. The image is then sized and drawn as if it was never trimmed.
+void img_SetTrim( int idx, Vector2 trimPos, Vector2 sourceSize );
+
+// Marks the image as being stored rotated 90 degrees clockwise in its texture, the SpriteSheetGenerator does this when it
+//  packs better. The size is swapped back to the size of the image before it was rotated. Clears any trim, so
+//  img_SetTrim has to be called after this.
+void img_SetRotatedInTexture( int idx );
+
 void img_ForceTransparency( int idx, bool transparent );
 
-// Gets the size of the image, putting it into the out Vector2. Returns a negative number if there's an issue.
+// Gets the size of the image, putting it into the out Vector2. For trimmed sprites this is the size before the trim.
+//  Returns a negative number if there's an issue.
 int img_GetSize( int idx, Vector2* out );
 
 // Gets the texture id for the image, used if you need to render it directly instead of going through this.
 //  Returns whether out was successfully set or not.
 int img_GetTextureID( int idx, GLuint* out );
 
+// Gets everything needed to draw the image as a quad directly through the triangle renderer, used when drawing a lot of
+//  simple images where going through the draw instructions would be too much overhead.
+//  Returns a negative number if there's an issue.
+int img_GetQuadData( int idx, ImageQuadData* out );
+
 // Retrieves a loaded image by it's id, for images loaded from files this will be the local path, for sprite sheet images 
 int img_GetExistingByID( const char* id );
 
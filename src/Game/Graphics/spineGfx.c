@@ -1,20 +1,31 @@
 #include "spineGfx.h"
 
 #include <assert.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <spine/extension.h>
 
 #include "triRendering.h"
 #include "debugRendering.h"
 #include "gfxUtil.h"
+#include "camera.h"
 #include "../Utils/helpers.h"
+#include "../Utils/stretchyBuffer.h"
+#include "../Math/mathUtil.h"
 #include "../System/memory.h"
 #include "../System/platformLog.h"
+#include "../System/jobQueue.h"
 
 // templates
 typedef struct {
 	spSkeletonData* skeletonData;
 	spAtlas* atlas;
 	spAnimationStateData* stateData;
+
+	// skeletons and animation states from cleaned up instances, reset and reused by new instances
+	spSkeleton** sbFreeSkeletons;
+	spAnimationState** sbFreeStates;
 } SpineTemplate;
 
 #define MAX_TEMPLATES 256
@@ -29,15 +40,81 @@ typedef struct {
 	spSkeleton* skeleton;
 	spAnimationState* state;
 	int8_t depth;
+
+	// level of detail, the world transform is only recalculated when the animation is updated, so the vertices are
+	//  offset by how far the instance has moved since then
+	Vector2 transformPos;
+	Vector2 drawPos;
+	bool boundsValid;
+	Vector2 boundsMin; // relative to drawPos, from the last time it was drawn
+	Vector2 boundsMax;
+	float pendingDT;
+	bool alwaysUpdate;
+	int poseCache;
+	float poseCacheTime;
+
+	// what to do during the current update
+	bool animateThisUpdate;
+	bool appliedOnMain;
+	float updateDT;
 } SpineInstance;
 
 #define MAX_INSTANCES 2048
 static SpineInstance instances[MAX_INSTANCES];
-static int lastInstance = -1;
+
+// unused instance slots, used as a stack
+static int freeInstances[MAX_INSTANCES];
+static int numFreeInstances = 0;
+
+// slots that are in use, kept sorted so instances are always processed and drawn in the same order
+static int activeInstances[MAX_INSTANCES];
+static int numActiveInstances = 0;
 
 // working memory
-#define MAX_SPINE_VERTS 1000
-static float spineVertices[MAX_SPINE_VERTS];
+//  updating and rendering is split into batches of instances that are run across the job queue, each batch has its own
+//  scratch memory so nothing is shared between threads, the triangles are then submitted in order on the main thread
+typedef struct {
+	TriVert verts[3];
+	GLuint texture;
+	TriType type;
+	uint32_t camFlags;
+	int8_t depth;
+} SpineTri;
+
+typedef struct {
+	float* sbWorldVerts;
+	SpineTri* sbTris;
+} SpineDrawBatch;
+
+#define MAX_DRAW_BATCHES 64
+#define MIN_INSTANCES_PER_BATCH 16
+static SpineDrawBatch drawBatches[MAX_DRAW_BATCHES];
+
+// level of detail
+static SpineLODSettings lodSettings = { 0.5f, 0.05f, 1.0f / 15.0f };
+
+typedef struct {
+	uint32_t flags;
+	Matrix4 vpMat;
+} CullCamera;
+
+#define MAX_CULL_CAMERAS 32
+static CullCamera cullCameras[MAX_CULL_CAMERAS];
+static int numCullCameras = 0;
+
+// baked poses
+typedef struct {
+	int templateIdx;
+	int bonesCount;
+	int frameCount;
+	float framesPerSecond;
+	float duration;
+	float* transforms; // POSE_FLOATS_PER_BONE for each bone for each frame
+} SpinePoseCache;
+
+#define POSE_FLOATS_PER_BONE 6
+#define MAX_POSE_CACHES 64
+static SpinePoseCache poseCaches[MAX_POSE_CACHES];
 
 // helper functions
 // these have to be not static
@@ -103,13 +180,19 @@ void spine_Init( void )
 {
 	memset( templates, 0, sizeof( templates ) );
 	memset( instances, 0, sizeof( instances ) );
+	memset( poseCaches, 0, sizeof( poseCaches ) );
 
 	_setMalloc( Allocate_Spine );
 	_setFree( Release_Spine );
 
 	spBone_setYDown( 1 );
 
-	lastInstance = -1;
+	// push in reverse so the lowest slots are used first
+	numFreeInstances = 0;
+	for( int i = MAX_INSTANCES - 1; i >= 0; --i ) {
+		freeInstances[numFreeInstances++] = i;
+	}
+	numActiveInstances = 0;
 }
 
 void spine_CleanEverything( void )
@@ -118,21 +201,85 @@ void spine_CleanEverything( void )
 	for( int i = 0; i < MAX_TEMPLATES; ++i ) {
 		spine_CleanTemplate( i );
 	}
+
+	for( int i = 0; i < MAX_DRAW_BATCHES; ++i ) {
+		sb_Release( drawBatches[i].sbWorldVerts );
+		sb_Release( drawBatches[i].sbTris );
+	}
 }
 
 // template handling
+// returns true if the json has been modified since the binary was exported, if either can't be found, like when
+//  they're packed into the apk on Android, we assume the binary is fine
+static bool isBinarySkeletonStale( const char* binaryFileName, const char* jsonFileName )
+{
+	struct stat binaryStat;
+	struct stat jsonStat;
+	if( ( stat( binaryFileName, &binaryStat ) != 0 ) || ( stat( jsonFileName, &jsonStat ) != 0 ) ) {
+		return false;
+	}
+
+	return ( jsonStat.st_mtime > binaryStat.st_mtime );
+}
+
+// prefers the binary export if there is one, it's smaller and can be read without building the whole json document
+//  in memory first, falls back to the json if there's no binary, it couldn't be read, or the json is newer than it
+static spSkeletonData* loadSkeletonData( spAtlas* atlas, const char* fileNameBase )
+{
+	char fileName[256];
+	char jsonFileName[256];
+	spSkeletonData* skeletonData = NULL;
+
+	SDL_snprintf( fileName, sizeof( fileName ), "%s.skel", fileNameBase );
+	SDL_snprintf( jsonFileName, sizeof( jsonFileName ), "%s.json", fileNameBase );
+	int length = 0;
+	char* data = NULL;
+	if( isBinarySkeletonStale( fileName, jsonFileName ) ) {
+		llog( LOG_WARN, "Binary skeleton %s is older than %s, loading the json instead. Run tools/bakeSpine.bat to update it.", fileName, jsonFileName );
+	} else {
+		data = _spUtil_readFile( fileName, &length );
+	}
+	if( data != NULL ) {
+		spSkeletonBinary* binary = spSkeletonBinary_create( atlas );
+		if( binary != NULL ) {
+			binary->scale = 1.0f;
+			skeletonData = spSkeletonBinary_readSkeletonData( binary, (const unsigned char*)data, length );
+			if( skeletonData == NULL ) {
+				llog( LOG_WARN, "Unable to read binary skeleton %s, trying json: %s", fileName, binary->error );
+			}
+			spSkeletonBinary_dispose( binary );
+		}
+		mem_Release( data );
+
+		if( skeletonData != NULL ) {
+			return skeletonData;
+		}
+	}
+
+	spSkeletonJson* json = spSkeletonJson_create( atlas );
+	if( json == NULL ) {
+		llog( LOG_DEBUG, "Unable to create skeleton JSON for %s", fileNameBase );
+		return NULL;
+	}
+
+	json->scale = 1.0f;
+	skeletonData = spSkeletonJson_readSkeletonDataFile( json, jsonFileName );
+	spSkeletonJson_dispose( json );
+
+	return skeletonData;
+}
+
 /*
 Loads a set of spine files. Assumes there's three files: fileNameBase.json, fileNameBase.atlas, and fileNameBase.png.
-The template is created from these three files.
+ If there's a fileNameBase.skel binary export it will be used instead of the json, tools/bakeSpine.bat will create them.
+ If the json has been modified more recently than the binary the json is used and a warning is logged.
+The template is created from these files.
 Returns the index of the template if the loading was successfull, -1 if it was not.
 TODO: Get this working with direct from memory for Android.
 */
 int spine_LoadTemplate( const char* fileNameBase )
 {
 	char atlasName[256];
-	char pngName[256];
-	char jsonName[256];
-	spSkeletonJson* json;
 
 	int idx;
 	for( idx = 0; ( templates[idx].skeletonData != NULL ) && ( idx < MAX_TEMPLATES ); ++idx ) ;
@@ -141,8 +288,6 @@ int spine_LoadTemplate( const char* fileNameBase )
 	}
 
 	SDL_snprintf( atlasName, sizeof( atlasName ), "%s.atlas", fileNameBase );
-	SDL_snprintf( jsonName, sizeof( jsonName ), "%s.json", fileNameBase );
-	SDL_snprintf( pngName, sizeof( pngName ), "%s.png", fileNameBase );
 
 	templates[idx].atlas = spAtlas_createFromFile( atlasName, 0 );
 	if( templates[idx].atlas == NULL ) {
@@ -150,20 +295,7 @@ int spine_LoadTemplate( const char* fileNameBase )
 		return -1;
 	}
 
-	json = spSkeletonJson_create( templates[idx].atlas );
-	if( json == NULL ) {
-		llog( LOG_DEBUG, "Unable to create skeleton JSON for %s", fileNameBase );
-
-		spAtlas_dispose( templates[idx].atlas );
-		templates[idx].atlas = NULL;
-
-		return -1;
-	}
-
-	json->scale = 1.0f;
-
-	templates[idx].skeletonData = spSkeletonJson_readSkeletonDataFile( json, jsonName );
-	spSkeletonJson_dispose( json );
+	templates[idx].skeletonData = loadSkeletonData( templates[idx].atlas, fileNameBase );
 	if( templates[idx].skeletonData == NULL ) {
 		llog( LOG_DEBUG, "Unable to create skeleton data for %s", fileNameBase );
 
@@ -172,7 +304,6 @@ int spine_LoadTemplate( const char* fileNameBase )
 
 		return -1;
 	}
-	
 
 	templates[idx].stateData = spAnimationStateData_create( templates[idx].skeletonData );
 	if( templates[idx].stateData == NULL ) {
@@ -199,6 +330,15 @@ void spine_CleanTemplate( int idx )
 	assert( idx >= 0 );
 	assert( idx < MAX_TEMPLATES );
 
+	for( size_t i = 0; i < sb_Count( templates[idx].sbFreeStates ); ++i ) {
+		spAnimationState_dispose( templates[idx].sbFreeStates[i] );
+	}
+	sb_Release( templates[idx].sbFreeStates );
+	for( size_t i = 0; i < sb_Count( templates[idx].sbFreeSkeletons ); ++i ) {
+		spSkeleton_dispose( templates[idx].sbFreeSkeletons[i] );
+	}
+	sb_Release( templates[idx].sbFreeSkeletons );
+
 	if( templates[idx].stateData != NULL ) {
 		spAnimationStateData_dispose( templates[idx].stateData );
 		templates[idx].stateData = NULL;
@@ -212,8 +352,14 @@ void spine_CleanTemplate( int idx )
 		templates[idx].atlas = NULL;
 	}
 
-	for( int i = 0; i < lastInstance; ++i ) {
-		if( ( instances[i].templateIdx == idx ) &&  ( instances[i].skeleton != NULL ) ) {
+	for( int i = 0; i < MAX_POSE_CACHES; ++i ) {
+		if( ( poseCaches[i].transforms != NULL ) && ( poseCaches[i].templateIdx == idx ) ) {
+			spine_CleanPoseCache( i );
+		}
+	}
+
+	for( int i = 0; i < numActiveInstances; ++i ) {
+		if( instances[activeInstances[i]].templateIdx == idx ) {
 			llog( LOG_ERROR, "Found a spine instance using a freed template." );
 		}
 	}
@@ -259,35 +405,151 @@ Creates an instance of a template. The templateIdx passed in should be a value r
  hasn't been cleaned up.
 Returns an id to use in other functions. Returns -1 if there's a problem.
 */
-int spine_CreateInstance( int templateIdx, Vector2 pos, int cameraFlags, char depth, spAnimationStateListener listener, void* object )
+// finds where the slot is or should go in the sorted active list
+static int findActiveIndex( int idx )
 {
-	int idx;
-	for( idx = 0; ( instances[idx].skeleton != NULL ) && ( idx < MAX_INSTANCES ); ++idx ) ;
-	if( idx >= MAX_INSTANCES ) {
-		return -1;
+	int low = 0;
+	int high = numActiveInstances;
+	while( low < high ) {
+		int mid = ( low + high ) / 2;
+		if( activeInstances[mid] < idx ) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
 	}
+	return low;
+}
 
-	if( idx >= lastInstance ) {
-		lastInstance = idx;
-	}
+static void addActiveInstance( int idx )
+{
+	int pos = findActiveIndex( idx );
+	memmove( &( activeInstances[pos + 1] ), &( activeInstances[pos] ), sizeof( activeInstances[0] ) * ( numActiveInstances - pos ) );
+	activeInstances[pos] = idx;
+	++numActiveInstances;
+}
 
-	SpineInstance* charState = &( instances[idx] );
+static void removeActiveInstance( int idx )
+{
+	int pos = findActiveIndex( idx );
+	assert( ( pos < numActiveInstances ) && ( activeInstances[pos] == idx ) );
+	memmove( &( activeInstances[pos] ), &( activeInstances[pos + 1] ), sizeof( activeInstances[0] ) * ( numActiveInstances - pos - 1 ) );
+	--numActiveInstances;
+}
 
-	charState->skeleton = spSkeleton_create( templates[templateIdx].skeletonData );
-	if( charState->skeleton == NULL ) {
+// gets a skeleton and animation state for the template, reusing pooled ones if there are any
+static bool acquireSkeleton( int templateIdx, spSkeleton** outSkeleton, spAnimationState** outState )
+{
+	SpineTemplate* spineTemplate = &( templates[templateIdx] );
+
+	if( sb_Count( spineTemplate->sbFreeSkeletons ) > 0 ) {
+		assert( sb_Count( spineTemplate->sbFreeSkeletons ) == sb_Count( spineTemplate->sbFreeStates ) );
+		(*outSkeleton) = sb_Pop( spineTemplate->sbFreeSkeletons );
+		(*outState) = sb_Pop( spineTemplate->sbFreeStates );
+		return true;
+	}
+
+	(*outSkeleton) = spSkeleton_create( spineTemplate->skeletonData );
+	if( (*outSkeleton) == NULL ) {
 		llog( LOG_ERROR, "Unable to create skeleton." );
-		return -1;
+		return false;
 	}
 
-	charState->state = spAnimationState_create( templates[templateIdx].stateData );
-	if( charState->state == NULL ) {
+	(*outState) = spAnimationState_create( spineTemplate->stateData );
+	if( (*outState) == NULL ) {
 		llog( LOG_ERROR, "Unable to create animation state." );
 
-		spSkeleton_dispose( charState->skeleton );
-		charState->skeleton = NULL;
+		spSkeleton_dispose( (*outSkeleton) );
+		(*outSkeleton) = NULL;
+
+		return false;
+	}
+
+	return true;
+}
+
+// resets the skeleton and animation state back to how they were when created and puts them in the template's pool
+// removes the state listener and the listeners on every track entry, including queued and mixing ones
+static void clearListeners( spAnimationState* state )
+{
+	state->listener = NULL;
+
+	for( int i = 0; i < state->tracksCount; ++i ) {
+		for( spTrackEntry* entry = state->tracks[i]; entry != NULL; entry = entry->next ) {
+			for( spTrackEntry* from = entry; from != NULL; from = from->mixingFrom ) {
+				from->listener = NULL;
+			}
+		}
+	}
+}
+
+static void releaseSkeleton( int templateIdx, spSkeleton* skeleton, spAnimationState* state )
+{
+	SpineTemplate* spineTemplate = &( templates[templateIdx] );
+
+	// clearing the tracks sends end and dispose events, nothing should be listening anymore
+	clearListeners( state );
+	state->rendererObject = NULL;
+	spAnimationState_clearTracks( state );
+	state->timeScale = 1.0f;
+
+	spSkeleton_setSkin( skeleton, NULL );
+	skeleton->r = skeleton->g = skeleton->b = skeleton->a = 1.0f;
+	skeleton->time = 0.0f;
+	skeleton->flipX = 0;
+	skeleton->flipY = 0;
+	spSkeleton_setToSetupPose( skeleton );
+
+	sb_Push( spineTemplate->sbFreeSkeletons, skeleton );
+	sb_Push( spineTemplate->sbFreeStates, state );
+}
+
+/*
+Creates skeletons for the template ahead of time so creating up to count instances won't have to allocate them.
+ Useful before spawning a lot of instances at once.
+*/
+void spine_ReserveInstances( int templateIdx, int count )
+{
+	assert( templateIdx >= 0 );
+	assert( templateIdx < MAX_TEMPLATES );
+
+	SpineTemplate* spineTemplate = &( templates[templateIdx] );
+	if( spineTemplate->skeletonData == NULL ) {
+		llog( LOG_WARN, "Attempting to reserve instances for a template that doesn't exist." );
+		return;
+	}
+
+	while( (int)sb_Count( spineTemplate->sbFreeSkeletons ) < count ) {
+		spSkeleton* skeleton = spSkeleton_create( spineTemplate->skeletonData );
+		spAnimationState* state = spAnimationState_create( spineTemplate->stateData );
+		if( ( skeleton == NULL ) || ( state == NULL ) ) {
+			llog( LOG_ERROR, "Unable to create skeleton to reserve." );
+			if( state != NULL ) spAnimationState_dispose( state );
+			if( skeleton != NULL ) spSkeleton_dispose( skeleton );
+			return;
+		}
+
+		spSkeleton_setToSetupPose( skeleton );
+		sb_Push( spineTemplate->sbFreeSkeletons, skeleton );
+		sb_Push( spineTemplate->sbFreeStates, state );
+	}
+}
+
+int spine_CreateInstance( int templateIdx, Vector2 pos, int cameraFlags, char depth, spAnimationStateListener listener, void* object )
+{
+	if( numFreeInstances <= 0 ) {
+		return -1;
+	}
 
+	int idx = freeInstances[numFreeInstances - 1];
+	SpineInstance* charState = &( instances[idx] );
+
+	if( !acquireSkeleton( templateIdx, &( charState->skeleton ), &( charState->state ) ) ) {
 		return -1;
 	}
+
+	--numFreeInstances;
+	addActiveInstance( idx );
 	
 	charState->startPos = pos;
 	charState->endPos = pos;
@@ -305,11 +567,19 @@ int spine_CreateInstance( int templateIdx, Vector2 pos, int cameraFlags, char de
 	charState->cameraFlags = cameraFlags;
 	charState->depth = depth;
 
+	charState->transformPos = pos;
+	charState->drawPos = pos;
+	charState->boundsValid = false;
+	charState->pendingDT = 0.0f;
+	charState->alwaysUpdate = false;
+	charState->poseCache = -1;
+	charState->poseCacheTime = 0.0f;
+
 	return idx;
 }
 
 /*
-Cleans up a spine instance.
+Cleans up a spine instance. The skeleton is reset and kept by the template to be reused by the next instance created.
 */
 void spine_CleanInstance( int idx )
 {
@@ -322,15 +592,13 @@ void spine_CleanInstance( int idx )
 		return;
 	}
 
-	spAnimationState_dispose( charState->state );
-	spSkeleton_dispose( charState->skeleton );
+	releaseSkeleton( charState->templateIdx, charState->skeleton, charState->state );
 
 	charState->state = NULL;
 	charState->skeleton = NULL;
 
-	for( int i = lastInstance; ( i >= 0 ) && ( instances[idx].skeleton != NULL ); --i ) {
-		lastInstance = i;
-	}
+	removeActiveInstance( idx );
+	freeInstances[numFreeInstances++] = idx;
 }
 
 /*
@@ -338,8 +606,8 @@ Cleans up all instances.
 */
 void spine_CleanAllInstances( void )
 {
-	for( int i = 0; i < MAX_INSTANCES; ++i ) {
-		spine_CleanInstance( i );
+	while( numActiveInstances > 0 ) {
+		spine_CleanInstance( activeInstances[numActiveInstances - 1] );
 	}
 }
 
@@ -364,12 +632,9 @@ Flips the positions used for rendering the instances.
 */
 void spine_FlipInstancePositions( void )
 {
-	for( int i = 0; i <= lastInstance; ++i ) {
-		if( instances[i].skeleton == NULL ) {
-			continue;
-		}
-		
-		instances[i].startPos = instances[i].endPos;
+	for( int i = 0; i < numActiveInstances; ++i ) {
+		SpineInstance* instance = &( instances[activeInstances[i]] );
+		instance->startPos = instance->endPos;
 	}
 }
 
@@ -398,32 +663,384 @@ spAnimationState* spine_GetInstanceAnimState( int idx )
 	return instances[idx].state;
 }
 
+// batch size to use so jq_ParallelFor never has to adjust it, that way the batch index can be found from the start index
+static int instanceBatchSize( int count )
+{
+	int batchSize = ( count + MAX_DRAW_BATCHES - 1 ) / MAX_DRAW_BATCHES;
+	return MAX( batchSize, MIN_INSTANCES_PER_BATCH );
+}
+
+// whether anything will be called back when the animation state is updated or applied
+static bool hasListeners( spAnimationState* state )
+{
+	if( state->listener != NULL ) {
+		return true;
+	}
+
+	for( int i = 0; i < state->tracksCount; ++i ) {
+		for( spTrackEntry* entry = state->tracks[i]; entry != NULL; entry = entry->next ) {
+			for( spTrackEntry* from = entry; from != NULL; from = from->mixingFrom ) {
+				if( from->listener != NULL ) {
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+static void applyAnimation( SpineInstance* instance, float dt )
+{
+	spSkeleton_update( instance->skeleton, dt );
+	spAnimationState_update( instance->state, dt );
+	spAnimationState_apply( instance->state, instance->skeleton );
+}
+
+// copies the bone transforms for the current frame out of the cache, used instead of applying the animation
+static void applyPoseCache( SpineInstance* instance, float dt )
+{
+	SpinePoseCache* cache = &( poseCaches[instance->poseCache] );
+	assert( cache->bonesCount == instance->skeleton->bonesCount );
+
+	instance->poseCacheTime += dt;
+	if( cache->duration > 0.0f ) {
+		instance->poseCacheTime = fmodf( instance->poseCacheTime, cache->duration );
+	}
+
+	int frame = ( (int)( instance->poseCacheTime * cache->framesPerSecond ) ) % cache->frameCount;
+	float* transform = cache->transforms + ( frame * cache->bonesCount * POSE_FLOATS_PER_BONE );
+	for( int i = 0; i < cache->bonesCount; ++i ) {
+		spBone* bone = instance->skeleton->bones[i];
+		CONST_CAST( float, bone->a ) = transform[0];
+		CONST_CAST( float, bone->b ) = transform[1];
+		CONST_CAST( float, bone->c ) = transform[2];
+		CONST_CAST( float, bone->d ) = transform[3];
+		CONST_CAST( float, bone->worldX ) = transform[4];
+		CONST_CAST( float, bone->worldY ) = transform[5];
+		transform += POSE_FLOATS_PER_BONE;
+	}
+
+	// the poses were baked at the origin
+	instance->transformPos = VEC2_ZERO;
+}
+
+static void updateInstancesJob( void* data, int start, int end )
+{
+	for( int i = start; i < end; ++i ) {
+		SpineInstance* instance = &( instances[activeInstances[i]] );
+		if( !instance->animateThisUpdate ) {
+			continue;
+		}
+
+		if( instance->poseCache >= 0 ) {
+			applyPoseCache( instance, instance->updateDT );
+			continue;
+		}
+
+		if( !instance->appliedOnMain ) {
+			applyAnimation( instance, instance->updateDT );
+		}
+		spSkeleton_updateWorldTransform( instance->skeleton );
+		instance->transformPos.x = instance->skeleton->x;
+		instance->transformPos.y = instance->skeleton->y;
+	}
+}
+
+// grabs the view projection matrices for all the active cameras so the instances can be tested against them
+static void gatherCullCameras( void )
+{
+	numCullCameras = 0;
+	for( int currCamera = cam_StartIteration( ); ( currCamera != -1 ) && ( numCullCameras < MAX_CULL_CAMERAS ); currCamera = cam_GetNextActiveCam( ) ) {
+		cullCameras[numCullCameras].flags = cam_GetFlags( currCamera );
+		cam_GetVPMatrix( currCamera, &( cullCameras[numCullCameras].vpMat ) );
+		++numCullCameras;
+	}
+}
+
+// how often the instance should be updated based on how large it is on screen, 0 is every update and a negative value
+//  is never
+static float instanceUpdateInterval( SpineInstance* instance )
+{
+	if( instance->alwaysUpdate || !instance->boundsValid ) {
+		return 0.0f;
+	}
+
+	bool visible = false;
+	float screenSize = 0.0f;
+	for( int c = 0; c < numCullCameras; ++c ) {
+		if( !( cullCameras[c].flags & instance->cameraFlags ) ) {
+			continue;
+		}
+
+		// find the bounds in clip space
+		Vector2 corners[4];
+		corners[0].x = instance->boundsMin.x; corners[0].y = instance->boundsMin.y;
+		corners[1].x = instance->boundsMax.x; corners[1].y = instance->boundsMin.y;
+		corners[2].x = instance->boundsMin.x; corners[2].y = instance->boundsMax.y;
+		corners[3].x = instance->boundsMax.x; corners[3].y = instance->boundsMax.y;
+
+		Vector2 clipMin = { INFINITY, INFINITY };
+		Vector2 clipMax = { -INFINITY, -INFINITY };
+		for( int i = 0; i < 4; ++i ) {
+			Vector2 clip;
+			vec2_Add( &( corners[i] ), &( instance->endPos ), &( corners[i] ) );
+			mat4_TransformVec2Pos( &( cullCameras[c].vpMat ), &( corners[i] ), &clip );
+			clipMin.x = MIN( clipMin.x, clip.x );
+			clipMin.y = MIN( clipMin.y, clip.y );
+			clipMax.x = MAX( clipMax.x, clip.x );
+			clipMax.y = MAX( clipMax.y, clip.y );
+		}
+
+		if( ( clipMax.x < -1.0f ) || ( clipMin.x > 1.0f ) || ( clipMax.y < -1.0f ) || ( clipMin.y > 1.0f ) ) {
+			continue;
+		}
+
+		// clip space is two units across
+		visible = true;
+		screenSize = MAX( screenSize, MAX( clipMax.x - clipMin.x, clipMax.y - clipMin.y ) * 0.5f );
+	}
+
+	if( !visible ) {
+		return lodSettings.offscreenUpdateInterval;
+	}
+
+	if( screenSize < lodSettings.smallScreenSize ) {
+		return lodSettings.smallUpdateInterval;
+	}
+
+	return 0.0f;
+}
+
 /*
 Updates all the instance animations.
+ Anything with a listener is updated on the calling thread so the listeners are never called from another thread, the
+ rest of the work is spread across the job queue. Instances that are off screen or small are updated less often based
+ on the level of detail settings.
 */
 void spine_UpdateInstances( float dt )
 {
-	for( int i = 0; i <= lastInstance; ++i ) {
-		if( instances[i].skeleton == NULL ) {
+	int count = numActiveInstances;
+	if( count <= 0 ) {
+		return;
+	}
+
+	gatherCullCameras( );
+
+	for( int i = 0; i < count; ++i ) {
+		SpineInstance* instance = &( instances[activeInstances[i]] );
+
+		// time keeps building up until the instance is updated, so it stays in sync when it becomes visible again, unless
+		//  it's never going to be updated where it is, then it's paused instead so there's no huge jump when it comes back
+		float interval = instanceUpdateInterval( instance );
+		instance->pendingDT = ( interval >= 0.0f ) ? ( instance->pendingDT + dt ) : 0.0f;
+		instance->animateThisUpdate = ( interval >= 0.0f ) && ( instance->pendingDT >= interval );
+		instance->appliedOnMain = false;
+		if( !instance->animateThisUpdate ) {
 			continue;
 		}
 
-		SpineInstance* instance = &( instances[i] );
+		instance->updateDT = instance->pendingDT;
+		instance->pendingDT = 0.0f;
 
-		spSkeleton_update( instance->skeleton, dt );
-		spAnimationState_update( instance->state, dt );
-		spAnimationState_apply( instance->state, instance->skeleton );
-		spSkeleton_updateWorldTransform( instance->skeleton );
+		if( ( instance->poseCache < 0 ) && hasListeners( instance->state ) ) {
+			applyAnimation( instance, instance->updateDT );
+			instance->appliedOnMain = true;
+		}
+	}
+
+	jq_ParallelFor( updateInstancesJob, NULL, count, instanceBatchSize( count ) );
+}
+
+/*
+Sets how the instances are updated based on what they look like on screen.
+*/
+void spine_SetLODSettings( const SpineLODSettings* settings )
+{
+	assert( settings != NULL );
+	lodSettings = (*settings);
+}
+
+void spine_GetLODSettings( SpineLODSettings* outSettings )
+{
+	assert( outSettings != NULL );
+	(*outSettings) = lodSettings;
+}
+
+/*
+Makes the instance ignore the level of detail settings and update every time.
+*/
+void spine_SetInstanceAlwaysUpdate( int id, bool alwaysUpdate )
+{
+	assert( id >= 0 );
+	assert( id < MAX_INSTANCES );
+
+	instances[id].alwaysUpdate = alwaysUpdate;
+}
+
+/*
+Samples a looping animation and stores the bone transforms for every frame.
+ Returns the index of the cache, -1 if there was a problem.
+*/
+int spine_BakePoseCache( int templateIdx, const char* animationName, float framesPerSecond )
+{
+	assert( templateIdx >= 0 );
+	assert( templateIdx < MAX_TEMPLATES );
+	assert( animationName != NULL );
+	assert( framesPerSecond > 0.0f );
+
+	SpineTemplate* spineTemplate = &( templates[templateIdx] );
+	if( spineTemplate->skeletonData == NULL ) {
+		llog( LOG_WARN, "Attempting to bake a pose cache for a template that doesn't exist." );
+		return -1;
+	}
+
+	int idx;
+	for( idx = 0; ( idx < MAX_POSE_CACHES ) && ( poseCaches[idx].transforms != NULL ); ++idx ) ;
+	if( idx >= MAX_POSE_CACHES ) {
+		llog( LOG_ERROR, "No free spine pose caches." );
+		return -1;
+	}
+
+	spAnimation* animation = spSkeletonData_findAnimation( spineTemplate->skeletonData, animationName );
+	if( animation == NULL ) {
+		llog( LOG_WARN, "Unable to find animation %s to bake.", animationName );
+		return -1;
+	}
+
+	spSkeleton* skeleton = spSkeleton_create( spineTemplate->skeletonData );
+	spAnimationState* state = spAnimationState_create( spineTemplate->stateData );
+	if( ( skeleton == NULL ) || ( state == NULL ) ) {
+		llog( LOG_ERROR, "Unable to create skeleton to bake animation %s.", animationName );
+		if( state != NULL ) spAnimationState_dispose( state );
+		if( skeleton != NULL ) spSkeleton_dispose( skeleton );
+		return -1;
+	}
+
+	SpinePoseCache* cache = &( poseCaches[idx] );
+	cache->templateIdx = templateIdx;
+	cache->bonesCount = skeleton->bonesCount;
+	cache->framesPerSecond = framesPerSecond;
+	cache->duration = animation->duration;
+	cache->frameCount = MAX( 1, (int)ceilf( animation->duration * framesPerSecond ) );
+	cache->transforms = mem_Allocate( sizeof( cache->transforms[0] ) * POSE_FLOATS_PER_BONE * cache->bonesCount * cache->frameCount );
+	if( cache->transforms == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate pose cache for animation %s.", animationName );
+		spAnimationState_dispose( state );
+		spSkeleton_dispose( skeleton );
+		return -1;
+	}
+
+	skeleton->x = 0.0f;
+	skeleton->y = 0.0f;
+	spSkeleton_setToSetupPose( skeleton );
+	spAnimationState_setAnimation( state, 0, animation, 1 );
+
+	float* transform = cache->transforms;
+	for( int f = 0; f < cache->frameCount; ++f ) {
+		if( f > 0 ) {
+			spAnimationState_update( state, 1.0f / framesPerSecond );
+		}
+		spAnimationState_apply( state, skeleton );
+		spSkeleton_updateWorldTransform( skeleton );
+
+		for( int i = 0; i < cache->bonesCount; ++i ) {
+			spBone* bone = skeleton->bones[i];
+			transform[0] = bone->a;
+			transform[1] = bone->b;
+			transform[2] = bone->c;
+			transform[3] = bone->d;
+			transform[4] = bone->worldX;
+			transform[5] = bone->worldY;
+			transform += POSE_FLOATS_PER_BONE;
+		}
+	}
+
+	spAnimationState_dispose( state );
+	spSkeleton_dispose( skeleton );
+
+	return idx;
+}
+
+/*
+Cleans up a pose cache, any instances using it go back to using their animation state.
+*/
+void spine_CleanPoseCache( int cacheIdx )
+{
+	assert( cacheIdx >= 0 );
+	assert( cacheIdx < MAX_POSE_CACHES );
+
+	for( int i = 0; i < numActiveInstances; ++i ) {
+		if( instances[activeInstances[i]].poseCache == cacheIdx ) {
+			instances[activeInstances[i]].poseCache = -1;
+		}
+	}
+
+	mem_Release( poseCaches[cacheIdx].transforms );
+	memset( &( poseCaches[cacheIdx] ), 0, sizeof( poseCaches[cacheIdx] ) );
+}
+
+/*
+Sets the instance to use a baked pose cache instead of its animation state, pass in -1 to go back to the animation state.
+*/
+void spine_SetInstancePoseCache( int id, int cacheIdx )
+{
+	assert( id >= 0 );
+	assert( id < MAX_INSTANCES );
+	assert( cacheIdx < MAX_POSE_CACHES );
+
+	SpineInstance* instance = &( instances[id] );
+	if( instance->skeleton == NULL ) {
+		return;
+	}
+
+	if( cacheIdx >= 0 ) {
+		if( ( poseCaches[cacheIdx].transforms == NULL ) || ( poseCaches[cacheIdx].templateIdx != instance->templateIdx ) ) {
+			llog( LOG_WARN, "Attempting to use an invalid pose cache for a spine instance." );
+			return;
+		}
+	}
+
+	instance->poseCache = cacheIdx;
+	instance->poseCacheTime = 0.0f;
+}
+
+static void addTri( SpineDrawBatch* batch, TriVert* verts, Texture* texture, SpineInstance* spine )
+{
+	// move the vertices to where the instance is now instead of where it was when the world transform was calculated
+	Vector2 offset;
+	vec2_Subtract( &( spine->drawPos ), &( spine->transformPos ), &offset );
+
+	SpineTri* tri = sb_Add( batch->sbTris, 1 );
+	for( int i = 0; i < 3; ++i ) {
+		tri->verts[i] = verts[i];
+		vec2_Add( &( tri->verts[i].pos ), &offset, &( tri->verts[i].pos ) );
+
+		Vector2 local;
+		vec2_Subtract( &( tri->verts[i].pos ), &( spine->drawPos ), &local );
+		if( spine->boundsValid ) {
+			spine->boundsMin.x = MIN( spine->boundsMin.x, local.x );
+			spine->boundsMin.y = MIN( spine->boundsMin.y, local.y );
+			spine->boundsMax.x = MAX( spine->boundsMax.x, local.x );
+			spine->boundsMax.y = MAX( spine->boundsMax.y, local.y );
+		} else {
+			spine->boundsMin = local;
+			spine->boundsMax = local;
+			spine->boundsValid = true;
+		}
 	}
+
+	tri->texture = texture->textureID;
+	tri->type = ( texture->flags & TF_IS_TRANSPARENT ) ? TT_TRANSPARENT : TT_SOLID;
+	tri->camFlags = spine->cameraFlags;
+	tri->depth = spine->depth;
 }
 
-static void drawCharacter( SpineInstance* spine )
+// generates the triangles for the character and stores them in the batch, doesn't touch anything shared so it can be
+//  run on any thread
+static void drawCharacter( SpineInstance* spine, SpineDrawBatch* batch )
 {
-	// just draw bone positions to start with
-	//GLuint texture;
 	Color col;
-	int camFlags = spine->cameraFlags;
-	char depth = spine->depth;
 	Texture* texture;
 
 	for( int i = 0; i < spine->skeleton->slotsCount; ++i ) {
@@ -458,34 +1075,37 @@ static void drawCharacter( SpineInstance* spine )
 
 				texture = (Texture*)((spAtlasRegion*)regionAttachment->rendererObject)->page->rendererObject;
 
-				TriType type = ( texture->flags & TF_IS_TRANSPARENT ) ? TT_TRANSPARENT : TT_SOLID;
-				triRenderer_Add( verts[0], verts[1], verts[2], ST_DEFAULT, texture->textureID, 0.0f, -1, camFlags, depth, type );
-				triRenderer_Add( verts[0], verts[2], verts[3], ST_DEFAULT, texture->textureID, 0.0f, -1, camFlags, depth, type );
+				TriVert tri0[3] = { verts[0], verts[1], verts[2] };
+				TriVert tri1[3] = { verts[0], verts[2], verts[3] };
+				addTri( batch, tri0, texture, spine );
+				addTri( batch, tri1, texture, spine );
 			} break;
 		/*case SP_ATTACHMENT_BOUNDING_BOX: {
 				// if we're debugging 
 				spBoundingBoxAttachment* boundingBoxAttachment = (spBoundingBoxAttachment*)attachment;
-				assert( boundingBoxAttachment->verticesCount < MAX_SPINE_VERTS );
+				sb_Clear( batch->sbWorldVerts );
+				float* worldVerts = sb_Add( batch->sbWorldVerts, boundingBoxAttachment->super.worldVerticesLength );
 
-				spBoundingBoxAttachment_computeWorldVertices( boundingBoxAttachment, slot->bone, spineVertices );
+				spBoundingBoxAttachment_computeWorldVertices( boundingBoxAttachment, slot->bone, worldVerts );
 
 				for( int i = 0; i <	boundingBoxAttachment->verticesCount; ++i ) {
 					Vector2 pos0, pos1;
 					int j = ( i + 1 ) % boundingBoxAttachment->verticesCount;
-					pos0.x = spineVertices[i*2];
-					pos0.y = spineVertices[(i*2)+1];
-					pos1.x = spineVertices[j*2];
-					pos1.y = spineVertices[(j*2)+1];
+					pos0.x = worldVerts[i*2];
+					pos0.y = worldVerts[(i*2)+1];
+					pos1.x = worldVerts[j*2];
+					pos1.y = worldVerts[(j*2)+1];
 
 					dbgDraw_Line( pos0, pos1, CLR_GREEN );
 				}
 			} break;*/
 		case SP_ATTACHMENT_MESH: {
 				spMeshAttachment* meshAttachment = (spMeshAttachment*)attachment;
-				assert( meshAttachment->super.worldVerticesLength < MAX_SPINE_VERTS );
 
-				// todo: come up with a better way than just a preallocated array, possible probems when world vertices > sizeof( spineVertices )
-				spMeshAttachment_computeWorldVertices( meshAttachment, slot, spineVertices );
+				// the scratch buffer belongs to the batch, so it just grows to fit the largest mesh
+				sb_Clear( batch->sbWorldVerts );
+				float* worldVerts = sb_Add( batch->sbWorldVerts, meshAttachment->super.worldVerticesLength );
+				spMeshAttachment_computeWorldVertices( meshAttachment, slot, worldVerts );
 
 				texture = (Texture*)((spAtlasRegion*)meshAttachment->rendererObject)->page->rendererObject;
 
@@ -494,16 +1114,16 @@ static void drawCharacter( SpineInstance* spine )
 					
 					for( int j = 0; j < 3; ++j ) {
 						int baseIndex = meshAttachment->triangles[x+j] * 2;
-						verts[j].pos.x = spineVertices[baseIndex];
-						verts[j].pos.y = spineVertices[baseIndex+1];
+						verts[j].pos.x = worldVerts[baseIndex];
+						verts[j].pos.y = worldVerts[baseIndex+1];
 
-						verts[x].uv.s = meshAttachment->uvs[baseIndex];
-						verts[x].uv.t = meshAttachment->uvs[baseIndex+1];
+						verts[j].uv.s = meshAttachment->uvs[baseIndex];
+						verts[j].uv.t = meshAttachment->uvs[baseIndex+1];
+
+						verts[j].col = col;
 					}
 
-					//debugRenderer_Triangle( camFlags, verts[0], verts[1], verts[2], CLR_GREEN );
-					TriType type = ( texture->flags & TF_IS_TRANSPARENT ) ? TT_TRANSPARENT : TT_SOLID;
-					triRenderer_AddVertices( verts, ST_DEFAULT, texture->textureID, 0.0f, -1, camFlags, depth, type );
+					addTri( batch, verts, texture, spine );
 				}
 			} break;
 		default:
@@ -513,21 +1133,62 @@ static void drawCharacter( SpineInstance* spine )
 	}
 }
 
+typedef struct {
+	float normTimeElapsed;
+	int batchSize;
+} RenderJobData;
+
+static void renderInstancesJob( void* data, int start, int end )
+{
+	RenderJobData* jobData = (RenderJobData*)data;
+
+	int batchIdx = start / jobData->batchSize;
+	assert( batchIdx < MAX_DRAW_BATCHES );
+	SpineDrawBatch* batch = &( drawBatches[batchIdx] );
+
+	for( int i = start; i < end; ++i ) {
+		SpineInstance* instance = &( instances[activeInstances[i]] );
+
+		Vector2 pos;
+		vec2_Lerp( &( instance->startPos ), &( instance->endPos ), jobData->normTimeElapsed, &pos );
+		instance->skeleton->x = pos.x;
+		instance->skeleton->y = pos.y;
+		instance->drawPos = pos;
+
+		// the bounds are found as the triangles are generated
+		instance->boundsValid = false;
+		drawCharacter( instance, batch );
+	}
+}
+
 /*
 Draws all the spine instances.
+ The triangles for each batch of instances are generated across the job queue and then added to the triangle renderer
+ on this thread in instance order.
 */
 void spine_RenderInstances( float normTimeElapsed )
 {
-	for( int i = 0; i <= lastInstance; ++i ) {
-		if( instances[i].skeleton == NULL ) {
-			continue;
-		}
+	int count = numActiveInstances;
+	if( count <= 0 ) {
+		return;
+	}
 
-		Vector2 pos;
-		vec2_Lerp( &( instances[i].startPos ), &( instances[i].endPos ), normTimeElapsed, &pos );
-		instances[i].skeleton->x = pos.x;
-		instances[i].skeleton->y = pos.y;
+	RenderJobData jobData;
+	jobData.normTimeElapsed = normTimeElapsed;
+	jobData.batchSize = instanceBatchSize( count );
+	int numBatches = ( count + jobData.batchSize - 1 ) / jobData.batchSize;
+
+	for( int i = 0; i < numBatches; ++i ) {
+		sb_Clear( drawBatches[i].sbTris );
+	}
+
+	jq_ParallelFor( renderInstancesJob, &jobData, count, jobData.batchSize );
 
-		drawCharacter( &( instances[i] ) );
+	for( int i = 0; i < numBatches; ++i ) {
+		SpineDrawBatch* batch = &( drawBatches[i] );
+		for( size_t t = 0; t < sb_Count( batch->sbTris ); ++t ) {
+			SpineTri* tri = &( batch->sbTris[t] );
+			triRenderer_AddVertices( tri->verts, ST_DEFAULT, tri->texture, 0.0f, -1, tri->camFlags, tri->depth, tri->type );
+		}
 	}
-}
\ No newline at end of file
+}
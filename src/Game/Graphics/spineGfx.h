@@ -2,6 +2,7 @@
 #define SPINE_GFX_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <spine/spine.h>
 #include "../Math/vector2.h"
 #include "../Graphics/color.h"
@@ -14,7 +15,8 @@ void spine_CleanEverything( void );
 // template handling
 /*
 Loads a set of spine files. Assumes there's three files: fileNameBase.json, fileNameBase.atlas, and fileNameBase.png.
- The template is created from these three files.
+ If there's a fileNameBase.skel binary export it will be used instead of the json, tools/bakeSpine.bat will create them.
+ The template is created from these files.
  Returns the index of the template if the loading was successfull, -1 if it was not.
 */
 int spine_LoadTemplate( const char* fileNameBase );
@@ -46,10 +48,16 @@ Returns an id to use in other functions. Returns -1 if there's a problem.
 int spine_CreateInstance( int templateIdx, Vector2 pos, int cameraFlags, char depth, spAnimationStateListener listener, void* object );
 
 /*
-Cleans up a spine instance.
+Cleans up a spine instance. The skeleton is reset and kept by the template to be reused by the next instance created.
 */
 void spine_CleanInstance( int id );
 
+/*
+Creates skeletons for the template ahead of time so creating up to count instances won't have to allocate them.
+ Useful before spawning a lot of instances at once.
+*/
+void spine_ReserveInstances( int templateIdx, int count );
+
 /*
 Cleans up all instances.
 */
@@ -91,4 +99,44 @@ Draws all the spine instances.
 */
 void spine_RenderInstances( float normTimeElapsed );
 
+// level of detail
+/*
+Instances that can't be seen by any camera they're drawn to, or that are small on screen, are updated less often. Any
+ time that's skipped is added onto the next update, so animations and events stay in sync, just less smoothly. The
+ exception is a negative offscreenUpdateInterval, then instances that can't be seen are paused and lose that time.
+ The bounds used are from the last time the instance was drawn, so new instances are always updated the first time.
+*/
+typedef struct {
+	float offscreenUpdateInterval; // seconds between updates for instances no camera can see, negative to pause them until they can be seen
+	float smallScreenSize; // fraction of the screen below which an instance counts as small
+	float smallUpdateInterval; // seconds between updates for small instances
+} SpineLODSettings;
+
+void spine_SetLODSettings( const SpineLODSettings* settings );
+void spine_GetLODSettings( SpineLODSettings* outSettings );
+
+/*
+Makes the instance ignore the level of detail settings and update every time, for things like the player.
+*/
+void spine_SetInstanceAlwaysUpdate( int id, bool alwaysUpdate );
+
+/*
+Samples a looping animation of the template at framesPerSecond and stores the bone transforms for every frame.
+ Instances set to use the cache copy the bones from it instead of updating their animation state. Only the bones are
+ stored, so animations that change attachments, colors, or draw order won't look right.
+ Returns the index of the cache, -1 if there was a problem.
+*/
+int spine_BakePoseCache( int templateIdx, const char* animationName, float framesPerSecond );
+
+/*
+Cleans up a pose cache, any instances using it go back to using their animation state.
+*/
+void spine_CleanPoseCache( int cacheIdx );
+
+/*
+Sets the instance to use a pose cache baked from the same template, pass in -1 to go back to the animation state.
+ While using the cache the animation state isn't updated, so no listeners are called.
+*/
+void spine_SetInstancePoseCache( int id, int cacheIdx );
+
 #endif
\ No newline at end of file
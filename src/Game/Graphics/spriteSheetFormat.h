@@ -0,0 +1,61 @@
+#ifndef SPRITE_SHEET_FORMAT_H
+#define SPRITE_SHEET_FORMAT_H
+
+#include <stdint.h>
+
+/*
+Layout of the binary sprite sheet index written by the SpriteSheetGenerator tool alongside the text .ss file. Everything
+ is little endian and laid out so the whole file can be read or mapped in one go and used in place.
+ File layout:
+  SpriteSheetIndexHeader
+  SpriteSheetIndexPage[numPages]
+  SpriteSheetIndexRect[numSprites], grouped by page
+  stringsSize bytes of null terminated strings, the page image file names followed by the sprite names
+
+ The generator trims the clear border off of sprites, so the rect only covers what's left. trimX and trimY are where the
+ rect sits in the original image and sourceW and sourceH are the size of the original image. If SSRF_ROTATED is set the
+ sprite was stored rotated 90 degrees clockwise, w and h are always the size of the rect in the page.
+*/
+
+#define SPRITE_SHEET_INDEX_MAGIC 0x42485353 // "SSHB"
+#define SPRITE_SHEET_INDEX_VERSION 2
+#define SPRITE_SHEET_INDEX_EXTENSION ".ssb"
+
+// version of the text .ss definition that matches the index
+//  version
+//  number of pages
+//  page image file name, repeated for each page
+//  spriteName page x y w h trimX trimY sourceW sourceH rotated
+#define SPRITE_SHEET_TEXT_VERSION 3
+
+enum SpriteSheetRectFlags {
+	SSRF_ROTATED = 0x1
+};
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numPages;
+	uint32_t numSprites;
+	uint32_t stringsSize;
+} SpriteSheetIndexHeader;
+
+typedef struct {
+	uint32_t imageNameOffset; // into the strings, the image is in the same directory as the index
+} SpriteSheetIndexPage;
+
+typedef struct {
+	uint32_t nameOffset; // into the strings
+	uint32_t page;
+	uint32_t flags;
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+	int32_t trimX;
+	int32_t trimY;
+	int32_t sourceW;
+	int32_t sourceH;
+} SpriteSheetIndexRect;
+
+#endif /* inclusion guard */
@@ -38,11 +38,9 @@ So we have the vertices we transfer at the beginning of the rendering
 Once that is done we generate index buffers to represent what each camera can see
 */
 #define MAX_SOLID_TRIS 2048
-#define MAX_TRANSPARENT_TRIS 2048
+#define MAX_TRANSPARENT_TRIS 16384 // particles are transparent and there can be a lot of them
 #define MAX_STENCIL_TRIS 256
 
-#define MAX_TRIS ( MAX( MAX_SOLID_TRIS, MAX( MAX_TRANSPARENT_TRIS, MAX_STENCIL_TRIS ) ) )
-
 typedef struct {
 	//Vertex startVertices[MAX_VERTS];
 	//Vertex endVertices[MAX_VERTS];
@@ -152,7 +150,10 @@ if( isStencilTriangles ) {
 
 
 
-#define Z_ORDER_OFFSET ( 1.0f / (float)( 2 * ( MAX_TRIS + 1 ) ) )
+// solid and transparent triangles each get half of the space between depths, so the large number of transparent
+//  triangles doesn't reduce how far apart solid triangles are in the depth buffer
+#define SOLID_Z_ORDER_OFFSET ( 1.0f / (float)( 2 * ( MAX_SOLID_TRIS + 1 ) ) )
+#define TRANSPARENT_Z_ORDER_OFFSET ( 1.0f / (float)( 2 * ( MAX_TRANSPARENT_TRIS + 1 ) ) )
 
 static ShaderProgram shaderPrograms[NUM_SHADERS];
 
@@ -417,7 +418,8 @@ static int addTriangle( TriangleList* triList, TriVert vert0, TriVert vert1, Tri
 		return -1;
 	}
 
-	float z = (float)depth + ( Z_ORDER_OFFSET * ( solidTriangles.lastTriIndex + transparentTriangles.lastTriIndex + 2 ) );
+	float z = (float)depth + ( SOLID_Z_ORDER_OFFSET * ( solidTriangles.lastTriIndex + 1 ) ) +
+		( TRANSPARENT_Z_ORDER_OFFSET * ( transparentTriangles.lastTriIndex + 1 ) );
 
 	int idx = triList->lastTriIndex + 1;
 	triList->lastTriIndex = idx;
@@ -645,8 +647,11 @@ void triRenderer_Render( )
 		GL( glDisable( GL_BLEND ) );
 		drawTriangles( currCamera, &solidTriangles, onStencilSwitch_Standard );
 
+		// transparent triangles are closer together than the depth buffer can resolve, they're already sorted so let
+		//  the later ones draw over the earlier ones when they end up with the same depth
 		GL( glEnable( GL_BLEND ) );
 		GL( glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA ) );
+		GL( glDepthFunc( GL_LEQUAL ) );
 		drawTriangles( currCamera, &transparentTriangles, onStencilSwitch_Standard );
 	}
 
@@ -0,0 +1,178 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+/*
+Thin wrapper around the SIMD intrinsics available on the platforms we build for, so batched code can be written once.
+ SIMD_SSE is defined for x86 with SSE2, SIMD_NEON for 64-bit ARM. 32-bit ARM NEON is missing division and square
+ root so it isn't used. If neither is defined then SIMD_WIDTH is 0 and everything using this should fall back to
+ scalar code.
+Masks are stored in a simd4f with every bit of a lane set for true and cleared for false.
+*/
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) )
+	#define SIMD_SSE
+	#include <emmintrin.h>
+#elif ( defined( __ARM_NEON ) || defined( __ARM_NEON__ ) ) && defined( __aarch64__ )
+	#define SIMD_NEON
+	#include <arm_neon.h>
+#endif
+
+#if defined( SIMD_SSE )
+
+#define SIMD_WIDTH 4
+typedef __m128 simd4f;
+typedef __m128i simd4i;
+
+static inline simd4f simd4f_Load( const float* p ) { return _mm_loadu_ps( p ); }
+static inline simd4f simd4f_Set1( float f ) { return _mm_set1_ps( f ); }
+static inline simd4f simd4f_Zero( void ) { return _mm_setzero_ps( ); }
+static inline void simd4f_Store( float* p, simd4f v ) { _mm_storeu_ps( p, v ); }
+// stores x and y as xyxyxyxy
+static inline void simd4f_StoreInterleaved( float* p, simd4f x, simd4f y )
+{
+	_mm_storeu_ps( p, _mm_unpacklo_ps( x, y ) );
+	_mm_storeu_ps( p + 4, _mm_unpackhi_ps( x, y ) );
+}
+// loads xyxyxyxy into separate x and y
+static inline void simd4f_LoadInterleaved( const float* p, simd4f* outX, simd4f* outY )
+{
+	__m128 lo = _mm_loadu_ps( p );
+	__m128 hi = _mm_loadu_ps( p + 4 );
+	(*outX) = _mm_shuffle_ps( lo, hi, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+	(*outY) = _mm_shuffle_ps( lo, hi, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+}
+
+static inline simd4f simd4f_Add( simd4f a, simd4f b ) { return _mm_add_ps( a, b ); }
+static inline simd4f simd4f_Sub( simd4f a, simd4f b ) { return _mm_sub_ps( a, b ); }
+static inline simd4f simd4f_Mul( simd4f a, simd4f b ) { return _mm_mul_ps( a, b ); }
+static inline simd4f simd4f_Div( simd4f a, simd4f b ) { return _mm_div_ps( a, b ); }
+static inline simd4f simd4f_Sqrt( simd4f a ) { return _mm_sqrt_ps( a ); }
+static inline simd4f simd4f_Min( simd4f a, simd4f b ) { return _mm_min_ps( a, b ); }
+static inline simd4f simd4f_Max( simd4f a, simd4f b ) { return _mm_max_ps( a, b ); }
+static inline simd4f simd4f_Abs( simd4f a ) { return _mm_andnot_ps( _mm_set1_ps( -0.0f ), a ); }
+static inline simd4f simd4f_Floor( simd4f a )
+{
+	// SSE2 has no floor, truncate and then adjust the values that were rounded up
+	simd4f t = _mm_cvtepi32_ps( _mm_cvttps_epi32( a ) );
+	return _mm_sub_ps( t, _mm_and_ps( _mm_cmpgt_ps( t, a ), _mm_set1_ps( 1.0f ) ) );
+}
+
+static inline simd4f simd4f_CmpLT( simd4f a, simd4f b ) { return _mm_cmplt_ps( a, b ); }
+static inline simd4f simd4f_CmpLE( simd4f a, simd4f b ) { return _mm_cmple_ps( a, b ); }
+static inline simd4f simd4f_CmpGT( simd4f a, simd4f b ) { return _mm_cmpgt_ps( a, b ); }
+static inline simd4f simd4f_CmpGE( simd4f a, simd4f b ) { return _mm_cmpge_ps( a, b ); }
+static inline simd4f simd4f_And( simd4f a, simd4f b ) { return _mm_and_ps( a, b ); }
+static inline simd4f simd4f_Or( simd4f a, simd4f b ) { return _mm_or_ps( a, b ); }
+static inline simd4f simd4f_AndNot( simd4f mask, simd4f a ) { return _mm_andnot_ps( mask, a ); } // ~mask & a
+// for each lane returns a if the mask is set, b otherwise
+static inline simd4f simd4f_Select( simd4f mask, simd4f a, simd4f b ) { return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) ); }
+// returns a 4-bit value, one bit per lane of the mask
+static inline int simd4f_MoveMask( simd4f mask ) { return _mm_movemask_ps( mask ); }
+
+static inline simd4i simd4f_ToInt( simd4f a ) { return _mm_cvttps_epi32( a ); }
+static inline simd4f simd4i_ToFloat( simd4i a ) { return _mm_cvtepi32_ps( a ); }
+static inline void simd4i_Store( int32_t* p, simd4i v ) { _mm_storeu_si128( (__m128i*)p, v ); }
+// stores a and b as abababab
+static inline void simd4i_StoreInterleaved( int32_t* p, simd4i a, simd4i b )
+{
+	_mm_storeu_si128( (__m128i*)p, _mm_unpacklo_epi32( a, b ) );
+	_mm_storeu_si128( (__m128i*)( p + 4 ), _mm_unpackhi_epi32( a, b ) );
+}
+
+typedef __m128i simd16u8;
+
+static inline simd16u8 simd16u8_Load( const uint8_t* p ) { return _mm_loadu_si128( (const __m128i*)p ); }
+static inline simd16u8 simd16u8_Set1( uint8_t b ) { return _mm_set1_epi8( (char)b ); }
+static inline simd16u8 simd16u8_CmpEq( simd16u8 a, simd16u8 b ) { return _mm_cmpeq_epi8( a, b ); }
+// returns a 16-bit value with each bit set to the high bit of each byte
+static inline int simd16u8_MoveMask( simd16u8 a ) { return _mm_movemask_epi8( a ); }
+
+#elif defined( SIMD_NEON )
+
+#define SIMD_WIDTH 4
+typedef float32x4_t simd4f;
+typedef int32x4_t simd4i;
+
+static inline simd4f simd4f_Load( const float* p ) { return vld1q_f32( p ); }
+static inline simd4f simd4f_Set1( float f ) { return vdupq_n_f32( f ); }
+static inline simd4f simd4f_Zero( void ) { return vdupq_n_f32( 0.0f ); }
+static inline void simd4f_Store( float* p, simd4f v ) { vst1q_f32( p, v ); }
+// stores x and y as xyxyxyxy
+static inline void simd4f_StoreInterleaved( float* p, simd4f x, simd4f y )
+{
+	float32x4x2_t xy;
+	xy.val[0] = x;
+	xy.val[1] = y;
+	vst2q_f32( p, xy );
+}
+// loads xyxyxyxy into separate x and y
+static inline void simd4f_LoadInterleaved( const float* p, simd4f* outX, simd4f* outY )
+{
+	float32x4x2_t xy = vld2q_f32( p );
+	(*outX) = xy.val[0];
+	(*outY) = xy.val[1];
+}
+
+static inline simd4f simd4f_Add( simd4f a, simd4f b ) { return vaddq_f32( a, b ); }
+static inline simd4f simd4f_Sub( simd4f a, simd4f b ) { return vsubq_f32( a, b ); }
+static inline simd4f simd4f_Mul( simd4f a, simd4f b ) { return vmulq_f32( a, b ); }
+static inline simd4f simd4f_Div( simd4f a, simd4f b ) { return vdivq_f32( a, b ); }
+static inline simd4f simd4f_Sqrt( simd4f a ) { return vsqrtq_f32( a ); }
+static inline simd4f simd4f_Min( simd4f a, simd4f b ) { return vminq_f32( a, b ); }
+static inline simd4f simd4f_Max( simd4f a, simd4f b ) { return vmaxq_f32( a, b ); }
+static inline simd4f simd4f_Abs( simd4f a ) { return vabsq_f32( a ); }
+static inline simd4f simd4f_Floor( simd4f a ) { return vrndmq_f32( a ); }
+
+static inline simd4f simd4f_CmpLT( simd4f a, simd4f b ) { return vreinterpretq_f32_u32( vcltq_f32( a, b ) ); }
+static inline simd4f simd4f_CmpLE( simd4f a, simd4f b ) { return vreinterpretq_f32_u32( vcleq_f32( a, b ) ); }
+static inline simd4f simd4f_CmpGT( simd4f a, simd4f b ) { return vreinterpretq_f32_u32( vcgtq_f32( a, b ) ); }
+static inline simd4f simd4f_CmpGE( simd4f a, simd4f b ) { return vreinterpretq_f32_u32( vcgeq_f32( a, b ) ); }
+static inline simd4f simd4f_And( simd4f a, simd4f b ) { return vreinterpretq_f32_u32( vandq_u32( vreinterpretq_u32_f32( a ), vreinterpretq_u32_f32( b ) ) ); }
+static inline simd4f simd4f_Or( simd4f a, simd4f b ) { return vreinterpretq_f32_u32( vorrq_u32( vreinterpretq_u32_f32( a ), vreinterpretq_u32_f32( b ) ) ); }
+static inline simd4f simd4f_AndNot( simd4f mask, simd4f a ) { return vreinterpretq_f32_u32( vbicq_u32( vreinterpretq_u32_f32( a ), vreinterpretq_u32_f32( mask ) ) ); } // ~mask & a
+// for each lane returns a if the mask is set, b otherwise
+static inline simd4f simd4f_Select( simd4f mask, simd4f a, simd4f b ) { return vbslq_f32( vreinterpretq_u32_f32( mask ), a, b ); }
+// returns a 4-bit value, one bit per lane of the mask
+static inline int simd4f_MoveMask( simd4f mask )
+{
+	static const int32_t shifts[4] = { 0, 1, 2, 3 };
+	uint32x4_t bits = vshrq_n_u32( vreinterpretq_u32_f32( mask ), 31 );
+	return (int)vaddvq_u32( vshlq_u32( bits, vld1q_s32( shifts ) ) );
+}
+
+static inline simd4i simd4f_ToInt( simd4f a ) { return vcvtq_s32_f32( a ); }
+static inline simd4f simd4i_ToFloat( simd4i a ) { return vcvtq_f32_s32( a ); }
+static inline void simd4i_Store( int32_t* p, simd4i v ) { vst1q_s32( p, v ); }
+// stores a and b as abababab
+static inline void simd4i_StoreInterleaved( int32_t* p, simd4i a, simd4i b )
+{
+	int32x4x2_t ab;
+	ab.val[0] = a;
+	ab.val[1] = b;
+	vst2q_s32( p, ab );
+}
+
+typedef uint8x16_t simd16u8;
+
+static inline simd16u8 simd16u8_Load( const uint8_t* p ) { return vld1q_u8( p ); }
+static inline simd16u8 simd16u8_Set1( uint8_t b ) { return vdupq_n_u8( b ); }
+static inline simd16u8 simd16u8_CmpEq( simd16u8 a, simd16u8 b ) { return vceqq_u8( a, b ); }
+// returns a 16-bit value with each bit set to the high bit of each byte
+static inline int simd16u8_MoveMask( simd16u8 a )
+{
+	static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+	// spread the high bit across the whole byte, then keep a different bit for each lane and add them together
+	uint8x16_t highBits = vreinterpretq_u8_s8( vshrq_n_s8( vreinterpretq_s8_u8( a ), 7 ) );
+	uint8x16_t masked = vandq_u8( highBits, vld1q_u8( bits ) );
+	return (int)vaddv_u8( vget_low_u8( masked ) ) | ( (int)vaddv_u8( vget_high_u8( masked ) ) << 8 );
+}
+
+#else
+
+#define SIMD_WIDTH 0
+
+#endif
+
+#endif // inclusion guard
@@ -0,0 +1,472 @@
+#include "assetManager.h"
+
+#include <assert.h>
+#include <string.h>
+#include <SDL_timer.h>
+
+#include "memory.h"
+#include "platformLog.h"
+#include "jobQueue.h"
+#include "../Utils/stretchyBuffer.h"
+#include "../Utils/idSet.h"
+
+#define MAX_ASSET_TYPES 16
+#define INITIAL_MAX_ASSETS 256
+
+typedef struct {
+	AssetLoader loader;
+	int placeholder;
+} AssetType;
+
+// allocated separately from the asset so the job thread never touches anything that can move
+typedef struct {
+	AssetHandle handle;
+	int type;
+	void* loadData;
+	bool succeeded;
+	bool cancelled; // the asset was released while this was on the job thread
+} AssetLoadJob;
+
+typedef struct {
+	AssetHandle handle;
+	int type;
+	AssetStatus status;
+	AssetPriority priority;
+	uint32_t requestOrder; // earlier requests of the same priority go first
+	int refCount;
+
+	uint32_t hash;
+	char* fileName;
+	void* params;
+
+	AssetLoadJob* job; // while loading or loaded
+	int id; // once ready
+} Asset;
+
+static AssetType types[MAX_ASSET_TYPES];
+static int numTypes = 0;
+
+static IDSet assetIDs = { NULL, 0 };
+static Asset* sbAssets = NULL; // indexed by the index of the handle
+
+static AssetHandle* sbQueued = NULL;
+static AssetHandle* sbLoaded = NULL;
+
+static int uploadsPerFrame = 2;
+static int maxLoadsInFlight = 4;
+static int loadsInFlight = 0;
+static uint32_t nextRequestOrder = 0;
+
+// Registers a kind of asset, returns the type to use when requesting them or -1 if there was a problem.
+int asset_RegisterType( const AssetLoader* loader )
+{
+	assert( loader != NULL );
+	assert( loader->create != NULL );
+	assert( loader->load != NULL );
+	assert( loader->bind != NULL );
+	assert( loader->destroy != NULL );
+	assert( loader->unload != NULL );
+
+	if( numTypes >= MAX_ASSET_TYPES ) {
+		llog( LOG_ERROR, "Too many asset types registered." );
+		return -1;
+	}
+
+	types[numTypes].loader = (*loader);
+	types[numTypes].placeholder = -1;
+
+	return numTypes++;
+}
+
+// Sets the id asset_Get returns for assets of the type that aren't ready yet, -1 by default.
+void asset_SetPlaceholder( int type, int placeholderID )
+{
+	assert( ( type >= 0 ) && ( type < numTypes ) );
+	types[type].placeholder = placeholderID;
+}
+
+// Sets how many assets that use the GPU can be bound each frame, defaults to 2.
+void asset_SetUploadsPerFrame( int newUploadsPerFrame )
+{
+	assert( newUploadsPerFrame > 0 );
+	uploadsPerFrame = newUploadsPerFrame;
+}
+
+// Sets how many assets can be loading on the job threads at once, defaults to 4.
+void asset_SetMaxLoadsInFlight( int maxLoads )
+{
+	assert( maxLoads > 0 );
+	maxLoadsInFlight = maxLoads;
+}
+
+static Asset* getAsset( AssetHandle handle )
+{
+	if( ( assetIDs.sbIDData == NULL ) || !idSet_IsIDValid( &assetIDs, handle ) ) {
+		return NULL;
+	}
+	return &( sbAssets[idSet_GetIndex( handle )] );
+}
+
+static uint32_t hashRequest( int type, const char* fileName, const void* params, size_t paramsSize )
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	hash = ( hash ^ (uint32_t)type ) * 16777619u;
+	for( const char* c = fileName; *c; ++c ) {
+		hash = ( hash ^ (uint8_t)( *c ) ) * 16777619u;
+	}
+	const uint8_t* bytes = (const uint8_t*)params;
+	for( size_t i = 0; i < paramsSize; ++i ) {
+		hash = ( hash ^ bytes[i] ) * 16777619u;
+	}
+	return hash;
+}
+
+static void removeHandle( AssetHandle* sbHandles, AssetHandle handle )
+{
+	for( size_t i = 0; i < sb_Count( sbHandles ); ++i ) {
+		if( sbHandles[i] == handle ) {
+			sbHandles[i] = sb_Last( sbHandles );
+			sb_Pop( sbHandles );
+			return;
+		}
+	}
+}
+
+// Requests the file be loaded, params should point to paramsSize bytes for the type. If the same file is already
+//  requested with the same params the existing handle is returned with another reference added.
+//  Returns INVALID_ASSET_HANDLE if there was a problem.
+AssetHandle asset_Request( int type, const char* fileName, const void* params, AssetPriority priority )
+{
+	assert( ( type >= 0 ) && ( type < numTypes ) );
+	assert( fileName != NULL );
+	assert( ( params != NULL ) || ( types[type].loader.paramsSize == 0 ) );
+
+	if( assetIDs.sbIDData == NULL ) {
+		idSet_Init( &assetIDs, INITIAL_MAX_ASSETS );
+	}
+
+	size_t paramsSize = types[type].loader.paramsSize;
+	uint32_t hash = hashRequest( type, fileName, params, paramsSize );
+
+	// if it's already been requested just use that, if it failed try loading it again
+	for( size_t i = 0; i < sb_Count( sbAssets ); ++i ) {
+		Asset* existing = &( sbAssets[i] );
+		if( ( existing->status == AS_INVALID ) || ( existing->hash != hash ) || ( existing->type != type ) ||
+			( strcmp( existing->fileName, fileName ) != 0 ) || ( memcmp( existing->params, params, paramsSize ) != 0 ) ) {
+			continue;
+		}
+
+		++existing->refCount;
+		if( existing->status == AS_FAILED ) {
+			existing->status = AS_QUEUED;
+			existing->priority = priority;
+			existing->requestOrder = nextRequestOrder++;
+			sb_Push( sbQueued, existing->handle );
+		} else if( priority > existing->priority ) {
+			existing->priority = priority;
+		}
+		return existing->handle;
+	}
+
+	AssetHandle handle = idSet_ClaimID( &assetIDs );
+	if( handle == INVALID_ASSET_HANDLE ) {
+		size_t newMax = sb_Count( assetIDs.sbIDData ) * 2;
+		if( newMax > UINT16_MAX ) {
+			newMax = UINT16_MAX;
+		}
+		idSet_IncreaseMaximum( &assetIDs, newMax );
+		handle = idSet_ClaimID( &assetIDs );
+		if( handle == INVALID_ASSET_HANDLE ) {
+			llog( LOG_ERROR, "Unable to create handle for asset %s.", fileName );
+			return INVALID_ASSET_HANDLE;
+		}
+	}
+
+	uint16_t idx = idSet_GetIndex( handle );
+	if( idx >= sb_Count( sbAssets ) ) {
+		size_t oldCount = sb_Count( sbAssets );
+		sb_Add( sbAssets, ( idx + 1 ) - oldCount );
+		memset( sbAssets + oldCount, 0, sizeof( sbAssets[0] ) * ( sb_Count( sbAssets ) - oldCount ) );
+	}
+
+	Asset* asset = &( sbAssets[idx] );
+	size_t fileNameSize = strlen( fileName ) + 1;
+	asset->fileName = mem_Allocate( fileNameSize );
+	asset->params = ( paramsSize > 0 ) ? mem_Allocate( paramsSize ) : NULL;
+	if( ( asset->fileName == NULL ) || ( ( paramsSize > 0 ) && ( asset->params == NULL ) ) ) {
+		llog( LOG_ERROR, "Unable to allocate request for asset %s.", fileName );
+		mem_Release( asset->fileName );
+		mem_Release( asset->params );
+		asset->fileName = NULL;
+		asset->params = NULL;
+		idSet_ReleaseID( &assetIDs, handle );
+		return INVALID_ASSET_HANDLE;
+	}
+	memcpy( asset->fileName, fileName, fileNameSize );
+	if( paramsSize > 0 ) {
+		memcpy( asset->params, params, paramsSize );
+	}
+
+	asset->handle = handle;
+	asset->type = type;
+	asset->status = AS_QUEUED;
+	asset->priority = priority;
+	asset->requestOrder = nextRequestOrder++;
+	asset->refCount = 1;
+	asset->hash = hash;
+	asset->job = NULL;
+	asset->id = -1;
+
+	sb_Push( sbQueued, handle );
+
+	return handle;
+}
+
+// Adds a reference to the asset.
+void asset_AddRef( AssetHandle handle )
+{
+	Asset* asset = getAsset( handle );
+	assert( asset != NULL );
+	++asset->refCount;
+}
+
+static void destroyLoadJob( AssetLoadJob* job )
+{
+	types[job->type].loader.destroy( job->loadData );
+	mem_Release( job );
+}
+
+// Removes a reference to the asset. When there are none left it's cancelled if it's still loading and unloaded if
+//  it's ready, the handle is invalid after that.
+void asset_Release( AssetHandle handle )
+{
+	Asset* asset = getAsset( handle );
+	if( asset == NULL ) {
+		return;
+	}
+
+	--asset->refCount;
+	if( asset->refCount > 0 ) {
+		return;
+	}
+
+	switch( asset->status ) {
+	case AS_QUEUED:
+		removeHandle( sbQueued, handle );
+		break;
+	case AS_LOADING:
+		// the job thread still has it, it'll be cleaned up when it gets back to the main thread
+		asset->job->cancelled = true;
+		break;
+	case AS_LOADED:
+		removeHandle( sbLoaded, handle );
+		destroyLoadJob( asset->job );
+		break;
+	case AS_READY:
+		types[asset->type].loader.unload( asset->id );
+		break;
+	default:
+		break;
+	}
+
+	mem_Release( asset->fileName );
+	mem_Release( asset->params );
+	asset->fileName = NULL;
+	asset->params = NULL;
+	asset->job = NULL;
+	asset->status = AS_INVALID;
+	idSet_ReleaseID( &assetIDs, handle );
+}
+
+// Changes the priority of an asset that hasn't started loading yet.
+void asset_SetPriority( AssetHandle handle, AssetPriority priority )
+{
+	Asset* asset = getAsset( handle );
+	if( asset != NULL ) {
+		asset->priority = priority;
+	}
+}
+
+AssetStatus asset_GetStatus( AssetHandle handle )
+{
+	Asset* asset = getAsset( handle );
+	return ( asset != NULL ) ? asset->status : AS_INVALID;
+}
+
+// Returns the id of the asset if it's ready, otherwise the placeholder for the type.
+int asset_Get( AssetHandle handle )
+{
+	Asset* asset = getAsset( handle );
+	if( asset == NULL ) {
+		return -1;
+	}
+
+	if( asset->status == AS_READY ) {
+		return asset->id;
+	}
+	return types[asset->type].placeholder;
+}
+
+static void loadFinishedTask( void* data )
+{
+	AssetLoadJob* job = (AssetLoadJob*)data;
+	--loadsInFlight;
+
+	if( job->cancelled ) {
+		destroyLoadJob( job );
+		return;
+	}
+
+	Asset* asset = getAsset( job->handle );
+	assert( asset != NULL );
+
+	if( !job->succeeded ) {
+		llog( LOG_ERROR, "Unable to load asset %s.", asset->fileName );
+		destroyLoadJob( job );
+		asset->job = NULL;
+		asset->status = AS_FAILED;
+		return;
+	}
+
+	asset->status = AS_LOADED;
+	sb_Push( sbLoaded, job->handle );
+}
+
+static void loadAssetJob( void* data )
+{
+	AssetLoadJob* job = (AssetLoadJob*)data;
+
+	job->succeeded = types[job->type].loader.load( job->loadData );
+
+	// this is just bookkeeping, binding is done in asset_ProcessUploads, so don't let it wait behind other jobs
+	jq_AddPrioritizedMainThreadJobWait( loadFinishedTask, data, JOB_PRIORITY_HIGH );
+}
+
+// Returns the index in sbHandles of the highest priority asset, the earliest requested if there's a tie. If
+//  skipGPU is set anything that uses the GPU is ignored. Returns -1 if there's nothing.
+static int findNext( AssetHandle* sbHandles, bool skipGPU )
+{
+	int best = -1;
+	Asset* bestAsset = NULL;
+	for( size_t i = 0; i < sb_Count( sbHandles ); ++i ) {
+		Asset* asset = getAsset( sbHandles[i] );
+		if( skipGPU && types[asset->type].loader.usesGPU ) {
+			continue;
+		}
+
+		if( ( bestAsset == NULL ) || ( asset->priority > bestAsset->priority ) ||
+			( ( asset->priority == bestAsset->priority ) && ( asset->requestOrder < bestAsset->requestOrder ) ) ) {
+			best = (int)i;
+			bestAsset = asset;
+		}
+	}
+	return best;
+}
+
+static void startLoad( Asset* asset )
+{
+	AssetLoader* loader = &( types[asset->type].loader );
+
+	AssetLoadJob* job = mem_Allocate( sizeof( AssetLoadJob ) );
+	if( job == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate load job for asset %s.", asset->fileName );
+		asset->status = AS_FAILED;
+		return;
+	}
+
+	job->handle = asset->handle;
+	job->type = asset->type;
+	job->succeeded = false;
+	job->cancelled = false;
+	job->loadData = loader->create( asset->fileName, asset->params );
+	if( job->loadData == NULL ) {
+		llog( LOG_ERROR, "Unable to create load data for asset %s.", asset->fileName );
+		mem_Release( job );
+		asset->status = AS_FAILED;
+		return;
+	}
+
+	asset->job = job;
+	asset->status = AS_LOADING;
+	++loadsInFlight;
+	if( !jq_AddJob( loadAssetJob, job ) ) {
+		--loadsInFlight;
+		destroyLoadJob( job );
+		asset->job = NULL;
+		asset->status = AS_FAILED;
+	}
+}
+
+static void bindAsset( Asset* asset )
+{
+	AssetLoadJob* job = asset->job;
+
+	asset->id = types[asset->type].loader.bind( job->loadData );
+	asset->status = ( asset->id >= 0 ) ? AS_READY : AS_FAILED;
+	if( asset->id < 0 ) {
+		llog( LOG_ERROR, "Unable to bind asset %s.", asset->fileName );
+	}
+
+	destroyLoadJob( job );
+	asset->job = NULL;
+}
+
+// Starts any queued loads and binds finished ones, call once a frame on the main thread after the main thread jobs
+//  have been processed.
+void asset_ProcessUploads( void )
+{
+	// bind first so anything that finishes while binding has to wait for the next frame, keeps the time spent here
+	//  more even
+	int uploads = 0;
+	int next;
+	while( ( next = findNext( sbLoaded, uploads >= uploadsPerFrame ) ) >= 0 ) {
+		Asset* asset = getAsset( sbLoaded[next] );
+		sbLoaded[next] = sb_Last( sbLoaded );
+		sb_Pop( sbLoaded );
+
+		if( types[asset->type].loader.usesGPU ) {
+			++uploads;
+		}
+		bindAsset( asset );
+	}
+
+	while( ( loadsInFlight < maxLoadsInFlight ) && ( ( next = findNext( sbQueued, false ) ) >= 0 ) ) {
+		Asset* asset = getAsset( sbQueued[next] );
+		sbQueued[next] = sb_Last( sbQueued );
+		sb_Pop( sbQueued );
+
+		startLoad( asset );
+	}
+}
+
+// Returns whether nothing is waiting to be loaded or bound.
+bool asset_AllLoaded( void )
+{
+	return ( ( sb_Count( sbQueued ) == 0 ) && ( sb_Count( sbLoaded ) == 0 ) && ( loadsInFlight == 0 ) );
+}
+
+// Unloads everything and releases all the handles, any loads in progress are cancelled.
+void asset_CleanUp( void )
+{
+	for( size_t i = 0; i < sb_Count( sbAssets ); ++i ) {
+		if( sbAssets[i].status != AS_INVALID ) {
+			sbAssets[i].refCount = 1;
+			asset_Release( sbAssets[i].handle );
+		}
+	}
+
+	// the cancelled loads still own their jobs until they get back to the main thread, so wait for them, running any
+	//  that haven't been started here so this doesn't depend on the job threads
+	while( loadsInFlight > 0 ) {
+		if( !jq_ProcessNextJob( ) ) {
+			SDL_Delay( 1 );
+		}
+		jq_ProcessMainThreadJobs( );
+	}
+
+	sb_Release( sbAssets );
+	sb_Release( sbQueued );
+	sb_Release( sbLoaded );
+	idSet_Destroy( &assetIDs );
+}
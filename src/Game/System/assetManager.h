@@ -0,0 +1,103 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+Handles loading assets on the job threads and binding them on the main thread.
+ Each kind of asset registers an AssetLoader, requests for it return a handle that's reference counted. Requesting a
+ file that's already been requested with the same parameters returns the same handle instead of loading it again.
+ Requests are loaded in order of priority, only a few at a time so high priority requests don't have to wait behind
+ everything else. Binding anything that uploads to the GPU is limited to a few per frame so a lot of loads finishing at
+ once doesn't cause a spike. Until an asset is ready asset_Get returns the placeholder set for the type.
+ Releasing the last reference to something that's still loading cancels it, releasing a loaded asset unloads it.
+ Everything other than AssetLoader.load is called on the main thread.
+*/
+
+typedef uint32_t AssetHandle;
+#define INVALID_ASSET_HANDLE 0
+
+typedef enum {
+	ASSET_PRIORITY_LOW,
+	ASSET_PRIORITY_NORMAL,
+	ASSET_PRIORITY_HIGH,
+	NUM_ASSET_PRIORITIES
+} AssetPriority;
+
+typedef enum {
+	AS_INVALID, // handle isn't valid
+	AS_QUEUED, // waiting for a job thread to start loading it
+	AS_LOADING,
+	AS_LOADED, // waiting to be bound on the main thread
+	AS_READY,
+	AS_FAILED
+} AssetStatus;
+
+typedef struct {
+	// Creates the data used to load the asset. Called when the load is started, so anything that can change
+	//  should be copied here. Returns NULL if there was a problem.
+	void* (*create)( const char* fileName, const void* params );
+
+	// Called on a job thread, does everything that doesn't need the main thread. Returns whether it succeeded.
+	bool (*load)( void* loadData );
+
+	// Creates the asset from the loaded data, returns the id of the asset or -1 if there was a problem.
+	int (*bind)( void* loadData );
+
+	// Releases the data from create, called after bind or when the load fails or is cancelled.
+	void (*destroy)( void* loadData );
+
+	// Releases a bound asset.
+	void (*unload)( int id );
+
+	size_t paramsSize; // size of the params passed into asset_Request, used to find duplicate requests
+	bool usesGPU; // binding uploads to the GPU, counts against the uploads per frame
+} AssetLoader;
+
+// Registers a kind of asset, returns the type to use when requesting them or -1 if there was a problem.
+int asset_RegisterType( const AssetLoader* loader );
+
+// Sets the id asset_Get returns for assets of the type that aren't ready yet, -1 by default.
+void asset_SetPlaceholder( int type, int placeholderID );
+
+// Sets how many assets that use the GPU can be bound each frame, defaults to 2.
+void asset_SetUploadsPerFrame( int uploadsPerFrame );
+
+// Sets how many assets can be loading on the job threads at once, defaults to 4.
+void asset_SetMaxLoadsInFlight( int maxLoads );
+
+// Requests the file be loaded, params should point to paramsSize bytes for the type. If the same file is already
+//  requested with the same params the existing handle is returned with another reference added, if that failed to
+//  load it's queued to be loaded again.
+//  Returns INVALID_ASSET_HANDLE if there was a problem.
+AssetHandle asset_Request( int type, const char* fileName, const void* params, AssetPriority priority );
+
+// Adds a reference to the asset.
+void asset_AddRef( AssetHandle handle );
+
+// Removes a reference to the asset. When there are none left it's cancelled if it's still loading and unloaded if
+//  it's ready, the handle is invalid after that.
+void asset_Release( AssetHandle handle );
+
+// Changes the priority of an asset that hasn't started loading yet.
+void asset_SetPriority( AssetHandle handle, AssetPriority priority );
+
+AssetStatus asset_GetStatus( AssetHandle handle );
+
+// Returns the id of the asset if it's ready, otherwise the placeholder for the type.
+int asset_Get( AssetHandle handle );
+
+// Starts any queued loads and binds finished ones, call once a frame on the main thread after the main thread jobs
+//  have been processed.
+void asset_ProcessUploads( void );
+
+// Returns whether nothing is waiting to be loaded or bound.
+bool asset_AllLoaded( void );
+
+// Unloads everything and releases all the handles, any loads in progress are cancelled. Waits for loads that are on
+//  the job threads to finish, so call it before jq_ShutDown.
+void asset_CleanUp( void );
+
+#endif /* inclusion guard */
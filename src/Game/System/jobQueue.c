@@ -3,15 +3,22 @@
 #include <stddef.h>
 #include <SDL.h>
 #include <assert.h>
+#include <string.h>
 
 #include "../System/platformLog.h"
+#include "../System/memory.h"
 #include "../Utils/stretchyBuffer.h"
 
 // TODO?: Give the option to create multiple job queues
 
 static JobRingQueue jobQueue;
 
-static JobRingQueue mainThreadQueue; // used for things that need to be done on the main thread
+static JobRingQueue mainThreadQueues[NUM_JOB_PRIORITIES]; // used for things that need to be done on the main thread
+
+static SDL_threadID mainThreadID = 0;
+
+static uint64_t mainThreadBudget = 0; // in microseconds, 0 is unlimited
+static MainThreadJobStats mainThreadStats;
 
 // returns if all the jobs are done or not
 bool jq_AllJobsDone( void )
@@ -49,7 +56,11 @@ int jq_Initialize( uint8_t numThreads )
 
 	sbThreadPool = NULL;
 	jobQueue.ringBuffer = NULL;
-	mainThreadQueue.ringBuffer = NULL;
+	for( int i = 0; i < NUM_JOB_PRIORITIES; ++i ) {
+		mainThreadQueues[i].ringBuffer = NULL;
+	}
+	memset( &mainThreadStats, 0, sizeof( mainThreadStats ) );
+	mainThreadID = SDL_ThreadID( );
 
 	if( jrq_Init( &jobQueue, 256 ) < 0 ) {
 		llog( LOG_ERROR, "Unable to create job ring queue." );
@@ -57,10 +68,12 @@ int jq_Initialize( uint8_t numThreads )
 		return -1;
 	}
 
-	if( jrq_Init( &mainThreadQueue, 256 ) < 0 ) {
-		llog( LOG_ERROR, "Unable to create main thread job queue." );
-		jq_ShutDown( );
-		return -1;
+	for( int i = 0; i < NUM_JOB_PRIORITIES; ++i ) {
+		if( jrq_Init( &( mainThreadQueues[i] ), 256 ) < 0 ) {
+			llog( LOG_ERROR, "Unable to create main thread job queue." );
+			jq_ShutDown( );
+			return -1;
+		}
 	}
 
 #ifdef THREAD_SUPPORT
@@ -110,12 +123,14 @@ void jq_ShutDown( void )
 	// signal to the threads that they need to shut down
 	SDL_AtomicSet( &quitFlag, 1 );
 
-	// wait for all the threads to shut down
+	// wake up all the threads and wait for them to finish the jobs they're running, anything still in the queue is dropped
 	for( size_t i = 0; i < sb_Count( sbThreadPool ); ++i ) {
-		SDL_SemPost( jobQueueSemaphore ); // get the threads to wake up
-
-		// don't need the return value, so don't bother waiting
-		SDL_DetachThread( sbThreadPool[i] );
+		SDL_SemPost( jobQueueSemaphore );
+	}
+	for( size_t i = 0; i < sb_Count( sbThreadPool ); ++i ) {
+		if( sbThreadPool[i] != NULL ) {
+			SDL_WaitThread( sbThreadPool[i], NULL );
+		}
 	}
 
 	// destroy the thread pool
@@ -125,17 +140,19 @@ void jq_ShutDown( void )
 	jobQueueSemaphore = NULL;
 #endif
 
-	jrq_CleanUp( &mainThreadQueue );
+	for( int i = 0; i < NUM_JOB_PRIORITIES; ++i ) {
+		jrq_CleanUp( &( mainThreadQueues[i] ) );
+	}
 	jrq_CleanUp( &jobQueue );
 }
 
-static void addJob( JobProcessFunc proc, void* data, JobRingQueue* queue )
+static bool addJob( JobProcessFunc proc, void* data, JobRingQueue* queue )
 {
 	Job newJob;
 	newJob.process = proc;
 	newJob.data = data;
 
-	jrq_Write( queue, &newJob );
+	return jrq_Write( queue, &newJob );
 }
 
 // TODO: Create a copy of the data so we don't have to worry about it disappearing while
@@ -148,7 +165,9 @@ bool jq_AddJob( JobProcessFunc proc, void* data )
 		llog( LOG_WARN, "Attempting to add job before job queue created." );
 		return false;
 	}//*/
-	addJob( proc, data, &jobQueue );
+	if( !addJob( proc, data, &jobQueue ) ) {
+		return false;
+	}
 	SDL_SemPost( jobQueueSemaphore );
 
 	return true;
@@ -156,11 +175,150 @@ bool jq_AddJob( JobProcessFunc proc, void* data )
 
 bool jq_AddMainThreadJob( JobProcessFunc proc, void* data )
 {
-	addJob( proc, data, &mainThreadQueue );
+	return jq_AddPrioritizedMainThreadJob( proc, data, JOB_PRIORITY_NORMAL );
+}
+
+bool jq_AddPrioritizedMainThreadJob( JobProcessFunc proc, void* data, JobPriority priority )
+{
+	assert( ( priority >= 0 ) && ( priority < NUM_JOB_PRIORITIES ) );
+
+	return addJob( proc, data, &( mainThreadQueues[priority] ) );
+}
+
+// Only the main thread empties its queues, so if this is the main thread the job is run immediately instead of waiting
+//  for room, which can happen when there's no thread support and the job threads' jobs are run on the main thread.
+void jq_AddPrioritizedMainThreadJobWait( JobProcessFunc proc, void* data, JobPriority priority )
+{
+	while( !jq_AddPrioritizedMainThreadJob( proc, data, priority ) ) {
+		if( jq_IsMainThread( ) ) {
+			proc( data );
+			return;
+		}
+
+#ifdef THREAD_SUPPORT
+		// the main thread is waiting for this thread to finish in jq_ShutDown, so it won't be emptying the queue
+		if( SDL_AtomicGet( &quitFlag ) != 0 ) {
+			return;
+		}
+#endif
+		SDL_Delay( 1 );
+	}
+}
+
+bool jq_IsMainThread( void )
+{
+	return ( SDL_ThreadID( ) == mainThreadID );
+}
+
+// the ring buffer is fixed size, so limit how many batches we'll add at once so we don't overrun it
+#define MAX_PARALLEL_FOR_JOBS 64
+
+typedef struct {
+	JobParallelForFunc proc;
+	void* data;
+	int start;
+	int end;
+	SDL_atomic_t* remaining;
+} ParallelForJob;
+
+static void parallelForJob( void* data )
+{
+	ParallelForJob* job = (ParallelForJob*)data;
+	job->proc( job->data, job->start, job->end );
+	SDL_AtomicAdd( job->remaining, -1 );
+}
+
+void jq_ParallelFor( JobParallelForFunc proc, void* data, int count, int batchSize )
+{
+	assert( proc != NULL );
+
+	if( count <= 0 ) {
+		return;
+	}
+
+	if( batchSize < 1 ) {
+		batchSize = 1;
+	}
+
+	int numJobs = ( count + batchSize - 1 ) / batchSize;
+	if( numJobs > MAX_PARALLEL_FOR_JOBS ) {
+		numJobs = MAX_PARALLEL_FOR_JOBS;
+		batchSize = ( count + numJobs - 1 ) / numJobs;
+	}
+
+	ParallelForJob* jobs = NULL;
+	if( ( numJobs > 1 ) && ( jobQueue.ringBuffer != NULL ) ) {
+		jobs = mem_Allocate( sizeof( jobs[0] ) * numJobs );
+	}
+
+	if( jobs == NULL ) {
+		// nothing to split up or nowhere to put the jobs, just do it all here
+		proc( data, 0, count );
+		return;
+	}
+
+	SDL_atomic_t remaining;
+	SDL_AtomicSet( &remaining, numJobs );
+
+	// the first batch is done on this thread, so it doesn't need to go through the queue
+	for( int i = 0; i < numJobs; ++i ) {
+		jobs[i].proc = proc;
+		jobs[i].data = data;
+		jobs[i].start = i * batchSize;
+		jobs[i].end = ( ( i + 1 ) * batchSize ) < count ? ( ( i + 1 ) * batchSize ) : count;
+		jobs[i].remaining = &remaining;
+		if( ( i > 0 ) && !jq_AddJob( parallelForJob, &( jobs[i] ) ) ) {
+			// the queue is full, waiting for room could deadlock if every job thread is doing the same, so do it here
+			parallelForJob( &( jobs[i] ) );
+		}
+	}
+	parallelForJob( &( jobs[0] ) );
+
+	// help out until everything is done
+	while( SDL_AtomicGet( &remaining ) > 0 ) {
+		if( !jq_ProcessNextJob( ) ) {
+			SDL_Delay( 0 );
+		}
+	}
+
+	mem_Release( jobs );
+}
+
+// Sets how long jq_ProcessMainThreadJobs can spend each frame, in microseconds. Once the budget is used up only high
+//  priority jobs are run, everything else is left for the next frame. At least one job is always run so everything
+//  gets processed eventually. 0 means there's no limit, which is the default.
+void jq_SetMainThreadJobBudget( uint64_t microseconds )
+{
+	mainThreadBudget = microseconds;
+}
+
+static uint64_t ticksToMicroseconds( Uint64 ticks )
+{
+	return ( (uint64_t)ticks * 1000000 ) / (uint64_t)SDL_GetPerformanceFrequency( );
+}
+
+// runs the next job with the priority and records how long it took, returns if there was a job to run
+static bool runMainThreadJob( JobPriority priority )
+{
+	Uint64 start = SDL_GetPerformanceCounter( );
+
+	JobProcessFunc process = NULL;
+	if( !jrq_ProcessNextGetJob( &( mainThreadQueues[priority] ), &process ) ) {
+		return false;
+	}
+
+	uint64_t elapsed = ticksToMicroseconds( SDL_GetPerformanceCounter( ) - start );
+	++mainThreadStats.jobsRun[priority];
+	mainThreadStats.totalMicroseconds[priority] += elapsed;
+	if( ( mainThreadStats.longestJob == NULL ) || ( elapsed > mainThreadStats.longestMicroseconds ) ) {
+		mainThreadStats.longestMicroseconds = elapsed;
+		mainThreadStats.longestJob = process;
+	}
+
 	return true;
 }
 
-// Goes through all the jobs added to the main thread and processes them
+// Goes through the jobs added to the main thread and processes them, highest priority first, until the budget is used up
 //  If there is no threading support then all other jobs are processed here as well
 void jq_ProcessMainThreadJobs( void )
 {
@@ -169,6 +327,37 @@ void jq_ProcessMainThreadJobs( void )
 		;
 #endif
 
-	while( jrq_ProcessNext( &mainThreadQueue ) )
+	memset( &mainThreadStats, 0, sizeof( mainThreadStats ) );
+	Uint64 start = SDL_GetPerformanceCounter( );
+
+	// high priority jobs are always run
+	while( runMainThreadJob( JOB_PRIORITY_HIGH ) )
 		;
+
+	bool anyRun = ( mainThreadStats.jobsRun[JOB_PRIORITY_HIGH] > 0 );
+	for( int priority = JOB_PRIORITY_HIGH - 1; priority >= 0; --priority ) {
+		JobRingQueue* queue = &( mainThreadQueues[priority] );
+		for( ;; ) {
+			// the job threads wait for room when this is full, so if it's getting full keep going past the budget
+			//  instead of stalling them
+			bool overBudget = ( mainThreadBudget > 0 ) && anyRun &&
+				( ticksToMicroseconds( SDL_GetPerformanceCounter( ) - start ) >= mainThreadBudget ) &&
+				( jrq_Count( queue ) < ( queue->size / 2 ) );
+			if( overBudget || !runMainThreadJob( (JobPriority)priority ) ) {
+				break;
+			}
+			anyRun = true;
+		}
+	}
+
+	for( int i = 0; i < NUM_JOB_PRIORITIES; ++i ) {
+		mainThreadStats.jobsWaiting[i] = (uint32_t)jrq_Count( &( mainThreadQueues[i] ) );
+	}
+}
+
+void jq_GetMainThreadJobStats( MainThreadJobStats* outStats )
+{
+	assert( outStats != NULL );
+
+	(*outStats) = mainThreadStats;
 }
\ No newline at end of file
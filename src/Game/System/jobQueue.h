@@ -6,6 +6,24 @@
 
 #include "jobRingQueue.h"
 
+// Priority classes for main thread jobs. High priority jobs are always run the frame they're processed, the others are
+//  run in order of priority until the main thread budget is used up and the rest wait for the next frame.
+typedef enum {
+	JOB_PRIORITY_LOW,
+	JOB_PRIORITY_NORMAL,
+	JOB_PRIORITY_HIGH,
+	NUM_JOB_PRIORITIES
+} JobPriority;
+
+// Timing for the last call to jq_ProcessMainThreadJobs.
+typedef struct {
+	uint32_t jobsRun[NUM_JOB_PRIORITIES];
+	uint32_t jobsWaiting[NUM_JOB_PRIORITIES]; // left in the queue for the next frame
+	uint64_t totalMicroseconds[NUM_JOB_PRIORITIES];
+	uint64_t longestMicroseconds;
+	JobProcessFunc longestJob; // the job that took the longest, useful for tracking down spikes
+} MainThreadJobStats;
+
 // Simple job queue system to handle multithreading
 //  Primarily issue is how to handle data passing and allocation, will need to make memory manager thread safe
 //  Easy way may to be do a memory pool per thread
@@ -13,9 +31,19 @@
 // Stores the jobs in a priority queue
 // The jobs will use the data passed in directly, so it's best to make it static, global, or allocate it on the heap
 int jq_Initialize( uint8_t numThreads );
+// Waits for the jobs that are running to finish, anything that hasn't been started yet is dropped.
 void jq_ShutDown( void );
+// The queues are fixed size, these return false if the job couldn't be added because the queue is full.
 bool jq_AddJob( JobProcessFunc proc, void* data );
 bool jq_AddMainThreadJob( JobProcessFunc proc, void* data );
+bool jq_AddPrioritizedMainThreadJob( JobProcessFunc proc, void* data, JobPriority priority );
+
+// For jobs that hand their results back to the main thread. Waits until there's room in the queue, if called from the
+//  main thread the job is run immediately instead so it can't wait on itself.
+void jq_AddPrioritizedMainThreadJobWait( JobProcessFunc proc, void* data, JobPriority priority );
+
+// Returns if this is the thread jq_Initialize was called from.
+bool jq_IsMainThread( void );
 
 // gets the next job and runs it, used if you want the main thread running jobs as well
 bool jq_ProcessNextJob( void );
@@ -23,8 +51,23 @@ bool jq_ProcessNextJob( void );
 // Returns if all the non-main thread jobs are done
 bool jq_AllJobsDone( void );
 
-// Goes through all the jobs added to the main thread and processes them
+// Called by jq_ParallelFor with a range of indices, [start,end), to process
+typedef void (*JobParallelForFunc)( void* data, int start, int end );
+
+// Splits the indices [0,count) into batches of at least batchSize and runs them across the job threads, the calling
+//  thread helps process jobs until all the batches are done. Doesn't return until proc has been called for every index.
+//  If the job queue hasn't been initialized then everything is run on the calling thread.
+void jq_ParallelFor( JobParallelForFunc proc, void* data, int count, int batchSize );
+
+// Sets how long jq_ProcessMainThreadJobs can spend each frame, in microseconds. Once the budget is used up only high
+//  priority jobs are run, everything else is left for the next frame. At least one job is always run so everything
+//  gets processed eventually. 0 means there's no limit, which is the default.
+void jq_SetMainThreadJobBudget( uint64_t microseconds );
+
+// Goes through the jobs added to the main thread and processes them, highest priority first, until the budget is used up
 //  If there is no threading support then all other jobs are processed here as well
 void jq_ProcessMainThreadJobs( void );
 
+void jq_GetMainThreadJobStats( MainThreadJobStats* outStats );
+
 #endif /* inclusion guard */
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <string.h>
+#include <SDL_timer.h>
 
 #include "memory.h"
 
@@ -30,32 +31,64 @@ void jrq_CleanUp( JobRingQueue* queue )
 	mem_Release( queue->ringBuffer );
 }
 
-void jrq_Write( JobRingQueue* queue, Job* jobby )
+// adds the job to the queue, returns false if the queue is full
+bool jrq_Write( JobRingQueue* queue, Job* jobby )
 {
-	// TODO: Test to see if we're writing over the tail, and if we are then fail
-	bool writeSuccess = false;
-	while( !writeSuccess ) {
+	assert( jobby->process != NULL );
+
+	for( ;; ) {
 		int idx = queue->head.value;
-		if( SDL_AtomicCAS( &( queue->head ), idx, ( idx + 1 ) % queue->size ) ) {
-			queue->ringBuffer[idx] = (*jobby);
-			writeSuccess = true;
+		int next = ( idx + 1 ) % queue->size;
+		if( next == queue->tail.value ) {
+			// waiting for room could deadlock if the thread that empties the queue is this one, so let the caller decide
+			return false;
+		}
+
+		if( SDL_AtomicGetPtr( (void**)&( queue->ringBuffer[idx].process ) ) != NULL ) {
+			// the reader has claimed the slot but hasn't finished taking the job out of it yet
+			SDL_Delay( 0 );
+			continue;
+		}
+
+		if( SDL_AtomicCAS( &( queue->head ), idx, next ) ) {
+			// the slot is claimed as soon as the head moves, readers wait until the process is set so set it last
+			queue->ringBuffer[idx].data = jobby->data;
+			SDL_AtomicSetPtr( (void**)&( queue->ringBuffer[idx].process ), (void*)jobby->process );
+			return true;
 		}
 	}
 }
 
 // do the next job available in the ring buffer, returns if anything was actually done
 bool jrq_ProcessNext( JobRingQueue* queue )
+{
+	return jrq_ProcessNextGetJob( queue, NULL );
+}
+
+// same as jrq_ProcessNext, but if a job was done its process function is put into outProcess
+bool jrq_ProcessNextGetJob( JobRingQueue* queue, JobProcessFunc* outProcess )
 {
 	int idx = queue->tail.value;
 	if( idx != queue->head.value ) {
 		if( SDL_AtomicCAS( &( queue->tail ), idx, ( idx + 1 ) % queue->size ) ) {
 			SDL_AtomicAdd( &( queue->busy ), 1 );
 
-			if( queue->ringBuffer[idx].process != NULL ) queue->ringBuffer[idx].process( queue->ringBuffer[idx].data );
-			queue->ringBuffer[idx].process = NULL; // invalidate the job
+			// the writer may have moved the head but not finished filling in the job yet
+			JobProcessFunc process;
+			while( ( process = (JobProcessFunc)SDL_AtomicGetPtr( (void**)&( queue->ringBuffer[idx].process ) ) ) == NULL ) {
+				SDL_Delay( 0 );
+			}
+			void* data = queue->ringBuffer[idx].data;
+			SDL_AtomicSetPtr( (void**)&( queue->ringBuffer[idx].process ), NULL ); // invalidate the job so the slot can be reused
+
+			process( data );
 
 			SDL_AtomicAdd( &( queue->busy ), -1 );
 
+			if( outProcess != NULL ) {
+				(*outProcess) = process;
+			}
+
 			return true;
 		}
 	}
@@ -67,6 +100,13 @@ bool jrq_IsEmpty( JobRingQueue* queue )
 	return ( queue->head.value == queue->tail.value );
 }
 
+size_t jrq_Count( JobRingQueue* queue )
+{
+	int head = queue->head.value;
+	int tail = queue->tail.value;
+	return ( head >= tail ) ? (size_t)( head - tail ) : ( queue->size - (size_t)( tail - head ) );
+}
+
 bool jrq_IsBusy( JobRingQueue* queue )
 {
 	return ( queue->busy.value > 0 );
@@ -21,10 +21,15 @@ typedef struct {
 
 int jrq_Init( JobRingQueue* queue, size_t size );
 void jrq_CleanUp( JobRingQueue* queue );
-void jrq_Write( JobRingQueue* queue, Job* jobby );
+// adds the job to the queue, returns false if the queue is full
+bool jrq_Write( JobRingQueue* queue, Job* jobby );
 // do the next job available in the ring buffer, returns if anything was actually done
 bool jrq_ProcessNext( JobRingQueue* queue );
+// same as jrq_ProcessNext, but if a job was done its process function is put into outProcess
+bool jrq_ProcessNextGetJob( JobRingQueue* queue, JobProcessFunc* outProcess );
 bool jrq_IsEmpty( JobRingQueue* queue );
+// how many jobs are waiting to be processed, may be out of date as soon as it's returned if other threads are using it
+size_t jrq_Count( JobRingQueue* queue );
 bool jrq_IsBusy( JobRingQueue* queue );
 
 #endif /* inclusion guard */
\ No newline at end of file
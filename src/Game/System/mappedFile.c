@@ -0,0 +1,159 @@
+#include "mappedFile.h"
+
+#include <assert.h>
+#include <string.h>
+#include <SDL_rwops.h>
+
+#include "memory.h"
+#include "platformLog.h"
+
+#if defined( __ANDROID__ ) || defined( __EMSCRIPTEN__ )
+	#define READ_WHOLE_FILE
+#elif defined( WIN32 )
+	#define WIN32_LEAN_AND_MEAN
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+static int readWholeFile( const char* fileName, MappedFile* outFile )
+{
+	SDL_RWops* rwopsFile = SDL_RWFromFile( fileName, "rb" );
+	if( rwopsFile == NULL ) {
+		return -1;
+	}
+
+	Sint64 fileSize = SDL_RWsize( rwopsFile );
+	if( fileSize < 0 ) {
+		llog( LOG_ERROR, "Unable to get size of file %s: %s", fileName, SDL_GetError( ) );
+		SDL_RWclose( rwopsFile );
+		return -1;
+	}
+
+	uint8_t* data = NULL;
+	if( fileSize > 0 ) {
+		data = mem_Allocate( (size_t)fileSize );
+		if( data == NULL ) {
+			llog( LOG_ERROR, "Unable to allocate memory to read file %s", fileName );
+			SDL_RWclose( rwopsFile );
+			return -1;
+		}
+
+		size_t readTotal = 0;
+		size_t amtRead = 1;
+		while( ( readTotal < (size_t)fileSize ) && ( amtRead > 0 ) ) {
+			amtRead = SDL_RWread( rwopsFile, data + readTotal, sizeof( uint8_t ), (size_t)fileSize - readTotal );
+			readTotal += amtRead;
+		}
+
+		if( readTotal < (size_t)fileSize ) {
+			llog( LOG_ERROR, "Unable to read all of file %s", fileName );
+			mem_Release( data );
+			SDL_RWclose( rwopsFile );
+			return -1;
+		}
+	}
+	SDL_RWclose( rwopsFile );
+
+	outFile->data = data;
+	outFile->size = (size_t)fileSize;
+	outFile->isMapped = false;
+	return 0;
+}
+
+// Opens the file and gives access to all of its data. Safe to call from any thread.
+//  Returns >= 0 on success, < 0 if the file couldn't be opened. Nothing is logged if the file doesn't exist.
+int mf_Open( const char* fileName, MappedFile* outFile )
+{
+	assert( fileName != NULL );
+	assert( outFile != NULL );
+
+	memset( outFile, 0, sizeof( *outFile ) );
+
+#if defined( READ_WHOLE_FILE )
+	return readWholeFile( fileName, outFile );
+#elif defined( WIN32 )
+	HANDLE file = CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( file == INVALID_HANDLE_VALUE ) {
+		return -1;
+	}
+
+	LARGE_INTEGER fileSize;
+	if( !GetFileSizeEx( file, &fileSize ) || ( fileSize.QuadPart == 0 ) ) {
+		// can't map an empty file
+		CloseHandle( file );
+		return readWholeFile( fileName, outFile );
+	}
+
+	HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if( mapping == NULL ) {
+		llog( LOG_WARN, "Unable to map file %s, reading it instead. Error: %d", fileName, GetLastError( ) );
+		CloseHandle( file );
+		return readWholeFile( fileName, outFile );
+	}
+
+	const void* view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+	if( view == NULL ) {
+		llog( LOG_WARN, "Unable to map view of file %s, reading it instead. Error: %d", fileName, GetLastError( ) );
+		CloseHandle( mapping );
+		CloseHandle( file );
+		return readWholeFile( fileName, outFile );
+	}
+
+	outFile->data = (const uint8_t*)view;
+	outFile->size = (size_t)fileSize.QuadPart;
+	outFile->isMapped = true;
+	outFile->fileHandle = (void*)file;
+	outFile->mapHandle = (void*)mapping;
+	return 0;
+#else
+	int fd = open( fileName, O_RDONLY );
+	if( fd < 0 ) {
+		return -1;
+	}
+
+	struct stat fileStat;
+	if( ( fstat( fd, &fileStat ) < 0 ) || ( fileStat.st_size == 0 ) ) {
+		close( fd );
+		return readWholeFile( fileName, outFile );
+	}
+
+	void* view = mmap( NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	// the mapping stays valid after the file is closed
+	close( fd );
+	if( view == MAP_FAILED ) {
+		llog( LOG_WARN, "Unable to map file %s, reading it instead.", fileName );
+		return readWholeFile( fileName, outFile );
+	}
+
+	outFile->data = (const uint8_t*)view;
+	outFile->size = (size_t)fileStat.st_size;
+	outFile->isMapped = true;
+	return 0;
+#endif
+}
+
+// Releases everything opened with mf_Open, the data is invalid after this.
+void mf_Close( MappedFile* file )
+{
+	assert( file != NULL );
+
+	if( !file->isMapped ) {
+		mem_Release( (void*)file->data );
+	} else {
+#if defined( READ_WHOLE_FILE )
+		assert( false && "File shouldn't be mapped on this platform." );
+#elif defined( WIN32 )
+		UnmapViewOfFile( file->data );
+		CloseHandle( (HANDLE)file->mapHandle );
+		CloseHandle( (HANDLE)file->fileHandle );
+#else
+		munmap( (void*)file->data, file->size );
+#endif
+	}
+
+	memset( file, 0, sizeof( *file ) );
+}
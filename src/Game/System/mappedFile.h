@@ -0,0 +1,30 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+Read only access to the entire contents of a file. Where the platform supports it the file is memory mapped so nothing
+ is copied until it's touched, otherwise it's read into memory in one go (assets on Android live in the apk and on the web
+ they're in the preloaded file system, so they're always read).
+*/
+
+typedef struct {
+	const uint8_t* data;
+	size_t size;
+
+	bool isMapped; // otherwise data was allocated with mem_Allocate
+	void* fileHandle;
+	void* mapHandle;
+} MappedFile;
+
+// Opens the file and gives access to all of its data. Safe to call from any thread.
+//  Returns >= 0 on success, < 0 if the file couldn't be opened. Nothing is logged if the file doesn't exist.
+int mf_Open( const char* fileName, MappedFile* outFile );
+
+// Releases everything opened with mf_Open, the data is invalid after this.
+void mf_Close( MappedFile* file );
+
+#endif /* inclusion guard */
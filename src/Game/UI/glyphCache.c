@@ -0,0 +1,603 @@
+#include "glyphCache.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <stb_truetype.h>
+
+#include "../Graphics/gfxUtil.h"
+#include "../Utils/stretchyBuffer.h"
+#include "../Utils/intHashMap.h"
+#include "../Math/mathUtil.h"
+#include "../System/memory.h"
+#include "../System/platformLog.h"
+#include "../System/jobQueue.h"
+
+#define PAGE_SIZE 1024
+#define MAX_PAGES 4
+#define GLYPH_PADDING 1
+#define SHELF_HEIGHT_STEP 4
+#define MAX_CACHE_FONTS 32
+
+typedef struct {
+	Texture texture;
+	uint8_t* pixels; // copy of what's in the texture, rows are uploaded from this
+	int nextShelfY;
+	int dirtyMinY;
+	int dirtyMaxY; // exclusive, nothing to upload if dirtyMaxY <= dirtyMinY
+} GlyphPage;
+
+typedef struct {
+	int page;
+	int y;
+	int height;
+	int nextX;
+	uint32_t lastUsed;
+	int* sbGlyphs; // may have glyphs that have since been removed
+} GlyphShelf;
+
+typedef enum {
+	GS_UNUSED,
+	GS_PENDING,
+	GS_READY,
+	GS_NO_ROOM // rasterized but there was no space for it, tried again once a shelf is evicted
+} GlyphState;
+
+typedef struct {
+	GlyphState state;
+	uint32_t key;
+	int cacheFont;
+	int shelf; // -1 if it isn't in the atlas
+	int x;
+	int y;
+	int width;
+	int height;
+	Vector2 offset;
+	float advance;
+} GlyphEntry;
+
+typedef struct {
+	bool inUse;
+	bool removed; // waiting for rasterizations to finish before the data can be released
+	uint8_t* fontData;
+	stbtt_fontinfo info;
+	float scale;
+	int pendingJobs;
+	uint32_t generation;
+} CacheFont;
+
+typedef struct {
+	int cacheFont;
+	int glyph;
+	uint32_t key;
+	int glyphIndex;
+	int width;
+	int height;
+	uint8_t* bitmap;
+} RasterizeJobData;
+
+static GlyphPage pages[MAX_PAGES];
+static int numPages = 0;
+static GlyphShelf* sbShelves = NULL;
+static GlyphEntry* sbGlyphs = NULL;
+static int* sbFreeGlyphs = NULL;
+static int* sbNoRoomGlyphs = NULL; // may have glyphs that have since been removed
+static IntHashMap glyphMap; // key to index in sbGlyphs
+static CacheFont fonts[MAX_CACHE_FONTS];
+static uint32_t currentFrame = 1;
+
+// codepoints are at most 21 bits, so the font can go in the rest
+static uint32_t glyphKey( int cacheFont, uint32_t codepoint )
+{
+	return ( (uint32_t)cacheFont << 21 ) | ( codepoint & 0x1FFFFF );
+}
+
+static void releaseFontData( CacheFont* font )
+{
+	mem_Release( font->fontData );
+	memset( font, 0, sizeof( *font ) );
+}
+
+// Adds a font to create glyphs for. The cache takes ownership of fontData, which has to be allocated with mem_Allocate.
+//  Returns the id to use for the font, returns -1 if there was an issue.
+int glyphCache_AddFont( uint8_t* fontData, float pixelHeight )
+{
+	assert( fontData != NULL );
+
+	int idx = 0;
+	while( ( idx < MAX_CACHE_FONTS ) && fonts[idx].inUse ) {
+		++idx;
+	}
+	if( idx >= MAX_CACHE_FONTS ) {
+		llog( LOG_ERROR, "Unable to find empty glyph cache font." );
+		return -1;
+	}
+
+	CacheFont* font = &( fonts[idx] );
+	if( !stbtt_InitFont( &( font->info ), fontData, 0 ) ) {
+		llog( LOG_ERROR, "Unable to initialize font for the glyph cache." );
+		return -1;
+	}
+
+	if( glyphMap.valueSize == 0 ) {
+		ihm_Init( &glyphMap, sizeof( int ), 256 );
+	}
+
+	font->inUse = true;
+	font->removed = false;
+	font->fontData = fontData;
+	font->scale = stbtt_ScaleForPixelHeight( &( font->info ), pixelHeight );
+	font->pendingJobs = 0;
+	++font->generation;
+
+	return idx;
+}
+
+static void freeGlyph( int glyph )
+{
+	GlyphEntry* entry = &( sbGlyphs[glyph] );
+	assert( entry->state != GS_UNUSED );
+
+	ihm_Remove( &glyphMap, entry->key );
+	++fonts[entry->cacheFont].generation;
+
+	entry->state = GS_UNUSED;
+	entry->shelf = -1;
+	sb_Push( sbFreeGlyphs, glyph );
+}
+
+// Removes all the glyphs for the font, the font data will be released once any pending rasterizations are done.
+void glyphCache_RemoveFont( int cacheFontID )
+{
+	assert( cacheFontID >= 0 );
+	assert( cacheFontID < MAX_CACHE_FONTS );
+
+	CacheFont* font = &( fonts[cacheFontID] );
+	if( !font->inUse || font->removed ) {
+		return;
+	}
+
+	// the space in the shelves isn't reclaimed until they're evicted, they won't be used again so they'll go first
+	for( size_t i = 0; i < sb_Count( sbGlyphs ); ++i ) {
+		if( ( sbGlyphs[i].state != GS_UNUSED ) && ( sbGlyphs[i].cacheFont == cacheFontID ) ) {
+			freeGlyph( (int)i );
+		}
+	}
+
+	if( font->pendingJobs > 0 ) {
+		font->removed = true;
+	} else {
+		releaseFontData( font );
+	}
+}
+
+static void insertGlyphTask( void* data );
+
+static void rasterizeGlyphTask( void* data )
+{
+	RasterizeJobData* jobData = (RasterizeJobData*)data;
+
+	// the font info is only read from, and the font isn't released until all the rasterizations for it are done
+	CacheFont* font = &( fonts[jobData->cacheFont] );
+	jobData->bitmap = mem_Allocate( (size_t)jobData->width * (size_t)jobData->height );
+	if( jobData->bitmap != NULL ) {
+		stbtt_MakeGlyphBitmap( &( font->info ), jobData->bitmap, jobData->width, jobData->height, jobData->width,
+			font->scale, font->scale, jobData->glyphIndex );
+	} else {
+		llog( LOG_ERROR, "Unable to allocate glyph bitmap." );
+	}
+
+	jq_AddPrioritizedMainThreadJobWait( insertGlyphTask, data, JOB_PRIORITY_NORMAL );
+}
+
+// Gets the glyph for the codepoint. The advance will always be set, returns whether the glyph is ready to be drawn.
+//  If this is the first time the glyph was asked for it will start being rasterized.
+bool glyphCache_GetGlyph( int cacheFontID, uint32_t codepoint, CachedGlyph* outGlyph )
+{
+	assert( cacheFontID >= 0 );
+	assert( cacheFontID < MAX_CACHE_FONTS );
+	assert( outGlyph != NULL );
+
+	CacheFont* font = &( fonts[cacheFontID] );
+	assert( font->inUse && !font->removed );
+
+	uint32_t key = glyphKey( cacheFontID, codepoint );
+	int* existing = ihm_FindAs( &glyphMap, key, int );
+	if( existing != NULL ) {
+		GlyphEntry* entry = &( sbGlyphs[*existing] );
+		outGlyph->glyph = (*existing);
+		outGlyph->advance = entry->advance;
+		outGlyph->offset = entry->offset;
+		outGlyph->size.x = (float)entry->width;
+		outGlyph->size.y = (float)entry->height;
+
+		if( entry->state != GS_READY ) {
+			return false;
+		}
+
+		if( entry->shelf < 0 ) {
+			// nothing to draw, like a space
+			outGlyph->textureObj = 0;
+			outGlyph->uvMin = VEC2_ZERO;
+			outGlyph->uvMax = VEC2_ZERO;
+			return true;
+		}
+
+		GlyphShelf* shelf = &( sbShelves[entry->shelf] );
+		shelf->lastUsed = currentFrame;
+		outGlyph->textureObj = pages[shelf->page].texture.textureID;
+		outGlyph->uvMin.x = (float)entry->x / (float)PAGE_SIZE;
+		outGlyph->uvMin.y = (float)entry->y / (float)PAGE_SIZE;
+		outGlyph->uvMax.x = (float)( entry->x + entry->width ) / (float)PAGE_SIZE;
+		outGlyph->uvMax.y = (float)( entry->y + entry->height ) / (float)PAGE_SIZE;
+		return true;
+	}
+
+	// first time this glyph has been asked for, the metrics are cheap so get them now
+	int glyphIndex = stbtt_FindGlyphIndex( &( font->info ), (int)codepoint );
+
+	int advance, lsb;
+	stbtt_GetGlyphHMetrics( &( font->info ), glyphIndex, &advance, &lsb );
+
+	int ix0, iy0, ix1, iy1;
+	stbtt_GetGlyphBitmapBox( &( font->info ), glyphIndex, font->scale, font->scale, &ix0, &iy0, &ix1, &iy1 );
+
+	int glyph;
+	if( sb_Count( sbFreeGlyphs ) > 0 ) {
+		glyph = sb_Pop( sbFreeGlyphs );
+	} else {
+		glyph = (int)sb_Count( sbGlyphs );
+		sb_Add( sbGlyphs, 1 );
+	}
+
+	GlyphEntry* entry = &( sbGlyphs[glyph] );
+	entry->key = key;
+	entry->cacheFont = cacheFontID;
+	entry->shelf = -1;
+	entry->x = 0;
+	entry->y = 0;
+	entry->width = ix1 - ix0;
+	entry->height = iy1 - iy0;
+	entry->advance = (float)advance * font->scale;
+	entry->offset.x = ( ix0 + ix1 ) / 2.0f;
+	entry->offset.y = ( iy0 + iy1 ) / 2.0f;
+	ihm_Set( &glyphMap, key, &glyph );
+
+	outGlyph->glyph = glyph;
+	outGlyph->advance = entry->advance;
+	outGlyph->offset = entry->offset;
+	outGlyph->size.x = (float)entry->width;
+	outGlyph->size.y = (float)entry->height;
+	outGlyph->textureObj = 0;
+	outGlyph->uvMin = VEC2_ZERO;
+	outGlyph->uvMax = VEC2_ZERO;
+
+	if( ( entry->width <= 0 ) || ( entry->height <= 0 ) ) {
+		entry->width = 0;
+		entry->height = 0;
+		entry->state = GS_READY;
+		return true;
+	}
+
+	entry->state = GS_PENDING;
+
+	RasterizeJobData* jobData = mem_Allocate( sizeof( RasterizeJobData ) );
+	if( jobData == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate glyph rasterization data." );
+		freeGlyph( glyph );
+		return false;
+	}
+	jobData->cacheFont = cacheFontID;
+	jobData->glyph = glyph;
+	jobData->key = key;
+	jobData->glyphIndex = glyphIndex;
+	jobData->width = entry->width;
+	jobData->height = entry->height;
+	jobData->bitmap = NULL;
+
+	++font->pendingJobs;
+	if( !jq_AddJob( rasterizeGlyphTask, jobData ) ) {
+		--font->pendingJobs;
+		mem_Release( jobData );
+		freeGlyph( glyph );
+		return false;
+	}
+
+	return false;
+}
+
+// Marks the glyph as used this frame so it won't be evicted.
+void glyphCache_TouchGlyph( int glyph )
+{
+	assert( glyph >= 0 );
+	assert( glyph < (int)sb_Count( sbGlyphs ) );
+
+	int shelf = sbGlyphs[glyph].shelf;
+	if( shelf >= 0 ) {
+		sbShelves[shelf].lastUsed = currentFrame;
+	}
+}
+
+// Changes whenever glyphs for the font are added or removed.
+uint32_t glyphCache_GetGeneration( int cacheFontID )
+{
+	assert( cacheFontID >= 0 );
+	assert( cacheFontID < MAX_CACHE_FONTS );
+	return fonts[cacheFontID].generation;
+}
+
+static void markDirty( GlyphPage* page, int minY, int maxY )
+{
+	if( page->dirtyMaxY <= page->dirtyMinY ) {
+		page->dirtyMinY = minY;
+		page->dirtyMaxY = maxY;
+	} else {
+		page->dirtyMinY = MIN( page->dirtyMinY, minY );
+		page->dirtyMaxY = MAX( page->dirtyMaxY, maxY );
+	}
+}
+
+static int createPage( void )
+{
+	if( numPages >= MAX_PAGES ) {
+		return -1;
+	}
+
+	GlyphPage* page = &( pages[numPages] );
+	page->pixels = mem_Allocate( PAGE_SIZE * PAGE_SIZE );
+	if( page->pixels == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate glyph cache page." );
+		return -1;
+	}
+	memset( page->pixels, 0, PAGE_SIZE * PAGE_SIZE );
+
+	if( gfxUtil_CreateTextureFromAlphaBitmap( page->pixels, PAGE_SIZE, PAGE_SIZE, &( page->texture ) ) < 0 ) {
+		llog( LOG_ERROR, "Unable to create glyph cache page texture." );
+		mem_Release( page->pixels );
+		page->pixels = NULL;
+		return -1;
+	}
+
+	page->nextShelfY = 0;
+	page->dirtyMinY = 0;
+	page->dirtyMaxY = 0;
+
+	return numPages++;
+}
+
+// Clears out the shelf and everything in it so it can be reused.
+static void evictShelf( int shelfIdx )
+{
+	GlyphShelf* shelf = &( sbShelves[shelfIdx] );
+
+	for( size_t i = 0; i < sb_Count( shelf->sbGlyphs ); ++i ) {
+		int glyph = shelf->sbGlyphs[i];
+		if( ( sbGlyphs[glyph].state == GS_READY ) && ( sbGlyphs[glyph].shelf == shelfIdx ) ) {
+			freeGlyph( glyph );
+		}
+	}
+	sb_Clear( shelf->sbGlyphs );
+	shelf->nextX = 0;
+
+	// there's space now, so anything that didn't fit before is removed, it'll be rasterized again when the layouts
+	//  using it are rebuilt
+	for( size_t i = 0; i < sb_Count( sbNoRoomGlyphs ); ++i ) {
+		if( sbGlyphs[sbNoRoomGlyphs[i]].state == GS_NO_ROOM ) {
+			freeGlyph( sbNoRoomGlyphs[i] );
+		}
+	}
+	sb_Clear( sbNoRoomGlyphs );
+
+	// clear the old pixels so they can't bleed into the padding of new glyphs
+	GlyphPage* page = &( pages[shelf->page] );
+	memset( page->pixels + ( shelf->y * PAGE_SIZE ), 0, (size_t)shelf->height * PAGE_SIZE );
+	markDirty( page, shelf->y, shelf->y + shelf->height );
+}
+
+// Finds a place for a rectangle of the size, evicting the least recently used shelf if needed.
+//  Returns the shelf, or -1 if there's no room.
+static int allocateSpace( int width, int height, int* outX )
+{
+	// find the shelf that fits best, not wasting too much height
+	int best = -1;
+	for( size_t i = 0; i < sb_Count( sbShelves ); ++i ) {
+		GlyphShelf* shelf = &( sbShelves[i] );
+		if( ( shelf->height < height ) || ( shelf->height > ( height + ( height / 4 ) + SHELF_HEIGHT_STEP ) ) ||
+			( ( shelf->nextX + width ) > PAGE_SIZE ) ) {
+			continue;
+		}
+
+		if( ( best < 0 ) || ( shelf->height < sbShelves[best].height ) ) {
+			best = (int)i;
+		}
+	}
+
+	// start a new shelf
+	if( best < 0 ) {
+		int shelfHeight = ( ( height + SHELF_HEIGHT_STEP - 1 ) / SHELF_HEIGHT_STEP ) * SHELF_HEIGHT_STEP;
+
+		int page = -1;
+		for( int i = 0; ( i < numPages ) && ( page < 0 ); ++i ) {
+			if( ( pages[i].nextShelfY + shelfHeight ) <= PAGE_SIZE ) {
+				page = i;
+			}
+		}
+		if( page < 0 ) {
+			page = createPage( );
+		}
+
+		if( page >= 0 ) {
+			GlyphShelf newShelf;
+			newShelf.page = page;
+			newShelf.y = pages[page].nextShelfY;
+			newShelf.height = shelfHeight;
+			newShelf.nextX = 0;
+			newShelf.lastUsed = currentFrame;
+			newShelf.sbGlyphs = NULL;
+			sb_Push( sbShelves, newShelf );
+
+			pages[page].nextShelfY += shelfHeight;
+			best = (int)sb_Count( sbShelves ) - 1;
+		}
+	}
+
+	// everything's full, evict the least recently used shelf that's tall enough, anything used this frame has
+	//  already been drawn with so it has to stay
+	if( best < 0 ) {
+		for( size_t i = 0; i < sb_Count( sbShelves ); ++i ) {
+			GlyphShelf* shelf = &( sbShelves[i] );
+			if( ( shelf->height < height ) || ( shelf->lastUsed >= currentFrame ) ) {
+				continue;
+			}
+
+			if( ( best < 0 ) || ( shelf->lastUsed < sbShelves[best].lastUsed ) ) {
+				best = (int)i;
+			}
+		}
+
+		if( best >= 0 ) {
+			evictShelf( best );
+		}
+	}
+
+	if( best < 0 ) {
+		return -1;
+	}
+
+	(*outX) = sbShelves[best].nextX;
+	sbShelves[best].nextX += width;
+	return best;
+}
+
+static void insertGlyphTask( void* data )
+{
+	RasterizeJobData* jobData = (RasterizeJobData*)data;
+	CacheFont* font = &( fonts[jobData->cacheFont] );
+
+	--font->pendingJobs;
+	if( font->removed ) {
+		if( font->pendingJobs <= 0 ) {
+			releaseFontData( font );
+		}
+		goto clean_up;
+	}
+
+	// the glyph may have been removed and reused while this was being rasterized
+	GlyphEntry* entry = &( sbGlyphs[jobData->glyph] );
+	if( ( entry->state != GS_PENDING ) || ( entry->key != jobData->key ) ) {
+		goto clean_up;
+	}
+
+	if( jobData->bitmap == NULL ) {
+		freeGlyph( jobData->glyph );
+		goto clean_up;
+	}
+
+	int x;
+	int shelfIdx = allocateSpace( jobData->width + GLYPH_PADDING, jobData->height + GLYPH_PADDING, &x );
+	if( shelfIdx < 0 ) {
+		// no room right now, it stays in the map so it isn't requested again until a shelf is evicted, nothing
+		//  changed for the font so the generation stays the same
+		llog( LOG_VERBOSE, "Glyph cache is full." );
+		entry->state = GS_NO_ROOM;
+		sb_Push( sbNoRoomGlyphs, jobData->glyph );
+		goto clean_up;
+	}
+
+	GlyphShelf* shelf = &( sbShelves[shelfIdx] );
+	GlyphPage* page = &( pages[shelf->page] );
+	for( int row = 0; row < jobData->height; ++row ) {
+		memcpy( page->pixels + ( ( shelf->y + row ) * PAGE_SIZE ) + x, jobData->bitmap + ( row * jobData->width ), jobData->width );
+	}
+	markDirty( page, shelf->y, shelf->y + jobData->height );
+
+	entry->state = GS_READY;
+	entry->shelf = shelfIdx;
+	entry->x = x;
+	entry->y = shelf->y;
+	sb_Push( shelf->sbGlyphs, jobData->glyph );
+	shelf->lastUsed = currentFrame;
+
+	++font->generation;
+
+clean_up:
+	mem_Release( jobData->bitmap );
+	mem_Release( jobData );
+}
+
+// Uploads any glyphs added since the last update, should be called once a frame before anything is drawn.
+void glyphCache_Update( void )
+{
+	// if glyphs didn't fit because every shelf was in use, evict the least recently used shelf that wasn't drawn
+	//  with this frame so they get another chance
+	if( sb_Count( sbNoRoomGlyphs ) > 0 ) {
+		int height = 0;
+		for( size_t i = 0; i < sb_Count( sbNoRoomGlyphs ); ++i ) {
+			GlyphEntry* entry = &( sbGlyphs[sbNoRoomGlyphs[i]] );
+			if( entry->state == GS_NO_ROOM ) {
+				height = MAX( height, entry->height + GLYPH_PADDING );
+			}
+		}
+
+		int best = -1;
+		for( size_t i = 0; ( height > 0 ) && ( i < sb_Count( sbShelves ) ); ++i ) {
+			GlyphShelf* shelf = &( sbShelves[i] );
+			if( ( shelf->height < height ) || ( shelf->lastUsed >= currentFrame ) ) {
+				continue;
+			}
+
+			if( ( best < 0 ) || ( shelf->lastUsed < sbShelves[best].lastUsed ) ) {
+				best = (int)i;
+			}
+		}
+
+		if( best >= 0 ) {
+			evictShelf( best );
+		} else if( height <= 0 ) {
+			sb_Clear( sbNoRoomGlyphs );
+		}
+	}
+
+	for( int i = 0; i < numPages; ++i ) {
+		GlyphPage* page = &( pages[i] );
+		if( page->dirtyMaxY <= page->dirtyMinY ) {
+			continue;
+		}
+
+		gfxUtil_UpdateAlphaBitmapRows( &( page->texture ), page->pixels, page->dirtyMinY, page->dirtyMaxY - page->dirtyMinY );
+		page->dirtyMinY = 0;
+		page->dirtyMaxY = 0;
+	}
+
+	++currentFrame;
+}
+
+// Releases all the pages and fonts. Call this after jq_ShutDown( ) so no rasterizations are running, any that never
+//  started are dropped so their fonts are released here.
+void glyphCache_CleanUp( void )
+{
+	for( int i = 0; i < MAX_CACHE_FONTS; ++i ) {
+		if( fonts[i].inUse ) {
+			glyphCache_RemoveFont( i );
+			if( fonts[i].inUse ) {
+				releaseFontData( &( fonts[i] ) );
+			}
+		}
+	}
+
+	for( int i = 0; i < numPages; ++i ) {
+		gfxUtil_UnloadTexture( &( pages[i].texture ) );
+		mem_Release( pages[i].pixels );
+		pages[i].pixels = NULL;
+	}
+	numPages = 0;
+
+	for( size_t i = 0; i < sb_Count( sbShelves ); ++i ) {
+		sb_Release( sbShelves[i].sbGlyphs );
+	}
+	sb_Release( sbShelves );
+	sb_Release( sbGlyphs );
+	sb_Release( sbFreeGlyphs );
+	sb_Release( sbNoRoomGlyphs );
+	ihm_Release( &glyphMap );
+}
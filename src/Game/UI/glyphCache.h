@@ -0,0 +1,54 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../Graphics/glPlatform.h"
+#include "../Math/vector2.h"
+
+/*
+Creates glyph images as they're needed instead of all when the font is loaded.
+ The first time a glyph is asked for it's rasterized on a worker thread, once that's done it's packed into a shelf of
+ one of the atlas pages on the main thread. All the glyphs added to a page since the last update are uploaded together
+ in glyphCache_Update. When the pages fill up the least recently used shelf is cleared out to make room.
+ Any time glyphs for a font are added or removed the generation for the font is changed, anything that stores the
+ texture coordinates of glyphs should check it to see if they need to be created again.
+ Everything other than the rasterization is done on the main thread.
+*/
+
+typedef struct {
+	int glyph; // pass to glyphCache_TouchGlyph when drawing
+	GLuint textureObj;
+	Vector2 uvMin;
+	Vector2 uvMax;
+	Vector2 size;
+	Vector2 offset; // from the pen position on the base line to the center of the glyph
+	float advance;
+} CachedGlyph;
+
+// Adds a font to create glyphs for. The cache takes ownership of fontData, which has to be allocated with mem_Allocate.
+//  Returns the id to use for the font, returns -1 if there was an issue.
+int glyphCache_AddFont( uint8_t* fontData, float pixelHeight );
+
+// Removes all the glyphs for the font, the font data will be released once any pending rasterizations are done.
+void glyphCache_RemoveFont( int cacheFontID );
+
+// Gets the glyph for the codepoint. The advance will always be set, returns whether the glyph is ready to be drawn.
+//  If this is the first time the glyph was asked for it will start being rasterized.
+bool glyphCache_GetGlyph( int cacheFontID, uint32_t codepoint, CachedGlyph* outGlyph );
+
+// Marks the glyph as used this frame so it won't be evicted.
+void glyphCache_TouchGlyph( int glyph );
+
+// Changes whenever glyphs for the font are added or removed.
+uint32_t glyphCache_GetGeneration( int cacheFontID );
+
+// Uploads any glyphs added since the last update, should be called once a frame before anything is drawn.
+void glyphCache_Update( void );
+
+// Releases all the pages and fonts. Rasterizations that are running aren't waited on, so call this after jq_ShutDown( ),
+//  which waits for them, rasterizations that never started are dropped.
+void glyphCache_CleanUp( void );
+
+#endif /* inclusion guard */
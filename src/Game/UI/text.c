@@ -1,11 +1,10 @@
 #include "text.h"
 
-// TODO: Ability to cache string images
-
 #include <SDL_rwops.h>
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../System/memory.h"
@@ -43,6 +42,10 @@
 #include "../System/jobQueue.h"
 
 #include "../Graphics/gfxUtil.h"
+#include "../Graphics/graphics.h"
+#include "glyphCache.h"
+#include "../Utils/distanceTransform.h"
+#include "../System/gameTime.h"
 
 typedef struct {
 	int32_t codepoint;
@@ -50,12 +53,19 @@ typedef struct {
 	float advance;
 } Glyph;
 
+typedef struct {
+	int32_t codepoint;
+	int glyphIdx;
+} GlyphLookup;
+
 static const uint32_t LINE_FEED = 0xA;
+static const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
 
 // used for when we want to modify a string but don't want to change what was passed in
 static uint32_t* sbStringCodepointBuffer = NULL;
 
 #define MAX_FONTS 32
+#define LATIN1_GLYPH_COUNT 256
 typedef struct {
 	// this will be sorted by the codepoint entry in all the structs, make it easier to search
 	//  could also preprocess strings to just be a list of indices into the buffer
@@ -65,6 +75,11 @@ typedef struct {
 
 	int missingCharGlyphIdx;
 
+	// glyphs for the Basic Latin and Latin-1 Supplement blocks are looked up directly, everything else is found with a
+	//  binary search of sbSortedGlyphs
+	int latin1Glyphs[LATIN1_GLYPH_COUNT]; // index into glyphsBuffer, -1 if the font doesn't have it
+	GlyphLookup* sbSortedGlyphs;
+
 	float descent;
 	float lineGap;
 	float ascent;
@@ -72,11 +87,89 @@ typedef struct {
 	float nextLineDescent;
 
 	int baseSize;
+
+	// dynamic fonts create their glyphs in the glyph cache as they're used instead of having a fixed set of images
+	bool isDynamic;
+	int cacheFontID;
 } Font;
 
 static int missingChar = 0x3F; // '?'
 
 static Font fonts[MAX_FONTS] = { 0 };
+
+// text layouts
+//  the quads for a string are positioned relative to where it's drawn, so the same layout can be used for any position,
+//  color, or camera
+typedef struct {
+	Vector2 min;
+	Vector2 max;
+	Vector2 uvMin;
+	Vector2 uvMax;
+	GLuint texture;
+	int cacheGlyph; // -1 if the font isn't dynamic
+} TextQuad;
+
+typedef struct {
+	TextQuad* sbQuads;
+	ShaderType shaderType;
+	TriType triType;
+	uint32_t generation; // glyph cache generation of the font when this was created, only used for dynamic fonts
+} TextLayout;
+
+// layouts used by txt_DisplayString, set associative so finding one only has to check a few entries
+#define LAYOUT_CACHE_SETS 64
+#define LAYOUT_CACHE_WAYS 4
+typedef struct {
+	uint32_t hash;
+	char* str; // NULL if the entry is unused
+	int fontID;
+	float pixelSize;
+	HorizTextAlignment hAlign;
+	VertTextAlignment vAlign;
+	uint32_t lastUsed;
+	TextLayout layout;
+} CachedLayout;
+
+static CachedLayout layoutCache[LAYOUT_CACHE_SETS][LAYOUT_CACHE_WAYS];
+static uint32_t layoutCacheTime = 0;
+
+// retained text
+typedef struct {
+	bool inUse;
+	bool dirty;
+	char* str;
+	int fontID;
+	float pixelSize;
+	HorizTextAlignment hAlign;
+	VertTextAlignment vAlign;
+	TextLayout layout;
+} TextObject;
+
+static TextObject* sbTextObjects = NULL;
+
+// scratch layout for txt_DisplayTextArea, the wrapping depends on the area so these aren't cached
+static TextLayout textAreaLayout = { 0 };
+
+// everything to be drawn this frame, the quads are copied out of the layouts so the layouts can change before rendering
+typedef struct {
+	TriVert verts[4];
+	GLuint texture;
+} TextDrawQuad;
+
+typedef struct {
+	size_t firstQuad;
+	size_t numQuads;
+	ShaderType shaderType;
+	TriType triType;
+	uint32_t camFlags;
+	int8_t depth;
+} TextDraw;
+
+static TextDrawQuad* sbDrawQuads = NULL;
+static TextDraw* sbDraws = NULL;
+
+static void drawAllText( float t );
+static void clearTextDraws( void );
 // TODO: for localization we can define stbtt_pack_range for each language and link them together to be loaded
 stbtt_pack_range fontPackRange = { 0 };
 
@@ -93,10 +186,21 @@ int txt_Init( void )
 			sb_Release( fonts[i].glyphsBuffer );
 		}
 		fonts[i].glyphsBuffer = NULL;
+		sb_Release( fonts[i].sbSortedGlyphs );
+
+		if( fonts[i].isDynamic ) {
+			glyphCache_RemoveFont( fonts[i].cacheFontID );
+			fonts[i].isDynamic = false;
+		}
 	}
 
 	sb_Add( sbStringCodepointBuffer, 1024 );
 
+	gfx_RemoveDrawTrisFunc( drawAllText );
+	gfx_RemoveClearCommand( clearTextDraws );
+	gfx_AddDrawTrisFunc( drawAllText );
+	gfx_AddClearCommand( clearTextDraws );
+
 	return 0;
 }
 
@@ -117,11 +221,63 @@ void txt_AddCharacterToLoad( int c )
 	fontPackRange.num_chars = sb_Count( fontPackRange.array_of_unicode_codepoints );
 }
 
+static int compareGlyphLookups( const void* pLeft, const void* pRight )
+{
+	const GlyphLookup* left = (const GlyphLookup*)pLeft;
+	const GlyphLookup* right = (const GlyphLookup*)pRight;
+
+	if( left->codepoint != right->codepoint ) {
+		return ( left->codepoint < right->codepoint ) ? -1 : 1;
+	}
+	return ( left->glyphIdx - right->glyphIdx );
+}
+
+// Creates the tables used to find the glyph for a codepoint, call after the glyphs for the font have been set.
+//  If a codepoint has multiple glyphs the first one is used.
+static void buildGlyphLookup( Font* font )
+{
+	for( int i = 0; i < LATIN1_GLYPH_COUNT; ++i ) {
+		font->latin1Glyphs[i] = -1;
+	}
+	sb_Clear( font->sbSortedGlyphs );
+
+	for( size_t i = 0; i < sb_Count( font->glyphsBuffer ); ++i ) {
+		int32_t codepoint = font->glyphsBuffer[i].codepoint;
+		if( ( codepoint >= 0 ) && ( codepoint < LATIN1_GLYPH_COUNT ) ) {
+			if( font->latin1Glyphs[codepoint] < 0 ) {
+				font->latin1Glyphs[codepoint] = (int)i;
+			}
+		} else {
+			GlyphLookup lookup = { codepoint, (int)i };
+			sb_Push( font->sbSortedGlyphs, lookup );
+		}
+	}
+
+	size_t count = sb_Count( font->sbSortedGlyphs );
+	if( count > 1 ) {
+		qsort( font->sbSortedGlyphs, count, sizeof( font->sbSortedGlyphs[0] ), compareGlyphLookups );
+
+		// remove the duplicates, after sorting the first glyph for each codepoint comes first
+		size_t used = 1;
+		for( size_t i = 1; i < count; ++i ) {
+			if( font->sbSortedGlyphs[i].codepoint != font->sbSortedGlyphs[used - 1].codepoint ) {
+				font->sbSortedGlyphs[used++] = font->sbSortedGlyphs[i];
+			}
+		}
+		sb__Used( font->sbSortedGlyphs ) = used;
+	}
+}
+
+static bool fontInUse( int fontID )
+{
+	return ( ( fonts[fontID].glyphsBuffer != NULL ) || fonts[fontID].isDynamic );
+}
+
 int findUnusedFontID( void )
 {
 	int newFont = 0;
 
-	while( fonts[newFont].glyphsBuffer != NULL ) {
+	while( ( newFont < MAX_FONTS ) && fontInUse( newFont ) ) {
 		++newFont;
 	}
 	if( newFont >= MAX_FONTS ) {
@@ -280,6 +436,7 @@ int txt_LoadFont( const char* fileName, int pixelHeight )
 		offset.y = ( quad.y0 + quad.y1 ) / 2.0f;
 		img_SetOffset( retIDs[i], offset );
 	}
+	buildGlyphLookup( &( fonts[newFont] ) );
 
 	// TODO: get a way to do this with fewer temporary allocations
 clean_up:
@@ -300,8 +457,7 @@ clean_up:
 }
 
 typedef struct {
-	const char* fileName;
-	int* outFontID;
+	char* fileName;
 
 	stbtt_pack_range packRange; // in case stuff changes while loading the font
 
@@ -316,36 +472,32 @@ typedef struct {
 	unsigned char* bmpBuffer;
 } LoadFontData;
 
-static void cleanUpLoadFontTaskData( LoadFontData* data )
+static int fontAssetType = -1;
+
+static void cleanUpLoadFontTaskData( void* data )
 {
 	if( data == NULL ) return;
 
-	mem_Release( data->packRange.chardata_for_range );
-	mem_Release( data->packRange.array_of_unicode_codepoints );
-	mem_Release( data->bmpBuffer );
+	LoadFontData* fontData = (LoadFontData*)data;
+	mem_Release( fontData->packRange.chardata_for_range );
+	mem_Release( fontData->packRange.array_of_unicode_codepoints );
+	mem_Release( fontData->bmpBuffer );
+	mem_Release( fontData->fileName );
 
-	mem_Release( data );
+	mem_Release( fontData );
 }
 
-static void bindFontTask( void* data )
+static int bindFontTask( void* data )
 {
-	int newFont = 0;
+	int newFont = -1;
 	Vector2* mins = NULL;
 	Vector2* maxes = NULL;
 	int* retIDs = NULL;
-	LoadFontData* fontData = NULL;
-
-	if( data == NULL ) {
-		llog( LOG_ERROR, "NULL data passed to bindFontTask." );
-		goto clean_up;
-	}
-	fontData = (LoadFontData*)data;
+	LoadFontData* fontData = (LoadFontData*)data;
 
 	// find an unused font ID
-	while( fonts[newFont].glyphsBuffer != NULL ) {
-		++newFont;
-	}
-	if( newFont >= MAX_FONTS ) {
+	newFont = findUnusedFontID( );
+	if( newFont < 0 ) {
 		llog( LOG_ERROR, "Unable to find empty font to use for %s", fontData->fileName );
 		goto clean_up;
 	}
@@ -412,26 +564,21 @@ static void bindFontTask( void* data )
 		offset.y = ( quad.y0 + quad.y1 ) / 2.0f;
 		img_SetOffset( retIDs[i], offset );
 	}
-
-	// all done, set our new font
-	(*(fontData->outFontID)) = newFont;
+	buildGlyphLookup( &( fonts[newFont] ) );
 
 clean_up:
 	mem_Release( mins );
 	mem_Release( maxes );
 	mem_Release( retIDs );
 
-	cleanUpLoadFontTaskData( fontData );
+	return newFont;
 }
 
-static void loadFontTask( void* data )
+static bool loadFontTask( void* data )
 {
 	uint8_t* buffer = NULL;
 	SDL_RWops* rwopsFile = NULL;
-
-	if( data == NULL ) {
-		return;
-	}
+	bool success = false;
 
 	LoadFontData* fontData = (LoadFontData*)data;
 
@@ -440,13 +587,13 @@ static void loadFontTask( void* data )
 	buffer = mem_Allocate( bufferSize * sizeof( uint8_t ) ); // megabyte sized buffer, should never load a file larger than this
 	if( buffer == NULL ) {
 		llog( LOG_WARN, "Error allocating font data buffer for %s", fontData->fileName );
-		goto failure;
+		goto clean_up;
 	}
 
 	rwopsFile = SDL_RWFromFile( fontData->fileName, "r" );
 	if( rwopsFile == NULL ) {
 		llog( LOG_ERROR, "Error opening font file %s", fontData->fileName );
-		goto failure;
+		goto clean_up;
 	}
 
 	size_t numRead = SDL_RWread( rwopsFile, (void*)buffer, sizeof( uint8_t ), bufferSize );
@@ -476,53 +623,53 @@ static void loadFontTask( void* data )
 	fontData->bmpBuffer = mem_Allocate( sizeof( unsigned char ) * fontData->bmpWidth * fontData->bmpHeight ); // the 4 allows room for expansion
 	if( fontData->bmpBuffer == NULL ) {
 		llog( LOG_ERROR, "Unable to allocate bitmap memory for %s", fontData->fileName );
-		goto failure;
+		goto clean_up;
 	}
 	// TODO: Test oversampling
 	if( !stbtt_PackBegin( &packContext, fontData->bmpBuffer, fontData->bmpWidth, fontData->bmpHeight, 0, 1, NULL ) ) {
 		llog( LOG_ERROR, "Unable to begin packing ranges for %s", fontData->fileName );
-		goto failure;
+		goto clean_up;
 	}
 
 	int wasPacked = stbtt_PackFontRanges( &packContext, (unsigned char*)buffer, 0, &( fontData->packRange ), 1 );
 	stbtt_PackEnd( &packContext );
 	if( !wasPacked ) {
 		llog( LOG_ERROR, "Unable to pack ranges for %s", fontData->fileName );
-		goto failure;
-	}
-
-	if( !jq_AddMainThreadJob( bindFontTask, data ) ) {
-		goto failure;
-	} else {
 		goto clean_up;
 	}
 
-failure:
-	cleanUpLoadFontTaskData( fontData );
+	success = true;
 
 clean_up:
 	mem_Release( buffer );
-	SDL_RWclose( rwopsFile );
+	if( rwopsFile != NULL ) {
+		SDL_RWclose( rwopsFile );
+	}
+
+	return success;
 }
 
-// Loads the font at file name on a seperate thread. Uses a height of pixelHeight.
-// This will initialize a bunch of stuff but not do any of the loading.
-//  Puts the resulting font ID into outFontID.
-void txt_ThreadedLoadFont( const char* fileName, float pixelHeight, int* outFontID )
+// Copies everything that can change while the font is loading.
+static void* createFontLoad( const char* fileName, const void* params )
 {
-	(*outFontID) = -1;
-
 	LoadFontData* data = mem_Allocate( sizeof( LoadFontData ) );
 	if( data == NULL ) {
 		llog( LOG_WARN, "Unable to create data for threaded font load for file %s", fileName );
-		return;
+		return NULL;
 	}
+	memset( data, 0, sizeof( *data ) );
 
 	// initalize all the data we'll need
-	data->fileName = fileName;
-	data->outFontID = outFontID;
+	size_t fileNameSize = strlen( fileName ) + 1;
+	data->fileName = mem_Allocate( fileNameSize );
+	if( data->fileName == NULL ) {
+		llog( LOG_WARN, "Unable to create file name storage for threaded font load for file %s", fileName );
+		mem_Release( data );
+		return NULL;
+	}
+	memcpy( data->fileName, fileName, fileNameSize );
 
-	data->packRange.font_size = pixelHeight;
+	data->packRange.font_size = *( (const float*)params );
 	data->packRange.num_chars = fontPackRange.num_chars;
 	data->packRange.first_unicode_codepoint_in_range = fontPackRange.first_unicode_codepoint_in_range;
 
@@ -530,143 +677,584 @@ void txt_ThreadedLoadFont( const char* fileName, float pixelHeight, int* outFont
 
 	size_t codePointsSize = sizeof( data->packRange.array_of_unicode_codepoints[0] ) * sb_Count( fontPackRange.array_of_unicode_codepoints );
 	data->packRange.array_of_unicode_codepoints = mem_Allocate( codePointsSize );
-	memcpy( data->packRange.array_of_unicode_codepoints, fontPackRange.array_of_unicode_codepoints, codePointsSize );
 
 	data->bmpBuffer = NULL;
 
-	if( !jq_AddJob( loadFontTask, data ) ) {
+	if( ( data->packRange.chardata_for_range == NULL ) || ( data->packRange.array_of_unicode_codepoints == NULL ) ) {
+		llog( LOG_WARN, "Unable to allocate character data for threaded font load for file %s", fileName );
 		cleanUpLoadFontTaskData( data );
+		return NULL;
 	}
+	memcpy( data->packRange.array_of_unicode_codepoints, fontPackRange.array_of_unicode_codepoints, codePointsSize );
+
+	return data;
 }
 
+// Loads the font at file name on a job thread, the images are created on the main thread by asset_ProcessUploads.
+//  Uses a height of pixelHeight. Use asset_Get with the handle to get the font ID, it will be -1 until the font is
+//  ready. Release the handle with asset_Release when it's no longer needed.
+AssetHandle txt_ThreadedLoadFont( const char* fileName, float pixelHeight, AssetPriority priority )
+{
+	assert( fileName != NULL );
+
+	if( fontAssetType < 0 ) {
+		AssetLoader loader;
+		loader.create = createFontLoad;
+		loader.load = loadFontTask;
+		loader.bind = bindFontTask;
+		loader.destroy = cleanUpLoadFontTaskData;
+		loader.unload = txt_UnloadFont;
+		loader.paramsSize = sizeof( float );
+		loader.usesGPU = true;
+		fontAssetType = asset_RegisterType( &loader );
+		if( fontAssetType < 0 ) {
+			return INVALID_ASSET_HANDLE;
+		}
+	}
+
+	return asset_Request( fontAssetType, fileName, &pixelHeight, priority );
+}
+
+// Loads the font at fileName, with a height of pixelHeight. Instead of creating images for a fixed set of characters
+//  the glyphs are created as they're used, so any character in the font can be displayed.
+//  Returns an ID to be used when displaying a string, returns -1 if there was an issue.
+int txt_LoadDynamicFont( const char* fileName, int pixelHeight )
+{
+	uint8_t* buffer = NULL;
+	SDL_RWops* rwopsFile = NULL;
+
+	int newFont = findUnusedFontID( );
+	if( newFont < 0 ) {
+		llog( LOG_ERROR, "Unable to find empty font to use for %s", fileName );
+		goto clean_up;
+	}
+
+	rwopsFile = SDL_RWFromFile( fileName, "r" );
+	if( rwopsFile == NULL ) {
+		llog( LOG_ERROR, "Error opening font file %s", fileName );
+		newFont = -1;
+		goto clean_up;
+	}
+
+	// the font data has to stay around for the glyphs to be created from it, so read in the whole file
+	Sint64 fileSize = SDL_RWsize( rwopsFile );
+	if( fileSize <= 0 ) {
+		llog( LOG_ERROR, "Unable to get size of font file %s", fileName );
+		newFont = -1;
+		goto clean_up;
+	}
+
+	buffer = mem_Allocate( (size_t)fileSize );
+	if( buffer == NULL ) {
+		llog( LOG_ERROR, "Error allocating font data buffer for %s", fileName );
+		newFont = -1;
+		goto clean_up;
+	}
+
+	if( SDL_RWread( rwopsFile, (void*)buffer, sizeof( uint8_t ), (size_t)fileSize ) != (size_t)fileSize ) {
+		llog( LOG_ERROR, "Unable to read font file %s", fileName );
+		newFont = -1;
+		goto clean_up;
+	}
+
+	stbtt_fontinfo font;
+	if( !stbtt_InitFont( &font, buffer, 0 ) ) {
+		llog( LOG_ERROR, "Unable to initialize font %s", fileName );
+		newFont = -1;
+		goto clean_up;
+	}
+
+	int ascent, descent, lineGap;
+	stbtt_GetFontVMetrics( &font, &ascent, &descent, &lineGap );
+	float scale = stbtt_ScaleForPixelHeight( &font, (float)pixelHeight );
+
+	int cacheFontID = glyphCache_AddFont( buffer, (float)pixelHeight );
+	if( cacheFontID < 0 ) {
+		llog( LOG_ERROR, "Unable to add font %s to the glyph cache", fileName );
+		newFont = -1;
+		goto clean_up;
+	}
+	buffer = NULL; // owned by the glyph cache now
+
+	fonts[newFont].ascent = (float)ascent * scale;
+	fonts[newFont].descent = (float)descent * scale;
+	fonts[newFont].lineGap = (float)lineGap * scale;
+	fonts[newFont].nextLineDescent = fonts[newFont].ascent - fonts[newFont].descent + fonts[newFont].lineGap;
+	fonts[newFont].baseSize = pixelHeight;
+	fonts[newFont].isDynamic = true;
+	fonts[newFont].cacheFontID = cacheFontID;
+
+clean_up:
+	mem_Release( buffer );
+	if( rwopsFile != NULL ) {
+		SDL_RWclose( rwopsFile );
+	}
+
+	return newFont;
+}
+
+static void invalidateFontLayouts( int fontID );
+
 void txt_UnloadFont( int fontID )
 {
 	assert( fontID >= 0 );
 
+	invalidateFontLayouts( fontID );
+
+	if( fonts[fontID].isDynamic ) {
+		glyphCache_RemoveFont( fonts[fontID].cacheFontID );
+		fonts[fontID].isDynamic = false;
+		return;
+	}
+
 	sb_Release( fonts[fontID].glyphsBuffer );
 	fonts[fontID].glyphsBuffer = NULL;
+	sb_Release( fonts[fontID].sbSortedGlyphs );
 	img_CleanPackage( fonts[fontID].packageID );
 }
 
 Glyph* getCodepointGlyph( int fontID, int codepoint )
 {
 	Font* font = &( fonts[fontID] );
-	Glyph* out = NULL;
-	int glyphCount = sb_Count( font->glyphsBuffer );
-	// TODO: Make this faster
-	for( int i = 0; i < glyphCount; ++i ) {
-		if( font->glyphsBuffer[i].codepoint == codepoint ) {
-			return &( font->glyphsBuffer[i] );
+	int idx = -1;
+
+	if( ( codepoint >= 0 ) && ( codepoint < LATIN1_GLYPH_COUNT ) ) {
+		idx = font->latin1Glyphs[codepoint];
+	} else {
+		size_t low = 0;
+		size_t high = sb_Count( font->sbSortedGlyphs );
+		while( low < high ) {
+			size_t mid = ( low + high ) / 2;
+			if( font->sbSortedGlyphs[mid].codepoint < codepoint ) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+
+		if( ( low < sb_Count( font->sbSortedGlyphs ) ) && ( font->sbSortedGlyphs[low].codepoint == codepoint ) ) {
+			idx = font->sbSortedGlyphs[low].glyphIdx;
 		}
 	}
-	return &( font->glyphsBuffer[ font->missingCharGlyphIdx ] );
+
+	if( idx < 0 ) {
+		idx = font->missingCharGlyphIdx;
+	}
+	return &( font->glyphsBuffer[idx] );
 }
 
+// length of the sequence based on the top five bits of the first byte, 0 if it can't start a sequence
+static const uint8_t utf8SequenceLengths[32] = {
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	0, 0, 0, 0, 0, 0, 0, 0,
+	2, 2, 2, 2,
+	3, 3,
+	4,
+	0
+};
+
+// smallest codepoint that can be encoded by each sequence length, anything less is an overlong encoding
+static const uint32_t utf8MinCodepoints[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+
 // Gets the code point from a string, will advance the string past the current codepoint to the next.
+//  Invalid sequences return U+FFFD and only advance past the first byte, so a missing null terminator can't be skipped.
+//  https://tools.ietf.org/html/rfc3629
 uint32_t getUTF8CodePoint( const uint8_t** strData )
 {
-	// TODO: Get this working with actual UTF-8 and not just the ASCII subset
-	//  https://tools.ietf.org/html/rfc3629
-	uint32_t c = (**strData);
-	++(*strData);
+	const uint8_t* str = (*strData);
+	uint32_t c = str[0];
+
+	if( c < 0x80 ) {
+		++(*strData);
+		return c;
+	}
+
+	int length = utf8SequenceLengths[c >> 3];
+	if( length < 2 ) {
+		++(*strData);
+		return REPLACEMENT_CHARACTER;
+	}
+
+	// the continuation bytes all have to be 10xxxxxx, the null terminator will fail this so we never read past it
+	c &= ( 0x7F >> length );
+	for( int i = 1; i < length; ++i ) {
+		if( ( str[i] & 0xC0 ) != 0x80 ) {
+			++(*strData);
+			return REPLACEMENT_CHARACTER;
+		}
+		c = ( c << 6 ) | ( str[i] & 0x3F );
+	}
+
+	if( ( c < utf8MinCodepoints[length] ) || ( c > 0x10FFFF ) || ( ( c >= 0xD800 ) && ( c <= 0xDFFF ) ) ) {
+		++(*strData);
+		return REPLACEMENT_CHARACTER;
+	}
+
+	(*strData) += length;
 	return c;
 }
 
-// Gets the total width of the string once it's been rendered
-float calcStringRenderWidth( const uint8_t* str, int fontID, float scale )
+// Gets how far the pen moves for the codepoint at the base size of the font.
+static float getAdvance( int fontID, uint32_t codepoint )
 {
-	float width = 0.0f;
-
-	uint32_t codepoint = 0;
-	do {
-		codepoint = getUTF8CodePoint( &str );
-		if( ( codepoint == 0 ) || ( codepoint == LINE_FEED ) ) {
-			// end of string/line do nothing
-		} else {
-			Glyph* glyph = getCodepointGlyph( fontID, codepoint );
-			width += ( glyph->advance * scale );
-		}
-	} while( ( codepoint != 0 ) && ( codepoint != LINE_FEED ) );
+	if( fonts[fontID].isDynamic ) {
+		CachedGlyph cached;
+		glyphCache_GetGlyph( fonts[fontID].cacheFontID, codepoint, &cached );
+		return cached.advance;
+	}
 
-	return width;
+	return getCodepointGlyph( fontID, (int)codepoint )->advance;
 }
 
 float calcCodepointsRenderWidth( const uint32_t* str, int fontID, float scale )
 {
 	float width = 0.0f;
 	for( int i = 0; ( str[i] != 0 ) && ( str[i] != LINE_FEED ); ++i ) {
-		width += getCodepointGlyph( fontID, str[i] )->advance;
+		width += getAdvance( fontID, str[i] );
 	}
 	return width * scale;
 }
 
-void positionStringStartX( const uint8_t* str, int fontID, HorizTextAlignment align, float scale, Vector2* inOutPos )
+void positionCodepointsStartX( const uint32_t* codeptStr, int fontID, HorizTextAlignment align, float width, float scale, Vector2* inOutPos )
 {
 	switch( align ) {
 	case HORIZ_ALIGN_RIGHT:
-		inOutPos->x -= calcStringRenderWidth( str, fontID, scale );
+		inOutPos->x += width - calcCodepointsRenderWidth( codeptStr, fontID, scale );
 		break;
 	case HORIZ_ALIGN_CENTER:
-		inOutPos->x -= ( calcStringRenderWidth( str, fontID, scale ) / 2.0f );
+		inOutPos->x += ( width / 2.0f ) - ( calcCodepointsRenderWidth( codeptStr, fontID, scale ) / 2.0f );
 		break;
 	/*case HORIZ_ALIGN_LEFT:
-	default:
 		// nothing to do
 		break;*/
 	}
 }
 
-void positionCodepointsStartX( const uint32_t* codeptStr, int fontID, HorizTextAlignment align, float width, float scale, Vector2* inOutPos )
+// Moves the quads for a line so it's aligned horizontally around the start position.
+static void alignLine( TextLayout* layout, size_t firstQuad, float lineWidth, HorizTextAlignment hAlign )
 {
-	switch( align ) {
+	float shift = 0.0f;
+	switch( hAlign ) {
 	case HORIZ_ALIGN_RIGHT:
-		inOutPos->x += width - calcCodepointsRenderWidth( codeptStr, fontID, scale );
+		shift = -lineWidth;
 		break;
 	case HORIZ_ALIGN_CENTER:
-		inOutPos->x += ( width / 2.0f ) - ( calcCodepointsRenderWidth( codeptStr, fontID, scale ) / 2.0f );
+		shift = -lineWidth / 2.0f;
 		break;
 	/*case HORIZ_ALIGN_LEFT:
+	default:
 		// nothing to do
 		break;*/
 	}
+
+	if( shift == 0.0f ) {
+		return;
+	}
+
+	for( size_t i = firstQuad; i < sb_Count( layout->sbQuads ); ++i ) {
+		layout->sbQuads[i].min.x += shift;
+		layout->sbQuads[i].max.x += shift;
+	}
 }
 
-float calcRenderHeight( const uint8_t* str, int fontID )
+// Adds the quad for the codepoint with the pen on the base line at pen. Returns how far to move the pen.
+//  Glyphs a dynamic font is still creating are skipped, the layout will be created again once they're done.
+static float addGlyphQuad( TextLayout* layout, int fontID, uint32_t codepoint, Vector2 pen, float scale )
 {
-	float height = fonts[fontID].nextLineDescent;
+	Vector2 size;
+	Vector2 offset;
+	Vector2 uvMin;
+	Vector2 uvMax;
+	GLuint texture;
+	int cacheGlyph = -1;
+	float advance;
 
-	uint32_t codepoint = 0;
-	do {
-		codepoint = getUTF8CodePoint( &str );
-		if( codepoint == 0xA ) {
-			height += fonts[fontID].nextLineDescent;
+	if( fonts[fontID].isDynamic ) {
+		CachedGlyph cached;
+		bool ready = glyphCache_GetGlyph( fonts[fontID].cacheFontID, codepoint, &cached );
+		advance = cached.advance * scale;
+		if( !ready || ( cached.size.x <= 0.0f ) ) {
+			return advance;
 		}
-	} while( codepoint != 0 );
 
-	return height;
+		size = cached.size;
+		offset = cached.offset;
+		uvMin = cached.uvMin;
+		uvMax = cached.uvMax;
+		texture = cached.textureObj;
+		cacheGlyph = cached.glyph;
+
+		layout->shaderType = ST_ALPHA_ONLY;
+		layout->triType = TT_TRANSPARENT;
+	} else {
+		Glyph* glyph = getCodepointGlyph( fontID, (int)codepoint );
+		advance = glyph->advance * scale;
+
+		ImageQuadData quadData;
+		if( img_GetQuadData( glyph->imageID, &quadData ) < 0 ) {
+			return advance;
+		}
+
+		size = quadData.size;
+		offset = quadData.offset;
+		uvMin = quadData.uvMin;
+		uvMax = quadData.uvMax;
+		texture = quadData.textureObj;
+
+		// all the glyphs in a font share these
+		layout->shaderType = quadData.shaderType;
+		layout->triType = quadData.transparent ? TT_TRANSPARENT : TT_SOLID;
+	}
+
+	// positioned the same way img_Render does for a scaled image with no rotation
+	Vector2 center;
+	center.x = pen.x + ( offset.x * scale );
+	center.y = pen.y + ( offset.y * scale );
+
+	TextQuad* quad = sb_Add( layout->sbQuads, 1 );
+	quad->min.x = center.x - ( size.x * scale * 0.5f );
+	quad->min.y = center.y - ( size.y * scale * 0.5f );
+	quad->max.x = center.x + ( size.x * scale * 0.5f );
+	quad->max.y = center.y + ( size.y * scale * 0.5f );
+	quad->uvMin = uvMin;
+	quad->uvMax = uvMax;
+	quad->texture = texture;
+	quad->cacheGlyph = cacheGlyph;
+
+	return advance;
 }
 
-void positionStringStartY( const uint8_t* str, int fontID, VertTextAlignment align, float scale, Vector2* inOutPos )
+// Creates the quads for the string relative to the base line of the first line. Everything is placed in a single
+//  pass over the string, each line is shifted once its width is known and the whole thing once the height is known.
+static void buildLayout( TextLayout* layout, const uint8_t* str, int fontID, float desiredPixelSize,
+	HorizTextAlignment hAlign, VertTextAlignment vAlign )
 {
-	// nothing to do, position is what we want
-	if( align == VERT_ALIGN_BASE_LINE ) {
-		return;
+	sb_Clear( layout->sbQuads );
+	layout->shaderType = ST_DEFAULT;
+	layout->triType = TT_TRANSPARENT;
+
+	Font* font = &( fonts[fontID] );
+	float scale = desiredPixelSize / font->baseSize;
+
+	Vector2 currPos = VEC2_ZERO;
+	size_t lineStart = 0;
+	int numLines = 1;
+
+	uint32_t codepoint;
+	do {
+		codepoint = getUTF8CodePoint( &str );
+		if( ( codepoint == 0 ) || ( codepoint == LINE_FEED ) ) {
+			alignLine( layout, lineStart, currPos.x, hAlign );
+			lineStart = sb_Count( layout->sbQuads );
+
+			if( codepoint == LINE_FEED ) {
+				currPos.x = 0.0f;
+				currPos.y += font->nextLineDescent * scale;
+				++numLines;
+			}
+			continue;
+		}
+
+		currPos.x += addGlyphQuad( layout, fontID, codepoint, currPos, scale );
+	} while( codepoint != 0 );
+
+	if( font->isDynamic ) {
+		layout->generation = glyphCache_GetGeneration( font->cacheFontID );
 	}
 
-	switch( align ) {
+	float renderHeight = font->nextLineDescent * numLines;
+	float shift = 0.0f;
+	switch( vAlign ) {
+	case VERT_ALIGN_BASE_LINE:
+		// nothing to do, position is what we want
+		break;
 	case VERT_ALIGN_BOTTOM:
-		inOutPos->y += ( fonts[fontID].descent - calcRenderHeight( str, fontID ) + fonts[fontID].nextLineDescent ) * scale;
+		shift = ( font->descent - renderHeight + font->nextLineDescent ) * scale;
 		break;
 	case VERT_ALIGN_TOP:
-		inOutPos->y += fonts[fontID].ascent * scale;
+		shift = font->ascent * scale;
 		break;
 	case VERT_ALIGN_CENTER:
-		inOutPos->y += ( fonts[fontID].ascent - ( calcRenderHeight( str, fontID ) / 2.0f ) ) * scale;
+		shift = ( font->ascent - ( renderHeight / 2.0f ) ) * scale;
 		break;
 	}
+
+	if( shift != 0.0f ) {
+		for( size_t i = 0; i < sb_Count( layout->sbQuads ); ++i ) {
+			layout->sbQuads[i].min.y += shift;
+			layout->sbQuads[i].max.y += shift;
+		}
+	}
+}
+
+static uint32_t hashLayoutKey( const char* str, int fontID, float pixelSize, HorizTextAlignment hAlign, VertTextAlignment vAlign )
+{
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	while( *str ) {
+		hash = ( hash ^ (uint8_t)( *str ) ) * 16777619u;
+		++str;
+	}
+
+	uint32_t sizeBits;
+	memcpy( &sizeBits, &pixelSize, sizeof( sizeBits ) );
+	hash = ( hash ^ sizeBits ) * 16777619u;
+	hash = ( hash ^ (uint32_t)fontID ) * 16777619u;
+	hash = ( hash ^ ( (uint32_t)hAlign | ( (uint32_t)vAlign << 4 ) ) ) * 16777619u;
+
+	return hash;
+}
+
+static void clearCachedLayout( CachedLayout* entry )
+{
+	mem_Release( entry->str );
+	entry->str = NULL;
+	entry->lastUsed = 0;
+	sb_Clear( entry->layout.sbQuads );
+}
+
+// Gets the layout for the string from the cache, creating it and replacing the least recently used one if it's not there.
+static const TextLayout* getCachedLayout( const char* utf8Str, int fontID, float pixelSize, HorizTextAlignment hAlign, VertTextAlignment vAlign )
+{
+	uint32_t hash = hashLayoutKey( utf8Str, fontID, pixelSize, hAlign, vAlign );
+	CachedLayout* set = layoutCache[hash % LAYOUT_CACHE_SETS];
+
+	++layoutCacheTime;
+
+	// unused entries have a lastUsed of 0 so they'll always be chosen first
+	CachedLayout* oldest = &( set[0] );
+	for( int i = 0; i < LAYOUT_CACHE_WAYS; ++i ) {
+		CachedLayout* entry = &( set[i] );
+		if( ( entry->str != NULL ) && ( entry->hash == hash ) && ( entry->fontID == fontID ) && ( entry->pixelSize == pixelSize ) &&
+			( entry->hAlign == hAlign ) && ( entry->vAlign == vAlign ) && ( strcmp( entry->str, utf8Str ) == 0 ) ) {
+			entry->lastUsed = layoutCacheTime;
+
+			// glyphs have been added to or removed from the cache since this was created
+			if( fonts[fontID].isDynamic && ( entry->layout.generation != glyphCache_GetGeneration( fonts[fontID].cacheFontID ) ) ) {
+				buildLayout( &( entry->layout ), (const uint8_t*)utf8Str, fontID, pixelSize, hAlign, vAlign );
+			}
+			return &( entry->layout );
+		}
+
+		if( entry->lastUsed < oldest->lastUsed ) {
+			oldest = entry;
+		}
+	}
+
+	clearCachedLayout( oldest );
+
+	size_t length = strlen( utf8Str );
+	oldest->str = mem_Allocate( length + 1 );
+	if( oldest->str == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate cached text layout string." );
+		return NULL;
+	}
+	memcpy( oldest->str, utf8Str, length + 1 );
+
+	oldest->hash = hash;
+	oldest->fontID = fontID;
+	oldest->pixelSize = pixelSize;
+	oldest->hAlign = hAlign;
+	oldest->vAlign = vAlign;
+	oldest->lastUsed = layoutCacheTime;
+	buildLayout( &( oldest->layout ), (const uint8_t*)utf8Str, fontID, pixelSize, hAlign, vAlign );
+
+	return &( oldest->layout );
+}
+
+// Anything laid out with the font will have to be created again.
+static void invalidateFontLayouts( int fontID )
+{
+	for( int s = 0; s < LAYOUT_CACHE_SETS; ++s ) {
+		for( int w = 0; w < LAYOUT_CACHE_WAYS; ++w ) {
+			if( ( layoutCache[s][w].str != NULL ) && ( layoutCache[s][w].fontID == fontID ) ) {
+				clearCachedLayout( &( layoutCache[s][w] ) );
+			}
+		}
+	}
+
+	for( size_t i = 0; i < sb_Count( sbTextObjects ); ++i ) {
+		if( sbTextObjects[i].inUse && ( sbTextObjects[i].fontID == fontID ) ) {
+			sbTextObjects[i].dirty = true;
+		}
+	}
+}
+
+static void queueLayout( const TextLayout* layout, Vector2 pos, Color clr, int camFlags, int8_t depth )
+{
+	size_t count = sb_Count( layout->sbQuads );
+	if( count == 0 ) {
+		return;
+	}
+
+	TextDraw* draw = sb_Add( sbDraws, 1 );
+	draw->firstQuad = sb_Count( sbDrawQuads );
+	draw->numQuads = count;
+	draw->shaderType = layout->shaderType;
+	draw->triType = layout->triType;
+	draw->camFlags = (uint32_t)camFlags;
+	draw->depth = depth;
+
+	TextDrawQuad* drawQuads = sb_Add( sbDrawQuads, count );
+	for( size_t i = 0; i < count; ++i ) {
+		TextQuad* quad = &( layout->sbQuads[i] );
+		TriVert* verts = drawQuads[i].verts;
+
+		drawQuads[i].texture = quad->texture;
+		if( quad->cacheGlyph >= 0 ) {
+			glyphCache_TouchGlyph( quad->cacheGlyph );
+		}
+
+		// same corner order as img_Render
+		verts[0].pos.x = pos.x + quad->min.x;
+		verts[0].pos.y = pos.y + quad->min.y;
+		verts[0].uv = quad->uvMin;
+
+		verts[1].pos.x = pos.x + quad->min.x;
+		verts[1].pos.y = pos.y + quad->max.y;
+		verts[1].uv.x = quad->uvMin.x;
+		verts[1].uv.y = quad->uvMax.y;
+
+		verts[2].pos.x = pos.x + quad->max.x;
+		verts[2].pos.y = pos.y + quad->min.y;
+		verts[2].uv.x = quad->uvMax.x;
+		verts[2].uv.y = quad->uvMin.y;
+
+		verts[3].pos.x = pos.x + quad->max.x;
+		verts[3].pos.y = pos.y + quad->max.y;
+		verts[3].uv = quad->uvMax;
+
+		for( int v = 0; v < 4; ++v ) {
+			verts[v].col = clr;
+		}
+	}
+}
+
+static void drawAllText( float t )
+{
+	for( size_t i = 0; i < sb_Count( sbDraws ); ++i ) {
+		TextDraw* draw = &( sbDraws[i] );
+		for( size_t q = draw->firstQuad; q < ( draw->firstQuad + draw->numQuads ); ++q ) {
+			TriVert* verts = sbDrawQuads[q].verts;
+			triRenderer_Add( verts[0], verts[1], verts[2], draw->shaderType, sbDrawQuads[q].texture, 0.0f,
+				-1, draw->camFlags, draw->depth, draw->triType );
+			triRenderer_Add( verts[1], verts[2], verts[3], draw->shaderType, sbDrawQuads[q].texture, 0.0f,
+				-1, draw->camFlags, draw->depth, draw->triType );
+		}
+	}
+}
+
+static void clearTextDraws( void )
+{
+	sb_Clear( sbDraws );
+	sb_Clear( sbDrawQuads );
+
+	// upload the glyphs created last frame before anything new is drawn
+	glyphCache_Update( );
 }
 
 // Draws a string on the screen. The base line is determined by pos.
+//  The layout of the string is cached, so drawing the same string again is mostly just copying out the quads.
 void txt_DisplayString( const char* utf8Str, Vector2 pos, Color clr, HorizTextAlignment hAlign, VertTextAlignment vAlign,
 	int fontID, int camFlags, int8_t depth, float desiredPixelSize )
 {
@@ -674,36 +1262,109 @@ void txt_DisplayString( const char* utf8Str, Vector2 pos, Color clr, HorizTextAl
 
 	if( fontID < 0 ) return;
 
-	float scale = desiredPixelSize / fonts[fontID].baseSize;
+	const TextLayout* layout = getCachedLayout( utf8Str, fontID, desiredPixelSize, hAlign, vAlign );
+	if( layout != NULL ) {
+		queueLayout( layout, pos, clr, camFlags, depth );
+	}
+}
 
-	// TODO: Alignment options?
-	// TODO: Handle multi-line text better (sometimes letters overlap right now)
-	const uint8_t* str = (uint8_t*)utf8Str;
-	Vector2 currPos = pos;
-	positionStringStartX( str, fontID, hAlign, scale, &currPos );
-	positionStringStartY( str, fontID, vAlign, scale, &currPos );
-	uint32_t codepoint = 0;
-	do {
-		codepoint = getUTF8CodePoint( &str );
-		if( codepoint == 0 ) {
-			// end of line do nothing
-		} else if( codepoint == 0xA ) {
-			// new line
-			currPos.x = pos.x;
-			currPos.y += fonts[fontID].nextLineDescent;
-			positionStringStartX( str, fontID, hAlign, scale, &currPos );
-		} else {
-			Glyph* glyph = getCodepointGlyph( fontID, codepoint );
-			if( glyph != NULL ) {
-				int drawID = img_CreateDraw( glyph->imageID, camFlags, currPos, currPos, depth );
-				img_SetDrawScale( drawID, scale, scale );
-				img_SetDrawColor( drawID, clr, clr );
-				//img_Draw_s_c( glyph->imageID, camFlags, currPos, currPos, scale, scale, clr, clr, depth );
-				//img_Draw_c( glyph->imageID, camFlags, currPos, currPos, clr, clr, depth );
-				currPos.x += glyph->advance * scale;
-			}
+// Creates a text object that keeps its layout, only creating it again when the string changes.
+//  Returns the id to use to draw it, returns -1 if there was an issue.
+int txt_CreateText( const char* utf8Str, int fontID, float desiredPixelSize, HorizTextAlignment hAlign, VertTextAlignment vAlign )
+{
+	assert( utf8Str != NULL );
+	assert( fontID >= 0 );
+
+	size_t idx = 0;
+	while( ( idx < sb_Count( sbTextObjects ) ) && sbTextObjects[idx].inUse ) {
+		++idx;
+	}
+
+	if( idx >= sb_Count( sbTextObjects ) ) {
+		TextObject* newText = sb_Add( sbTextObjects, 1 );
+		if( newText == NULL ) {
+			llog( LOG_ERROR, "Unable to allocate text object." );
+			return -1;
 		}
-	} while( codepoint != 0 );
+		memset( newText, 0, sizeof( *newText ) );
+	}
+
+	TextObject* text = &( sbTextObjects[idx] );
+	text->inUse = true;
+	text->fontID = fontID;
+	text->pixelSize = desiredPixelSize;
+	text->hAlign = hAlign;
+	text->vAlign = vAlign;
+	text->str = NULL;
+	text->dirty = true;
+
+	txt_SetTextString( (int)idx, utf8Str );
+
+	return (int)idx;
+}
+
+// Changes the string displayed by the text object.
+void txt_SetTextString( int textID, const char* utf8Str )
+{
+	assert( textID >= 0 );
+	assert( textID < (int)sb_Count( sbTextObjects ) );
+	assert( utf8Str != NULL );
+
+	TextObject* text = &( sbTextObjects[textID] );
+	if( ( text->str != NULL ) && ( strcmp( text->str, utf8Str ) == 0 ) ) {
+		return;
+	}
+
+	mem_Release( text->str );
+	size_t length = strlen( utf8Str );
+	text->str = mem_Allocate( length + 1 );
+	if( text->str == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate text object string." );
+		return;
+	}
+	memcpy( text->str, utf8Str, length + 1 );
+	text->dirty = true;
+}
+
+// Draws the text object. The base line is determined by pos.
+void txt_DrawText( int textID, Vector2 pos, Color clr, int camFlags, int8_t depth )
+{
+	assert( textID >= 0 );
+	assert( textID < (int)sb_Count( sbTextObjects ) );
+
+	TextObject* text = &( sbTextObjects[textID] );
+	if( !text->inUse || ( text->str == NULL ) ) {
+		return;
+	}
+
+	Font* font = &( fonts[text->fontID] );
+	if( font->isDynamic && ( text->layout.generation != glyphCache_GetGeneration( font->cacheFontID ) ) ) {
+		text->dirty = true;
+	}
+
+	if( text->dirty ) {
+		// the font may have been unloaded
+		if( !fontInUse( text->fontID ) ) {
+			return;
+		}
+		buildLayout( &( text->layout ), (const uint8_t*)text->str, text->fontID, text->pixelSize, text->hAlign, text->vAlign );
+		text->dirty = false;
+	}
+
+	queueLayout( &( text->layout ), pos, clr, camFlags, depth );
+}
+
+// Cleans up the text object, the id shouldn't be used after this.
+void txt_DestroyText( int textID )
+{
+	assert( textID >= 0 );
+	assert( textID < (int)sb_Count( sbTextObjects ) );
+
+	TextObject* text = &( sbTextObjects[textID] );
+	mem_Release( text->str );
+	text->str = NULL;
+	sb_Release( text->layout.sbQuads );
+	text->inUse = false;
 }
 
 // returns whether we can break the line at the specified codepoint
@@ -731,15 +1392,37 @@ bool isBreakableCodepoint( int codepoint )
 			 ( codepoint == 8205 ) );
 }
 
+// Decodes the string into sbStringCodepointBuffer, including the null terminator.
 void convertOutToBuffer( const uint8_t* utf8Str )
 {
-	const uint8_t* str = utf8Str;
-	uint32_t codepoint;
+	// there can't be more codepoints than bytes, so reserve that up front and write directly
+	size_t length = strlen( (const char*)utf8Str );
 	sb_Clear( sbStringCodepointBuffer );
-	do {
-		codepoint = getUTF8CodePoint( &str );
-		sb_Push( sbStringCodepointBuffer, codepoint );
-	} while( codepoint != 0 );
+	uint32_t* out = sb_Add( sbStringCodepointBuffer, length + 1 );
+
+	const uint8_t* str = utf8Str;
+	const uint8_t* end = utf8Str + length;
+	size_t count = 0;
+	while( str < end ) {
+		// most strings are plain ASCII, check eight bytes at a time and copy them straight across if none have the high
+		//  bit set
+		if( ( end - str ) >= 8 ) {
+			uint64_t word;
+			memcpy( &word, str, sizeof( word ) );
+			if( ( word & 0x8080808080808080ull ) == 0 ) {
+				for( int i = 0; i < 8; ++i ) {
+					out[count++] = str[i];
+				}
+				str += 8;
+				continue;
+			}
+		}
+
+		out[count++] = getUTF8CodePoint( &str );
+	}
+	out[count++] = 0;
+
+	sb__Used( sbStringCodepointBuffer ) = count;
 }
 
 // Draws a string on the screen to an area. Splits up lines and such. If outCharPos is not equal to NULL it will
@@ -797,8 +1480,8 @@ bool txt_DisplayTextArea( const uint8_t* utf8Str, Vector2 upperLeft, Vector2 siz
 		}
 
 		if( sbStringCodepointBuffer[i] != LINE_FEED ) {
-			Glyph* glyph = getCodepointGlyph( fontID, sbStringCodepointBuffer[i] );
-			currentLength += ( glyph->advance * scale );
+			float advance = getAdvance( fontID, sbStringCodepointBuffer[i] ) * scale;
+			currentLength += advance;
 			
 			if( currentLength > size.x ) {
 				if( lastBreakPoint != SIZE_MAX ) {
@@ -810,7 +1493,7 @@ bool txt_DisplayTextArea( const uint8_t* utf8Str, Vector2 upperLeft, Vector2 siz
 					//  of the word
 					--i;
 					sb_Insert( sbStringCodepointBuffer, i, LINE_FEED );
-					lastBreakPointSize = currentLength - ( glyph->advance * scale );
+					lastBreakPointSize = currentLength - advance;
 				}
 			}
 		}
@@ -853,6 +1536,11 @@ bool txt_DisplayTextArea( const uint8_t* utf8Str, Vector2 upperLeft, Vector2 siz
 		break;
 	}
 	positionCodepointsStartX( sbStringCodepointBuffer, fontID, hAlign, size.x, scale, &renderPos );
+
+	// the lines are laid out at their final positions, so the layout is drawn at the origin
+	sb_Clear( textAreaLayout.sbQuads );
+	textAreaLayout.shaderType = ST_DEFAULT;
+	textAreaLayout.triType = TT_TRANSPARENT;
 	for( size_t i = 0; ( i < sb_Count( sbStringCodepointBuffer ) ) && ( sbStringCodepointBuffer[i] != 0 ); ++i ) {
 		if( sbStringCodepointBuffer[i] == LINE_FEED ) {
 			// new line
@@ -860,15 +1548,7 @@ bool txt_DisplayTextArea( const uint8_t* utf8Str, Vector2 upperLeft, Vector2 siz
 			renderPos.y += fonts[fontID].nextLineDescent * scale;
 			positionCodepointsStartX( &( sbStringCodepointBuffer[i+1] ), fontID, hAlign, size.x, scale, &renderPos );
 		} else {
-			Glyph* glyph = getCodepointGlyph( fontID, sbStringCodepointBuffer[i] );
-			if( glyph != NULL ) {
-				//img_Draw_c( glyph->imageID, camFlags, renderPos, renderPos, clr, clr, depth );
-				//img_Draw_s_c( glyph->imageID, camFlags, renderPos, renderPos, scale, scale, clr, clr, depth );
-				int drawID = img_CreateDraw( glyph->imageID, camFlags, renderPos, renderPos, depth );
-				img_SetDrawScale( drawID, scale, scale );
-				img_SetDrawColor( drawID, clr, clr );
-				renderPos.x += ( glyph->advance * scale );
-			}
+			renderPos.x += addGlyphQuad( &textAreaLayout, fontID, sbStringCodepointBuffer[i], renderPos, scale );
 		}
 
 		if( ( i == charBufferPos ) && ( outCharPos != NULL ) ) {
@@ -877,6 +1557,8 @@ bool txt_DisplayTextArea( const uint8_t* utf8Str, Vector2 upperLeft, Vector2 siz
 		}
 	}
 
+	queueLayout( &textAreaLayout, VEC2_ZERO, clr, camFlags, depth );
+
 	if( !posValid && ( outCharPos != NULL ) ) {
 		(*outCharPos) = renderPos;
 		posValid = true;
@@ -909,6 +1591,58 @@ static void calcSDFCodepointSize( stbtt_fontinfo* font, int codepoint, float sca
 	(*outHeight) = (iy1 - iy0);
 }
 
+typedef struct {
+	stbtt_fontinfo* font;
+	float scale;
+	int padding;
+	unsigned char onEdgeValue;
+	float pixelDistScale;
+	stbrp_rect* rects;
+	uint8_t* image;
+	int imageWidth;
+} SDFGlyphsData;
+
+// Rasterizes the glyph and turns it into a distance field directly in the image at its packed position. The packed
+//  rectangles don't overlap so any number of these can be run at once.
+static void generateSDFGlyph( SDFGlyphsData* data, int idx )
+{
+	stbrp_rect* rect = &( data->rects[idx] );
+	if( !rect->was_packed || ( rect->w == 0 ) || ( rect->h == 0 ) ) {
+		return;
+	}
+
+	int width = rect->w;
+	int height = rect->h;
+	int padding = data->padding;
+
+	// the coverage and workspace are allocated together to keep the allocations down
+	size_t coverageSize = (size_t)width * (size_t)height;
+	size_t workspaceOffset = ( coverageSize + 15 ) & ~(size_t)15;
+	uint8_t* memory = mem_Allocate( workspaceOffset + edt_SDFWorkspaceSize( width, height ) );
+	if( memory == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate memory to generate SDF for codepoint %i.", rect->id );
+		return;
+	}
+	memset( memory, 0, coverageSize );
+
+	// same box calcSDFCodepointSize used, with the padding around it
+	int glyph = stbtt_FindGlyphIndex( data->font, rect->id );
+	stbtt_MakeGlyphBitmap( data->font, memory + padding + ( padding * width ), width - ( padding * 2 ), height - ( padding * 2 ),
+		width, data->scale, data->scale, glyph );
+
+	uint8_t* out = data->image + rect->x + ( rect->y * data->imageWidth );
+	edt_CreateSDF( memory, width, height, data->onEdgeValue, data->pixelDistScale, out, data->imageWidth, memory + workspaceOffset );
+
+	mem_Release( memory );
+}
+
+static void generateSDFGlyphsJob( void* data, int start, int end )
+{
+	for( int i = start; i < end; ++i ) {
+		generateSDFGlyph( (SDFGlyphsData*)data, i );
+	}
+}
+
 /*
 For a SDF font the file format will be as follows:
 Font:
@@ -1187,6 +1921,7 @@ static int loadSDFFont( const char* fileName )
 			fonts[fontID].missingCharGlyphIdx = i;
 		}
 	}
+	buildGlyphLookup( &( fonts[fontID] ) );
 
 clean_up:
 
@@ -1318,30 +2053,26 @@ int txt_CreateSDFFont( const char* fileName )
 	baseImage = mem_Allocate( sizeof( unsigned char ) * WIDTH * HEIGHT );
 	CHECK_POINTER( baseImage, "Error allocating full image" );
 
+	memset( baseImage, 0, sizeof( unsigned char ) * WIDTH * HEIGHT );
+
 	for( int i = 0; i < fontPackRange.num_chars; ++i ) {
 		if( !rects[i].was_packed ) {
 			llog( LOG_WARN, "Unable to pack codepoint %i for font %s.", rects[i].id, fileName );
-			continue;
-		}
-
-		int sdfWidth, sdfHeight, sdfXOff, sdfYOff;
-		unsigned char* charSDF = stbtt_GetCodepointSDF( &font, scale, rects[i].id, padding, onEdgeValue, pixelDistScale, &sdfWidth, &sdfHeight, &sdfXOff, &sdfYOff );
-
-		//llog( LOG_INFO, "Packing codepoint %i - x: %i  y: %i  w: %i  h: %i  xo: %i  yo: %i", rects[i].id, rects[i].x, rects[i].y, sdfWidth, sdfHeight, sdfXOff, sdfYOff );
-		//if( rects[i].w != sdfWidth ) llog( LOG_WARN, "  - widths don't match!" );
-		//if( rects[i].h != sdfHeight ) llog( LOG_WARN, "  - heights don't match!" );
-
-		// pack into image
-		//  would really like a version of memcpy with stride
-		int x = rects[i].x;
-		for( int yo = 0; yo < rects[i].h; ++yo ) {
-			unsigned char* rowDest = baseImage + ( ( rects[i].x ) + ( ( rects[i].y + yo ) * WIDTH ) );//( ( y * WIDTH ) + x );
-			unsigned char* rowSrc = charSDF + ( yo * rects[i].w );
-			memcpy( rowDest, rowSrc, sizeof( unsigned char ) * rects[i].w );
 		}
-		STBTT_free( charSDF, 0 );
 	}
 
+	// each glyph is independent so spread them across the job threads
+	SDFGlyphsData sdfData;
+	sdfData.font = &font;
+	sdfData.scale = scale;
+	sdfData.padding = padding;
+	sdfData.onEdgeValue = onEdgeValue;
+	sdfData.pixelDistScale = pixelDistScale;
+	sdfData.rects = rects;
+	sdfData.image = baseImage;
+	sdfData.imageWidth = WIDTH;
+	jq_ParallelFor( generateSDFGlyphsJob, &sdfData, fontPackRange.num_chars, 4 );
+
 	// split the bitmap
 	mins = mem_Allocate( sizeof( Vector2 ) * fontPackRange.num_chars );
 	CHECK_POINTER( mins, "Unable to allocate mins list" );
@@ -1396,6 +2127,7 @@ int txt_CreateSDFFont( const char* fileName )
 		}
 	}
 	fonts[newFont].glyphsBuffer = sbGlyphStorage;
+	buildGlyphLookup( &( fonts[newFont] ) );
 
 	// save out the font so next time we can load it faster
 	LoadedImage fontImg;
@@ -1434,6 +2166,125 @@ clean_up:
 #undef OUT_ERROR
 }
 
+// Times creating the distance fields for the glyphs of the font with stbtt_GetCodepointSDF on one thread against
+//  edt_CreateSDF spread across the job queue, logs the glyphs per second of each. Only the distance fields are
+//  created, nothing is packed, saved, or loaded.
+int txt_RunSDFBenchmark( const char* fileName, int iterations )
+{
+	int pixelHeight = 64;
+	int padding = 4;
+	unsigned char onEdgeValue = 128;
+	float pixelDistScale = (float)onEdgeValue / (float)padding;
+
+	uint8_t* buffer = NULL;
+	stbrp_rect* rects = NULL;
+	uint8_t* image = NULL;
+	int result = 0;
+
+	SDL_RWops* rwopsFile = SDL_RWFromFile( fileName, "r" );
+	if( rwopsFile == NULL ) {
+		llog( LOG_ERROR, "Error opening font file %s", fileName );
+		return -1;
+	}
+
+	Sint64 fileSize = SDL_RWsize( rwopsFile );
+	buffer = ( fileSize > 0 ) ? mem_Allocate( (size_t)fileSize ) : NULL;
+	if( ( buffer == NULL ) || ( SDL_RWread( rwopsFile, (void*)buffer, sizeof( uint8_t ), (size_t)fileSize ) != (size_t)fileSize ) ) {
+		llog( LOG_ERROR, "Unable to read font file %s", fileName );
+		result = -1;
+		goto clean_up;
+	}
+
+	stbtt_fontinfo font;
+	if( !stbtt_InitFont( &font, buffer, 0 ) ) {
+		llog( LOG_ERROR, "Unable to initialize font %s", fileName );
+		result = -1;
+		goto clean_up;
+	}
+	float scale = stbtt_ScaleForPixelHeight( &font, (float)pixelHeight );
+
+	// the printable characters of Basic Latin and Latin-1 Supplement, laid out in a column so they don't overlap
+	int numGlyphs = 0;
+	int imageWidth = 0;
+	int imageHeight = 0;
+	rects = mem_Allocate( sizeof( stbrp_rect ) * 256 );
+	if( rects == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate benchmark glyphs" );
+		result = -1;
+		goto clean_up;
+	}
+	for( int c = 0x20; c <= 0xFF; ++c ) {
+		if( ( c >= 0x7F ) && ( c < 0xA0 ) ) {
+			continue;
+		}
+
+		int width, height;
+		calcSDFCodepointSize( &font, c, scale, padding, &width, &height );
+		rects[numGlyphs].id = c;
+		rects[numGlyphs].w = (stbrp_coord)width;
+		rects[numGlyphs].h = (stbrp_coord)height;
+		rects[numGlyphs].x = 0;
+		rects[numGlyphs].y = (stbrp_coord)imageHeight;
+		rects[numGlyphs].was_packed = 1;
+		imageWidth = MAX( imageWidth, width );
+		imageHeight += height;
+		++numGlyphs;
+	}
+
+	image = mem_Allocate( (size_t)MAX( imageWidth, 1 ) * (size_t)MAX( imageHeight, 1 ) );
+	if( image == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate benchmark image" );
+		result = -1;
+		goto clean_up;
+	}
+
+	llog( LOG_INFO, "SDF generation for %s, %i glyphs at %i pixels, %i iterations", fileName, numGlyphs, pixelHeight, iterations );
+
+	Uint64 timer = gt_StartTimer( );
+	for( int i = 0; i < iterations; ++i ) {
+		for( int g = 0; g < numGlyphs; ++g ) {
+			int sdfWidth, sdfHeight, sdfXOff, sdfYOff;
+			unsigned char* charSDF = stbtt_GetCodepointSDF( &font, scale, rects[g].id, padding, onEdgeValue, pixelDistScale,
+				&sdfWidth, &sdfHeight, &sdfXOff, &sdfYOff );
+			STBTT_free( charSDF, 0 );
+		}
+	}
+	float seconds = gt_StopTimer( timer );
+	llog( LOG_INFO, "  %-40s %9.3f ms  %10.1f glyphs/sec", "stbtt_GetCodepointSDF", seconds * 1000.0f, ( numGlyphs * iterations ) / seconds );
+
+	SDFGlyphsData sdfData;
+	sdfData.font = &font;
+	sdfData.scale = scale;
+	sdfData.padding = padding;
+	sdfData.onEdgeValue = onEdgeValue;
+	sdfData.pixelDistScale = pixelDistScale;
+	sdfData.rects = rects;
+	sdfData.image = image;
+	sdfData.imageWidth = imageWidth;
+
+	timer = gt_StartTimer( );
+	for( int i = 0; i < iterations; ++i ) {
+		generateSDFGlyphsJob( &sdfData, 0, numGlyphs );
+	}
+	seconds = gt_StopTimer( timer );
+	llog( LOG_INFO, "  %-40s %9.3f ms  %10.1f glyphs/sec", "edt_CreateSDF, one thread", seconds * 1000.0f, ( numGlyphs * iterations ) / seconds );
+
+	timer = gt_StartTimer( );
+	for( int i = 0; i < iterations; ++i ) {
+		jq_ParallelFor( generateSDFGlyphsJob, &sdfData, numGlyphs, 4 );
+	}
+	seconds = gt_StopTimer( timer );
+	llog( LOG_INFO, "  %-40s %9.3f ms  %10.1f glyphs/sec", "edt_CreateSDF, job queue", seconds * 1000.0f, ( numGlyphs * iterations ) / seconds );
+
+clean_up:
+	SDL_RWclose( rwopsFile );
+	mem_Release( buffer );
+	mem_Release( rects );
+	mem_Release( image );
+
+	return result;
+}
+
 int txt_GetBaseSize( int fontID )
 {
 	assert( fontID >= 0 );
@@ -1443,6 +2294,12 @@ int txt_GetBaseSize( int fontID )
 int txt_GetCharacterImage( int fontID, int c )
 {
 	assert( fontID >= 0 );
+
+	// glyphs for dynamic fonts aren't images
+	if( fonts[fontID].isDynamic ) {
+		return -1;
+	}
+
 	Glyph* glyph = getCodepointGlyph( fontID, c );
 	return glyph->imageID;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include "../Graphics/color.h"
 #include "../Math/vector2.h"
+#include "../System/assetManager.h"
 
 typedef enum {
 	HORIZ_ALIGN_LEFT,
@@ -34,14 +35,22 @@ void txt_AddCharacterToLoad( int c );
 //  Returns an ID to be used when displaying a string, returns -1 if there was an issue.
 int txt_LoadFont( const char* fileName, int pixelHeight );
 
-// Loads the font at file name on a seperate thread. Uses a height of pixelHeight.
-//  Puts the resulting font ID into outFontID
-void txt_ThreadedLoadFont( const char* fileName, float pixelHeight, int* outFontID );
+// Loads the font at file name on a job thread, the images are created on the main thread by asset_ProcessUploads.
+//  Uses a height of pixelHeight. Use asset_Get with the handle to get the font ID, it will be -1 until the font is
+//  ready. Release the handle with asset_Release when it's no longer needed.
+AssetHandle txt_ThreadedLoadFont( const char* fileName, float pixelHeight, AssetPriority priority );
+
+// Loads the font at fileName, with a height of pixelHeight. Instead of creating images for a fixed set of characters
+//  the glyphs are created as they're used, so any character in the font can be displayed. Glyphs show up the frame
+//  after they're finished being created. txt_GetCharacterImage won't work with these fonts.
+//  Returns an ID to be used when displaying a string, returns -1 if there was an issue.
+int txt_LoadDynamicFont( const char* fileName, int pixelHeight );
 
 // Frees up the font specified by fontID.
 void txt_UnloadFont( int fontID );
 
 // Draws a string on the screen. The base line is determined by pos.
+//  The layout of the string is cached, so drawing the same string again is mostly just copying out the quads.
 void txt_DisplayString( const char* utf8Str, Vector2 pos, Color clr, HorizTextAlignment hAlign, VertTextAlignment vAlign,
 	int fontID, int camFlags, int8_t depth, float desiredPixelSize );
 
@@ -53,9 +62,27 @@ bool txt_DisplayTextArea( const uint8_t* utf8Str, Vector2 upperLeft, Vector2 siz
 
 int txt_GetCharacterImage( int fontID, int c );
 
+// Creates a text object that keeps its layout, only creating it again when the string changes. Useful for labels
+//  and other text that's displayed every frame. Returns the id to use to draw it, returns -1 if there was an issue.
+int txt_CreateText( const char* utf8Str, int fontID, float desiredPixelSize, HorizTextAlignment hAlign, VertTextAlignment vAlign );
+
+// Changes the string displayed by the text object.
+void txt_SetTextString( int textID, const char* utf8Str );
+
+// Draws the text object. The base line is determined by pos.
+void txt_DrawText( int textID, Vector2 pos, Color clr, int camFlags, int8_t depth );
+
+// Cleans up the text object, the id shouldn't be used after this.
+void txt_DestroyText( int textID );
+
 
 // Creates a font that's rendered out as a signed distance field. Will also attempt to save a version of this font that
 //  can be loaded later much quicker.
 int txt_CreateSDFFont( const char* fileName );
 
+// Times creating the distance fields for the glyphs of the font the old way and the way txt_CreateSDFFont does now,
+//  logging the glyphs per second of each. Needs the memory manager, SDL timer, and job queue to be initialized.
+//  Returns < 0 if the font couldn't be loaded.
+int txt_RunSDFBenchmark( const char* fileName, int iterations );
+
 #endif /* inclusion guard */
\ No newline at end of file
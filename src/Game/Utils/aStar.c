@@ -5,7 +5,9 @@
 #include <math.h>
 
 #include "../System/memory.h"
+#include "../System/jobQueue.h"
 #include "stretchyBuffer.h"
+#include "binaryHeap.h"
 
 // used if they don't give us a move or heuristic cost function
 static float defaultCost( void* graph, int fromNode, int toNode )
@@ -13,6 +15,44 @@ static float defaultCost( void* graph, int fromNode, int toNode )
 	return 0.0f;
 }
 
+static bool frontierLess( const void* pLeft, const void* pRight )
+{
+	const AStarFrontierData* left = (const AStarFrontierData*)pLeft;
+	const AStarFrontierData* right = (const AStarFrontierData*)pRight;
+
+	if( left->cost != right->cost ) {
+		return ( left->cost < right->cost );
+	}
+	return ( left->order < right->order );
+}
+
+static bool isNodeSet( AStarSearchState* state, int node )
+{
+	return ( state->sbPath[node].generation == state->generation );
+}
+
+static float nodeCost( AStarSearchState* state, int node )
+{
+	return isNodeSet( state, node ) ? state->sbPath[node].cost : INFINITY;
+}
+
+static void setNode( AStarSearchState* state, int node, int from, float cost )
+{
+	state->sbPath[node].from = from;
+	state->sbPath[node].cost = cost;
+	state->sbPath[node].generation = state->generation;
+}
+
+static void pushFrontier( AStarSearchState* state, int loc, float cost, float pathCost )
+{
+	AStarFrontierData asfd;
+	asfd.loc = loc;
+	asfd.cost = cost;
+	asfd.pathCost = pathCost;
+	asfd.order = state->nextOrder++;
+	heap_Push( state->sbFrontier, asfd, frontierLess );
+}
+
 // creates a search state we can send to process and extract, we should call aStar_CleanUpSearchState
 //  after we're done with it to clean up any memory we have allocated here
 void aStar_CreateSearchState( void* graph, size_t nodeCount, int startNodeID, int targetNodeID,
@@ -29,6 +69,7 @@ void aStar_CreateSearchState( void* graph, size_t nodeCount, int startNodeID, in
 
 	outState->sbPath = NULL;
 	outState->sbFrontier = NULL;
+	outState->generation = 0;
 
 	if( nodeCount == 0 ) {
 		return;
@@ -36,21 +77,43 @@ void aStar_CreateSearchState( void* graph, size_t nodeCount, int startNodeID, in
 
 	sb_Add( outState->sbPath, nodeCount );
 	for( size_t i = 0; i < sb_Count( outState->sbPath ); ++i ) {
-		outState->sbPath[i].from = -1;
-		outState->sbPath[i].cost = INFINITY;
+		outState->sbPath[i].generation = 0;
 	}
 
-	AStarFrontierData initASD;
-	initASD.loc = startNodeID;
-	initASD.cost = 0.0f;
 	sb_Reserve( outState->sbFrontier, nodeCount ); // just reserve some data
-	sb_Push( outState->sbFrontier, initASD );
 
-	outState->sbPath[startNodeID].from = startNodeID;
-	outState->sbPath[startNodeID].cost = 0.0f;
+	aStar_ResetSearchState( outState, startNodeID, targetNodeID );
+}
+
+// sets up the search state for a new search on the same graph, reusing the memory allocated for the previous one
+void aStar_ResetSearchState( AStarSearchState* state, int startNodeID, int targetNodeID )
+{
+	assert( state != NULL );
+
+	if( !aStar_IsValid( state ) ) {
+		return;
+	}
+
+	assert( ( startNodeID >= 0 ) && ( startNodeID < (int)sb_Count( state->sbPath ) ) );
+
+	++state->generation;
+	if( state->generation == 0 ) {
+		// wrapped around, so the old records could look valid, this will happen very rarely so just clear everything
+		for( size_t i = 0; i < sb_Count( state->sbPath ); ++i ) {
+			state->sbPath[i].generation = 0;
+		}
+		state->generation = 1;
+	}
+
+	sb_Clear( state->sbFrontier );
+	state->nextOrder = 0;
+	state->pathFound = false;
+
+	setNode( state, startNodeID, startNodeID, 0.0f );
+	pushFrontier( state, startNodeID, 0.0f, 0.0f );
 
-	outState->targetNodeID = targetNodeID;
-	outState->startNodeID = startNodeID;
+	state->targetNodeID = targetNodeID;
+	state->startNodeID = startNodeID;
 }
 
 // in case we need to test for this, if it's invalid aStar_ProcessPath will handle it by returning
@@ -85,7 +148,7 @@ bool aStar_ProcessPath( AStarSearchState* state, int numSteps, int** sbOutPaths
 			processingDone = true;
 		} else {
 		
-			AStarFrontierData front = sb_Pop( state->sbFrontier );
+			AStarFrontierData front = heap_Pop( state->sbFrontier, frontierLess );
 			if( front.loc == state->targetNodeID ) {
 				// found the path, generate it and put it into sbOutPaths and stop processing
 				if( sbOutPaths != NULL ) {
@@ -95,31 +158,21 @@ bool aStar_ProcessPath( AStarSearchState* state, int numSteps, int** sbOutPaths
 						current = state->sbPath[current].from;
 					}
 				}
+				state->pathFound = true;
 				processingDone = true;
-			} else {
+			} else if( front.pathCost <= state->sbPath[front.loc].cost ) {
+				// entries for nodes that were later reached with a lower cost can be skipped, the cheaper one has already been processed
 
+				float frontCost = state->sbPath[front.loc].cost;
 				int neighbor = state->nextNeighbor( state->graph, front.loc, -1 );
 				while( neighbor != -1 ) {
-					float newCost = state->sbPath[front.loc].cost + state->moveCost( state->graph, front.loc, neighbor );
-					// no set check because we're initializing the values to FLT_MAX
-					if( newCost < state->sbPath[neighbor].cost ) {
-						assert( neighbor < (int)sb_Count( state->sbPath ) );
-
-						state->sbPath[neighbor].cost = newCost;
-						state->sbPath[neighbor].from = front.loc;
-
-						AStarFrontierData asfd;
-						asfd.loc = neighbor;
-
-						asfd.cost = newCost + state->heuristic( state->graph, neighbor, state->targetNodeID );
-
-						// insertion sort into frontier, simulate a priority queue
-						// TODO: Create a proper priority queue if speed ever becomes an issue here
-						size_t idx = 0;
-						while( ( idx < sb_Count( state->sbFrontier ) ) && ( asfd.cost < state->sbFrontier[idx].cost ) ) {
-							++idx;
-						}
-						sb_Insert( state->sbFrontier, idx, asfd );
+					assert( neighbor < (int)sb_Count( state->sbPath ) );
+
+					float newCost = frontCost + state->moveCost( state->graph, front.loc, neighbor );
+					// unset nodes are treated as having an infinite cost
+					if( newCost < nodeCost( state, neighbor ) ) {
+						setNode( state, neighbor, front.loc, newCost );
+						pushFrontier( state, neighbor, newCost + state->heuristic( state->graph, neighbor, state->targetNodeID ), newCost );
 					}
 					neighbor = state->nextNeighbor( state->graph, front.loc, neighbor );
 				}
@@ -142,4 +195,56 @@ void aStar_CleanUpSearchState( AStarSearchState* state )
 
 	sb_Release( state->sbPath );
 	state->sbPath = NULL;
-}
\ No newline at end of file
+}
+
+typedef struct {
+	void* graph;
+	size_t nodeCount;
+	AStar_CostFunc moveCost;
+	AStar_CostFunc heuristic;
+	AStar_GetNextNeighborFunc nextNeighbor;
+	AStarBatchRequest* requests;
+} AStarBatch;
+
+// how many searches each job should do, they all share one search state so the node records are only allocated once per job
+#define SEARCHES_PER_JOB 4
+
+static void processBatchRange( void* data, int start, int end )
+{
+	AStarBatch* batch = (AStarBatch*)data;
+
+	AStarSearchState state;
+	aStar_CreateSearchState( batch->graph, batch->nodeCount, batch->requests[start].startNodeID, batch->requests[start].targetNodeID,
+		batch->moveCost, batch->heuristic, batch->nextNeighbor, &state );
+
+	for( int i = start; i < end; ++i ) {
+		AStarBatchRequest* request = &( batch->requests[i] );
+		if( i != start ) {
+			aStar_ResetSearchState( &state, request->startNodeID, request->targetNodeID );
+		}
+
+		request->sbPath = NULL;
+		aStar_ProcessPath( &state, -1, &( request->sbPath ) );
+		request->found = state.pathFound;
+	}
+
+	aStar_CleanUpSearchState( &state );
+}
+
+// runs every request until it's done, spreading them across the job queue, all of the requests use the same graph
+//  and functions
+void aStar_ProcessBatch( void* graph, size_t nodeCount, AStar_CostFunc moveCost, AStar_CostFunc heuristic,
+	AStar_GetNextNeighborFunc nextNeighbor, AStarBatchRequest* requests, int numRequests )
+{
+	assert( ( requests != NULL ) || ( numRequests == 0 ) );
+
+	AStarBatch batch;
+	batch.graph = graph;
+	batch.nodeCount = nodeCount;
+	batch.moveCost = moveCost;
+	batch.heuristic = heuristic;
+	batch.nextNeighbor = nextNeighbor;
+	batch.requests = requests;
+
+	jq_ParallelFor( processBatchRange, &batch, numRequests, SEARCHES_PER_JOB );
+}
@@ -9,11 +9,16 @@
 typedef struct {
 	int loc;
 	float cost;
+	float pathCost; // cost to get to loc when this was added, used to skip entries that have been superseded
+	unsigned int order; // used to break ties so nodes with the same cost come out in the order they were added
 } AStarFrontierData;
 
+// only valid if generation matches the generation of the search state, that way the records can be reused for another
+//  search without having to reset them all
 typedef struct {
 	int from;
 	float cost;
+	unsigned int generation;
 } AStarPathData;
 
 typedef float (*AStar_CostFunc)( void* graph, int fromNodeID, int toNodeID );
@@ -23,11 +28,14 @@ typedef float (*AStar_CostFunc)( void* graph, int fromNodeID, int toNodeID );
 typedef int (*AStar_GetNextNeighborFunc)( void* graph, int nodeID, int currNeighborNodeID );
 
 typedef struct {
-	AStarFrontierData* sbFrontier;
+	AStarFrontierData* sbFrontier; // binary heap, lowest cost first
 	AStarPathData* sbPath;
+	unsigned int generation;
+	unsigned int nextOrder;
 
 	int startNodeID;
 	int targetNodeID;
+	bool pathFound;
 
 	void* graph;
 
@@ -46,6 +54,8 @@ General usage:
 		sb_Release( sbPath );
 	}
 	aStar_CleanUpSearchState( &searchState );
+
+To run another search on the same graph call aStar_ResetSearchState instead of cleaning up and creating a new state.
 */
 
 // creates a search state we can send to process and extract, we should call aStar_CleanUpSearchState
@@ -63,7 +73,27 @@ bool aStar_IsValid( AStarSearchState* state );
 //  returns whether processing is done and puts the resulting path into a stretchy buffer in sbOutPaths
 bool aStar_ProcessPath( AStarSearchState* state, int numSteps, int** sbOutPaths );
 
+// sets up the search state for a new search on the same graph, reusing the memory allocated for the previous one
+//  the node records aren't cleared, so this doesn't depend on the size of the graph
+void aStar_ResetSearchState( AStarSearchState* state, int startNodeID, int targetNodeID );
+
 // cleans up all the extra data created by the search state
 void aStar_CleanUpSearchState( AStarSearchState* state );
 
+typedef struct {
+	int startNodeID;
+	int targetNodeID;
+
+	// filled in by aStar_ProcessBatch, sbPath is in the same format aStar_ProcessPath gives and should be released
+	//  with sb_Release when done
+	int* sbPath;
+	bool found;
+} AStarBatchRequest;
+
+// runs every request until it's done, spreading them across the job queue, all of the requests use the same graph
+//  and functions. The functions will be called from multiple threads at once so they shouldn't modify anything.
+//  Doesn't return until all the requests are done.
+void aStar_ProcessBatch( void* graph, size_t nodeCount, AStar_CostFunc moveCost, AStar_CostFunc heuristic,
+	AStar_GetNextNeighborFunc nextNeighbor, AStarBatchRequest* requests, int numRequests );
+
 #endif /* inclusion guard */
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef BINARY_HEAP_H
+#define BINARY_HEAP_H
+
+#include <stdbool.h>
+#include <string.h>
+#include "stretchyBuffer.h"
+
+// Binary min-heap stored in a stretchy buffer, the element at index 0 is always the one that should come out first.
+//  The less than function decides the order, if less( a, b ) is true then a will come out before b.
+//  Elements are swapped using memcpy so they should be plain data. Use sb_Release to free the heap and sb_Count to
+//  get the number of elements in it.
+//  Elements with the same priority come out in an undefined order.
+
+typedef bool (*HeapLessFunc)( const void* left, const void* right );
+
+// adds an element to the heap
+#define heap_Push( sbHeap, val, less ) ( sb_Push( (sbHeap), (val) ), heap__SiftUp( (sbHeap), sb_Count( (sbHeap) ) - 1, sizeof( (sbHeap)[0] ), (less) ) )
+
+// the element that will come out next, the heap must not be empty
+#define heap_Peek( sbHeap ) ( (sbHeap)[0] )
+
+// removes and returns the element that should come out first, the heap must not be empty
+#define heap_Pop( sbHeap, less ) ( heap__MoveTopToBack( (sbHeap), sb_Count( (sbHeap) ), sizeof( (sbHeap)[0] ), (less) ), sb_Pop( (sbHeap) ) )
+
+// call after the element at idx has had its priority changed so it will move into the correct spot
+#define heap_Update( sbHeap, idx, less ) heap__Update( (sbHeap), sb_Count( (sbHeap) ), (idx), sizeof( (sbHeap)[0] ), (less) )
+
+// turns an unordered stretchy buffer into a heap in O(n), faster than pushing everything one at a time
+#define heap_Heapify( sbHeap, less ) heap__Heapify( (sbHeap), sb_Count( (sbHeap) ), sizeof( (sbHeap)[0] ), (less) )
+
+#define HEAP__ELEM( data, idx, size ) ( (char*)(data) + ( (idx) * (size) ) )
+
+static inline void heap__Swap( void* a, void* b, size_t itemSize )
+{
+	char buffer[64];
+	char* left = (char*)a;
+	char* right = (char*)b;
+
+	// swap in chunks so larger elements don't need any allocations
+	while( itemSize > 0 ) {
+		size_t chunk = ( itemSize > sizeof( buffer ) ) ? sizeof( buffer ) : itemSize;
+		memcpy( buffer, left, chunk );
+		memcpy( left, right, chunk );
+		memcpy( right, buffer, chunk );
+		left += chunk;
+		right += chunk;
+		itemSize -= chunk;
+	}
+}
+
+// returns the final position of the element
+static inline size_t heap__SiftUp( void* data, size_t idx, size_t itemSize, HeapLessFunc less )
+{
+	while( idx > 0 ) {
+		size_t parent = ( idx - 1 ) / 2;
+		if( !less( HEAP__ELEM( data, idx, itemSize ), HEAP__ELEM( data, parent, itemSize ) ) ) {
+			break;
+		}
+		heap__Swap( HEAP__ELEM( data, idx, itemSize ), HEAP__ELEM( data, parent, itemSize ), itemSize );
+		idx = parent;
+	}
+	return idx;
+}
+
+static inline size_t heap__SiftDown( void* data, size_t count, size_t idx, size_t itemSize, HeapLessFunc less )
+{
+	while( true ) {
+		size_t smallest = idx;
+		size_t left = ( idx * 2 ) + 1;
+		size_t right = left + 1;
+
+		if( ( left < count ) && less( HEAP__ELEM( data, left, itemSize ), HEAP__ELEM( data, smallest, itemSize ) ) ) {
+			smallest = left;
+		}
+		if( ( right < count ) && less( HEAP__ELEM( data, right, itemSize ), HEAP__ELEM( data, smallest, itemSize ) ) ) {
+			smallest = right;
+		}
+
+		if( smallest == idx ) {
+			return idx;
+		}
+
+		heap__Swap( HEAP__ELEM( data, idx, itemSize ), HEAP__ELEM( data, smallest, itemSize ), itemSize );
+		idx = smallest;
+	}
+}
+
+// moves the top element to the end of the array and fixes up the rest of the heap, so it can be popped off the stretchy buffer
+static inline void heap__MoveTopToBack( void* data, size_t count, size_t itemSize, HeapLessFunc less )
+{
+	assert( count > 0 );
+	heap__Swap( data, HEAP__ELEM( data, count - 1, itemSize ), itemSize );
+	heap__SiftDown( data, count - 1, 0, itemSize, less );
+}
+
+static inline size_t heap__Update( void* data, size_t count, size_t idx, size_t itemSize, HeapLessFunc less )
+{
+	assert( idx < count );
+	size_t newIdx = heap__SiftUp( data, idx, itemSize, less );
+	if( newIdx == idx ) {
+		newIdx = heap__SiftDown( data, count, idx, itemSize, less );
+	}
+	return newIdx;
+}
+
+static inline void heap__Heapify( void* data, size_t count, size_t itemSize, HeapLessFunc less )
+{
+	if( count < 2 ) return;
+	for( size_t i = ( count / 2 ); i > 0; --i ) {
+		heap__SiftDown( data, count, i - 1, itemSize, less );
+	}
+}
+
+#endif // inclusion guard
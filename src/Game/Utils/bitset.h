@@ -0,0 +1,133 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "stretchyBuffer.h"
+
+// Fixed size set of bits packed into 32-bit words stored in a stretchy buffer.
+//  Zero initialize before use, call bs_Resize to set the number of bits and sb_Release on sbWords when done.
+//  Useful as a visited or closed list that's a lot smaller and faster to clear than a bool per element.
+
+typedef struct {
+	uint32_t* sbWords;
+	size_t numBits;
+} Bitset;
+
+#define BS__WORD( bit ) ( (bit) >> 5 )
+#define BS__MASK( bit ) ( 1u << ( (bit) & 31 ) )
+#define BS__NUM_WORDS( bits ) ( ( (bits) + 31 ) >> 5 )
+
+static inline int bs__LowestBit( uint32_t word )
+{
+	assert( word != 0 );
+#if defined( _MSC_VER )
+	unsigned long idx;
+	_BitScanForward( &idx, word );
+	return (int)idx;
+#else
+	return __builtin_ctz( word );
+#endif
+}
+
+static inline int bs__PopCount( uint32_t word )
+{
+	word = word - ( ( word >> 1 ) & 0x55555555 );
+	word = ( word & 0x33333333 ) + ( ( word >> 2 ) & 0x33333333 );
+	return (int)( ( ( ( word + ( word >> 4 ) ) & 0x0F0F0F0F ) * 0x01010101 ) >> 24 );
+}
+
+// clears all the bits
+static inline void bs_ClearAll( Bitset* bs )
+{
+	assert( bs != NULL );
+	if( bs->sbWords != NULL ) {
+		memset( bs->sbWords, 0, sizeof( bs->sbWords[0] ) * sb_Count( bs->sbWords ) );
+	}
+}
+
+// changes the number of bits, any new bits are cleared
+static inline void bs_Resize( Bitset* bs, size_t numBits )
+{
+	assert( bs != NULL );
+
+	size_t oldWords = sb_Count( bs->sbWords );
+	size_t newWords = BS__NUM_WORDS( numBits );
+	if( newWords > oldWords ) {
+		uint32_t* added = sb_Add( bs->sbWords, newWords - oldWords );
+		memset( added, 0, sizeof( added[0] ) * ( newWords - oldWords ) );
+	} else if( bs->sbWords != NULL ) {
+		sb__Used( bs->sbWords ) = newWords;
+	}
+
+	// clear any bits in the last word past the end so the counts and searches stay correct
+	if( ( numBits < bs->numBits ) && ( ( numBits & 31 ) != 0 ) ) {
+		bs->sbWords[newWords - 1] &= ( BS__MASK( numBits ) - 1 );
+	}
+
+	bs->numBits = numBits;
+}
+
+static inline void bs_Set( Bitset* bs, size_t bit )
+{
+	assert( bit < bs->numBits );
+	bs->sbWords[BS__WORD( bit )] |= BS__MASK( bit );
+}
+
+static inline void bs_Clear( Bitset* bs, size_t bit )
+{
+	assert( bit < bs->numBits );
+	bs->sbWords[BS__WORD( bit )] &= ~BS__MASK( bit );
+}
+
+static inline bool bs_Test( const Bitset* bs, size_t bit )
+{
+	assert( bit < bs->numBits );
+	return ( bs->sbWords[BS__WORD( bit )] & BS__MASK( bit ) ) != 0;
+}
+
+// sets the bit and returns whether it was already set
+static inline bool bs_TestAndSet( Bitset* bs, size_t bit )
+{
+	assert( bit < bs->numBits );
+	uint32_t* word = &( bs->sbWords[BS__WORD( bit )] );
+	bool wasSet = ( (*word) & BS__MASK( bit ) ) != 0;
+	(*word) |= BS__MASK( bit );
+	return wasSet;
+}
+
+// returns the number of set bits
+static inline size_t bs_Count( const Bitset* bs )
+{
+	size_t count = 0;
+	for( size_t i = 0; i < sb_Count( bs->sbWords ); ++i ) {
+		count += bs__PopCount( bs->sbWords[i] );
+	}
+	return count;
+}
+
+// returns the index of the first set bit at or after start, or -1 if there are none
+static inline ptrdiff_t bs_FindNextSet( const Bitset* bs, size_t start )
+{
+	if( start >= bs->numBits ) {
+		return -1;
+	}
+
+	size_t wordIdx = BS__WORD( start );
+	uint32_t word = bs->sbWords[wordIdx] & ~( BS__MASK( start ) - 1 );
+	while( true ) {
+		if( word != 0 ) {
+			return (ptrdiff_t)( ( wordIdx << 5 ) + bs__LowestBit( word ) );
+		}
+		++wordIdx;
+		if( wordIdx >= sb_Count( bs->sbWords ) ) {
+			return -1;
+		}
+		word = bs->sbWords[wordIdx];
+	}
+}
+
+#endif // inclusion guard
@@ -0,0 +1,211 @@
+#include "containerBenchmarks.h"
+
+#include <stdlib.h>
+#include <SDL_stdinc.h>
+
+#include "stretchyBuffer.h"
+#include "binaryHeap.h"
+#include "intHashMap.h"
+#include "smallVector.h"
+#include "bitset.h"
+#include "hashMap.h"
+#include "../System/gameTime.h"
+#include "../System/platformLog.h"
+#include "../System/memory.h"
+
+// the results are summed up and logged so the optimizer can't throw away the work
+static void report( const char* name, float seconds, size_t operations, double checkSum )
+{
+	llog( LOG_INFO, "  %-40s %9.3f ms  %8.2f ns/op  (check %.0f)", name, seconds * 1000.0f, ( seconds * 1.0e9 ) / (double)operations, checkSum );
+}
+
+static bool floatLess( const void* left, const void* right )
+{
+	return ( *(const float*)left ) < ( *(const float*)right );
+}
+
+static void benchmarkPriorityQueue( int scale )
+{
+	size_t count = 20000 * scale;
+	float* values = mem_Allocate( sizeof( float ) * count );
+	for( size_t i = 0; i < count; ++i ) {
+		values[i] = (float)rand( ) / (float)RAND_MAX;
+	}
+
+	llog( LOG_INFO, " Priority queue, %i pushes then pops", (int)count );
+
+	// sorted insertion, what the A* frontier does, highest first so the lowest is popped off the end
+	Uint64 timer = gt_StartTimer( );
+	double check = 0.0;
+	float* sbSorted = NULL;
+	for( size_t i = 0; i < count; ++i ) {
+		size_t lo = 0;
+		size_t hi = sb_Count( sbSorted );
+		while( lo < hi ) {
+			size_t mid = ( lo + hi ) / 2;
+			if( sbSorted[mid] > values[i] ) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		sb_Insert( sbSorted, lo, values[i] );
+	}
+	while( sb_Count( sbSorted ) > 0 ) {
+		check += sb_Pop( sbSorted );
+	}
+	report( "sorted stretchy buffer", gt_StopTimer( timer ), count * 2, check );
+	sb_Release( sbSorted );
+
+	timer = gt_StartTimer( );
+	check = 0.0;
+	float* sbHeap = NULL;
+	for( size_t i = 0; i < count; ++i ) {
+		heap_Push( sbHeap, values[i], floatLess );
+	}
+	while( sb_Count( sbHeap ) > 0 ) {
+		check += heap_Pop( sbHeap, floatLess );
+	}
+	report( "binary heap", gt_StopTimer( timer ), count * 2, check );
+	sb_Release( sbHeap );
+
+	mem_Release( values );
+}
+
+static void benchmarkIntHashMap( int scale )
+{
+	size_t count = 50000 * scale;
+	int lookups = 4;
+	char key[16];
+
+	llog( LOG_INFO, " Integer keyed map, %i inserts then %i lookups", (int)count, (int)count * lookups );
+
+	// what we'd have to do to use the string keyed map
+	Uint64 timer = gt_StartTimer( );
+	double check = 0.0;
+	HashMap stringMap;
+	hashMap_Init( &stringMap, 0, NULL );
+	for( size_t i = 0; i < count; ++i ) {
+		SDL_snprintf( key, sizeof( key ), "%u", (unsigned int)( i * 7 ) );
+		hashMap_Set( &stringMap, key, (int)i );
+	}
+	for( int l = 0; l < lookups; ++l ) {
+		for( size_t i = 0; i < count; ++i ) {
+			int value;
+			SDL_snprintf( key, sizeof( key ), "%u", (unsigned int)( i * 7 ) );
+			if( hashMap_Find( &stringMap, key, &value ) ) {
+				check += value;
+			}
+		}
+	}
+	report( "string hash map", gt_StopTimer( timer ), count * ( lookups + 1 ), check );
+	hashMap_Clear( &stringMap );
+
+	timer = gt_StartTimer( );
+	check = 0.0;
+	IntHashMap intMap;
+	ihm_Init( &intMap, sizeof( int ), 0 );
+	for( size_t i = 0; i < count; ++i ) {
+		int value = (int)i;
+		ihm_Set( &intMap, (uint32_t)( i * 7 ), &value );
+	}
+	for( int l = 0; l < lookups; ++l ) {
+		for( size_t i = 0; i < count; ++i ) {
+			int* value = ihm_FindAs( &intMap, (uint32_t)( i * 7 ), int );
+			if( value != NULL ) {
+				check += (*value);
+			}
+		}
+	}
+	report( "integer hash map", gt_StopTimer( timer ), count * ( lookups + 1 ), check );
+	ihm_Release( &intMap );
+}
+
+static void benchmarkSmallVector( int scale )
+{
+	size_t iterations = 200000 * scale;
+	int perList = 6;
+
+	llog( LOG_INFO, " Temporary lists, %i lists of %i elements", (int)iterations, perList );
+
+	Uint64 timer = gt_StartTimer( );
+	double check = 0.0;
+	for( size_t i = 0; i < iterations; ++i ) {
+		int* sbList = NULL;
+		for( int e = 0; e < perList; ++e ) {
+			sb_Push( sbList, (int)i + e );
+		}
+		check += sbList[perList - 1];
+		sb_Release( sbList );
+	}
+	report( "stretchy buffer", gt_StopTimer( timer ), iterations, check );
+
+	timer = gt_StartTimer( );
+	check = 0.0;
+	for( size_t i = 0; i < iterations; ++i ) {
+		SMALL_VECTOR( int, 8 ) list;
+		sv_Init( list );
+		for( int e = 0; e < perList; ++e ) {
+			sv_Push( list, (int)i + e );
+		}
+		check += list.data[perList - 1];
+		sv_Release( list );
+	}
+	report( "small vector", gt_StopTimer( timer ), iterations, check );
+}
+
+static void benchmarkBitset( int scale )
+{
+	size_t numBits = 100000;
+	size_t iterations = 100 * scale;
+
+	llog( LOG_INFO, " Visited flags, %i passes over %i flags", (int)iterations, (int)numBits );
+
+	Uint64 timer = gt_StartTimer( );
+	double check = 0.0;
+	bool* flags = mem_Allocate( sizeof( bool ) * numBits );
+	for( size_t i = 0; i < iterations; ++i ) {
+		memset( flags, 0, sizeof( bool ) * numBits );
+		for( size_t b = 0; b < numBits; b += 3 ) {
+			flags[b] = true;
+		}
+		for( size_t b = 0; b < numBits; ++b ) {
+			if( flags[b] ) ++check;
+		}
+	}
+	report( "bool array", gt_StopTimer( timer ), iterations * numBits, check );
+	mem_Release( flags );
+
+	timer = gt_StartTimer( );
+	check = 0.0;
+	Bitset bitset = { NULL, 0 };
+	bs_Resize( &bitset, numBits );
+	for( size_t i = 0; i < iterations; ++i ) {
+		bs_ClearAll( &bitset );
+		for( size_t b = 0; b < numBits; b += 3 ) {
+			bs_Set( &bitset, b );
+		}
+		for( ptrdiff_t b = bs_FindNextSet( &bitset, 0 ); b >= 0; b = bs_FindNextSet( &bitset, (size_t)b + 1 ) ) {
+			++check;
+		}
+	}
+	report( "bitset", gt_StopTimer( timer ), iterations * numBits, check );
+	sb_Release( bitset.sbWords );
+}
+
+void containers_RunBenchmarks( int scale )
+{
+	if( scale < 1 ) {
+		scale = 1;
+	}
+
+	llog( LOG_INFO, "Container benchmarks, scale %i", scale );
+
+	srand( 1 );
+	benchmarkPriorityQueue( scale );
+	benchmarkIntHashMap( scale );
+	benchmarkSmallVector( scale );
+	benchmarkBitset( scale );
+
+	llog( LOG_INFO, "Container benchmarks done" );
+}
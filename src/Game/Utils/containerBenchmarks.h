@@ -0,0 +1,9 @@
+#ifndef CONTAINER_BENCHMARKS_H
+#define CONTAINER_BENCHMARKS_H
+
+// Micro-benchmarks for the containers in Utils, compares each one against the stretchy buffer or hash map code it
+//  would replace and logs the timings. Needs the memory manager and SDL timer to be initialized.
+//  scale multiplies the number of elements and iterations used, 1 takes about a second on a desktop.
+void containers_RunBenchmarks( int scale );
+
+#endif /* inclusion guard */
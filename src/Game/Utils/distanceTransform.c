@@ -0,0 +1,169 @@
+#include "distanceTransform.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+
+typedef struct {
+	float* f; // copy of the column or row being transformed
+	float* z; // boundaries between the parabolas, one more than the number of parabolas
+	int* v; // locations of the parabolas in the lower envelope
+} EDTScratch;
+
+static int largestSide( int width, int height )
+{
+	return ( width > height ) ? width : height;
+}
+
+static EDTScratch splitScratch( void* scratch, int n )
+{
+	EDTScratch split;
+	split.f = (float*)scratch;
+	split.z = split.f + n;
+	split.v = (int*)( split.z + n + 1 );
+	return split;
+}
+
+// Size in bytes of the scratch memory edt_Transform needs for an image of the size.
+size_t edt_ScratchSize( int width, int height )
+{
+	size_t n = (size_t)largestSide( width, height );
+	return ( sizeof( float ) * ( ( n * 2 ) + 1 ) ) + ( sizeof( int ) * n );
+}
+
+// 1D transform of the n values starting at data, each value stride apart, results are written back over them.
+static void transform1D( float* data, int n, int stride, EDTScratch* scratch )
+{
+	float* f = scratch->f;
+	float* z = scratch->z;
+	int* v = scratch->v;
+
+	for( int i = 0; i < n; ++i ) {
+		f[i] = data[i * stride];
+	}
+
+	// find the lower envelope of the parabolas rooted at each sample, samples at infinity are skipped since they can't
+	//  be part of it and intersecting them loses all precision
+	int k = -1;
+	for( int q = 0; q < n; ++q ) {
+		if( f[q] >= EDT_INFINITY ) {
+			continue;
+		}
+
+		if( k < 0 ) {
+			k = 0;
+			v[0] = q;
+			z[0] = -EDT_INFINITY;
+			z[1] = EDT_INFINITY;
+			continue;
+		}
+
+		// z[0] is always -EDT_INFINITY so this will stop at the first parabola
+		float s;
+		for( ;; ) {
+			int p = v[k];
+			s = ( ( f[q] + ( (float)q * (float)q ) ) - ( f[p] + ( (float)p * (float)p ) ) ) / (float)( 2 * ( q - p ) );
+			if( s > z[k] ) {
+				break;
+			}
+			--k;
+		}
+
+		++k;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = EDT_INFINITY;
+	}
+
+	if( k < 0 ) {
+		// nothing to find the distance to, everything stays at infinity
+		return;
+	}
+
+	// fill in the distances from the envelope
+	k = 0;
+	for( int q = 0; q < n; ++q ) {
+		while( z[k + 1] < (float)q ) {
+			++k;
+		}
+		int p = v[k];
+		float diff = (float)( q - p );
+		data[q * stride] = ( diff * diff ) + f[p];
+	}
+}
+
+// Transforms the grid in place. Going in each value should be 0 for the pixels to find the distance to and
+//  EDT_INFINITY for everything else, coming out each value will be the squared distance to the closest of those pixels.
+void edt_Transform( float* grid, int width, int height, void* scratch )
+{
+	assert( grid != NULL );
+	assert( scratch != NULL );
+
+	EDTScratch split = splitScratch( scratch, largestSide( width, height ) );
+
+	for( int x = 0; x < width; ++x ) {
+		transform1D( grid + x, height, width, &split );
+	}
+
+	for( int y = 0; y < height; ++y ) {
+		transform1D( grid + ( y * width ), width, 1, &split );
+	}
+}
+
+// Size in bytes of the memory edt_CreateSDF needs for an image of the size.
+size_t edt_SDFWorkspaceSize( int width, int height )
+{
+	return ( sizeof( float ) * (size_t)width * (size_t)height * 2 ) + edt_ScratchSize( width, height );
+}
+
+// Creates a signed distance field from a single channel coverage bitmap, like the ones stb_truetype rasterizes, where
+//  anything at or above 128 is inside. Partially covered pixels use their coverage to place the edge within the pixel.
+//  The values are written the same way stbtt_GetGlyphSDF does, onEdgeValue at the edge and changing by pixelDistScale
+//  for each pixel away from it, increasing going inside. out is written using outStride bytes per row.
+void edt_CreateSDF( const uint8_t* coverage, int width, int height, uint8_t onEdgeValue, float pixelDistScale,
+	uint8_t* out, int outStride, void* workspace )
+{
+	assert( coverage != NULL );
+	assert( out != NULL );
+	assert( workspace != NULL );
+
+	size_t count = (size_t)width * (size_t)height;
+	float* toInside = (float*)workspace;
+	float* toOutside = toInside + count;
+	void* scratch = (void*)( toOutside + count );
+
+	for( size_t i = 0; i < count; ++i ) {
+		bool inside = ( coverage[i] >= 128 );
+		toInside[i] = inside ? 0.0f : EDT_INFINITY;
+		toOutside[i] = inside ? EDT_INFINITY : 0.0f;
+	}
+
+	edt_Transform( toInside, width, height, scratch );
+	edt_Transform( toOutside, width, height, scratch );
+
+	for( int y = 0; y < height; ++y ) {
+		for( int x = 0; x < width; ++x ) {
+			size_t i = (size_t)x + ( (size_t)y * (size_t)width );
+
+			// distance in pixels from the center of the pixel to the edge, positive outside
+			float dist;
+			uint8_t c = coverage[i];
+			if( ( c > 0 ) && ( c < 255 ) ) {
+				// the edge goes through this pixel, the coverage gives a better estimate than the neighbors do
+				dist = 0.5f - ( (float)c / 255.0f );
+			} else if( c >= 128 ) {
+				dist = 0.5f - sqrtf( toOutside[i] );
+			} else {
+				dist = sqrtf( toInside[i] ) - 0.5f;
+			}
+
+			float value = (float)onEdgeValue - ( dist * pixelDistScale );
+			if( value < 0.0f ) {
+				value = 0.0f;
+			} else if( value > 255.0f ) {
+				value = 255.0f;
+			}
+			out[x + ( y * outStride )] = (uint8_t)value;
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#ifndef DISTANCE_TRANSFORM_H
+#define DISTANCE_TRANSFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Exact euclidean distance transforms using the separable algorithm from Felzenszwalb and Huttenlocher,
+ "Distance Transforms of Sampled Functions": http://cs.brown.edu/people/pfelzens/papers/dt-final.pdf
+ The 2D transform is done as a 1D transform of every column followed by every row, so it's linear in the number of
+ pixels instead of having to compare every pixel against every edge.
+ Nothing is allocated, the caller passes in the memory to use so these can be called from multiple threads at once.
+*/
+
+#define EDT_INFINITY 1e20f
+
+// Size in bytes of the scratch memory edt_Transform needs for an image of the size.
+size_t edt_ScratchSize( int width, int height );
+
+// Transforms the grid in place. Going in each value should be 0 for the pixels to find the distance to and
+//  EDT_INFINITY for everything else, coming out each value will be the squared distance to the closest of those pixels.
+void edt_Transform( float* grid, int width, int height, void* scratch );
+
+// Size in bytes of the memory edt_CreateSDF needs for an image of the size.
+size_t edt_SDFWorkspaceSize( int width, int height );
+
+// Creates a signed distance field from a single channel coverage bitmap, like the ones stb_truetype rasterizes, where
+//  anything at or above 128 is inside. Partially covered pixels use their coverage to place the edge within the pixel.
+//  The values are written the same way stbtt_GetGlyphSDF does, onEdgeValue at the edge and changing by pixelDistScale
+//  for each pixel away from it, increasing going inside. out is written using outStride bytes per row.
+void edt_CreateSDF( const uint8_t* coverage, int width, int height, uint8_t onEdgeValue, float pixelDistScale,
+	uint8_t* out, int outStride, void* workspace );
+
+#endif /* inclusion guard */
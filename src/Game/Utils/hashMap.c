@@ -4,14 +4,26 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
-#include <math.h>
 
 #include <SDL_stdinc.h>
 
 #include "../Math/mathUtil.h"
+#include "../Math/simd.h"
 #include "../System/memory.h"
 #include "../System/platformLog.h"
 #include "../Utils/helpers.h"
+#include "../Utils/stretchyBuffer.h"
+
+#define GROUP_SIZE 16
+
+// control bytes, anything with the high bit clear is in use and holds the low 7 bits of the hash
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xFE
+
+#define IS_FULL( c ) ( ( (c) & 0x80 ) == 0 )
+
+// the table is rebuilt when more than 7/8 of the slots are in use or deleted
+#define MAX_LOAD( capacity ) ( ( (capacity) / 8 ) * 7 )
 
 static uint32_t hashFunc_DJB2( const char* str )
 {
@@ -27,44 +39,124 @@ static uint32_t hashFunc_DJB2( const char* str )
 	return hash;
 }
 
-static bool isPowerOfTwoU32( uint32_t val )
+// the control bytes and group index are taken from different parts of the hash, so make sure all the bits are
+//  well mixed no matter what hash function is used, this is the finalizer from MurmurHash3
+static uint32_t mixHash( uint32_t h )
 {
-	return ( ( val == 1 ) || ( ( val & ( val - 1 ) ) == 0 ) );
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
 }
 
-// we're assuming denom is a power of two
-static uint32_t powerTwoModulus( uint32_t num, uint32_t denom )
+static uint32_t hash( HashMap* hashMap, const char* key )
 {
-	assert( isPowerOfTwoU32( denom ) );
-	return ( num & ( denom - 1 ) );
+	return mixHash( hashMap->hashFunc( key ) );
 }
 
-static uint32_t chooseCapacity( uint32_t baseSize )
+#define H1( h ) ( (h) >> 7 )
+#define H2( h ) ( (uint8_t)( (h) & 0x7F ) )
+
+static int lowestBit( uint32_t mask )
 {
-	size_t size = baseSize - 1;
-	size = size | ( size >> 1 );
-	size = size | ( size >> 2 );
-	size = size | ( size >> 4 );
-	size = size | ( size >> 6 );
-	size = size | ( size >> 16 );
-
-	return ( size + 1 );
+	assert( mask != 0 );
+#if defined( _MSC_VER )
+	unsigned long idx;
+	_BitScanForward( &idx, mask );
+	return (int)idx;
+#else
+	return __builtin_ctz( mask );
+#endif
 }
 
-// wraps the modulus function, so it doesn't have to be in the hash function
-static uint32_t hash( HashMap* hashMap, const char* key )
+// returns a mask with a bit set for every slot in the group whose control byte is the same as ctrl
+static uint32_t groupMatch( const uint8_t* group, uint8_t ctrl )
+{
+#if SIMD_WIDTH > 0
+	return (uint32_t)simd16u8_MoveMask( simd16u8_CmpEq( simd16u8_Load( group ), simd16u8_Set1( ctrl ) ) );
+#else
+	uint32_t mask = 0;
+	for( int i = 0; i < GROUP_SIZE; ++i ) {
+		if( group[i] == ctrl ) mask |= ( 1u << i );
+	}
+	return mask;
+#endif
+}
+
+// returns a mask with a bit set for every slot in the group that is empty or deleted
+static uint32_t groupMatchAvailable( const uint8_t* group )
 {
-	return powerTwoModulus( hashMap->hashFunc( key ), hashMap->capacity );
+#if SIMD_WIDTH > 0
+	return (uint32_t)simd16u8_MoveMask( simd16u8_Load( group ) );
+#else
+	uint32_t mask = 0;
+	for( int i = 0; i < GROUP_SIZE; ++i ) {
+		if( !IS_FULL( group[i] ) ) mask |= ( 1u << i );
+	}
+	return mask;
+#endif
 }
 
-#define NEXT_IDX( hm, curr ) ( ( ( (curr) + 1 ) >= ( (hm)->capacity ) ) ? 0 : ( (curr) + 1 ) )
+static size_t chooseCapacity( size_t minSlots )
+{
+	// enough slots so minSlots stays under the max load
+	size_t needed = ( minSlots * 8 ) / 7 + 1;
+	size_t capacity = GROUP_SIZE;
+	while( capacity < needed ) {
+		capacity *= 2;
+	}
+	return capacity;
+}
 
-void hashMap_Init( HashMap* hashMap, uint32_t estimatedSize, HashFunc hashFunc )
+static void allocateSlots( HashMap* hashMap, size_t capacity )
 {
-	//hashMap->hashFunc = hashFunc_Test;
-	hashMap->keys = NULL;
+	hashMap->capacity = capacity;
+	hashMap->count = 0;
+	hashMap->numDeleted = 0;
+
+	hashMap->control = (uint8_t*)mem_Allocate( sizeof( hashMap->control[0] ) * capacity );
+	hashMap->hashes = (uint32_t*)mem_Allocate( sizeof( hashMap->hashes[0] ) * capacity );
+	hashMap->keyOffsets = (uint32_t*)mem_Allocate( sizeof( hashMap->keyOffsets[0] ) * capacity );
+	hashMap->values = (uint8_t*)mem_Allocate( hashMap->valueSize * capacity );
+
+	memset( hashMap->control, CTRL_EMPTY, sizeof( hashMap->control[0] ) * capacity );
+}
+
+static void releaseSlots( HashMap* hashMap )
+{
+	mem_Release( hashMap->control );
+	mem_Release( hashMap->hashes );
+	mem_Release( hashMap->keyOffsets );
+	mem_Release( hashMap->values );
+
+	hashMap->control = NULL;
+	hashMap->hashes = NULL;
+	hashMap->keyOffsets = NULL;
+	hashMap->values = NULL;
+	hashMap->capacity = 0;
+	hashMap->count = 0;
+	hashMap->numDeleted = 0;
+}
+
+#define KEY( hm, idx ) ( (hm)->sbKeyArena + (hm)->keyOffsets[(idx)] )
+#define VALUE( hm, idx ) ( (hm)->values + ( (idx) * (hm)->valueSize ) )
+
+void hashMap_InitTyped( HashMap* hashMap, uint32_t estimatedSize, size_t valueSize, HashFunc hashFunc )
+{
+	assert( hashMap != NULL );
+	assert( valueSize > 0 );
+
+	hashMap->control = NULL;
+	hashMap->hashes = NULL;
+	hashMap->keyOffsets = NULL;
 	hashMap->values = NULL;
+	hashMap->sbKeyArena = NULL;
 	hashMap->capacity = 0;
+	hashMap->count = 0;
+	hashMap->numDeleted = 0;
+	hashMap->valueSize = valueSize;
 
 	hashMap->hashFunc = hashFunc_DJB2;
 	if( hashFunc != NULL ) {
@@ -76,163 +168,210 @@ void hashMap_Init( HashMap* hashMap, uint32_t estimatedSize, HashFunc hashFunc )
 	}
 
 	// set an initial size based on the estimated size
-	hashMap->capacity = chooseCapacity( estimatedSize * 2 );
+	allocateSlots( hashMap, chooseCapacity( estimatedSize ) );
+}
 
-	hashMap->keys = (HashMapKey*)mem_Allocate( sizeof( HashMapKey ) * hashMap->capacity );
-	hashMap->values = (int*)mem_Allocate( sizeof( int ) * hashMap->capacity );
+void hashMap_Init( HashMap* hashMap, uint32_t estimatedSize, HashFunc hashFunc )
+{
+	hashMap_InitTyped( hashMap, estimatedSize, sizeof( int ), hashFunc );
+}
 
-	for( size_t i = 0; i < hashMap->capacity; ++i ) {
-		hashMap->keys[i].key = NULL;
-		hashMap->keys[i].probeLength = UINT8_MAX;
+// returns the slot the key is in, or -1 if it isn't in the hash map
+static int findIndex( HashMap* hashMap, const char* key, uint32_t h )
+{
+	if( hashMap->capacity == 0 ) {
+		return -1;
 	}
 
-	// android doesn't support log2, so we just do ln( c ) / ln( 2 )
-	//hashMap->probeLimit = (size_t)log2( (double)hashMap->capacity );
-	hashMap->probeLimit = (size_t)( SDL_log( (double)hashMap->capacity ) * 1.4426950408889634 );
-}
+	size_t groupMask = ( hashMap->capacity / GROUP_SIZE ) - 1;
+	size_t group = H1( h ) & groupMask;
+	uint8_t h2 = H2( h );
 
-static void resize( HashMap* hashMap, uint32_t newSize )
-{
-	// allocate new list and move data
-	HashMap newHashMap;
-	hashMap_Init( &newHashMap, newSize, hashMap->hashFunc );
+	for( size_t step = 1; ; ++step ) {
+		const uint8_t* ctrl = hashMap->control + ( group * GROUP_SIZE );
 
-	// insert elements from old hashmap
-	for( size_t i = 0; i < hashMap->capacity; ++i ) {
-		if( hashMap->keys[i].probeLength != UINT8_MAX ) {
-			hashMap_Set( &newHashMap, hashMap->keys[i].key, hashMap->values[i] );
-			mem_Release( hashMap->keys[i].key );
+		uint32_t matches = groupMatch( ctrl, h2 );
+		while( matches != 0 ) {
+			int idx = (int)( group * GROUP_SIZE ) + lowestBit( matches );
+			if( ( hashMap->hashes[idx] == h ) && ( strcmp( KEY( hashMap, idx ), key ) == 0 ) ) {
+				return idx;
+			}
+			matches &= matches - 1;
+		}
+
+		// if there's an empty slot in this group then the key would have been put here
+		if( groupMatch( ctrl, CTRL_EMPTY ) != 0 ) {
+			return -1;
 		}
+
+		// every group is full, this shouldn't happen since we rebuild before that
+		if( step > groupMask ) {
+			return -1;
+		}
+
+		group = ( group + step ) & groupMask;
 	}
+}
 
-	// release old data
-	mem_Release( hashMap->keys );
-	mem_Release( hashMap->values );
+// returns the first empty or deleted slot in the probe sequence for the hash, assumes there's at least one
+static int findAvailableIndex( HashMap* hashMap, uint32_t h )
+{
+	size_t groupMask = ( hashMap->capacity / GROUP_SIZE ) - 1;
+	size_t group = H1( h ) & groupMask;
 
-	// copy over new data
-	(*hashMap) = newHashMap;
+	for( size_t step = 1; ; ++step ) {
+		uint32_t available = groupMatchAvailable( hashMap->control + ( group * GROUP_SIZE ) );
+		if( available != 0 ) {
+			return (int)( group * GROUP_SIZE ) + lowestBit( available );
+		}
+		group = ( group + step ) & groupMask;
+	}
 }
 
-static bool matches( HashMap* hashMap, const char* key, int idx, uint8_t currLength )
+// puts a key we know doesn't exist into a slot, the key must already be in the arena
+static void insertNew( HashMap* hashMap, uint32_t h, uint32_t keyOffset, const void* value )
 {
-	return ( ( hashMap->keys[idx].probeLength == currLength ) && ( strcmp( key, hashMap->keys[idx].key ) == 0 ) );
+	int idx = findAvailableIndex( hashMap, h );
+	if( hashMap->control[idx] == CTRL_DELETED ) {
+		--hashMap->numDeleted;
+	}
+	hashMap->control[idx] = H2( h );
+	hashMap->hashes[idx] = h;
+	hashMap->keyOffsets[idx] = keyOffset;
+	memcpy( VALUE( hashMap, idx ), value, hashMap->valueSize );
+	++hashMap->count;
 }
 
-// returns whether the key was found, if it was outIdx will contain the index
-static bool findIndex( HashMap* hashMap, const char* key, uint32_t* outIdx )
+// rebuilds the table with the new capacity, also gets rid of any deleted slots and compacts the key arena
+static void rebuild( HashMap* hashMap, size_t newCapacity )
 {
-	uint32_t idx = hash( hashMap, key );
-	uint8_t currLength = 0;
+	HashMap old = (*hashMap);
 
-	while( ( hashMap->keys[idx].probeLength != UINT8_MAX ) && ( currLength <= hashMap->keys[idx].probeLength ) ) {
+	hashMap->sbKeyArena = NULL;
+	allocateSlots( hashMap, newCapacity );
+	if( old.sbKeyArena != NULL ) {
+		sb_Reserve( hashMap->sbKeyArena, sb_Count( old.sbKeyArena ) );
+	}
 
-		// seeing if the probe lengths are equal is a good first pass fail thing
-		if( matches( hashMap, key, idx, currLength ) ) {
-			(*outIdx) = idx;
-			return true;
-		}
+	for( size_t i = 0; i < old.capacity; ++i ) {
+		if( !IS_FULL( old.control[i] ) ) continue;
 
-		idx = NEXT_IDX( hashMap, idx );
-		++currLength;
+		const char* key = KEY( &old, i );
+		size_t len = SDL_strlen( key ) + 1;
+		uint32_t offset = (uint32_t)sb_Count( hashMap->sbKeyArena );
+		memcpy( sb_Add( hashMap->sbKeyArena, len ), key, len );
+
+		insertNew( hashMap, old.hashes[i], offset, VALUE( &old, i ) );
 	}
 
-	return false;
+	sb_Release( old.sbKeyArena );
+	releaseSlots( &old );
 }
 
-#define SWAP( l, r, type ) { type swap = (type)l; l = (type)r; r = swap; }
-
-// this is the biggie
-void hashMap_Set( HashMap* hashMap, const char* key, int value )
+void hashMap_SetTyped( HashMap* hashMap, const char* key, const void* value )
 {
 	assert( hashMap != NULL );
+	assert( key != NULL );
+	assert( value != NULL );
 
-	// find the ideal position
-	// from there scan forward until we find an empty spot
-	// if the spot matches (the key already exists) then set the new value
-	// otherwise if the spot is empty insert the key and values, also set the probe distance
-	// else if the current distance is greater than the probe distance rehash in a larger hashmap, start the Set from the beginning
-	// else if the current distance is greater then the distance for the entry at this spot, swap all the values and continue
+	uint32_t h = hash( hashMap, key );
 
-	// copy the key
-	size_t len = SDL_strlen( key ) + 1;
-	char* newKey = mem_Allocate( sizeof( char ) * len );
-	SDL_strlcpy( newKey, key, len );
-	
-	uint32_t idx = hash( hashMap, newKey );
-	uint8_t currLength = 0;
-	bool increaseLength = true;
-
-	while( ( hashMap->keys[idx].probeLength != UINT8_MAX ) &&
-		   !matches( hashMap, newKey, idx, currLength ) ) {
-
-		uint32_t nextIdx = NEXT_IDX( hashMap, idx );
-
-		if( currLength > hashMap->probeLimit ) {
-			// past the probe limit, this is a failed insert, rebuild and reset insertion stuff
-			resize( hashMap, chooseCapacity( hashMap->capacity ) );
-
-			nextIdx = hash( hashMap, newKey );
-			currLength = 0;
-			increaseLength = false;
-		} else if( currLength > hashMap->keys[idx].probeLength ) {
-			// current index is greater, take from the rich and give to the poor
-			SWAP( hashMap->keys[idx].key, newKey, char* );
-			SWAP( hashMap->keys[idx].probeLength, currLength, uint8_t );
-			SWAP( hashMap->values[idx], value, int );
+	// if it already exists just replace the value, no need to copy the key
+	int idx = findIndex( hashMap, key, h );
+	if( idx >= 0 ) {
+		memcpy( VALUE( hashMap, idx ), value, hashMap->valueSize );
+		return;
+	}
+
+	if( ( hashMap->count + hashMap->numDeleted + 1 ) > MAX_LOAD( hashMap->capacity ) ) {
+		// if it's mostly deleted slots then rebuilding at the same size will be enough to clear them out
+		size_t newCapacity = hashMap->capacity;
+		if( ( newCapacity == 0 ) || ( ( hashMap->count + 1 ) > ( MAX_LOAD( newCapacity ) / 2 ) ) ) {
+			newCapacity = chooseCapacity( ( hashMap->count + 1 ) * 2 );
 		}
+		rebuild( hashMap, newCapacity );
+	}
+
+	// copy the key into the arena
+	size_t len = SDL_strlen( key ) + 1;
+	uint32_t offset = (uint32_t)sb_Count( hashMap->sbKeyArena );
+	memcpy( sb_Add( hashMap->sbKeyArena, len ), key, len );
+
+	insertNew( hashMap, h, offset, value );
+}
+
+void* hashMap_FindTyped( HashMap* hashMap, const char* key )
+{
+	assert( hashMap != NULL );
+	assert( key != NULL );
 
-		if( increaseLength ) ++currLength;
-		idx = nextIdx;
-		increaseLength = true;
+	int idx = findIndex( hashMap, key, hash( hashMap, key ) );
+	if( idx < 0 ) {
+		return NULL;
 	}
 
-	// got a good spot, insert
-	hashMap->keys[idx].key = newKey;
-	hashMap->keys[idx].probeLength = currLength;
-	hashMap->values[idx] = value;
+	return VALUE( hashMap, idx );
+}
+
+void hashMap_Set( HashMap* hashMap, const char* key, int value )
+{
+	assert( hashMap != NULL );
+	assert( hashMap->valueSize == sizeof( int ) );
+
+	hashMap_SetTyped( hashMap, key, &value );
 }
 
 // returns whether the find was a success
 bool hashMap_Find( HashMap* hashMap, const char* key, int* outValue )
 {
 	assert( hashMap != NULL );
+	assert( hashMap->valueSize == sizeof( int ) );
 
-	uint32_t idx;
-	if( !findIndex( hashMap, key, &idx ) ) {
+	int* value = (int*)hashMap_FindTyped( hashMap, key );
+	if( value == NULL ) {
 		return false;
 	}
 
-	(*outValue) = hashMap->values[idx];
+	(*outValue) = (*value);
 	return true;
 }
 
 bool hashMap_Exists( HashMap* hashMap, const char* key )
 {
 	assert( hashMap != NULL );
-	uint32_t idx;
-	return findIndex( hashMap, key, &idx );
+	return ( findIndex( hashMap, key, hash( hashMap, key ) ) >= 0 );
 }
 
-static void removeAtIdx( HashMap* hashMap, uint32_t idx )
+// Makes room for numKeys more keys that take up keyBytes, including their null terminators, so adding a lot of keys at
+//  once only rebuilds the table once
+void hashMap_Reserve( HashMap* hashMap, size_t numKeys, size_t keyBytes )
 {
-	// mark idx as unused
-	hashMap->keys[idx].probeLength = UINT8_MAX;
-	mem_Release( hashMap->keys[idx].key );
-	hashMap->keys[idx].key = NULL;
-	uint32_t prevIdx = idx;
-	idx = NEXT_IDX( hashMap, idx );
+	assert( hashMap != NULL );
 
-	// swap with the next element as long as the next element is in use, decrement the distance by one as well
-	while( ( hashMap->keys[idx].probeLength != UINT8_MAX ) && ( hashMap->keys[idx].probeLength != 0 ) ) {
-		hashMap->keys[prevIdx].probeLength = hashMap->keys[idx].probeLength - 1;
-		hashMap->keys[prevIdx].key = hashMap->keys[idx].key;
-		hashMap->values[prevIdx] = hashMap->values[idx];
+	size_t needed = hashMap->count + numKeys;
+	if( ( needed + hashMap->numDeleted ) > MAX_LOAD( hashMap->capacity ) ) {
+		rebuild( hashMap, chooseCapacity( needed ) );
+	}
 
-		hashMap->keys[idx].probeLength = UINT8_MAX;
+	size_t arenaNeeded = sb_Count( hashMap->sbKeyArena ) + keyBytes;
+	if( sb_Reserved( hashMap->sbKeyArena ) < arenaNeeded ) {
+		sb_Reserve( hashMap->sbKeyArena, arenaNeeded );
+	}
+}
 
-		prevIdx = idx;
-		idx = NEXT_IDX( hashMap, idx );
+static void removeAtIdx( HashMap* hashMap, int idx )
+{
+	// if the group has an empty slot then no probe could have gone past it, so it's safe to mark this as empty as well
+	const uint8_t* group = hashMap->control + ( ( idx / GROUP_SIZE ) * GROUP_SIZE );
+	if( groupMatch( group, CTRL_EMPTY ) != 0 ) {
+		hashMap->control[idx] = CTRL_EMPTY;
+	} else {
+		hashMap->control[idx] = CTRL_DELETED;
+		++hashMap->numDeleted;
 	}
+	--hashMap->count;
+
+	// the key is left in the arena until the next rebuild
 }
 
 void hashMap_Remove( HashMap* hashMap, const char* key )
@@ -240,46 +379,41 @@ void hashMap_Remove( HashMap* hashMap, const char* key )
 	assert( hashMap != NULL );
 
 	// first see if what wants to be removed exists
-	uint32_t idx;
-	if( !findIndex( hashMap, key, &idx ) ) {
+	int idx = findIndex( hashMap, key, hash( hashMap, key ) );
+	if( idx < 0 ) {
 		return;
 	}
 
 	removeAtIdx( hashMap, idx );
 }
 
-void hashMap_RemoveFirstByValue( HashMap* hashMap, int value )
+void hashMap_RemoveFirstByValueTyped( HashMap* hashMap, const void* value )
 {
 	assert( hashMap != NULL );
 
 	// just do this the naive way until we run into performance issues
 	for( size_t i = 0; i < hashMap->capacity; ++i ) {
-		if( hashMap->keys[i].probeLength != UINT8_MAX ) {
-			if( hashMap->values[i] == value ) {
-				removeAtIdx( hashMap, (uint32_t)i );
-				return;
-			}
+		if( IS_FULL( hashMap->control[i] ) && ( memcmp( VALUE( hashMap, i ), value, hashMap->valueSize ) == 0 ) ) {
+			removeAtIdx( hashMap, (int)i );
+			return;
 		}
 	}
 }
 
-void hashMap_Clear( HashMap* hashMap )
+void hashMap_RemoveFirstByValue( HashMap* hashMap, int value )
 {
 	assert( hashMap != NULL );
+	assert( hashMap->valueSize == sizeof( int ) );
 
-	// clear out keys
-	for( size_t i = 0; i < hashMap->capacity; ++i ) {
-		mem_Release( hashMap->keys[i].key );
-	}
-
-	mem_Release( hashMap->keys );
-	mem_Release( hashMap->values );
+	hashMap_RemoveFirstByValueTyped( hashMap, &value );
+}
 
-	hashMap->keys = NULL;
-	hashMap->values = NULL;
+void hashMap_Clear( HashMap* hashMap )
+{
+	assert( hashMap != NULL );
 
-	hashMap->capacity = 0;
-	hashMap->probeLimit = 0;
+	releaseSlots( hashMap );
+	sb_Release( hashMap->sbKeyArena );
 }
 
 void hashMap_Report( HashMap* hashMap, size_t* capacity )
@@ -419,7 +553,7 @@ void hashMap_Test( void )
 
 	if( hashMap_Find( &testMap, "another test", &testVal ) ) {
 		llog( LOG_DEBUG, " - Additional added value exists." );
-		if( testVal == 100 ) {
+		if( testVal == 9001 ) {
 			llog( LOG_DEBUG, " - Correct additional value" );
 		} else {
 			llog( LOG_DEBUG, " - INCORRECT ADDITIONAL VALUE" );
@@ -443,7 +577,7 @@ void hashMap_Test( void )
 
 	if( hashMap_Find( &testMap, "another test", &testVal ) ) {
 		llog( LOG_DEBUG, " - Additional added value exists." );
-		if( testVal == 100 ) {
+		if( testVal == 9001 ) {
 			llog( LOG_DEBUG, " - Correct additional value" );
 		} else {
 			llog( LOG_DEBUG, " - INCORRECT ADDITIONAL VALUE" );
@@ -551,5 +685,50 @@ void hashMap_Test( void )
 
 	llog( LOG_DEBUG, "Mass add test done" );
 
+	llog( LOG_DEBUG, "Testing mass remove" );
+	for( size_t i = 0; i < arraySize; i += 2 ) {
+		hashMap_Remove( &testMap, testValues[i].key );
+	}
+
+	for( size_t i = 0; i < arraySize; ++i ) {
+		bool exists = hashMap_Find( &testMap, testValues[i].key, &testVal );
+		if( ( i % 2 ) == 0 ) {
+			if( exists ) {
+				llog( LOG_DEBUG, " - REMOVED PAIR %u STILL EXISTS", i );
+			}
+		} else if( !exists || ( testVal != testValues[i].value ) ) {
+			llog( LOG_DEBUG, " - AFTER REMOVING, PAIR %u IS MISSING OR INCORRECT", i );
+		}
+	}
+
+	llog( LOG_DEBUG, "Mass remove test done" );
+
+	hashMap_Clear( &testMap );
+
+	llog( LOG_DEBUG, "Testing typed values" );
+	typedef struct {
+		float x, y;
+		int id;
+	} TypedTest;
+
+	hashMap_InitTyped( &testMap, 4, sizeof( TypedTest ), NULL );
+	for( size_t i = 0; i < arraySize; ++i ) {
+		TypedTest value = { (float)i, (float)( i * 2 ), testValues[i].value };
+		hashMap_SetTyped( &testMap, testValues[i].key, &value );
+	}
+
+	for( size_t i = 0; i < arraySize; ++i ) {
+		TypedTest* found = hashMap_FindAs( &testMap, testValues[i].key, TypedTest );
+		if( ( found == NULL ) || ( found->id != testValues[i].value ) || ( found->y != (float)( i * 2 ) ) ) {
+			llog( LOG_DEBUG, " - TYPED PAIR %u IS MISSING OR INCORRECT", i );
+		}
+	}
+
+	if( hashMap_FindTyped( &testMap, "INVALID" ) != NULL ) {
+		llog( LOG_DEBUG, " - MISSING TYPED VALUE EXISTS!" );
+	}
+
+	llog( LOG_DEBUG, "Typed value test done" );
+
 	hashMap_Clear( &testMap );
 }
\ No newline at end of file
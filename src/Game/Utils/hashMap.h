@@ -1,18 +1,16 @@
 /*
-based on this: https://probablydance.com/2017/02/26/i-wrote-the-fastest-hashtable/
+String keyed hash map, based on the ideas behind this: https://abseil.io/about/design/swisstables
  - Open addressing
- - Linear probing
- - Robin Hood hashing (When you probe for an insertion, if the probe length (distance from the ideal spot) for the existing element is less than the probe
-	  length for the element being inserted, swap the two elements and keep going.) This lets us add a test when retrieving, such that if the distance from
-    the ideal spot is greater than the distance that the current slot is from it's ideal, we can assume the item doesn't exist.
-    When deleting an element we'll NEED to find if there was something that could fill it's spot, this is quite easy, go forward while there are still
-    elements, if the element is not in it's ideal spot move it back one (and decrement it's probe distance accordingly).
- - Power of two number of slots (they recommend primes, but we shouldn't run into the issues presented (hopefully))
- - Upper limit on the probe count (recommends log2(n) where n is the number of slots in the table), when we try to insert and
-    hit the upper limit probe count we resize the table to be larger, generally this was at about 2/3 full. Can add a test for retrieving, if the distance
-    from the ideal spot is greater than the max probe count we know the item cannot exist (this will end up being equivilant to the test from the Robin
-    Hood hashing retrieval test).
-NOTE: We're storing the string pointer passed in, so we're assuming it will not change. Can modify it later to make a copy of the string instead.
+ - Slots are split into groups of 16, each slot has a control byte that holds either the empty or deleted flags or the low
+    7 bits of the hash. Probing checks a whole group of control bytes at once, using SIMD when it's available, so most
+    of the time we only look at the keys of slots that are very likely to match.
+ - The full hash is stored for each slot, so the string comparison is only done if the hashes match.
+ - The keys are copied into a single arena owned by the hash map instead of being allocated one by one, setting the value
+    of a key that already exists doesn't copy the key again. The arena is compacted when the table is rebuilt.
+ - Power of two number of groups, probing jumps between groups using triangular numbers so every group will be visited.
+ - Removing a key leaves a deleted marker unless no probe could have passed through the group, the markers are cleared
+    out when the table is rebuilt.
+The values can be any size, the int functions are there for the common case of mapping a name to an index.
 */
 
 #ifndef HASH_MAP_H
@@ -25,23 +23,37 @@ NOTE: We're storing the string pointer passed in, so we're assuming it will not
 typedef uint32_t (*HashFunc)( const char* );
 
 typedef struct {
-	char* key;
-	uint8_t probeLength; // how far we are from our ideal spot
-	// using the system we'll have setup, the probe length should never be greater than log2(n), so if we set it to UINT8_MAX we can use that
-	//  as the empty spot flag
-} HashMapKey;
-
-typedef struct {
-	size_t capacity; // number of spots available
-	HashMapKey* keys;
-	int* values;
-	uint32_t probeLimit;
+	size_t capacity; // number of slots available, always a multiple of the group size
+	size_t count; // number of slots in use
+	size_t numDeleted; // number of slots marked as deleted
+	uint8_t* control;
+	uint32_t* hashes;
+	uint32_t* keyOffsets; // where each key starts in sbKeyArena
+	char* sbKeyArena;
+	uint8_t* values;
+	size_t valueSize;
 	HashFunc hashFunc;
 } HashMap;
 
-// if hashFunc == NULL will use a default function
+// if hashFunc == NULL will use a default function, the values stored will be ints
 void hashMap_Init( HashMap* hashMap, uint32_t estimatedSize, HashFunc hashFunc );
 
+// same as hashMap_Init but stores values of any size, use the *Typed functions to access them
+void hashMap_InitTyped( HashMap* hashMap, uint32_t estimatedSize, size_t valueSize, HashFunc hashFunc );
+
+// if the key already exists it will replace the value, otherwise it will add it, the value is copied into the hash map
+void hashMap_SetTyped( HashMap* hashMap, const char* key, const void* value );
+
+// Returns a pointer to the value stored for the key, or NULL if the key doesn't exist
+//  The pointer is only valid until the next time something is added to the hash map.
+void* hashMap_FindTyped( HashMap* hashMap, const char* key );
+
+// Removes the first key and value pair found whose value is the same as the passed in value
+void hashMap_RemoveFirstByValueTyped( HashMap* hashMap, const void* value );
+
+// helper for finding a typed value, evaluates to a type* or NULL
+#define hashMap_FindAs( hashMap, key, type ) ( (type*)hashMap_FindTyped( (hashMap), (key) ) )
+
 // if the value already exists it will replace it, otherwise it will add it
 void hashMap_Set( HashMap* hashMap, const char* key, int value );
 
@@ -51,6 +63,10 @@ bool hashMap_Find( HashMap* hashMap, const char* key, int* outValue );
 // Returns whether the key exists
 bool hashMap_Exists( HashMap* hashMap, const char* key );
 
+// Makes room for numKeys more keys that take up keyBytes, including their null terminators, so adding a lot of keys at
+//  once only rebuilds the table once
+void hashMap_Reserve( HashMap* hashMap, size_t numKeys, size_t keyBytes );
+
 // Removes a key and value pair
 void hashMap_Remove( HashMap* hashMap, const char* key );
 
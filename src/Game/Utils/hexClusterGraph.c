@@ -0,0 +1,704 @@
+#include "hexClusterGraph.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "stretchyBuffer.h"
+#include "binaryHeap.h"
+#include "aStar.h"
+#include "../Math/mathUtil.h"
+#include "../System/memory.h"
+#include "../System/platformLog.h"
+
+#define NUM_NEIGHBORS 6
+
+typedef struct {
+	int cellA;
+	int cellB;
+	int clusterB;
+	int group;
+} Crossing;
+
+static bool openLess( const void* pLeft, const void* pRight )
+{
+	const HexClusterOpen* left = (const HexClusterOpen*)pLeft;
+	const HexClusterOpen* right = (const HexClusterOpen*)pRight;
+
+	if( left->cost != right->cost ) {
+		return ( left->cost < right->cost );
+	}
+	return ( left->cell < right->cell );
+}
+
+static int coordToCell( HexClusterGraph* graph, HexGridCoord coord )
+{
+	if( !hex_CoordInRect( coord, graph->width, graph->height ) ) {
+		return -1;
+	}
+	return (int)hex_CoordToRectIndex( coord, graph->width, graph->height );
+}
+
+static int neighborCell( HexClusterGraph* graph, int cell, int neighbor )
+{
+	return (int)hex_RectIndexNeighbor( (uint32_t)cell, neighbor, graph->width, graph->height );
+}
+
+static bool isPassable( HexClusterGraph* graph, int cell )
+{
+	return ( graph->costs[cell] >= 0.0f );
+}
+
+static int cellCluster( HexClusterGraph* graph, int cell )
+{
+	int row = cell / graph->width;
+	int col = cell % graph->width;
+	return ( ( row / graph->clusterSize ) * graph->clustersWide ) + ( col / graph->clusterSize );
+}
+
+static int numClusters( HexClusterGraph* graph )
+{
+	return graph->clustersWide * graph->clustersHigh;
+}
+
+// ***** searching within a cluster
+
+static bool hasSearchCost( HexClusterGraph* graph, int cell )
+{
+	return ( graph->searchStamps[cell] == graph->searchStamp );
+}
+
+static float searchCost( HexClusterGraph* graph, int cell )
+{
+	return hasSearchCost( graph, cell ) ? graph->searchCost[cell] : INFINITY;
+}
+
+static void setSearchCost( HexClusterGraph* graph, int cell, float cost, int from )
+{
+	graph->searchStamps[cell] = graph->searchStamp;
+	graph->searchCost[cell] = cost;
+	graph->searchFrom[cell] = from;
+}
+
+// runs Dijkstra from the source cell without leaving the cluster, the results are valid until the next search
+//  if reverse is set the costs are for moving from each cell to the source instead of from the source to each cell
+//  stops early once targetCell has been reached, pass in -1 to search the entire cluster
+static void localSearch( HexClusterGraph* graph, int sourceCell, int cluster, bool reverse, int targetCell )
+{
+	++graph->searchStamp;
+	if( graph->searchStamp == 0 ) {
+		// wrapped around, clear out the old stamps so they can't match
+		memset( graph->searchStamps, 0, sizeof( graph->searchStamps[0] ) * (size_t)graph->width * (size_t)graph->height );
+		graph->searchStamp = 1;
+	}
+
+	sb_Clear( graph->sbOpen );
+	setSearchCost( graph, sourceCell, 0.0f, -1 );
+	HexClusterOpen start = { sourceCell, 0.0f };
+	heap_Push( graph->sbOpen, start, openLess );
+
+	while( sb_Count( graph->sbOpen ) > 0 ) {
+		HexClusterOpen open = heap_Pop( graph->sbOpen, openLess );
+		if( open.cost > graph->searchCost[open.cell] ) {
+			continue;
+		}
+
+		if( open.cell == targetCell ) {
+			break;
+		}
+
+		for( int n = 0; n < NUM_NEIGHBORS; ++n ) {
+			int neighbor = neighborCell( graph, open.cell, n );
+			if( ( neighbor < 0 ) || !isPassable( graph, neighbor ) || ( cellCluster( graph, neighbor ) != cluster ) ) {
+				continue;
+			}
+
+			// when going backwards the cost is for moving from the neighbor into the current cell
+			float newCost = open.cost + ( reverse ? graph->costs[open.cell] : graph->costs[neighbor] );
+			if( newCost < searchCost( graph, neighbor ) ) {
+				setSearchCost( graph, neighbor, newCost, open.cell );
+				HexClusterOpen next = { neighbor, newCost };
+				heap_Push( graph->sbOpen, next, openLess );
+			}
+		}
+	}
+}
+
+// ***** node management
+
+static int createNode( HexClusterGraph* graph, int cell, int cluster, int otherCluster )
+{
+	int idx;
+	if( sb_Count( graph->sbFreeNodes ) > 0 ) {
+		idx = sb_Pop( graph->sbFreeNodes );
+	} else {
+		idx = (int)sb_Count( graph->sbNodes );
+		HexClusterNode* newNode = sb_Add( graph->sbNodes, 1 );
+		newNode->sbEdges = NULL;
+	}
+
+	HexClusterNode* node = &( graph->sbNodes[idx] );
+	node->cell = cell;
+	node->cluster = cluster;
+	node->otherCluster = otherCluster;
+	node->active = true;
+	sb_Clear( node->sbEdges );
+
+	return idx;
+}
+
+static void destroyNode( HexClusterGraph* graph, int idx )
+{
+	HexClusterNode* node = &( graph->sbNodes[idx] );
+	node->active = false;
+	sb_Clear( node->sbEdges );
+	sb_Push( graph->sbFreeNodes, idx );
+}
+
+static void addEdge( HexClusterGraph* graph, int from, int to, float cost )
+{
+	HexClusterEdge edge;
+	edge.to = to;
+	edge.cost = cost;
+	sb_Push( graph->sbNodes[from].sbEdges, edge );
+}
+
+// ***** building
+
+static int compareCrossings( const void* pLeft, const void* pRight )
+{
+	const Crossing* left = (const Crossing*)pLeft;
+	const Crossing* right = (const Crossing*)pRight;
+
+	if( left->clusterB != right->clusterB ) {
+		return ( left->clusterB < right->clusterB ) ? -1 : 1;
+	}
+	if( left->cellA != right->cellA ) {
+		return ( left->cellA < right->cellA ) ? -1 : 1;
+	}
+	return ( left->cellB < right->cellB ) ? -1 : ( ( left->cellB > right->cellB ) ? 1 : 0 );
+}
+
+static bool cellsTouch( HexClusterGraph* graph, int a, int b )
+{
+	if( a == b ) return true;
+	for( int n = 0; n < NUM_NEIGHBORS; ++n ) {
+		if( neighborCell( graph, a, n ) == b ) return true;
+	}
+	return false;
+}
+
+static int findGroup( Crossing* crossings, int idx )
+{
+	while( crossings[idx].group != idx ) {
+		crossings[idx].group = crossings[crossings[idx].group].group;
+		idx = crossings[idx].group;
+	}
+	return idx;
+}
+
+// creates the entrances between cluster and every cluster with a higher index next to it, only for pairs where one of
+//  the clusters is dirty
+static void createEntrances( HexClusterGraph* graph, int cluster, Crossing** sbCrossings )
+{
+	sb_Clear( (*sbCrossings) );
+
+	int firstRow = ( cluster / graph->clustersWide ) * graph->clusterSize;
+	int firstCol = ( cluster % graph->clustersWide ) * graph->clusterSize;
+	int lastRow = MIN( firstRow + graph->clusterSize, graph->height );
+	int lastCol = MIN( firstCol + graph->clusterSize, graph->width );
+
+	for( int row = firstRow; row < lastRow; ++row ) {
+		for( int col = firstCol; col < lastCol; ++col ) {
+			// only cells along the edge can cross into another cluster
+			if( ( row != firstRow ) && ( row != ( lastRow - 1 ) ) && ( col != firstCol ) && ( col != ( lastCol - 1 ) ) ) {
+				continue;
+			}
+
+			int cell = ( row * graph->width ) + col;
+			if( !isPassable( graph, cell ) ) {
+				continue;
+			}
+
+			for( int n = 0; n < NUM_NEIGHBORS; ++n ) {
+				int neighbor = neighborCell( graph, cell, n );
+				if( ( neighbor < 0 ) || !isPassable( graph, neighbor ) ) {
+					continue;
+				}
+
+				int other = cellCluster( graph, neighbor );
+				if( ( other <= cluster ) || !( graph->dirtyClusters[cluster] || graph->dirtyClusters[other] ) ) {
+					continue;
+				}
+
+				Crossing crossing;
+				crossing.cellA = cell;
+				crossing.cellB = neighbor;
+				crossing.clusterB = other;
+				crossing.group = 0;
+				sb_Push( (*sbCrossings), crossing );
+			}
+		}
+	}
+
+	Crossing* crossings = (*sbCrossings);
+	int count = (int)sb_Count( crossings );
+	if( count == 0 ) {
+		return;
+	}
+
+	qsort( crossings, (size_t)count, sizeof( crossings[0] ), compareCrossings );
+
+	int runStart = 0;
+	while( runStart < count ) {
+		int runEnd = runStart;
+		while( ( runEnd < count ) && ( crossings[runEnd].clusterB == crossings[runStart].clusterB ) ) {
+			++runEnd;
+		}
+
+		// group crossings that are next to each other on both sides of the border, each group becomes one entrance
+		//  needing both means every crossing in the group can reach the entrance without leaving either cluster
+		for( int i = runStart; i < runEnd; ++i ) {
+			crossings[i].group = i;
+		}
+		for( int i = runStart; i < runEnd; ++i ) {
+			for( int j = i + 1; j < runEnd; ++j ) {
+				if( cellsTouch( graph, crossings[i].cellA, crossings[j].cellA ) && cellsTouch( graph, crossings[i].cellB, crossings[j].cellB ) ) {
+					int rootI = findGroup( crossings, i );
+					int rootJ = findGroup( crossings, j );
+					if( rootI != rootJ ) {
+						crossings[MAX( rootI, rootJ )].group = MIN( rootI, rootJ );
+					}
+				}
+			}
+		}
+
+		// use the crossing in the middle of each group as the entrance
+		for( int i = runStart; i < runEnd; ++i ) {
+			if( findGroup( crossings, i ) != i ) {
+				continue;
+			}
+
+			int groupSize = 0;
+			for( int j = i; j < runEnd; ++j ) {
+				if( findGroup( crossings, j ) == i ) ++groupSize;
+			}
+
+			int middle = groupSize / 2;
+			for( int j = i; j < runEnd; ++j ) {
+				if( findGroup( crossings, j ) != i ) continue;
+				if( middle-- > 0 ) continue;
+
+				Crossing* entrance = &( crossings[j] );
+				int nodeA = createNode( graph, entrance->cellA, cluster, entrance->clusterB );
+				int nodeB = createNode( graph, entrance->cellB, entrance->clusterB, cluster );
+				addEdge( graph, nodeA, nodeB, graph->costs[entrance->cellB] );
+				addEdge( graph, nodeB, nodeA, graph->costs[entrance->cellA] );
+				sb_Push( graph->clusterNodes[cluster], nodeA );
+				sb_Push( graph->clusterNodes[entrance->clusterB], nodeB );
+				break;
+			}
+		}
+
+		runStart = runEnd;
+	}
+}
+
+// replaces all the edges between nodes in the cluster
+static void createIntraEdges( HexClusterGraph* graph, int cluster )
+{
+	int* nodes = graph->clusterNodes[cluster];
+	size_t count = sb_Count( nodes );
+
+	// remove the old edges, the first edge of every entrance is the one leading to the other cluster so keep that
+	for( size_t i = 0; i < count; ++i ) {
+		HexClusterNode* node = &( graph->sbNodes[nodes[i]] );
+		assert( sb_Count( node->sbEdges ) > 0 );
+		sb__Used( node->sbEdges ) = 1;
+	}
+
+	for( size_t i = 0; i < count; ++i ) {
+		localSearch( graph, graph->sbNodes[nodes[i]].cell, cluster, false, -1 );
+		for( size_t j = 0; j < count; ++j ) {
+			if( i == j ) continue;
+
+			float cost = searchCost( graph, graph->sbNodes[nodes[j]].cell );
+			if( !isinf( cost ) ) {
+				addEdge( graph, nodes[i], nodes[j], cost );
+			}
+		}
+	}
+}
+
+static void markDirty( HexClusterGraph* graph, int cell )
+{
+	graph->dirtyClusters[cellCluster( graph, cell )] = true;
+
+	// changing a cell along a border also changes the entrances of the cluster on the other side
+	for( int n = 0; n < NUM_NEIGHBORS; ++n ) {
+		int neighbor = neighborCell( graph, cell, n );
+		if( neighbor >= 0 ) {
+			graph->dirtyClusters[cellCluster( graph, neighbor )] = true;
+		}
+	}
+
+	graph->anyDirty = true;
+}
+
+void clusterGraph_Update( HexClusterGraph* graph )
+{
+	assert( graph != NULL );
+
+	if( !graph->anyDirty ) {
+		return;
+	}
+
+	int clusterCount = numClusters( graph );
+
+	// affected clusters are dirty or next to a dirty cluster, their node lists and edges will change
+	bool* affected = mem_Allocate( sizeof( affected[0] ) * (size_t)clusterCount );
+	if( affected == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate space to update cluster graph" );
+		return;
+	}
+	memset( affected, 0, sizeof( affected[0] ) * (size_t)clusterCount );
+
+	// remove the entrances on any border touching a dirty cluster
+	for( size_t i = 0; i < sb_Count( graph->sbNodes ); ++i ) {
+		HexClusterNode* node = &( graph->sbNodes[i] );
+		if( !node->active ) continue;
+
+		assert( node->otherCluster >= 0 );
+		if( graph->dirtyClusters[node->cluster] || graph->dirtyClusters[node->otherCluster] ) {
+			affected[node->cluster] = true;
+			affected[node->otherCluster] = true;
+			destroyNode( graph, (int)i );
+		}
+	}
+
+	// clusters next to a dirty cluster can gain entrances even if they didn't have any before
+	for( int c = 0; c < clusterCount; ++c ) {
+		if( !graph->dirtyClusters[c] ) continue;
+
+		int clusterX = c % graph->clustersWide;
+		int clusterY = c / graph->clustersWide;
+		for( int y = MAX( clusterY - 1, 0 ); y <= MIN( clusterY + 1, graph->clustersHigh - 1 ); ++y ) {
+			for( int x = MAX( clusterX - 1, 0 ); x <= MIN( clusterX + 1, graph->clustersWide - 1 ); ++x ) {
+				affected[( y * graph->clustersWide ) + x] = true;
+			}
+		}
+	}
+
+	// rebuild the node lists, removing anything that was destroyed
+	for( int c = 0; c < clusterCount; ++c ) {
+		if( !affected[c] ) continue;
+
+		int* nodes = graph->clusterNodes[c];
+		size_t kept = 0;
+		for( size_t i = 0; i < sb_Count( nodes ); ++i ) {
+			if( graph->sbNodes[nodes[i]].active ) {
+				nodes[kept++] = nodes[i];
+			}
+		}
+		if( nodes != NULL ) {
+			sb__Used( nodes ) = kept;
+		}
+	}
+
+	Crossing* sbCrossings = NULL;
+	for( int c = 0; c < clusterCount; ++c ) {
+		if( affected[c] ) {
+			createEntrances( graph, c, &sbCrossings );
+		}
+	}
+	sb_Release( sbCrossings );
+
+	// new entrances can be created in clusters that were only next to a dirty cluster, so they need new edges as well
+	for( int c = 0; c < clusterCount; ++c ) {
+		if( affected[c] ) {
+			createIntraEdges( graph, c );
+		}
+	}
+
+	graph->minCost = INFINITY;
+	size_t numCells = (size_t)graph->width * (size_t)graph->height;
+	for( size_t i = 0; i < numCells; ++i ) {
+		if( isPassable( graph, (int)i ) && ( graph->costs[i] < graph->minCost ) ) {
+			graph->minCost = graph->costs[i];
+		}
+	}
+
+	memset( graph->dirtyClusters, 0, sizeof( graph->dirtyClusters[0] ) * (size_t)clusterCount );
+	graph->anyDirty = false;
+	mem_Release( affected );
+}
+
+int clusterGraph_Create( HexClusterGraph* graph, int32_t width, int32_t height, int32_t clusterSize )
+{
+	assert( graph != NULL );
+	assert( width > 0 );
+	assert( height > 0 );
+	assert( clusterSize > 1 );
+
+	memset( graph, 0, sizeof( *graph ) );
+	graph->width = width;
+	graph->height = height;
+	graph->clusterSize = clusterSize;
+	graph->clustersWide = ( width + clusterSize - 1 ) / clusterSize;
+	graph->clustersHigh = ( height + clusterSize - 1 ) / clusterSize;
+
+	size_t numCells = (size_t)width * (size_t)height;
+	size_t clusterCount = (size_t)numClusters( graph );
+	graph->costs = mem_Allocate( sizeof( graph->costs[0] ) * numCells );
+	graph->searchCost = mem_Allocate( sizeof( graph->searchCost[0] ) * numCells );
+	graph->searchFrom = mem_Allocate( sizeof( graph->searchFrom[0] ) * numCells );
+	graph->searchStamps = mem_Allocate( sizeof( graph->searchStamps[0] ) * numCells );
+	graph->clusterNodes = mem_Allocate( sizeof( graph->clusterNodes[0] ) * clusterCount );
+	graph->dirtyClusters = mem_Allocate( sizeof( graph->dirtyClusters[0] ) * clusterCount );
+	if( ( graph->costs == NULL ) || ( graph->searchCost == NULL ) || ( graph->searchFrom == NULL ) || ( graph->searchStamps == NULL ) ||
+		( graph->clusterNodes == NULL ) || ( graph->dirtyClusters == NULL ) ) {
+		llog( LOG_ERROR, "Unable to allocate cluster graph of size %i x %i", width, height );
+		clusterGraph_Destroy( graph );
+		return -1;
+	}
+
+	for( size_t i = 0; i < numCells; ++i ) {
+		graph->costs[i] = 1.0f;
+	}
+	memset( graph->searchStamps, 0, sizeof( graph->searchStamps[0] ) * numCells );
+	memset( graph->clusterNodes, 0, sizeof( graph->clusterNodes[0] ) * clusterCount );
+
+	// everything needs to be built
+	memset( graph->dirtyClusters, 1, sizeof( graph->dirtyClusters[0] ) * clusterCount );
+	graph->anyDirty = true;
+	clusterGraph_Update( graph );
+
+	return 0;
+}
+
+void clusterGraph_Destroy( HexClusterGraph* graph )
+{
+	assert( graph != NULL );
+
+	for( size_t i = 0; i < sb_Count( graph->sbNodes ); ++i ) {
+		sb_Release( graph->sbNodes[i].sbEdges );
+	}
+	sb_Release( graph->sbNodes );
+	sb_Release( graph->sbFreeNodes );
+
+	if( graph->clusterNodes != NULL ) {
+		for( int c = 0; c < numClusters( graph ); ++c ) {
+			sb_Release( graph->clusterNodes[c] );
+		}
+	}
+	mem_Release( graph->clusterNodes );
+
+	mem_Release( graph->costs );
+	mem_Release( graph->searchCost );
+	mem_Release( graph->searchFrom );
+	mem_Release( graph->searchStamps );
+	mem_Release( graph->dirtyClusters );
+	sb_Release( graph->sbOpen );
+
+	memset( graph, 0, sizeof( *graph ) );
+}
+
+void clusterGraph_SetCost( HexClusterGraph* graph, HexGridCoord coord, float cost )
+{
+	assert( graph != NULL );
+
+	int cell = coordToCell( graph, coord );
+	if( ( cell < 0 ) || ( graph->costs[cell] == cost ) ) {
+		return;
+	}
+
+	graph->costs[cell] = cost;
+	markDirty( graph, cell );
+}
+
+float clusterGraph_GetCost( HexClusterGraph* graph, HexGridCoord coord )
+{
+	assert( graph != NULL );
+
+	int cell = coordToCell( graph, coord );
+	if( cell < 0 ) {
+		return HEX_CLUSTER_IMPASSABLE;
+	}
+	return graph->costs[cell];
+}
+
+// ***** path finding
+
+static float edgeCost( void* pGraph, int fromNodeID, int toNodeID )
+{
+	HexClusterGraph* graph = (HexClusterGraph*)pGraph;
+	HexClusterNode* node = &( graph->sbNodes[fromNodeID] );
+	for( size_t i = 0; i < sb_Count( node->sbEdges ); ++i ) {
+		if( node->sbEdges[i].to == toNodeID ) {
+			return node->sbEdges[i].cost;
+		}
+	}
+	assert( false && "Asking for the cost of an edge that doesn't exist." );
+	return INFINITY;
+}
+
+static float nodeHeuristic( void* pGraph, int fromNodeID, int toNodeID )
+{
+	HexClusterGraph* graph = (HexClusterGraph*)pGraph;
+	if( !( graph->minCost > 0.0f ) || isinf( graph->minCost ) ) {
+		return 0.0f;
+	}
+
+	HexGridCoord from = hex_RectIndexToCoord( (uint32_t)graph->sbNodes[fromNodeID].cell, graph->width, graph->height );
+	HexGridCoord to = hex_RectIndexToCoord( (uint32_t)graph->sbNodes[toNodeID].cell, graph->width, graph->height );
+	return (float)hex_Distance( from, to ) * graph->minCost;
+}
+
+static int nextNodeNeighbor( void* pGraph, int nodeID, int currNeighborNodeID )
+{
+	HexClusterGraph* graph = (HexClusterGraph*)pGraph;
+	HexClusterNode* node = &( graph->sbNodes[nodeID] );
+	size_t count = sb_Count( node->sbEdges );
+
+	size_t next = 0;
+	if( currNeighborNodeID >= 0 ) {
+		while( ( next < count ) && ( node->sbEdges[next].to != currNeighborNodeID ) ) {
+			++next;
+		}
+		++next;
+	}
+
+	return ( next < count ) ? node->sbEdges[next].to : -1;
+}
+
+// pushes the cells to move through to get from one cell to the other in the same cluster, not including the first cell
+static bool refineSegment( HexClusterGraph* graph, int fromCell, int toCell, int cluster, HexGridCoord** sbOutPath )
+{
+	localSearch( graph, fromCell, cluster, false, toCell );
+	if( !hasSearchCost( graph, toCell ) ) {
+		return false;
+	}
+
+	size_t first = sb_Count( *sbOutPath );
+	int current = toCell;
+	while( current != fromCell ) {
+		sb_Push( (*sbOutPath), hex_RectIndexToCoord( (uint32_t)current, graph->width, graph->height ) );
+		current = graph->searchFrom[current];
+	}
+
+	// it was built backwards
+	size_t last = sb_Count( *sbOutPath );
+	for( size_t i = first, j = last - 1; i < j; ++i, --j ) {
+		HexGridCoord temp = (*sbOutPath)[i];
+		(*sbOutPath)[i] = (*sbOutPath)[j];
+		(*sbOutPath)[j] = temp;
+	}
+
+	return true;
+}
+
+bool clusterGraph_FindPath( HexClusterGraph* graph, HexGridCoord start, HexGridCoord goal, HexGridCoord** sbOutPath )
+{
+	assert( graph != NULL );
+	assert( sbOutPath != NULL );
+
+	int startCell = coordToCell( graph, start );
+	int goalCell = coordToCell( graph, goal );
+	if( ( startCell < 0 ) || ( goalCell < 0 ) || !isPassable( graph, startCell ) || !isPassable( graph, goalCell ) ) {
+		return false;
+	}
+
+	if( startCell == goalCell ) {
+		return true;
+	}
+
+	clusterGraph_Update( graph );
+
+	int startCluster = cellCluster( graph, startCell );
+	int goalCluster = cellCluster( graph, goalCell );
+
+	// if they're in the same cluster try staying inside it first, it's a lot cheaper than the full search
+	if( ( startCluster == goalCluster ) && refineSegment( graph, startCell, goalCell, startCluster, sbOutPath ) ) {
+		return true;
+	}
+
+	// temporarily add the start and goal to the graph, they always go on the end so they're easy to remove
+	size_t baseNodeCount = sb_Count( graph->sbNodes );
+	HexClusterNode* tempNodes = sb_Add( graph->sbNodes, 2 );
+	memset( tempNodes, 0, sizeof( tempNodes[0] ) * 2 );
+	int startNode = (int)baseNodeCount;
+	int goalNode = (int)baseNodeCount + 1;
+	tempNodes[0].cell = startCell;
+	tempNodes[0].cluster = startCluster;
+	tempNodes[0].otherCluster = -1;
+	tempNodes[1].cell = goalCell;
+	tempNodes[1].cluster = goalCluster;
+	tempNodes[1].otherCluster = -1;
+
+	int* startClusterNodes = graph->clusterNodes[startCluster];
+	localSearch( graph, startCell, startCluster, false, -1 );
+	for( size_t i = 0; i < sb_Count( startClusterNodes ); ++i ) {
+		float cost = searchCost( graph, graph->sbNodes[startClusterNodes[i]].cell );
+		if( !isinf( cost ) ) {
+			addEdge( graph, startNode, startClusterNodes[i], cost );
+		}
+	}
+
+	// edges into the goal are added onto the end of the existing nodes and removed afterwards
+	int* goalClusterNodes = graph->clusterNodes[goalCluster];
+	localSearch( graph, goalCell, goalCluster, true, -1 );
+	for( size_t i = 0; i < sb_Count( goalClusterNodes ); ++i ) {
+		float cost = searchCost( graph, graph->sbNodes[goalClusterNodes[i]].cell );
+		if( !isinf( cost ) ) {
+			addEdge( graph, goalClusterNodes[i], goalNode, cost );
+		}
+	}
+
+	AStarSearchState searchState;
+	int* sbNodePath = NULL;
+	aStar_CreateSearchState( graph, sb_Count( graph->sbNodes ), startNode, goalNode, edgeCost, nodeHeuristic, nextNodeNeighbor, &searchState );
+	aStar_ProcessPath( &searchState, -1, &sbNodePath );
+	bool found = searchState.pathFound;
+	aStar_CleanUpSearchState( &searchState );
+
+	// turn the abstract path back into cells, the path from the search is from the goal back to the start
+	if( found ) {
+		size_t first = sb_Count( *sbOutPath );
+		int prev = startNode;
+		for( int i = (int)sb_Count( sbNodePath ) - 1; ( i >= 0 ) && found; --i ) {
+			HexClusterNode* from = &( graph->sbNodes[prev] );
+			HexClusterNode* to = &( graph->sbNodes[sbNodePath[i]] );
+			if( from->cell != to->cell ) {
+				if( from->cluster != to->cluster ) {
+					// crossing between clusters, always a single step
+					sb_Push( (*sbOutPath), hex_RectIndexToCoord( (uint32_t)to->cell, graph->width, graph->height ) );
+				} else {
+					found = refineSegment( graph, from->cell, to->cell, from->cluster, sbOutPath );
+				}
+			}
+			prev = sbNodePath[i];
+		}
+
+		if( !found ) {
+			assert( false && "Unable to refine cluster path." );
+			if( (*sbOutPath) != NULL ) {
+				sb__Used( *sbOutPath ) = first;
+			}
+		}
+	}
+	sb_Release( sbNodePath );
+
+	// remove the temporary edges and nodes
+	for( size_t i = 0; i < sb_Count( goalClusterNodes ); ++i ) {
+		HexClusterNode* node = &( graph->sbNodes[goalClusterNodes[i]] );
+		if( ( sb_Count( node->sbEdges ) > 0 ) && ( node->sbEdges[sb_Count( node->sbEdges ) - 1].to == goalNode ) ) {
+			sb_Pop( node->sbEdges );
+		}
+	}
+	sb_Release( graph->sbNodes[startNode].sbEdges );
+	sb_Release( graph->sbNodes[goalNode].sbEdges );
+	sb__Used( graph->sbNodes ) = baseNodeCount;
+
+	return found;
+}
@@ -0,0 +1,81 @@
+#ifndef HEX_CLUSTER_GRAPH_H
+#define HEX_CLUSTER_GRAPH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hexGrid.h"
+
+/*
+Hierarchical pathfinding over a rectangular hex grid, laid out the same way as hex_CoordToRectIndex.
+ Based on HPA*: https://webdocs.cs.ualberta.ca/~mmueller/ps/hpastar.pdf
+ The grid is split into square clusters of cells. Where two clusters touch, an entrance node is created on each
+ side for every connected stretch of passable cells along the border. Inside each cluster the entrances are joined
+ by edges whose cost is the cost of the shortest path between them that stays in the cluster.
+ Long paths are found by searching this much smaller graph and then filling in the steps between the nodes.
+ The paths found are close to optimal but aren't guaranteed to be the shortest.
+ The cost of a cell is the cost of moving into it, negative costs are impassable.
+ Changing costs only rebuilds the clusters around the changed cells when clusterGraph_Update is called.
+ Not thread safe, clusterGraph_FindPath uses scratch data stored in the graph.
+*/
+
+#define HEX_CLUSTER_IMPASSABLE ( -1.0f )
+
+typedef struct {
+	int to;
+	float cost;
+} HexClusterEdge;
+
+typedef struct {
+	int cell;
+	int cluster;
+	int otherCluster; // the cluster the entrance leads to, -1 for the temporary start and goal nodes
+	bool active;
+	HexClusterEdge* sbEdges;
+} HexClusterNode;
+
+typedef struct {
+	int cell;
+	float cost;
+} HexClusterOpen;
+
+typedef struct {
+	int32_t width;
+	int32_t height;
+	int32_t clusterSize;
+	int32_t clustersWide;
+	int32_t clustersHigh;
+
+	float* costs;
+	float minCost; // smallest cost of any passable cell, used to keep the heuristic admissible
+
+	HexClusterNode* sbNodes;
+	int* sbFreeNodes;
+	int** clusterNodes; // a stretchy buffer of node indices for each cluster
+	bool* dirtyClusters;
+	bool anyDirty;
+
+	// scratch data for searching within clusters
+	float* searchCost;
+	int* searchFrom;
+	uint32_t* searchStamps;
+	uint32_t searchStamp;
+	HexClusterOpen* sbOpen;
+} HexClusterGraph;
+
+// Creates the graph with every cost set to 1 and builds it. Returns 0 on success.
+int clusterGraph_Create( HexClusterGraph* graph, int32_t width, int32_t height, int32_t clusterSize );
+void clusterGraph_Destroy( HexClusterGraph* graph );
+
+// Sets the cost of moving into the cell, use HEX_CLUSTER_IMPASSABLE for cells that can't be entered.
+//  The change won't be used until clusterGraph_Update is called.
+void clusterGraph_SetCost( HexClusterGraph* graph, HexGridCoord coord, float cost );
+float clusterGraph_GetCost( HexClusterGraph* graph, HexGridCoord coord );
+
+// Rebuilds the entrances and edges for the clusters around any cells whose cost has changed.
+void clusterGraph_Update( HexClusterGraph* graph );
+
+// Finds a path from start to goal and pushes it onto the stretchy buffer sbOutPath, from the first step to the goal.
+//  Returns whether a path was found. Will call clusterGraph_Update if there are any pending changes.
+bool clusterGraph_FindPath( HexClusterGraph* graph, HexGridCoord start, HexGridCoord goal, HexGridCoord** sbOutPath );
+
+#endif /* inclusion guard */
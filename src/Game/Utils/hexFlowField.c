@@ -0,0 +1,385 @@
+#include "hexFlowField.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include "stretchyBuffer.h"
+#include "binaryHeap.h"
+#include "../System/memory.h"
+#include "../System/platformLog.h"
+
+#define NUM_NEIGHBORS 6
+
+static bool openLess( const void* pLeft, const void* pRight )
+{
+	const HexFlowFieldOpen* left = (const HexFlowFieldOpen*)pLeft;
+	const HexFlowFieldOpen* right = (const HexFlowFieldOpen*)pRight;
+
+	if( left->cost != right->cost ) {
+		return ( left->cost < right->cost );
+	}
+	return ( left->cell < right->cell );
+}
+
+static int coordToCell( HexFlowField* field, HexGridCoord coord )
+{
+	if( !hex_CoordInRect( coord, field->width, field->height ) ) {
+		return -1;
+	}
+	return (int)hex_CoordToRectIndex( coord, field->width, field->height );
+}
+
+static int neighborCell( HexFlowField* field, int cell, int neighbor )
+{
+	return (int)hex_RectIndexNeighbor( (uint32_t)cell, neighbor, field->width, field->height );
+}
+
+static bool isPassable( HexFlowField* field, int cell )
+{
+	return ( field->costs[cell] >= 0.0f );
+}
+
+static bool isGoal( HexFlowField* field, int cell )
+{
+	for( size_t i = 0; i < sb_Count( field->sbGoals ); ++i ) {
+		if( field->sbGoals[i] == cell ) return true;
+	}
+	return false;
+}
+
+static void pushOpen( HexFlowField* field, int cell, float cost )
+{
+	HexFlowFieldOpen open;
+	open.cell = cell;
+	open.cost = cost;
+	heap_Push( field->sbOpen, open, openLess );
+}
+
+int flowField_Create( HexFlowField* field, int32_t width, int32_t height )
+{
+	assert( field != NULL );
+	assert( width > 0 );
+	assert( height > 0 );
+
+	memset( field, 0, sizeof( *field ) );
+	field->width = width;
+	field->height = height;
+
+	size_t numCells = (size_t)width * (size_t)height;
+	field->costs = mem_Allocate( sizeof( field->costs[0] ) * numCells );
+	field->integration = mem_Allocate( sizeof( field->integration[0] ) * numCells );
+	field->directions = mem_Allocate( sizeof( field->directions[0] ) * numCells );
+	field->invalidStamps = mem_Allocate( sizeof( field->invalidStamps[0] ) * numCells );
+	if( ( field->costs == NULL ) || ( field->integration == NULL ) || ( field->directions == NULL ) || ( field->invalidStamps == NULL ) ) {
+		llog( LOG_ERROR, "Unable to allocate flow field of size %i x %i", width, height );
+		flowField_Destroy( field );
+		return -1;
+	}
+
+	for( size_t i = 0; i < numCells; ++i ) {
+		field->costs[i] = 1.0f;
+		field->integration[i] = INFINITY;
+		field->directions[i] = -1;
+		field->invalidStamps[i] = 0;
+	}
+
+	return 0;
+}
+
+void flowField_Destroy( HexFlowField* field )
+{
+	assert( field != NULL );
+
+	mem_Release( field->costs );
+	mem_Release( field->integration );
+	mem_Release( field->directions );
+	mem_Release( field->invalidStamps );
+	sb_Release( field->sbGoals );
+	sb_Release( field->sbDirtyCells );
+	sb_Release( field->sbDirtyOldCosts );
+	sb_Release( field->sbOpen );
+	sb_Release( field->sbChangedCells );
+
+	memset( field, 0, sizeof( *field ) );
+}
+
+void flowField_SetGoal( HexFlowField* field, HexGridCoord goal )
+{
+	assert( field != NULL );
+
+	sb_Clear( field->sbGoals );
+	flowField_AddGoal( field, goal );
+}
+
+void flowField_AddGoal( HexFlowField* field, HexGridCoord goal )
+{
+	assert( field != NULL );
+
+	int cell = coordToCell( field, goal );
+	if( cell < 0 ) {
+		llog( LOG_WARN, "Flow field goal ( %i, %i ) is outside the grid", goal.q, goal.r );
+		return;
+	}
+
+	if( !isGoal( field, cell ) ) {
+		sb_Push( field->sbGoals, cell );
+	}
+}
+
+void flowField_SetCost( HexFlowField* field, HexGridCoord coord, float cost )
+{
+	assert( field != NULL );
+
+	int cell = coordToCell( field, coord );
+	if( cell < 0 ) {
+		return;
+	}
+
+	if( field->costs[cell] == cost ) {
+		return;
+	}
+
+	sb_Push( field->sbDirtyCells, cell );
+	sb_Push( field->sbDirtyOldCosts, field->costs[cell] );
+	field->costs[cell] = cost;
+}
+
+float flowField_GetCost( HexFlowField* field, HexGridCoord coord )
+{
+	assert( field != NULL );
+
+	int cell = coordToCell( field, coord );
+	if( cell < 0 ) {
+		return HEX_IMPASSABLE;
+	}
+	return field->costs[cell];
+}
+
+// the lowest integration that can be reached by moving from the cell into one of its neighbors
+//  ignores any neighbors that have been invalidated during the current update
+static float bestNeighborIntegration( HexFlowField* field, int cell, int* outNeighbor )
+{
+	float best = INFINITY;
+	int bestNeighbor = -1;
+
+	for( int n = 0; n < NUM_NEIGHBORS; ++n ) {
+		int neighbor = neighborCell( field, cell, n );
+		if( ( neighbor < 0 ) || !isPassable( field, neighbor ) || ( field->invalidStamps[neighbor] == field->invalidStamp ) ) {
+			continue;
+		}
+
+		float through = field->integration[neighbor] + field->costs[neighbor];
+		if( through < best ) {
+			best = through;
+			bestNeighbor = n;
+		}
+	}
+
+	if( outNeighbor != NULL ) {
+		(*outNeighbor) = bestNeighbor;
+	}
+	return best;
+}
+
+static void updateDirection( HexFlowField* field, int cell )
+{
+	int neighbor = -1;
+	if( isPassable( field, cell ) && !isinf( field->integration[cell] ) && !isGoal( field, cell ) ) {
+		bestNeighborIntegration( field, cell, &neighbor );
+	}
+	field->directions[cell] = (int8_t)neighbor;
+}
+
+// spreads out the integration from everything in the open list, any cell whose value changes is added to sbChangedCells
+static void propagate( HexFlowField* field )
+{
+	while( sb_Count( field->sbOpen ) > 0 ) {
+		HexFlowFieldOpen open = heap_Pop( field->sbOpen, openLess );
+		if( open.cost > field->integration[open.cell] ) {
+			// already found a better way to this cell
+			continue;
+		}
+
+		// can't move through an impassable cell, even if it's a goal
+		if( !isPassable( field, open.cell ) ) {
+			continue;
+		}
+
+		float through = field->integration[open.cell] + field->costs[open.cell];
+		for( int n = 0; n < NUM_NEIGHBORS; ++n ) {
+			int neighbor = neighborCell( field, open.cell, n );
+			if( ( neighbor < 0 ) || !isPassable( field, neighbor ) ) {
+				continue;
+			}
+
+			if( through < field->integration[neighbor] ) {
+				field->integration[neighbor] = through;
+				sb_Push( field->sbChangedCells, neighbor );
+				pushOpen( field, neighbor, through );
+			}
+		}
+	}
+}
+
+void flowField_Build( HexFlowField* field )
+{
+	assert( field != NULL );
+
+	size_t numCells = (size_t)field->width * (size_t)field->height;
+	for( size_t i = 0; i < numCells; ++i ) {
+		field->integration[i] = INFINITY;
+	}
+
+	sb_Clear( field->sbOpen );
+	sb_Clear( field->sbChangedCells );
+	for( size_t i = 0; i < sb_Count( field->sbGoals ); ++i ) {
+		field->integration[field->sbGoals[i]] = 0.0f;
+		pushOpen( field, field->sbGoals[i], 0.0f );
+	}
+
+	// nothing is invalid during a full build
+	++field->invalidStamp;
+	propagate( field );
+
+	for( size_t i = 0; i < numCells; ++i ) {
+		updateDirection( field, (int)i );
+	}
+
+	sb_Clear( field->sbDirtyCells );
+	sb_Clear( field->sbDirtyOldCosts );
+	sb_Clear( field->sbChangedCells );
+}
+
+// invalidates every cell whose path to the goal goes through the cell
+static void invalidateDependents( HexFlowField* field, int cell, int** sbQueue )
+{
+	// the cell itself isn't added to the queue, it's only invalid if it became impassable which is handled elsewhere
+	size_t next = sb_Count( *sbQueue );
+	int current = cell;
+
+	while( current >= 0 ) {
+		for( int n = 0; n < NUM_NEIGHBORS; ++n ) {
+			int neighbor = neighborCell( field, current, n );
+			if( ( neighbor < 0 ) || ( field->invalidStamps[neighbor] == field->invalidStamp ) || ( field->directions[neighbor] < 0 ) ) {
+				continue;
+			}
+
+			if( neighborCell( field, neighbor, field->directions[neighbor] ) == current ) {
+				field->invalidStamps[neighbor] = field->invalidStamp;
+				field->integration[neighbor] = INFINITY;
+				sb_Push( (*sbQueue), neighbor );
+			}
+		}
+
+		current = ( next < sb_Count( *sbQueue ) ) ? (*sbQueue)[next++] : -1;
+	}
+}
+
+void flowField_Update( HexFlowField* field )
+{
+	assert( field != NULL );
+
+	if( sb_Count( field->sbDirtyCells ) == 0 ) {
+		return;
+	}
+
+	++field->invalidStamp;
+	sb_Clear( field->sbOpen );
+	sb_Clear( field->sbChangedCells );
+
+	// first anything that relied on moving through a cell that got more expensive has to be recalculated
+	int* sbInvalid = NULL;
+	for( size_t i = 0; i < sb_Count( field->sbDirtyCells ); ++i ) {
+		int cell = field->sbDirtyCells[i];
+		bool increased = ( !isPassable( field, cell ) || ( field->costs[cell] > field->sbDirtyOldCosts[i] ) ) && ( field->sbDirtyOldCosts[i] >= 0.0f );
+		if( !increased ) {
+			continue;
+		}
+
+		if( !isPassable( field, cell ) && !isGoal( field, cell ) && ( field->invalidStamps[cell] != field->invalidStamp ) ) {
+			field->invalidStamps[cell] = field->invalidStamp;
+			field->integration[cell] = INFINITY;
+			sb_Push( sbInvalid, cell );
+		}
+		invalidateDependents( field, cell, &sbInvalid );
+	}
+
+	// seed the invalidated cells from the valid cells around them
+	for( size_t i = 0; i < sb_Count( sbInvalid ); ++i ) {
+		int cell = sbInvalid[i];
+		sb_Push( field->sbChangedCells, cell );
+		if( !isPassable( field, cell ) ) {
+			continue;
+		}
+
+		float best = bestNeighborIntegration( field, cell, NULL );
+		if( !isinf( best ) ) {
+			field->integration[cell] = best;
+			pushOpen( field, cell, best );
+		}
+	}
+
+	// cells that got cheaper or became passable can offer better paths to their neighbors
+	for( size_t i = 0; i < sb_Count( field->sbDirtyCells ); ++i ) {
+		int cell = field->sbDirtyCells[i];
+		sb_Push( field->sbChangedCells, cell );
+		if( !isPassable( field, cell ) ) {
+			continue;
+		}
+
+		if( !isGoal( field, cell ) ) {
+			float best = bestNeighborIntegration( field, cell, NULL );
+			if( best < field->integration[cell] ) {
+				field->integration[cell] = best;
+			}
+		}
+
+		if( !isinf( field->integration[cell] ) ) {
+			pushOpen( field, cell, field->integration[cell] );
+		}
+	}
+	sb_Release( sbInvalid );
+
+	// the stamps are only used to stop invalidated cells being used as seeds, everything is valid again now
+	++field->invalidStamp;
+	propagate( field );
+
+	// directions depend on the integration and cost of the neighbors, so update around everything that changed
+	for( size_t i = 0; i < sb_Count( field->sbChangedCells ); ++i ) {
+		int cell = field->sbChangedCells[i];
+		updateDirection( field, cell );
+		for( int n = 0; n < NUM_NEIGHBORS; ++n ) {
+			int neighbor = neighborCell( field, cell, n );
+			if( neighbor >= 0 ) {
+				updateDirection( field, neighbor );
+			}
+		}
+	}
+
+	sb_Clear( field->sbDirtyCells );
+	sb_Clear( field->sbDirtyOldCosts );
+	sb_Clear( field->sbChangedCells );
+}
+
+int flowField_GetDirection( HexFlowField* field, HexGridCoord coord )
+{
+	assert( field != NULL );
+
+	int cell = coordToCell( field, coord );
+	if( cell < 0 ) {
+		return -1;
+	}
+	return field->directions[cell];
+}
+
+float flowField_GetDistance( HexFlowField* field, HexGridCoord coord )
+{
+	assert( field != NULL );
+
+	int cell = coordToCell( field, coord );
+	if( cell < 0 ) {
+		return INFINITY;
+	}
+	return field->integration[cell];
+}
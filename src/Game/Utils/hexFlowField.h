@@ -0,0 +1,83 @@
+#ifndef HEX_FLOW_FIELD_H
+#define HEX_FLOW_FIELD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hexGrid.h"
+
+/*
+Flow field over a rectangular hex grid, laid out the same way as hex_CoordToRectIndex.
+ Instead of doing a search for every agent heading to the same place, the cost to reach the closest goal is found
+ for every cell once, then each agent just looks up which neighbor to move to.
+ The cost of a cell is the cost of moving into it, negative costs are impassable.
+ Changing costs after building only updates the cells affected by the change when flowField_Update is called.
+
+General usage:
+	HexFlowField field;
+	flowField_Create( &field, width, height );
+	flowField_SetGoal( &field, goalCoord );
+	flowField_Build( &field );
+	...
+	int dir = flowField_GetDirection( &field, agentCoord );
+	if( dir >= 0 ) agentCoord = hex_GetNeighbor( agentCoord, dir );
+	...
+	flowField_SetCost( &field, wallCoord, HEX_IMPASSABLE );
+	flowField_Update( &field );
+	...
+	flowField_Destroy( &field );
+*/
+
+#define HEX_IMPASSABLE ( -1.0f )
+
+typedef struct {
+	int cell;
+	float cost;
+} HexFlowFieldOpen;
+
+typedef struct {
+	int32_t width;
+	int32_t height;
+
+	float* costs;
+	float* integration; // cost to reach the closest goal from each cell, INFINITY if it can't be reached
+	int8_t* directions; // neighbor to move to from each cell to get closer to the goal, -1 if there is none
+
+	int* sbGoals;
+	int* sbDirtyCells;
+	float* sbDirtyOldCosts;
+
+	// scratch data for building and updating
+	HexFlowFieldOpen* sbOpen; // binary heap
+	uint32_t* invalidStamps;
+	uint32_t invalidStamp;
+	int* sbChangedCells;
+} HexFlowField;
+
+// Allocates a field for the grid with every cost set to 1. Returns 0 on success.
+int flowField_Create( HexFlowField* field, int32_t width, int32_t height );
+void flowField_Destroy( HexFlowField* field );
+
+// Clears out any existing goals and sets a single goal, or adds a goal to the list of current goals.
+//  Changing the goals requires a call to flowField_Build.
+void flowField_SetGoal( HexFlowField* field, HexGridCoord goal );
+void flowField_AddGoal( HexFlowField* field, HexGridCoord goal );
+
+// Sets the cost of moving into the cell, use HEX_IMPASSABLE for cells that can't be entered.
+//  The change won't be reflected in the field until flowField_Update or flowField_Build is called.
+void flowField_SetCost( HexFlowField* field, HexGridCoord coord, float cost );
+float flowField_GetCost( HexFlowField* field, HexGridCoord coord );
+
+// Calculates the integration and direction for every cell.
+void flowField_Build( HexFlowField* field );
+
+// Updates only the cells affected by the costs changed since the last build or update.
+void flowField_Update( HexFlowField* field );
+
+// Returns which neighbor to move to, in the same order as hex_GetNeighbor, or -1 if the coordinate is a goal, can't
+//  reach a goal, or is outside the grid.
+int flowField_GetDirection( HexFlowField* field, HexGridCoord coord );
+
+// Returns the cost to reach the closest goal, INFINITY if none can be reached.
+float flowField_GetDistance( HexFlowField* field, HexGridCoord coord );
+
+#endif /* inclusion guard */
@@ -5,6 +5,7 @@
 
 #include "stretchyBuffer.h"
 #include "../Math/mathUtil.h"
+#include "../Math/simd.h"
 #include "../System/platformLog.h"
 
 #define SQRT_THREE 1.73205080757f
@@ -123,6 +124,96 @@ HexGridCoord hex_Pointy_PositionToGrid( float size, Vector2 pos )
 	return roundHexCoord( q, r );
 }
 
+#if SIMD_WIDTH > 0
+// rounds half away from zero, same as roundf
+static simd4f simdRound( simd4f v )
+{
+	simd4f truncated = simd4i_ToFloat( simd4f_ToInt( v ) );
+	simd4f sign = simd4f_Select( simd4f_CmpLT( v, simd4f_Zero( ) ), simd4f_Set1( -1.0f ), simd4f_Set1( 1.0f ) );
+	simd4f roundAway = simd4f_CmpGE( simd4f_Abs( simd4f_Sub( v, truncated ) ), simd4f_Set1( 0.5f ) );
+	return simd4f_Add( truncated, simd4f_And( roundAway, sign ) );
+}
+
+// same as roundHexCoord but for four coordinates at once, stores them as qrqrqrqr
+static void roundHexCoords4( simd4f q, simd4f r, int32_t* out )
+{
+	simd4f x = q;
+	simd4f z = r;
+	simd4f y = simd4f_Sub( simd4f_Sub( simd4f_Zero( ), x ), z );
+
+	simd4f rx = simdRound( x );
+	simd4f ry = simdRound( y );
+	simd4f rz = simdRound( z );
+
+	simd4f xDiff = simd4f_Abs( simd4f_Sub( rx, x ) );
+	simd4f yDiff = simd4f_Abs( simd4f_Sub( ry, y ) );
+	simd4f zDiff = simd4f_Abs( simd4f_Sub( rz, z ) );
+
+	// only x and z are used for the axial coordinate, so we only need to fix them if they have the largest difference
+	simd4f fixX = simd4f_And( simd4f_CmpGT( xDiff, yDiff ), simd4f_CmpGT( xDiff, zDiff ) );
+	simd4f fixY = simd4f_AndNot( fixX, simd4f_CmpGT( yDiff, zDiff ) );
+
+	simd4f outQ = simd4f_Select( fixX, simd4f_Sub( simd4f_Sub( simd4f_Zero( ), ry ), rz ), rx );
+	simd4f outR = simd4f_Select( simd4f_Or( fixX, fixY ), rz, simd4f_Sub( simd4f_Sub( simd4f_Zero( ), rx ), ry ) );
+
+	simd4i_StoreInterleaved( out, simd4f_ToInt( outQ ), simd4f_ToInt( outR ) );
+}
+#endif
+
+void hex_Flat_PositionsToGrid( float size, const Vector2* positions, HexGridCoord* outCoords, size_t count )
+{
+	assert( ( positions != NULL ) || ( count == 0 ) );
+	assert( ( outCoords != NULL ) || ( count == 0 ) );
+
+	size_t i = 0;
+#if SIMD_WIDTH > 0
+	simd4f sizeV = simd4f_Set1( size );
+	simd4f qx = simd4f_Set1( 2.0f / 3.0f );
+	simd4f rx = simd4f_Set1( -1.0f / 3.0f );
+	simd4f ry = simd4f_Set1( SQRT_THREE / 3.0f );
+	for( ; ( i + 4 ) <= count; i += 4 ) {
+		simd4f x, y;
+		simd4f_LoadInterleaved( &( positions[i].x ), &x, &y );
+
+		simd4f q = simd4f_Div( simd4f_Mul( qx, x ), sizeV );
+		simd4f r = simd4f_Div( simd4f_Add( simd4f_Mul( rx, x ), simd4f_Mul( ry, y ) ), sizeV );
+
+		roundHexCoords4( q, r, &( outCoords[i].q ) );
+	}
+#endif
+
+	for( ; i < count; ++i ) {
+		outCoords[i] = hex_Flat_PositionToGrid( size, positions[i] );
+	}
+}
+
+void hex_Pointy_PositionsToGrid( float size, const Vector2* positions, HexGridCoord* outCoords, size_t count )
+{
+	assert( ( positions != NULL ) || ( count == 0 ) );
+	assert( ( outCoords != NULL ) || ( count == 0 ) );
+
+	size_t i = 0;
+#if SIMD_WIDTH > 0
+	simd4f sizeV = simd4f_Set1( size );
+	simd4f qx = simd4f_Set1( SQRT_THREE / 3.0f );
+	simd4f qy = simd4f_Set1( 1.0f / 3.0f );
+	simd4f ry = simd4f_Set1( 2.0f / 3.0f );
+	for( ; ( i + 4 ) <= count; i += 4 ) {
+		simd4f x, y;
+		simd4f_LoadInterleaved( &( positions[i].x ), &x, &y );
+
+		simd4f q = simd4f_Div( simd4f_Sub( simd4f_Mul( qx, x ), simd4f_Mul( qy, y ) ), sizeV );
+		simd4f r = simd4f_Div( simd4f_Mul( ry, y ), sizeV );
+
+		roundHexCoords4( q, r, &( outCoords[i].q ) );
+	}
+#endif
+
+	for( ; i < count; ++i ) {
+		outCoords[i] = hex_Pointy_PositionToGrid( size, positions[i] );
+	}
+}
+
 static HexGridCoord neighborOffets[] = {
 	{ 0, -1 }, { 1, -1 }, { 1, 0 }, { 0, 1 }, { -1, 1 }, { -1, 0 }
 };
@@ -155,6 +246,7 @@ void hex_AllInRange( HexGridCoord base, int32_t range, HexGridCoord** sbOutList
 	assert( range >= 0 );
 
 	sb_Clear( *sbOutList );
+	HexGridCoord* out = sb_Add( ( *sbOutList ), hex_RangeCount( range ) );
 
 	for( int32_t x = -range; x <= range; ++x ) {
 
@@ -167,9 +259,8 @@ void hex_AllInRange( HexGridCoord base, int32_t range, HexGridCoord** sbOutList
 			c.q = x;
 			c.r = z;
 
-			add( &base, &c, &c );
-
-			sb_Push( ( *sbOutList ), c );
+			add( &base, &c, out );
+			++out;
 		}
 	}
 }
@@ -206,14 +297,133 @@ void hex_Ring( HexGridCoord center, int32_t range, HexGridCoord** sbOutList )
 	c.r *= range;
 	add( &center, &c, &c );
 
+	HexGridCoord* out = sb_Add( ( *sbOutList ), hex_RingCount( range ) );
 	for( int i = 0; i < 6; ++i ) {
 		for( int j = 0; j < range; ++j ) {
-			sb_Push( ( *sbOutList ), c );
+			(*out++) = c;
 			c = hex_GetNeighbor( c, i );
 		}
 	}
 }
 
+// offsets for everything within HEX_OFFSET_TABLE_RANGE, in rings going out from the center
+//  each ring is in the same order hex_Ring uses
+static const HexGridCoord rangeOffsets[] = {
+	{ 0, 0 },
+	{ -1, 1 }, { -1, 0 }, { 0, -1 }, { 1, -1 }, { 1, 0 }, { 0, 1 },
+	{ -2, 2 }, { -2, 1 }, { -2, 0 }, { -1, -1 }, { 0, -2 }, { 1, -2 }, { 2, -2 }, { 2, -1 }, { 2, 0 }, { 1, 1 }, { 0, 2 }, { -1, 2 },
+	{ -3, 3 }, { -3, 2 }, { -3, 1 }, { -3, 0 }, { -2, -1 }, { -1, -2 }, { 0, -3 }, { 1, -3 }, { 2, -3 }, { 3, -3 }, { 3, -2 }, { 3, -1 },
+	{ 3, 0 }, { 2, 1 }, { 1, 2 }, { 0, 3 }, { -1, 3 }, { -2, 3 },
+	{ -4, 4 }, { -4, 3 }, { -4, 2 }, { -4, 1 }, { -4, 0 }, { -3, -1 }, { -2, -2 }, { -1, -3 }, { 0, -4 }, { 1, -4 }, { 2, -4 }, { 3, -4 },
+	{ 4, -4 }, { 4, -3 }, { 4, -2 }, { 4, -1 }, { 4, 0 }, { 3, 1 }, { 2, 2 }, { 1, 3 }, { 0, 4 }, { -1, 4 }, { -2, 4 }, { -3, 4 },
+	{ -5, 5 }, { -5, 4 }, { -5, 3 }, { -5, 2 }, { -5, 1 }, { -5, 0 }, { -4, -1 }, { -3, -2 }, { -2, -3 }, { -1, -4 }, { 0, -5 }, { 1, -5 },
+	{ 2, -5 }, { 3, -5 }, { 4, -5 }, { 5, -5 }, { 5, -4 }, { 5, -3 }, { 5, -2 }, { 5, -1 }, { 5, 0 }, { 4, 1 }, { 3, 2 }, { 2, 3 },
+	{ 1, 4 }, { 0, 5 }, { -1, 5 }, { -2, 5 }, { -3, 5 }, { -4, 5 },
+	{ -6, 6 }, { -6, 5 }, { -6, 4 }, { -6, 3 }, { -6, 2 }, { -6, 1 }, { -6, 0 }, { -5, -1 }, { -4, -2 }, { -3, -3 }, { -2, -4 }, { -1, -5 },
+	{ 0, -6 }, { 1, -6 }, { 2, -6 }, { 3, -6 }, { 4, -6 }, { 5, -6 }, { 6, -6 }, { 6, -5 }, { 6, -4 }, { 6, -3 }, { 6, -2 }, { 6, -1 },
+	{ 6, 0 }, { 5, 1 }, { 4, 2 }, { 3, 3 }, { 2, 4 }, { 1, 5 }, { 0, 6 }, { -1, 6 }, { -2, 6 }, { -3, 6 }, { -4, 6 }, { -5, 6 },
+	{ -7, 7 }, { -7, 6 }, { -7, 5 }, { -7, 4 }, { -7, 3 }, { -7, 2 }, { -7, 1 }, { -7, 0 }, { -6, -1 }, { -5, -2 }, { -4, -3 }, { -3, -4 },
+	{ -2, -5 }, { -1, -6 }, { 0, -7 }, { 1, -7 }, { 2, -7 }, { 3, -7 }, { 4, -7 }, { 5, -7 }, { 6, -7 }, { 7, -7 }, { 7, -6 }, { 7, -5 },
+	{ 7, -4 }, { 7, -3 }, { 7, -2 }, { 7, -1 }, { 7, 0 }, { 6, 1 }, { 5, 2 }, { 4, 3 }, { 3, 4 }, { 2, 5 }, { 1, 6 }, { 0, 7 },
+	{ -1, 7 }, { -2, 7 }, { -3, 7 }, { -4, 7 }, { -5, 7 }, { -6, 7 },
+	{ -8, 8 }, { -8, 7 }, { -8, 6 }, { -8, 5 }, { -8, 4 }, { -8, 3 }, { -8, 2 }, { -8, 1 }, { -8, 0 }, { -7, -1 }, { -6, -2 }, { -5, -3 },
+	{ -4, -4 }, { -3, -5 }, { -2, -6 }, { -1, -7 }, { 0, -8 }, { 1, -8 }, { 2, -8 }, { 3, -8 }, { 4, -8 }, { 5, -8 }, { 6, -8 }, { 7, -8 },
+	{ 8, -8 }, { 8, -7 }, { 8, -6 }, { 8, -5 }, { 8, -4 }, { 8, -3 }, { 8, -2 }, { 8, -1 }, { 8, 0 }, { 7, 1 }, { 6, 2 }, { 5, 3 },
+	{ 4, 4 }, { 3, 5 }, { 2, 6 }, { 1, 7 }, { 0, 8 }, { -1, 8 }, { -2, 8 }, { -3, 8 }, { -4, 8 }, { -5, 8 }, { -6, 8 }, { -7, 8 },
+};
+
+size_t hex_RangeCount( int32_t range )
+{
+	assert( range >= 0 );
+	return (size_t)( ( 3 * range * ( range + 1 ) ) + 1 );
+}
+
+size_t hex_RingCount( int32_t range )
+{
+	assert( range >= 0 );
+	return ( range == 0 ) ? 1 : (size_t)( 6 * range );
+}
+
+const HexGridCoord* hex_RangeOffsets( int32_t range, size_t* outCount )
+{
+	assert( range >= 0 );
+	assert( range <= HEX_OFFSET_TABLE_RANGE );
+	assert( ( sizeof( rangeOffsets ) / sizeof( rangeOffsets[0] ) ) == hex_RangeCount( HEX_OFFSET_TABLE_RANGE ) );
+
+	if( outCount != NULL ) {
+		(*outCount) = hex_RangeCount( range );
+	}
+	return rangeOffsets;
+}
+
+static void addOffsets( HexGridCoord base, const HexGridCoord* offsets, size_t count, HexGridCoord* out )
+{
+	for( size_t i = 0; i < count; ++i ) {
+		out[i].q = base.q + offsets[i].q;
+		out[i].r = base.r + offsets[i].r;
+	}
+}
+
+size_t hex_RingToBuffer( HexGridCoord center, int32_t range, HexGridCoord* outBuffer, size_t bufferSize )
+{
+	assert( range >= 0 );
+	assert( outBuffer != NULL );
+
+	size_t count = hex_RingCount( range );
+	assert( bufferSize >= count );
+	if( bufferSize < count ) {
+		return 0;
+	}
+
+	if( range <= HEX_OFFSET_TABLE_RANGE ) {
+		size_t first = ( range == 0 ) ? 0 : hex_RangeCount( range - 1 );
+		addOffsets( center, rangeOffsets + first, count, outBuffer );
+		return count;
+	}
+
+	// same as hex_Ring
+	HexGridCoord c = neighborOffets[4];
+	c.q *= range;
+	c.r *= range;
+	add( &center, &c, &c );
+
+	HexGridCoord* out = outBuffer;
+	for( int i = 0; i < 6; ++i ) {
+		for( int j = 0; j < range; ++j ) {
+			(*out++) = c;
+			c = hex_GetNeighbor( c, i );
+		}
+	}
+
+	return count;
+}
+
+size_t hex_AllInRangeToBuffer( HexGridCoord base, int32_t range, HexGridCoord* outBuffer, size_t bufferSize )
+{
+	assert( range >= 0 );
+	assert( outBuffer != NULL );
+
+	size_t count = hex_RangeCount( range );
+	assert( bufferSize >= count );
+	if( bufferSize < count ) {
+		return 0;
+	}
+
+	if( range <= HEX_OFFSET_TABLE_RANGE ) {
+		addOffsets( base, rangeOffsets, count, outBuffer );
+		return count;
+	}
+
+	// copy as much as we can from the table and then add the rings past it
+	size_t written = hex_RangeCount( HEX_OFFSET_TABLE_RANGE );
+	addOffsets( base, rangeOffsets, written, outBuffer );
+	for( int32_t ring = HEX_OFFSET_TABLE_RANGE + 1; ring <= range; ++ring ) {
+		written += hex_RingToBuffer( base, ring, outBuffer + written, bufferSize - written );
+	}
+
+	return written;
+}
+
 //***************************************************************************
 // Various functions to convert hex coordinates to grid indices
 //  For these we'll assume the hex coord [0,0] corresponds to index 0
@@ -278,4 +488,15 @@ HexGridCoord hex_RectIndexToCoord( uint32_t index, int32_t width, int32_t height
 	coord.q = ( index % width ) - qAdjustment;
 
 	return coord;
-}
\ No newline at end of file
+}
+
+// Gets the index of the neighbor of the hex at index, in the same order as hex_GetNeighbor.
+//  Returns -1 if the neighbor is outside the rectangle.
+int32_t hex_RectIndexNeighbor( uint32_t index, int neighbor, int32_t width, int32_t height )
+{
+	HexGridCoord coord = hex_GetNeighbor( hex_RectIndexToCoord( index, width, height ), neighbor );
+	if( !hex_CoordInRect( coord, width, height ) ) {
+		return -1;
+	}
+	return (int32_t)hex_CoordToRectIndex( coord, width, height );
+}
@@ -2,6 +2,7 @@
 #define HEX_GRID
 
 #include <stdint.h>
+#include <stddef.h>
 #include "../Math/vector2.h"
 
 /*
@@ -44,6 +45,10 @@ HexGridCoord hex_Flat_PositionToGrid( float size, Vector2 pos );
 Vector2 hex_Pointy_GridToPosition( float size, HexGridCoord coord );
 HexGridCoord hex_Pointy_PositionToGrid( float size, Vector2 pos );
 
+// Converts count positions to grid coordinates at once, gives the same results as calling the single versions on each.
+void hex_Flat_PositionsToGrid( float size, const Vector2* positions, HexGridCoord* outCoords, size_t count );
+void hex_Pointy_PositionsToGrid( float size, const Vector2* positions, HexGridCoord* outCoords, size_t count );
+
 // For flat topped the neighbor at 0 will be at the top, for pointy topped the neighbor at 0 will be to the north-west
 //  both will continue clockwise around the hex.
 // You can use the HexDirection_Flat and HexDirection_Pointy enumerations to more easily access the one you want.
@@ -61,6 +66,24 @@ void hex_AllInLine( HexGridCoord start, HexGridCoord end, HexGridCoord** sbOutLi
 // Get all hex coords that are a certain range from the center, where range > 0, and puts them into the stretchy buffer sbOutList
 void hex_Ring( HexGridCoord center, int32_t range, HexGridCoord** sbOutList );
 
+// Number of hex coords within range steps of a coord, including the coord itself.
+size_t hex_RangeCount( int32_t range );
+
+// Number of hex coords exactly range steps from a coord.
+size_t hex_RingCount( int32_t range );
+
+// Versions of hex_AllInRange and hex_Ring that write into a buffer instead of allocating, outBuffer should be able to hold
+//  hex_RangeCount( range ) or hex_RingCount( range ) coords. Returns the number of coords written.
+// Unlike hex_AllInRange the coords are ordered in rings spiraling out from base, so the first hex_RangeCount( n ) are
+//  everything within n steps. Ranges up to HEX_OFFSET_TABLE_RANGE are copied from a precomputed table.
+#define HEX_OFFSET_TABLE_RANGE 8
+size_t hex_AllInRangeToBuffer( HexGridCoord base, int32_t range, HexGridCoord* outBuffer, size_t bufferSize );
+size_t hex_RingToBuffer( HexGridCoord center, int32_t range, HexGridCoord* outBuffer, size_t bufferSize );
+
+// Gets the offsets from a center coord for everything within range steps, in the same order as hex_AllInRangeToBuffer.
+//  Only valid for ranges up to HEX_OFFSET_TABLE_RANGE. Puts the number of offsets into outCount.
+const HexGridCoord* hex_RangeOffsets( int32_t range, size_t* outCount );
+
 //***************************************************************************
 // Various functions to convert hex coordinates to grid indices
 
@@ -70,4 +93,8 @@ bool hex_CoordInRect( HexGridCoord coord, int32_t width, int32_t height );
 uint32_t hex_CoordToRectIndex( HexGridCoord coord, int32_t width, int32_t height );
 HexGridCoord hex_RectIndexToCoord( uint32_t index, int32_t width, int32_t height );
 
+// Gets the index of the neighbor of the hex at index, in the same order as hex_GetNeighbor.
+//  Returns -1 if the neighbor is outside the rectangle.
+int32_t hex_RectIndexNeighbor( uint32_t index, int neighbor, int32_t width, int32_t height );
+
 #endif
\ No newline at end of file
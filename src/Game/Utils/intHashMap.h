@@ -0,0 +1,203 @@
+#ifndef INT_HASH_MAP_H
+#define INT_HASH_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "../System/memory.h"
+
+// Flat hash map from 32-bit integer keys to values of any size. Linear probing with all the keys, states, and values
+//  in their own contiguous arrays, removal shifts the following entries back so there are no tombstones.
+//  Use this instead of HashMap when the keys are ids or indices, it doesn't need to hash or compare strings.
+//  Zero initialize or call ihm_Init before use, the value size has to be set before anything is added.
+
+typedef struct {
+	uint32_t* keys;
+	uint8_t* used;
+	uint8_t* values;
+	size_t valueSize;
+	size_t capacity; // always a power of two
+	size_t count;
+} IntHashMap;
+
+// helper for finding a typed value, evaluates to a type* or NULL
+#define ihm_FindAs( map, key, type ) ( (type*)ihm_Find( (map), (key) ) )
+
+#define IHM__VALUE( map, idx ) ( (map)->values + ( (idx) * (map)->valueSize ) )
+
+static inline uint32_t ihm__Hash( uint32_t key )
+{
+	// keys are often sequential, so spread them out, this is the finalizer from MurmurHash3
+	key ^= key >> 16;
+	key *= 0x85ebca6b;
+	key ^= key >> 13;
+	key *= 0xc2b2ae35;
+	key ^= key >> 16;
+	return key;
+}
+
+static inline void ihm_Release( IntHashMap* map )
+{
+	assert( map != NULL );
+
+	mem_Release( map->keys );
+	mem_Release( map->used );
+	mem_Release( map->values );
+
+	map->keys = NULL;
+	map->used = NULL;
+	map->values = NULL;
+	map->capacity = 0;
+	map->count = 0;
+}
+
+static inline void ihm__Allocate( IntHashMap* map, size_t capacity )
+{
+	map->capacity = capacity;
+	map->count = 0;
+	map->keys = (uint32_t*)mem_Allocate( sizeof( map->keys[0] ) * capacity );
+	map->used = (uint8_t*)mem_Allocate( sizeof( map->used[0] ) * capacity );
+	map->values = (uint8_t*)mem_Allocate( map->valueSize * capacity );
+	memset( map->used, 0, sizeof( map->used[0] ) * capacity );
+}
+
+static inline void* ihm_Set( IntHashMap* map, uint32_t key, const void* value );
+
+// keep the load under 3/4
+static inline void ihm__Grow( IntHashMap* map )
+{
+	IntHashMap old = (*map);
+	ihm__Allocate( map, ( old.capacity == 0 ) ? 16 : ( old.capacity * 2 ) );
+
+	for( size_t i = 0; i < old.capacity; ++i ) {
+		if( old.used[i] ) {
+			ihm_Set( map, old.keys[i], IHM__VALUE( &old, i ) );
+		}
+	}
+
+	ihm_Release( &old );
+}
+
+static inline void ihm_Init( IntHashMap* map, size_t valueSize, size_t estimatedSize )
+{
+	assert( map != NULL );
+	assert( valueSize > 0 );
+
+	memset( map, 0, sizeof( *map ) );
+	map->valueSize = valueSize;
+
+	if( estimatedSize > 0 ) {
+		size_t capacity = 16;
+		while( ( capacity * 3 ) / 4 < estimatedSize ) {
+			capacity *= 2;
+		}
+		ihm__Allocate( map, capacity );
+	}
+}
+
+// returns the slot the key is in, or the negative of one more than the empty slot it would go in
+static inline ptrdiff_t ihm__FindSlot( const IntHashMap* map, uint32_t key )
+{
+	size_t mask = map->capacity - 1;
+	size_t idx = ihm__Hash( key ) & mask;
+	while( map->used[idx] ) {
+		if( map->keys[idx] == key ) {
+			return (ptrdiff_t)idx;
+		}
+		idx = ( idx + 1 ) & mask;
+	}
+	return -(ptrdiff_t)idx - 1;
+}
+
+// returns a pointer to the value for the key, or NULL if it doesn't exist
+//  the pointer is only valid until the next time something is added or removed
+static inline void* ihm_Find( const IntHashMap* map, uint32_t key )
+{
+	assert( map != NULL );
+	if( map->count == 0 ) {
+		return NULL;
+	}
+
+	ptrdiff_t slot = ihm__FindSlot( map, key );
+	return ( slot >= 0 ) ? IHM__VALUE( map, (size_t)slot ) : NULL;
+}
+
+static inline bool ihm_Exists( const IntHashMap* map, uint32_t key )
+{
+	return ( ihm_Find( map, key ) != NULL );
+}
+
+// adds or replaces the value for the key, if value is NULL the value is left uninitialized
+//  returns a pointer to where the value is stored
+static inline void* ihm_Set( IntHashMap* map, uint32_t key, const void* value )
+{
+	assert( map != NULL );
+	assert( map->valueSize > 0 );
+
+	if( ( ( map->count + 1 ) * 4 ) > ( map->capacity * 3 ) ) {
+		ihm__Grow( map );
+	}
+
+	ptrdiff_t slot = ihm__FindSlot( map, key );
+	size_t idx;
+	if( slot >= 0 ) {
+		idx = (size_t)slot;
+	} else {
+		idx = (size_t)( -slot - 1 );
+		map->used[idx] = 1;
+		map->keys[idx] = key;
+		++map->count;
+	}
+
+	if( value != NULL ) {
+		memcpy( IHM__VALUE( map, idx ), value, map->valueSize );
+	}
+	return IHM__VALUE( map, idx );
+}
+
+// removes the key if it exists, returns whether anything was removed
+static inline bool ihm_Remove( IntHashMap* map, uint32_t key )
+{
+	assert( map != NULL );
+	if( map->count == 0 ) {
+		return false;
+	}
+
+	ptrdiff_t slot = ihm__FindSlot( map, key );
+	if( slot < 0 ) {
+		return false;
+	}
+
+	// shift back any following entries that would have wanted to be in an earlier spot
+	size_t mask = map->capacity - 1;
+	size_t hole = (size_t)slot;
+	size_t idx = ( hole + 1 ) & mask;
+	while( map->used[idx] ) {
+		size_t ideal = ihm__Hash( map->keys[idx] ) & mask;
+		// move it if the hole is between where it wants to be and where it is
+		if( ( ( idx - ideal ) & mask ) >= ( ( idx - hole ) & mask ) ) {
+			map->keys[hole] = map->keys[idx];
+			memcpy( IHM__VALUE( map, hole ), IHM__VALUE( map, idx ), map->valueSize );
+			hole = idx;
+		}
+		idx = ( idx + 1 ) & mask;
+	}
+
+	map->used[hole] = 0;
+	--map->count;
+	return true;
+}
+
+// removes everything but keeps the memory
+static inline void ihm_Clear( IntHashMap* map )
+{
+	assert( map != NULL );
+	if( map->used != NULL ) {
+		memset( map->used, 0, sizeof( map->used[0] ) * map->capacity );
+	}
+	map->count = 0;
+}
+
+#endif // inclusion guard
@@ -0,0 +1,83 @@
+#ifndef SMALL_VECTOR_H
+#define SMALL_VECTOR_H
+
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include "../System/memory.h"
+
+// Dynamic array that stores the first few elements inside itself, only allocating once it grows past that.
+//  Useful for temporary lists that are usually small, like neighbors or contacts, so they don't hit the memory manager.
+//  Declare with SMALL_VECTOR( type, count ) and call sv_Init before use and sv_Release when done.
+//  Because the data can point into the structure it must not be copied or moved after sv_Init is called.
+//
+//  SMALL_VECTOR( int, 8 ) neighbors;
+//  sv_Init( neighbors );
+//  sv_Push( neighbors, 10 );
+//  for( size_t i = 0; i < neighbors.count; ++i ) { ... neighbors.data[i] ... }
+//  sv_Release( neighbors );
+
+#define SMALL_VECTOR( type, inlineCount ) struct { type* data; size_t count; size_t capacity; type inlineData[(inlineCount)]; }
+
+#define sv_Init( v ) ( (v).data = (v).inlineData, (v).count = 0, (v).capacity = sizeof( (v).inlineData ) / sizeof( (v).inlineData[0] ) )
+
+// releases any allocated memory and goes back to using the inline storage
+#define sv_Release( v ) ( sv__Release( (void**)&( (v).data ), (v).inlineData ), sv_Init( v ) )
+
+// pushes the value onto the end of the vector
+#define sv_Push( v, val ) ( sv__Reserve( (v), (v).count + 1 ), (v).data[(v).count++] = (val) )
+
+// adds amt elements to the end of the vector and returns a pointer to the first one
+#define sv_Add( v, amt ) ( sv__Reserve( (v), (v).count + (amt) ), (v).count += (amt), &( (v).data[(v).count - (amt)] ) )
+
+// removes the last element and returns it, the vector must not be empty
+#define sv_Pop( v ) ( (v).data[--(v).count] )
+
+// removes the element at idx by moving the last element into its spot, doesn't keep the order
+#define sv_RemoveSwap( v, idx ) ( assert( (size_t)(idx) < (v).count ), (v).data[(idx)] = (v).data[--(v).count] )
+
+#define sv_Clear( v ) ( (v).count = 0 )
+
+// makes sure there's space for at least amt elements
+#define sv_Reserve( v, amt ) sv__Reserve( (v), (amt) )
+
+#define sv__Reserve( v, amt ) ( ( (size_t)(amt) > (v).capacity ) ? \
+	( (v).data = sv__Grow( (v).data, (v).inlineData, (v).count, &( (v).capacity ), (amt), sizeof( (v).data[0] ), __FILE__, __LINE__ ) ) : (v).data )
+
+static inline void* sv__Grow( void* data, void* inlineData, size_t count, size_t* capacity, size_t needed, size_t itemSize, const char* fileName, const int fileLine )
+{
+	size_t newCapacity = (*capacity) * 2;
+	if( newCapacity < needed ) {
+		newCapacity = needed;
+	}
+
+	void* newData;
+	if( data == inlineData ) {
+		// moving out of the inline storage
+		newData = mem_Allocate_Data( newCapacity * itemSize, fileName, fileLine );
+		if( newData == NULL ) {
+			assert( false && "Error allocating small vector." );
+			return data;
+		}
+		memcpy( newData, data, count * itemSize );
+	} else {
+		newData = mem_Resize_Data( data, newCapacity * itemSize, fileName, fileLine );
+		if( newData == NULL ) {
+			assert( false && "Error allocating small vector." );
+			return data;
+		}
+	}
+
+	(*capacity) = newCapacity;
+	return newData;
+}
+
+static inline void sv__Release( void** data, void* inlineData )
+{
+	if( ( (*data) != NULL ) && ( (*data) != inlineData ) ) {
+		mem_Release( (*data) );
+	}
+	(*data) = inlineData;
+}
+
+#endif // inclusion guard
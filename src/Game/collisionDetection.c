@@ -11,6 +11,9 @@
 #include "Math/mathUtil.h"
 #include "Utils/stretchyBuffer.h"
 #include "System/platformLog.h"
+#include "System/memory.h"
+#include "System/jobQueue.h"
+#include "Math/simd.h"
 
 // raycasting intersection functions
 int RayCastvAABBAxis( float rayStart, float dir, float boxMin, float boxMax, float* tMin, float* tMax )
@@ -68,7 +71,7 @@ int LineAABBTest( Vector2* start, Vector2* end, ColliderAABB* aabb, float maxAll
 		return 0;
 	}
 
-	vec2_AddScaled( start, end, tMin, pt );
+	vec2_Lerp( start, end, tMin, pt );
 	(*t) = tMin;
 
 	return 1;
@@ -76,7 +79,10 @@ int LineAABBTest( Vector2* start, Vector2* end, ColliderAABB* aabb, float maxAll
 
 int RayCastvAABB( Vector2* start, Vector2* dir, Collider* collider, float* t, Vector2* pt )
 {
-	return LineAABBTest( start, dir, &(collider->aabb), FLT_MAX, 0.0f, t, pt );
+	// LineAABBTest works with the end point, not the direction
+	Vector2 end;
+	vec2_Add( start, dir, &end );
+	return LineAABBTest( start, &end, &(collider->aabb), FLT_MAX, 0.0f, t, pt );
 }
 
 int RayCastvCircle( Vector2* start, Vector2* dir, Collider* collider, float* t, Vector2* pt )
@@ -131,8 +137,15 @@ int RayCastvHalfSpace( Vector2* start, Vector2* dir, Collider* collider, float*
 	return 0;
 }
 
+int RayCastvLineSegment( Vector2* start, Vector2* dir, Collider* collider, float* t, Vector2* pt )
+{
+	Vector2 end;
+	vec2_Add( start, dir, &end );
+	return collision_LineSegmentCollision( start, &end, &( collider->lineSegment.posOne ), &( collider->lineSegment.posTwo ), pt, t ) ? 1 : 0;
+}
+
 typedef int(*RayCastCheck)( Vector2* start, Vector2* dir, Collider* collider, float* t, Vector2* pt );
-RayCastCheck rayCastChecks[NUM_COLLIDER_TYPES] = { RayCastvAABB, RayCastvCircle, RayCastvHalfSpace };
+RayCastCheck rayCastChecks[NUM_COLLIDER_TYPES] = { RayCastvAABB, RayCastvCircle, RayCastvHalfSpace, RayCastvLineSegment };
 
 // Standard Collision Functions
 //  used if we don't want to ever handle collisions between these two types.
@@ -644,6 +657,271 @@ int collision_GetSeparation( Collider* c1, Collider* c2, Vector2* outSeparation
 	return collisionChecks[c1->type][c2->type]( c1, c2, outSeparation );
 }
 
+// Batched Collision Functions
+//  These work the same as the matching collision checks above, just on structure of arrays data so four pairs can be
+//  tested at once. The primary stride is either 1, to test pairs with the same index, or 0, to test a single primary
+//  collider against every fixed collider. Anything that doesn't fill a full SIMD register uses the scalar checks.
+
+static void scalarCirclevCircle( const ColliderCircleBatch* primary, int primaryIdx, const ColliderCircleBatch* fixed, int fixedIdx, Vector2* outSeparation, bool* outHit )
+{
+	Collider p, f;
+	p.circle.type = CT_CIRCLE;
+	p.circle.center = vec2( primary->centerX[primaryIdx], primary->centerY[primaryIdx] );
+	p.circle.radius = primary->radius[primaryIdx];
+	f.circle.type = CT_CIRCLE;
+	f.circle.center = vec2( fixed->centerX[fixedIdx], fixed->centerY[fixedIdx] );
+	f.circle.radius = fixed->radius[fixedIdx];
+
+	(*outHit) = CirclevCircle( &p, &f, outSeparation ) != 0;
+	if( !(*outHit) ) {
+		(*outSeparation) = VEC2_ZERO;
+	}
+}
+
+static void scalarAABBvAABB( const ColliderAABBBatch* primary, int primaryIdx, const ColliderAABBBatch* fixed, int fixedIdx, Vector2* outSeparation, bool* outHit )
+{
+	Collider p, f;
+	p.aabb.type = CT_AABB;
+	p.aabb.center = vec2( primary->centerX[primaryIdx], primary->centerY[primaryIdx] );
+	p.aabb.halfDim = vec2( primary->halfWidth[primaryIdx], primary->halfHeight[primaryIdx] );
+	f.aabb.type = CT_AABB;
+	f.aabb.center = vec2( fixed->centerX[fixedIdx], fixed->centerY[fixedIdx] );
+	f.aabb.halfDim = vec2( fixed->halfWidth[fixedIdx], fixed->halfHeight[fixedIdx] );
+
+	(*outHit) = AABBvAABB( &p, &f, outSeparation ) != 0;
+	if( !(*outHit) ) {
+		(*outSeparation) = VEC2_ZERO;
+	}
+}
+
+static void scalarCirclevAABB( const ColliderCircleBatch* primary, int primaryIdx, const ColliderAABBBatch* fixed, int fixedIdx, Vector2* outSeparation, bool* outHit )
+{
+	Collider p, f;
+	p.circle.type = CT_CIRCLE;
+	p.circle.center = vec2( primary->centerX[primaryIdx], primary->centerY[primaryIdx] );
+	p.circle.radius = primary->radius[primaryIdx];
+	f.aabb.type = CT_AABB;
+	f.aabb.center = vec2( fixed->centerX[fixedIdx], fixed->centerY[fixedIdx] );
+	f.aabb.halfDim = vec2( fixed->halfWidth[fixedIdx], fixed->halfHeight[fixedIdx] );
+
+	(*outHit) = CirclevAABB( &p, &f, outSeparation ) != 0;
+	if( !(*outHit) ) {
+		(*outSeparation) = VEC2_ZERO;
+	}
+}
+
+#if SIMD_WIDTH > 0
+static inline simd4f loadBatch( const float* data, int idx, int stride )
+{
+	return ( stride == 0 ) ? simd4f_Set1( data[0] ) : simd4f_Load( data + idx );
+}
+
+static inline int storeBatchResults( int idx, simd4f hit, simd4f sepX, simd4f sepY, Vector2* outSeparations, bool* outHits )
+{
+	simd4f_StoreInterleaved( &( outSeparations[idx].x ), simd4f_And( hit, sepX ), simd4f_And( hit, sepY ) );
+
+	int mask = simd4f_MoveMask( hit );
+	for( int i = 0; i < SIMD_WIDTH; ++i ) {
+		outHits[idx + i] = ( mask & ( 1 << i ) ) != 0;
+	}
+
+	return ( mask & 1 ) + ( ( mask >> 1 ) & 1 ) + ( ( mask >> 2 ) & 1 ) + ( ( mask >> 3 ) & 1 );
+}
+#endif
+
+static int batchCirclevCircle( const ColliderCircleBatch* primary, int primaryStride, const ColliderCircleBatch* fixed, int count, Vector2* outSeparations, bool* outHits )
+{
+	int numHits = 0;
+	int i = 0;
+
+#if SIMD_WIDTH > 0
+	for( ; ( i + SIMD_WIDTH ) <= count; i += SIMD_WIDTH ) {
+		simd4f pX = loadBatch( primary->centerX, i, primaryStride );
+		simd4f pY = loadBatch( primary->centerY, i, primaryStride );
+		simd4f pR = loadBatch( primary->radius, i, primaryStride );
+		simd4f fX = simd4f_Load( fixed->centerX + i );
+		simd4f fY = simd4f_Load( fixed->centerY + i );
+		simd4f fR = simd4f_Load( fixed->radius + i );
+
+		// same order of operations as CirclevCircle so the results match exactly
+		simd4f radiiSum = simd4f_Add( pR, fR );
+		radiiSum = simd4f_Mul( radiiSum, radiiSum );
+		simd4f diffX = simd4f_Sub( pX, fX );
+		simd4f diffY = simd4f_Sub( pY, fY );
+		simd4f distSqrd = simd4f_Add( simd4f_Mul( diffX, diffX ), simd4f_Mul( diffY, diffY ) );
+		simd4f hit = simd4f_CmpLT( distSqrd, radiiSum );
+
+		radiiSum = simd4f_Sqrt( radiiSum );
+		simd4f dist = simd4f_Sqrt( distSqrd );
+		simd4f nonZero = simd4f_CmpGT( dist, simd4f_Zero( ) );
+		simd4f safeDist = simd4f_Select( nonZero, dist, simd4f_Set1( 1.0f ) );
+		simd4f scale = simd4f_Sub( radiiSum, dist );
+		simd4f sepX = simd4f_Mul( simd4f_Div( diffX, safeDist ), scale );
+		simd4f sepY = simd4f_Mul( simd4f_Div( diffY, safeDist ), scale );
+
+		numHits += storeBatchResults( i, hit, sepX, sepY, outSeparations, outHits );
+	}
+#endif
+
+	for( ; i < count; ++i ) {
+		scalarCirclevCircle( primary, i * primaryStride, fixed, i, &( outSeparations[i] ), &( outHits[i] ) );
+		numHits += outHits[i] ? 1 : 0;
+	}
+
+	return numHits;
+}
+
+static int batchAABBvAABB( const ColliderAABBBatch* primary, int primaryStride, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits )
+{
+	int numHits = 0;
+	int i = 0;
+
+#if SIMD_WIDTH > 0
+	for( ; ( i + SIMD_WIDTH ) <= count; i += SIMD_WIDTH ) {
+		simd4f pX = loadBatch( primary->centerX, i, primaryStride );
+		simd4f pY = loadBatch( primary->centerY, i, primaryStride );
+		simd4f pW = loadBatch( primary->halfWidth, i, primaryStride );
+		simd4f pH = loadBatch( primary->halfHeight, i, primaryStride );
+		simd4f fX = simd4f_Load( fixed->centerX + i );
+		simd4f fY = simd4f_Load( fixed->centerY + i );
+		simd4f fW = simd4f_Load( fixed->halfWidth + i );
+		simd4f fH = simd4f_Load( fixed->halfHeight + i );
+
+		simd4f zero = simd4f_Zero( );
+		simd4f penX = simd4f_Sub( simd4f_Add( pW, fW ), simd4f_Abs( simd4f_Sub( pX, fX ) ) );
+		simd4f penY = simd4f_Sub( simd4f_Add( pH, fH ), simd4f_Abs( simd4f_Sub( pY, fY ) ) );
+		simd4f hit = simd4f_And( simd4f_CmpGT( penX, zero ), simd4f_CmpGT( penY, zero ) );
+
+		// separate along the axis with the least penetration, away from the fixed box
+		simd4f useY = simd4f_CmpLE( penY, penX );
+		simd4f sepX = simd4f_Select( simd4f_CmpLT( pX, fX ), simd4f_Sub( zero, penX ), penX );
+		simd4f sepY = simd4f_Select( simd4f_CmpLT( pY, fY ), simd4f_Sub( zero, penY ), penY );
+		sepX = simd4f_AndNot( useY, sepX );
+		sepY = simd4f_And( useY, sepY );
+
+		numHits += storeBatchResults( i, hit, sepX, sepY, outSeparations, outHits );
+	}
+#endif
+
+	for( ; i < count; ++i ) {
+		scalarAABBvAABB( primary, i * primaryStride, fixed, i, &( outSeparations[i] ), &( outHits[i] ) );
+		numHits += outHits[i] ? 1 : 0;
+	}
+
+	return numHits;
+}
+
+static int batchCirclevAABB( const ColliderCircleBatch* primary, int primaryStride, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits )
+{
+	int numHits = 0;
+	int i = 0;
+
+#if SIMD_WIDTH > 0
+	for( ; ( i + SIMD_WIDTH ) <= count; i += SIMD_WIDTH ) {
+		simd4f pX = loadBatch( primary->centerX, i, primaryStride );
+		simd4f pY = loadBatch( primary->centerY, i, primaryStride );
+		simd4f pR = loadBatch( primary->radius, i, primaryStride );
+		simd4f fX = simd4f_Load( fixed->centerX + i );
+		simd4f fY = simd4f_Load( fixed->centerY + i );
+		simd4f fW = simd4f_Load( fixed->halfWidth + i );
+		simd4f fH = simd4f_Load( fixed->halfHeight + i );
+
+		simd4f zero = simd4f_Zero( );
+		simd4f diffX = simd4f_Sub( pX, fX );
+		simd4f diffY = simd4f_Sub( pY, fY );
+		simd4f absDiffX = simd4f_Abs( diffX );
+		simd4f absDiffY = simd4f_Abs( diffY );
+		simd4f penX = simd4f_Sub( simd4f_Add( pR, fW ), absDiffX );
+		simd4f penY = simd4f_Sub( simd4f_Add( pR, fH ), absDiffY );
+		simd4f hit = simd4f_And( simd4f_CmpGT( penX, zero ), simd4f_CmpGT( penY, zero ) );
+
+		// corner zones, test against the closest corner
+		simd4f inCorner = simd4f_And( simd4f_CmpGE( absDiffX, fW ), simd4f_CmpGE( absDiffY, fH ) );
+		simd4f cornerX = simd4f_Select( simd4f_CmpLT( diffX, zero ), simd4f_Sub( fX, fW ), simd4f_Add( fX, fW ) );
+		simd4f cornerY = simd4f_Select( simd4f_CmpLT( diffY, zero ), simd4f_Sub( fY, fH ), simd4f_Add( fY, fH ) );
+		simd4f cornerDiffX = simd4f_Sub( pX, cornerX );
+		simd4f cornerDiffY = simd4f_Sub( pY, cornerY );
+		simd4f cornerDistSqrd = simd4f_Add( simd4f_Mul( cornerDiffX, cornerDiffX ), simd4f_Mul( cornerDiffY, cornerDiffY ) );
+		simd4f cornerHit = simd4f_CmpLT( cornerDistSqrd, simd4f_Mul( pR, pR ) );
+		simd4f cornerDist = simd4f_Sqrt( cornerDistSqrd );
+		simd4f safeCornerDist = simd4f_Select( simd4f_CmpGT( cornerDist, zero ), cornerDist, simd4f_Set1( 1.0f ) );
+		simd4f cornerScale = simd4f_Sub( pR, cornerDist );
+		simd4f cornerSepX = simd4f_Mul( simd4f_Div( cornerDiffX, safeCornerDist ), cornerScale );
+		simd4f cornerSepY = simd4f_Mul( simd4f_Div( cornerDiffY, safeCornerDist ), cornerScale );
+
+		// otherwise treat the circle like an AABB
+		simd4f useY = simd4f_CmpLE( penY, penX );
+		simd4f sideSepX = simd4f_AndNot( useY, simd4f_Select( simd4f_CmpLT( pX, fX ), simd4f_Sub( zero, penX ), penX ) );
+		simd4f sideSepY = simd4f_And( useY, simd4f_Select( simd4f_CmpLT( pY, fY ), simd4f_Sub( zero, penY ), penY ) );
+
+		hit = simd4f_And( hit, simd4f_Or( simd4f_AndNot( inCorner, hit ), cornerHit ) );
+		simd4f sepX = simd4f_Select( inCorner, cornerSepX, sideSepX );
+		simd4f sepY = simd4f_Select( inCorner, cornerSepY, sideSepY );
+
+		numHits += storeBatchResults( i, hit, sepX, sepY, outSeparations, outHits );
+	}
+#endif
+
+	for( ; i < count; ++i ) {
+		scalarCirclevAABB( primary, i * primaryStride, fixed, i, &( outSeparations[i] ), &( outHits[i] ) );
+		numHits += outHits[i] ? 1 : 0;
+	}
+
+	return numHits;
+}
+
+int collision_BatchCirclevCircle( const ColliderCircleBatch* primary, const ColliderCircleBatch* fixed, int count, Vector2* outSeparations, bool* outHits )
+{
+	assert( ( primary != NULL ) && ( fixed != NULL ) && ( outSeparations != NULL ) && ( outHits != NULL ) );
+	return batchCirclevCircle( primary, 1, fixed, count, outSeparations, outHits );
+}
+
+int collision_BatchAABBvAABB( const ColliderAABBBatch* primary, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits )
+{
+	assert( ( primary != NULL ) && ( fixed != NULL ) && ( outSeparations != NULL ) && ( outHits != NULL ) );
+	return batchAABBvAABB( primary, 1, fixed, count, outSeparations, outHits );
+}
+
+int collision_BatchCirclevAABB( const ColliderCircleBatch* primary, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits )
+{
+	assert( ( primary != NULL ) && ( fixed != NULL ) && ( outSeparations != NULL ) && ( outHits != NULL ) );
+	return batchCirclevAABB( primary, 1, fixed, count, outSeparations, outHits );
+}
+
+int collision_CirclevCircleBatch( const ColliderCircle* primary, const ColliderCircleBatch* fixed, int count, Vector2* outSeparations, bool* outHits )
+{
+	assert( ( primary != NULL ) && ( fixed != NULL ) && ( outSeparations != NULL ) && ( outHits != NULL ) );
+
+	ColliderCircleBatch single;
+	single.centerX = (float*)&( primary->center.x );
+	single.centerY = (float*)&( primary->center.y );
+	single.radius = (float*)&( primary->radius );
+	return batchCirclevCircle( &single, 0, fixed, count, outSeparations, outHits );
+}
+
+int collision_AABBvAABBBatch( const ColliderAABB* primary, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits )
+{
+	assert( ( primary != NULL ) && ( fixed != NULL ) && ( outSeparations != NULL ) && ( outHits != NULL ) );
+
+	ColliderAABBBatch single;
+	single.centerX = (float*)&( primary->center.x );
+	single.centerY = (float*)&( primary->center.y );
+	single.halfWidth = (float*)&( primary->halfDim.x );
+	single.halfHeight = (float*)&( primary->halfDim.y );
+	return batchAABBvAABB( &single, 0, fixed, count, outSeparations, outHits );
+}
+
+int collision_CirclevAABBBatch( const ColliderCircle* primary, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits )
+{
+	assert( ( primary != NULL ) && ( fixed != NULL ) && ( outSeparations != NULL ) && ( outHits != NULL ) );
+
+	ColliderCircleBatch single;
+	single.centerX = (float*)&( primary->center.x );
+	single.centerY = (float*)&( primary->center.y );
+	single.radius = (float*)&( primary->radius );
+	return batchCirclevAABB( &single, 0, fixed, count, outSeparations, outHits );
+}
+
 // just test to see if the mainCollider intersects any entries in the collection
 bool collision_Test( Collider* mainCollider, ColliderCollection collection )
 {
@@ -697,6 +975,298 @@ void collision_Detect( Collider* mainCollider, ColliderCollection collection, Co
 	}
 }
 
+// Broad Phase
+//  Sweep and prune along the x-axis using the bounding box of each collider, only pairs whose bounding boxes
+//  overlap are passed on to the collision checks. Half-spaces have no bounds so they're paired with everything.
+//  The candidate pairs are sorted before being tested so the responses are called in the same order as they
+//  would be if we tested every pair. If a response moves a collider it's tested again against everything so any
+//  new overlaps with pairs that haven't been reached yet are still found.
+
+// below this many possible pairs it's faster to just test all of them
+#define BROAD_PHASE_MIN_PAIRS 256
+
+typedef struct {
+	float minX, maxX;
+	float minY, maxY;
+	int idx;
+	int set;
+} BroadPhaseEntry;
+
+// scratch buffers for a single detection call, kept on the stack of the caller so detection can be run from multiple
+//  threads at once
+typedef struct {
+	BroadPhaseEntry* sbEntries;
+	int* sbUnbounded; // index into sbEntries
+	uint64_t* sbPairs;
+	BroadPhaseEntry* sbBounds; // bounds of every collider when last tested, the second set comes after the first
+	int secondSetStart; // where the second set starts in sbBounds
+} BroadPhase;
+
+#define PAIR_KEY( first, second ) ( ( (uint64_t)(first) << 32 ) | (uint64_t)(uint32_t)(second) )
+#define PAIR_FIRST( key ) ( (int)( (key) >> 32 ) )
+#define PAIR_SECOND( key ) ( (int)( (key) & 0xFFFFFFFF ) )
+
+// gets the bounding box of the collider, returns false if the collider is unbounded
+static bool colliderBounds( Collider* collider, BroadPhaseEntry* outEntry )
+{
+	switch( collider->type ) {
+	case CT_AABB:
+		outEntry->minX = collider->aabb.center.x - collider->aabb.halfDim.x;
+		outEntry->maxX = collider->aabb.center.x + collider->aabb.halfDim.x;
+		outEntry->minY = collider->aabb.center.y - collider->aabb.halfDim.y;
+		outEntry->maxY = collider->aabb.center.y + collider->aabb.halfDim.y;
+		return true;
+	case CT_CIRCLE:
+		outEntry->minX = collider->circle.center.x - collider->circle.radius;
+		outEntry->maxX = collider->circle.center.x + collider->circle.radius;
+		outEntry->minY = collider->circle.center.y - collider->circle.radius;
+		outEntry->maxY = collider->circle.center.y + collider->circle.radius;
+		return true;
+	case CT_LINE_SEGMENT: {
+		// the line segment checks use a tolerance, so grow the bounds a little bit to make sure we don't miss anything
+		float dx = fabsf( collider->lineSegment.posTwo.x - collider->lineSegment.posOne.x );
+		float dy = fabsf( collider->lineSegment.posTwo.y - collider->lineSegment.posOne.y );
+		float pad = FLOAT_TOLERANCE * ( 1.0f + MAX( dx, dy ) );
+		outEntry->minX = MIN( collider->lineSegment.posOne.x, collider->lineSegment.posTwo.x ) - pad;
+		outEntry->maxX = MAX( collider->lineSegment.posOne.x, collider->lineSegment.posTwo.x ) + pad;
+		outEntry->minY = MIN( collider->lineSegment.posOne.y, collider->lineSegment.posTwo.y ) - pad;
+		outEntry->maxY = MAX( collider->lineSegment.posOne.y, collider->lineSegment.posTwo.y ) + pad;
+	} return true;
+	default:
+		return false;
+	}
+}
+
+static int sortBroadPhaseEntries( const void* pLeft, const void* pRight )
+{
+	const BroadPhaseEntry* left = (const BroadPhaseEntry*)pLeft;
+	const BroadPhaseEntry* right = (const BroadPhaseEntry*)pRight;
+
+	if( left->minX < right->minX ) return -1;
+	if( left->minX > right->minX ) return 1;
+
+	// keep the sort stable so the result doesn't depend on the qsort implementation
+	if( left->set != right->set ) return ( left->set - right->set );
+	return ( left->idx - right->idx );
+}
+
+static int sortCandidatePairs( const void* pLeft, const void* pRight )
+{
+	uint64_t left = *(const uint64_t*)pLeft;
+	uint64_t right = *(const uint64_t*)pRight;
+
+	if( left < right ) return -1;
+	if( left > right ) return 1;
+	return 0;
+}
+
+static void releaseBroadPhase( BroadPhase* broadPhase )
+{
+	sb_Release( broadPhase->sbEntries );
+	sb_Release( broadPhase->sbUnbounded );
+	sb_Release( broadPhase->sbPairs );
+	sb_Release( broadPhase->sbBounds );
+}
+
+// adds all the active colliders in the collection to the broad phase entries
+static void gatherBroadPhaseEntries( BroadPhase* broadPhase, ColliderCollection collection, int set )
+{
+	sb_Reserve( broadPhase->sbEntries, sb_Count( broadPhase->sbEntries ) + collection.count );
+	sb_Reserve( broadPhase->sbBounds, sb_Count( broadPhase->sbBounds ) + collection.count );
+	if( set == 1 ) {
+		broadPhase->secondSetStart = (int)sb_Count( broadPhase->sbBounds );
+	}
+
+	char* data = (char*)collection.firstCollider;
+	for( int i = 0; i < collection.count; ++i ) {
+		Collider* current = (Collider*)( data + ( i * collection.stride ) );
+
+		BroadPhaseEntry entry;
+		entry.idx = i;
+		entry.set = set;
+		if( current->type == CT_DEACTIVATED ) {
+			// empty bounds, so if it's turned on by a response it counts as having moved
+			entry.minX = entry.minY = FLT_MAX;
+			entry.maxX = entry.maxY = -FLT_MAX;
+			sb_Push( broadPhase->sbBounds, entry );
+			continue;
+		}
+
+		if( colliderBounds( current, &entry ) ) {
+			sb_Push( broadPhase->sbEntries, entry );
+		} else {
+			// unbounded entries are never swept, they get tested against everything
+			entry.minX = entry.minY = -FLT_MAX;
+			entry.maxX = entry.maxY = FLT_MAX;
+			sb_Push( broadPhase->sbEntries, entry );
+			sb_Push( broadPhase->sbUnbounded, (int)( sb_Count( broadPhase->sbEntries ) - 1 ) );
+		}
+		sb_Push( broadPhase->sbBounds, entry );
+	}
+}
+
+static void addCandidatePair( BroadPhase* broadPhase, BroadPhaseEntry* a, BroadPhaseEntry* b, bool separateSets )
+{
+	if( separateSets ) {
+		if( a->set == b->set ) return;
+		if( a->set == 0 ) {
+			sb_Push( broadPhase->sbPairs, PAIR_KEY( a->idx, b->idx ) );
+		} else {
+			sb_Push( broadPhase->sbPairs, PAIR_KEY( b->idx, a->idx ) );
+		}
+	} else {
+		if( a->idx < b->idx ) {
+			sb_Push( broadPhase->sbPairs, PAIR_KEY( a->idx, b->idx ) );
+		} else {
+			sb_Push( broadPhase->sbPairs, PAIR_KEY( b->idx, a->idx ) );
+		}
+	}
+}
+
+// fills sbPairs with all the pairs of entries whose bounds overlap, sorted
+//  if separateSets is true then only pairs with one entry from each set are generated, with the set 0 index first
+static void findCandidatePairs( BroadPhase* broadPhase, bool separateSets )
+{
+	BroadPhaseEntry* entries = broadPhase->sbEntries;
+	sb_Clear( broadPhase->sbPairs );
+
+	size_t count = sb_Count( entries );
+
+	// pair the unbounded entries with everything, done before sorting since the indices into the entries will change
+	for( size_t u = 0; u < sb_Count( broadPhase->sbUnbounded ); ++u ) {
+		int unboundedIdx = broadPhase->sbUnbounded[u];
+		BroadPhaseEntry* unbounded = &( entries[unboundedIdx] );
+		for( size_t i = 0; i < count; ++i ) {
+			if( (int)i == unboundedIdx ) continue;
+
+			// if both are unbounded only add the pair once
+			if( ( entries[i].minX == -FLT_MAX ) && ( (int)i < unboundedIdx ) ) continue;
+
+			addCandidatePair( broadPhase, unbounded, &( entries[i] ), separateSets );
+		}
+	}
+
+	qsort( entries, count, sizeof( entries[0] ), sortBroadPhaseEntries );
+
+	for( size_t i = 0; i < count; ++i ) {
+		BroadPhaseEntry* first = &( entries[i] );
+		if( first->minX == -FLT_MAX ) continue;
+
+		for( size_t j = i + 1; ( j < count ) && ( entries[j].minX <= first->maxX ); ++j ) {
+			BroadPhaseEntry* second = &( entries[j] );
+			if( ( second->minY > first->maxY ) || ( second->maxY < first->minY ) ) {
+				continue;
+			}
+
+			addCandidatePair( broadPhase, first, second, separateSets );
+		}
+	}
+
+	qsort( broadPhase->sbPairs, sb_Count( broadPhase->sbPairs ), sizeof( broadPhase->sbPairs[0] ), sortCandidatePairs );
+}
+
+static Collider* collectionCollider( ColliderCollection* collection, int idx )
+{
+	return (Collider*)( ( (char*)collection->firstCollider ) + ( idx * collection->stride ) );
+}
+
+// adds the pair to the candidates still to be tested if it isn't already there, the candidates are sorted so use a binary search
+static void insertCandidatePair( BroadPhase* broadPhase, size_t firstUntested, uint64_t key )
+{
+	size_t low = firstUntested;
+	size_t high = sb_Count( broadPhase->sbPairs );
+	while( low < high ) {
+		size_t mid = low + ( ( high - low ) / 2 );
+		if( broadPhase->sbPairs[mid] < key ) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	if( ( low < sb_Count( broadPhase->sbPairs ) ) && ( broadPhase->sbPairs[low] == key ) ) {
+		return;
+	}
+	sb_Insert( broadPhase->sbPairs, low, key );
+}
+
+// if the response moved the collider then the candidate pairs found before may be missing some, so test it against
+//  everything it can be paired with and add any overlapping pairs that haven't been reached yet. this matches what
+//  testing every pair would do, a pair that's already been passed isn't tested again
+static void retestIfMoved( BroadPhase* broadPhase, ColliderCollection* collections, bool separateSets, int set, int idx, size_t currPair )
+{
+	Collider* collider = collectionCollider( &( collections[set] ), idx );
+	BroadPhaseEntry bounds;
+	if( ( collider->type == CT_DEACTIVATED ) || !colliderBounds( collider, &bounds ) ) {
+		// unbounded colliders are already paired with everything
+		return;
+	}
+
+	BroadPhaseEntry* lastBounds = &( broadPhase->sbBounds[( set == 0 ) ? idx : ( broadPhase->secondSetStart + idx )] );
+	if( ( bounds.minX == lastBounds->minX ) && ( bounds.maxX == lastBounds->maxX ) &&
+		( bounds.minY == lastBounds->minY ) && ( bounds.maxY == lastBounds->maxY ) ) {
+		return;
+	}
+	lastBounds->minX = bounds.minX;
+	lastBounds->maxX = bounds.maxX;
+	lastBounds->minY = bounds.minY;
+	lastBounds->maxY = bounds.maxY;
+
+	uint64_t currKey = broadPhase->sbPairs[currPair];
+	int otherSet = separateSets ? ( 1 - set ) : set;
+	ColliderCollection* other = &( collections[otherSet] );
+	for( int i = 0; i < other->count; ++i ) {
+		if( !separateSets && ( i == idx ) ) continue;
+
+		Collider* otherCollider = collectionCollider( other, i );
+		if( otherCollider->type == CT_DEACTIVATED ) continue;
+
+		BroadPhaseEntry otherBounds;
+		if( colliderBounds( otherCollider, &otherBounds ) &&
+			( ( otherBounds.minX > bounds.maxX ) || ( otherBounds.maxX < bounds.minX ) ||
+			  ( otherBounds.minY > bounds.maxY ) || ( otherBounds.maxY < bounds.minY ) ) ) {
+			continue;
+		}
+
+		uint64_t key;
+		if( separateSets ) {
+			key = ( set == 0 ) ? PAIR_KEY( idx, i ) : PAIR_KEY( i, idx );
+		} else {
+			key = ( idx < i ) ? PAIR_KEY( idx, i ) : PAIR_KEY( i, idx );
+		}
+
+		if( key > currKey ) {
+			insertCandidatePair( broadPhase, currPair + 1, key );
+		}
+	}
+}
+
+// tests all the candidate pairs in order, calling the response for any that overlap
+static void detectCandidatePairs( BroadPhase* broadPhase, ColliderCollection first, ColliderCollection second, bool separateSets, CollisionResponse response )
+{
+	ColliderCollection collections[2] = { first, second };
+	Vector2 separation = VEC2_ZERO;
+
+	for( size_t p = 0; p < sb_Count( broadPhase->sbPairs ); ++p ) {
+		int i = PAIR_FIRST( broadPhase->sbPairs[p] );
+		int j = PAIR_SECOND( broadPhase->sbPairs[p] );
+		Collider* firstCurrent = collectionCollider( &first, i );
+		Collider* secondCurrent = collectionCollider( &second, j );
+
+		// an earlier response may have turned one of them off
+		if( ( firstCurrent->type == CT_DEACTIVATED ) || ( secondCurrent->type == CT_DEACTIVATED ) ) {
+			continue;
+		}
+
+		if( collisionChecks[firstCurrent->type][secondCurrent->type]( firstCurrent, secondCurrent, &separation ) ) {
+			response( i, j, separation );
+
+			retestIfMoved( broadPhase, collections, separateSets, 0, i, p );
+			retestIfMoved( broadPhase, collections, separateSets, separateSets ? 1 : 0, j, p );
+		}
+	}
+}
+
 void collision_DetectAll( ColliderCollection firstCollection, ColliderCollection secondCollection, CollisionResponse response )
 {
 	Vector2 separation = VEC2_ZERO;
@@ -710,6 +1280,16 @@ void collision_DetectAll( ColliderCollection firstCollection, ColliderCollection
 		return;
 	}
 
+	if( ( firstCollection.count * secondCollection.count ) >= BROAD_PHASE_MIN_PAIRS ) {
+		BroadPhase broadPhase = { 0 };
+		gatherBroadPhaseEntries( &broadPhase, firstCollection, 0 );
+		gatherBroadPhaseEntries( &broadPhase, secondCollection, 1 );
+		findCandidatePairs( &broadPhase, true );
+		detectCandidatePairs( &broadPhase, firstCollection, secondCollection, true, response );
+		releaseBroadPhase( &broadPhase );
+		return;
+	}
+
 	for( int i = 0; i < firstCollection.count; ++i ) {
 		firstCurrent = (Collider*)( firstData + ( i * firstCollection.stride ) );
 		if( ( firstCurrent == NULL ) || ( firstCurrent->type == CT_DEACTIVATED ) ) {
@@ -742,6 +1322,15 @@ void collision_DetectAllInternal( ColliderCollection collection, CollisionRespon
 		return;
 	}
 
+	if( ( ( collection.count * ( collection.count - 1 ) ) / 2 ) >= BROAD_PHASE_MIN_PAIRS ) {
+		BroadPhase broadPhase = { 0 };
+		gatherBroadPhaseEntries( &broadPhase, collection, 0 );
+		findCandidatePairs( &broadPhase, false );
+		detectCandidatePairs( &broadPhase, collection, collection, false, response );
+		releaseBroadPhase( &broadPhase );
+		return;
+	}
+
 	for( int i = 0; i < collection.count; ++i ) {
 		firstCurrent = (Collider*)( data + ( i * collection.stride ) );
 		if( ( firstCurrent == NULL ) || ( firstCurrent->type == CT_DEACTIVATED ) ) {
@@ -761,6 +1350,101 @@ void collision_DetectAllInternal( ColliderCollection collection, CollisionRespon
 	}
 }
 
+// Parallel Detection
+//  The broad phase is done on the calling thread, then the candidate pairs are split into batches that are tested
+//  on the job threads. Each batch writes only to its own range of the contact buffers so no locking is needed. Once
+//  every batch is done the responses are called on the calling thread in sorted pair order, which is the same order
+//  collision_DetectAll would use. Small collections go through the same steps, jq_ParallelFor just runs them all on
+//  the calling thread, so the results never depend on how many colliders there are.
+
+// how many pairs each job should test at the least, below this the overhead of the job isn't worth it
+#define PARALLEL_BATCH_PAIRS 256
+
+typedef struct {
+	ColliderCollection first;
+	ColliderCollection second;
+	uint64_t* pairs;
+	Vector2* separations;
+	bool* hits;
+} ParallelDetectData;
+
+static void parallelNarrowPhase( void* data, int start, int end )
+{
+	ParallelDetectData* detectData = (ParallelDetectData*)data;
+	char* firstData = (char*)detectData->first.firstCollider;
+	char* secondData = (char*)detectData->second.firstCollider;
+
+	for( int p = start; p < end; ++p ) {
+		int i = PAIR_FIRST( detectData->pairs[p] );
+		int j = PAIR_SECOND( detectData->pairs[p] );
+		Collider* firstCurrent = (Collider*)( firstData + ( i * detectData->first.stride ) );
+		Collider* secondCurrent = (Collider*)( secondData + ( j * detectData->second.stride ) );
+
+		detectData->hits[p] = collisionChecks[firstCurrent->type][secondCurrent->type]( firstCurrent, secondCurrent, &( detectData->separations[p] ) ) != 0;
+	}
+}
+
+static void parallelDetectCandidatePairs( BroadPhase* broadPhase, ColliderCollection first, ColliderCollection second, CollisionResponse response )
+{
+	int numPairs = (int)sb_Count( broadPhase->sbPairs );
+	if( numPairs <= 0 ) {
+		return;
+	}
+
+	ParallelDetectData data;
+	data.first = first;
+	data.second = second;
+	data.pairs = broadPhase->sbPairs;
+	data.separations = mem_Allocate( sizeof( Vector2 ) * numPairs );
+	data.hits = mem_Allocate( sizeof( bool ) * numPairs );
+	if( ( data.separations == NULL ) || ( data.hits == NULL ) ) {
+		llog( LOG_ERROR, "Unable to allocate contacts for parallel collision detection." );
+		mem_Release( data.separations );
+		mem_Release( data.hits );
+		return;
+	}
+
+	jq_ParallelFor( parallelNarrowPhase, &data, numPairs, PARALLEL_BATCH_PAIRS );
+
+	for( int p = 0; p < numPairs; ++p ) {
+		if( data.hits[p] ) {
+			response( PAIR_FIRST( data.pairs[p] ), PAIR_SECOND( data.pairs[p] ), data.separations[p] );
+		}
+	}
+
+	mem_Release( data.separations );
+	mem_Release( data.hits );
+}
+
+void collision_DetectAllParallel( ColliderCollection firstCollection, ColliderCollection secondCollection, CollisionResponse response )
+{
+	if( ( firstCollection.firstCollider == NULL ) || ( secondCollection.firstCollider == NULL ) || ( response == NULL ) ) {
+		return;
+	}
+
+	BroadPhase broadPhase = { 0 };
+	gatherBroadPhaseEntries( &broadPhase, firstCollection, 0 );
+	gatherBroadPhaseEntries( &broadPhase, secondCollection, 1 );
+	findCandidatePairs( &broadPhase, true );
+
+	parallelDetectCandidatePairs( &broadPhase, firstCollection, secondCollection, response );
+	releaseBroadPhase( &broadPhase );
+}
+
+void collision_DetectAllInternalParallel( ColliderCollection collection, CollisionResponse response )
+{
+	if( ( collection.firstCollider == NULL ) || ( response == NULL ) ) {
+		return;
+	}
+
+	BroadPhase broadPhase = { 0 };
+	gatherBroadPhaseEntries( &broadPhase, collection, 0 );
+	findCandidatePairs( &broadPhase, false );
+
+	parallelDetectCandidatePairs( &broadPhase, collection, collection, response );
+	releaseBroadPhase( &broadPhase );
+}
+
 /*
 Finds if the specified line segment hits anything in the list. Returns 1 if it did, 0 otherwise. Puts the
  collision point into out, if out is NULL it'll exit once it detects any collision instead of finding the first.
@@ -833,6 +1517,9 @@ float collision_Distance( Collider* collider, Vector2* pos )
 
 		dist = sqrtf( dist );
 	} break;
+	case CT_LINE_SEGMENT: {
+		dist = sqrtf( sqDistPointSegment( &( collider->lineSegment.posOne ), &( collider->lineSegment.posTwo ), pos ) );
+	} break;
 	case CT_DEACTIVATED: {
 		dist = -1.0f;
 	} break;
@@ -925,4 +1612,569 @@ bool collision_IsPointInsideComplexPolygon( Vector2* pos, Vector2* polygon, size
 	}
 
 	return oddNodes;
-}
\ No newline at end of file
+}
+// Bounding Volume Hierarchy
+//  Binary tree of bounding boxes built by splitting the colliders at the median of their centers along the longest
+//  axis. Children are always stored after their parent so the tree can be refit by walking the nodes backwards.
+
+#define BVH_MAX_LEAF_SIZE 4
+#define BVH_MAX_DEPTH 64
+
+static void emptyBounds( BroadPhaseEntry* bounds )
+{
+	bounds->minX = bounds->minY = FLT_MAX;
+	bounds->maxX = bounds->maxY = -FLT_MAX;
+}
+
+static void mergeBounds( BroadPhaseEntry* bounds, float minX, float minY, float maxX, float maxY )
+{
+	bounds->minX = MIN( bounds->minX, minX );
+	bounds->minY = MIN( bounds->minY, minY );
+	bounds->maxX = MAX( bounds->maxX, maxX );
+	bounds->maxY = MAX( bounds->maxY, maxY );
+}
+
+static Collider* bvhCollider( ColliderBVH* bvh, int idx )
+{
+	return (Collider*)( ( (char*)bvh->collection.firstCollider ) + ( idx * bvh->collection.stride ) );
+}
+
+// deactivated colliders get empty bounds so they'll never be hit, but will be if they're turned back on and the tree is refit
+static void bvhColliderBounds( ColliderBVH* bvh, int idx, BroadPhaseEntry* outBounds )
+{
+	if( !colliderBounds( bvhCollider( bvh, idx ), outBounds ) ) {
+		emptyBounds( outBounds );
+	}
+}
+
+static float bvhCentroid( ColliderBVH* bvh, int idx, int axis )
+{
+	BroadPhaseEntry bounds;
+	bvhColliderBounds( bvh, idx, &bounds );
+	if( bounds.minX > bounds.maxX ) {
+		return 0.0f;
+	}
+	return ( axis == 0 ) ? ( ( bounds.minX + bounds.maxX ) * 0.5f ) : ( ( bounds.minY + bounds.maxY ) * 0.5f );
+}
+
+// partially sorts the indices so the one at mid is where it would be if fully sorted along the axis
+static void bvhSelectMedian( ColliderBVH* bvh, int start, int end, int mid, int axis )
+{
+	int* indices = bvh->sbIndices;
+	while( end > start ) {
+		float pivot = bvhCentroid( bvh, indices[( start + end ) / 2], axis );
+		int i = start;
+		int j = end;
+		while( i <= j ) {
+			while( bvhCentroid( bvh, indices[i], axis ) < pivot ) ++i;
+			while( bvhCentroid( bvh, indices[j], axis ) > pivot ) --j;
+			if( i <= j ) {
+				int swap = indices[i];
+				indices[i] = indices[j];
+				indices[j] = swap;
+				++i;
+				--j;
+			}
+		}
+
+		if( mid <= j ) {
+			end = j;
+		} else if( mid >= i ) {
+			start = i;
+		} else {
+			break;
+		}
+	}
+}
+
+static void bvhBuildNode( ColliderBVH* bvh, int nodeIdx, int first, int count )
+{
+	BroadPhaseEntry bounds;
+	BroadPhaseEntry centers;
+	emptyBounds( &bounds );
+	emptyBounds( &centers );
+	for( int i = first; i < ( first + count ); ++i ) {
+		BroadPhaseEntry colliderBox;
+		bvhColliderBounds( bvh, bvh->sbIndices[i], &colliderBox );
+		mergeBounds( &bounds, colliderBox.minX, colliderBox.minY, colliderBox.maxX, colliderBox.maxY );
+
+		float cx = bvhCentroid( bvh, bvh->sbIndices[i], 0 );
+		float cy = bvhCentroid( bvh, bvh->sbIndices[i], 1 );
+		mergeBounds( &centers, cx, cy, cx, cy );
+	}
+
+	BVHNode* node = &( bvh->sbNodes[nodeIdx] );
+	node->minX = bounds.minX;
+	node->minY = bounds.minY;
+	node->maxX = bounds.maxX;
+	node->maxY = bounds.maxY;
+
+	if( count <= BVH_MAX_LEAF_SIZE ) {
+		node->firstChild = -1;
+		node->firstIndex = first;
+		node->count = count;
+		return;
+	}
+
+	int axis = ( ( centers.maxX - centers.minX ) >= ( centers.maxY - centers.minY ) ) ? 0 : 1;
+	int half = count / 2;
+	bvhSelectMedian( bvh, first, first + count - 1, first + half, axis );
+
+	// adding can move the nodes so don't use node after this
+	int childIdx = (int)sb_Count( bvh->sbNodes );
+	sb_Add( bvh->sbNodes, 2 );
+	bvh->sbNodes[nodeIdx].firstChild = childIdx;
+	bvh->sbNodes[nodeIdx].firstIndex = first;
+	bvh->sbNodes[nodeIdx].count = count;
+
+	bvhBuildNode( bvh, childIdx, first, half );
+	bvhBuildNode( bvh, childIdx + 1, first + half, count - half );
+}
+
+/*
+Builds the hierarchy for all the colliders in the collection. The collection has to stay valid while the hierarchy is in use.
+ If colliders are moved or resized call collision_BVHRefit, if any change type or the collection changes size it has to be rebuilt.
+ Returns 0 on success.
+*/
+int collision_BVHBuild( ColliderBVH* bvh, ColliderCollection collection )
+{
+	assert( bvh != NULL );
+
+	bvh->collection = collection;
+	sb_Clear( bvh->sbNodes );
+	sb_Clear( bvh->sbIndices );
+	sb_Clear( bvh->sbUnbounded );
+
+	for( int i = 0; i < collection.count; ++i ) {
+		BroadPhaseEntry ignore;
+		Collider* current = bvhCollider( bvh, i );
+		if( ( current->type == CT_DEACTIVATED ) || colliderBounds( current, &ignore ) ) {
+			sb_Push( bvh->sbIndices, i );
+		} else {
+			sb_Push( bvh->sbUnbounded, i );
+		}
+	}
+
+	if( sb_Count( bvh->sbIndices ) == 0 ) {
+		return 0;
+	}
+
+	sb_Add( bvh->sbNodes, 1 );
+	if( bvh->sbNodes == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate nodes for collision hierarchy." );
+		return -1;
+	}
+
+	bvhBuildNode( bvh, 0, 0, (int)sb_Count( bvh->sbIndices ) );
+	return 0;
+}
+
+// Updates the bounds of every node after the colliders have moved, much quicker than rebuilding but the tree quality will degrade
+void collision_BVHRefit( ColliderBVH* bvh )
+{
+	assert( bvh != NULL );
+
+	// children are always after their parents, so going backwards means the children are done before the parents
+	for( int n = (int)sb_Count( bvh->sbNodes ) - 1; n >= 0; --n ) {
+		BVHNode* node = &( bvh->sbNodes[n] );
+		BroadPhaseEntry bounds;
+		emptyBounds( &bounds );
+
+		if( node->firstChild < 0 ) {
+			for( int i = node->firstIndex; i < ( node->firstIndex + node->count ); ++i ) {
+				BroadPhaseEntry colliderBox;
+				bvhColliderBounds( bvh, bvh->sbIndices[i], &colliderBox );
+				mergeBounds( &bounds, colliderBox.minX, colliderBox.minY, colliderBox.maxX, colliderBox.maxY );
+			}
+		} else {
+			for( int c = node->firstChild; c < ( node->firstChild + 2 ); ++c ) {
+				BVHNode* child = &( bvh->sbNodes[c] );
+				mergeBounds( &bounds, child->minX, child->minY, child->maxX, child->maxY );
+			}
+		}
+
+		node->minX = bounds.minX;
+		node->minY = bounds.minY;
+		node->maxX = bounds.maxX;
+		node->maxY = bounds.maxY;
+	}
+}
+
+void collision_BVHDestroy( ColliderBVH* bvh )
+{
+	assert( bvh != NULL );
+
+	sb_Release( bvh->sbNodes );
+	sb_Release( bvh->sbIndices );
+	sb_Release( bvh->sbUnbounded );
+	bvh->collection.firstCollider = NULL;
+	bvh->collection.count = 0;
+}
+
+// returns if the segment from start to start+dir hits the node, tMax is how far along we care about
+static bool rayHitsNode( BVHNode* node, Vector2* start, Vector2* dir, float tMax )
+{
+	if( node->minX > node->maxX ) {
+		return false;
+	}
+
+	float tMin = 0.0f;
+	if( !RayCastvAABBAxis( start->x, dir->x, node->minX, node->maxX, &tMin, &tMax ) ) {
+		return false;
+	}
+
+	return RayCastvAABBAxis( start->y, dir->y, node->minY, node->maxY, &tMin, &tMax ) != 0;
+}
+
+/*
+Same as collision_RayCast but only visits the colliders whose bounds the line segment passes through.
+ Returns the index of the collider that was hit first, or -1 if nothing was hit. Puts the collision point into
+ outPos if it isn't NULL. If stopAtFirst is true it'll return as soon as anything is hit instead of finding the closest.
+*/
+int collision_BVHRayCast( ColliderBVH* bvh, Vector2 start, Vector2 end, bool stopAtFirst, Vector2* outPos )
+{
+	assert( bvh != NULL );
+
+	Vector2 dir;
+	Vector2 collPt;
+	float t;
+	float closestT = 1.0f;
+	int closestIdx = -1;
+
+	vec2_Subtract( &end, &start, &dir );
+
+	for( size_t u = 0; u < sb_Count( bvh->sbUnbounded ); ++u ) {
+		Collider* current = bvhCollider( bvh, bvh->sbUnbounded[u] );
+		if( ( current->type != CT_DEACTIVATED ) && rayCastChecks[current->type]( &start, &dir, current, &t, &collPt ) && ( t <= closestT ) ) {
+			closestT = t;
+			closestIdx = bvh->sbUnbounded[u];
+			if( outPos != NULL ) ( *outPos ) = collPt;
+			if( stopAtFirst ) return closestIdx;
+		}
+	}
+
+	if( sb_Count( bvh->sbNodes ) == 0 ) {
+		return closestIdx;
+	}
+
+	int stack[BVH_MAX_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while( stackSize > 0 ) {
+		BVHNode* node = &( bvh->sbNodes[stack[--stackSize]] );
+
+		// as we find closer hits we can ignore more of the tree
+		if( !rayHitsNode( node, &start, &dir, closestT ) ) {
+			continue;
+		}
+
+		if( node->firstChild >= 0 ) {
+			stack[stackSize++] = node->firstChild + 1;
+			stack[stackSize++] = node->firstChild;
+			continue;
+		}
+
+		for( int i = node->firstIndex; i < ( node->firstIndex + node->count ); ++i ) {
+			int idx = bvh->sbIndices[i];
+			Collider* current = bvhCollider( bvh, idx );
+			if( current->type == CT_DEACTIVATED ) {
+				continue;
+			}
+
+			if( rayCastChecks[current->type]( &start, &dir, current, &t, &collPt ) && ( t <= closestT ) ) {
+				closestT = t;
+				closestIdx = idx;
+				if( outPos != NULL ) ( *outPos ) = collPt;
+				if( stopAtFirst ) return closestIdx;
+			}
+		}
+	}
+
+	return closestIdx;
+}
+
+/*
+Finds all the colliders that overlap the box defined by min and max and pushes their indices onto the stretchy buffer sbOutIndices.
+ Returns the number of indices added.
+*/
+int collision_BVHQueryAABB( ColliderBVH* bvh, Vector2 min, Vector2 max, int** sbOutIndices )
+{
+	assert( bvh != NULL );
+	assert( sbOutIndices != NULL );
+
+	Collider box;
+	box.aabb.type = CT_AABB;
+	vec2_Lerp( &min, &max, 0.5f, &( box.aabb.center ) );
+	vec2_Subtract( &max, &( box.aabb.center ), &( box.aabb.halfDim ) );
+
+	int numFound = 0;
+	Vector2 ignore;
+	for( size_t u = 0; u < sb_Count( bvh->sbUnbounded ); ++u ) {
+		Collider* current = bvhCollider( bvh, bvh->sbUnbounded[u] );
+		if( ( current->type != CT_DEACTIVATED ) && collisionChecks[CT_AABB][current->type]( &box, current, &ignore ) ) {
+			sb_Push( (*sbOutIndices), bvh->sbUnbounded[u] );
+			++numFound;
+		}
+	}
+
+	if( sb_Count( bvh->sbNodes ) == 0 ) {
+		return numFound;
+	}
+
+	int stack[BVH_MAX_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while( stackSize > 0 ) {
+		BVHNode* node = &( bvh->sbNodes[stack[--stackSize]] );
+
+		if( ( node->minX > max.x ) || ( node->maxX < min.x ) || ( node->minY > max.y ) || ( node->maxY < min.y ) ) {
+			continue;
+		}
+
+		if( node->firstChild >= 0 ) {
+			stack[stackSize++] = node->firstChild + 1;
+			stack[stackSize++] = node->firstChild;
+			continue;
+		}
+
+		for( int i = node->firstIndex; i < ( node->firstIndex + node->count ); ++i ) {
+			int idx = bvh->sbIndices[i];
+			Collider* current = bvhCollider( bvh, idx );
+			if( ( current->type != CT_DEACTIVATED ) && collisionChecks[CT_AABB][current->type]( &box, current, &ignore ) ) {
+				sb_Push( (*sbOutIndices), idx );
+				++numFound;
+			}
+		}
+	}
+
+	return numFound;
+}
+
+static bool isPointInsideCollider( Collider* collider, Vector2* pos )
+{
+	switch( collider->type ) {
+	case CT_AABB:
+		return ( fabsf( pos->x - collider->aabb.center.x ) <= collider->aabb.halfDim.x ) &&
+			( fabsf( pos->y - collider->aabb.center.y ) <= collider->aabb.halfDim.y );
+	case CT_CIRCLE:
+		return vec2_DistSqrd( pos, &( collider->circle.center ) ) <= ( collider->circle.radius * collider->circle.radius );
+	case CT_HALF_SPACE:
+		return ( vec2_DotProduct( pos, &( collider->halfSpace.normal ) ) - collider->halfSpace.d ) <= 0.0f;
+	default:
+		// line segments have no area
+		return false;
+	}
+}
+
+/*
+Finds all the colliders that contain pos and pushes their indices onto the stretchy buffer sbOutIndices.
+ Returns the number of indices added.
+*/
+int collision_BVHQueryPoint( ColliderBVH* bvh, Vector2 pos, int** sbOutIndices )
+{
+	assert( bvh != NULL );
+	assert( sbOutIndices != NULL );
+
+	int numFound = 0;
+	for( size_t u = 0; u < sb_Count( bvh->sbUnbounded ); ++u ) {
+		if( isPointInsideCollider( bvhCollider( bvh, bvh->sbUnbounded[u] ), &pos ) ) {
+			sb_Push( (*sbOutIndices), bvh->sbUnbounded[u] );
+			++numFound;
+		}
+	}
+
+	if( sb_Count( bvh->sbNodes ) == 0 ) {
+		return numFound;
+	}
+
+	int stack[BVH_MAX_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while( stackSize > 0 ) {
+		BVHNode* node = &( bvh->sbNodes[stack[--stackSize]] );
+
+		if( ( pos.x < node->minX ) || ( pos.x > node->maxX ) || ( pos.y < node->minY ) || ( pos.y > node->maxY ) ) {
+			continue;
+		}
+
+		if( node->firstChild >= 0 ) {
+			stack[stackSize++] = node->firstChild + 1;
+			stack[stackSize++] = node->firstChild;
+			continue;
+		}
+
+		for( int i = node->firstIndex; i < ( node->firstIndex + node->count ); ++i ) {
+			int idx = bvh->sbIndices[i];
+			if( isPointInsideCollider( bvhCollider( bvh, idx ), &pos ) ) {
+				sb_Push( (*sbOutIndices), idx );
+				++numFound;
+			}
+		}
+	}
+
+	return numFound;
+}
+
+/*
+Finds the collider closest to pos using collision_Distance, anything further away than maxDist is ignored.
+ Only circles, AABBs, and line segments are tested since they're the only ones collision_Distance supports.
+ Returns the index of the closest collider, or -1 if there are none within maxDist. Puts the distance into outDist if it isn't NULL.
+*/
+int collision_BVHClosest( ColliderBVH* bvh, Vector2 pos, float maxDist, float* outDist )
+{
+	assert( bvh != NULL );
+
+	float closestDist = maxDist;
+	int closestIdx = -1;
+
+	if( sb_Count( bvh->sbNodes ) == 0 ) {
+		return -1;
+	}
+
+	int stack[BVH_MAX_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while( stackSize > 0 ) {
+		BVHNode* node = &( bvh->sbNodes[stack[--stackSize]] );
+		if( node->minX > node->maxX ) {
+			continue;
+		}
+
+		// early out if the box can't have anything closer than what we've already found
+		float dx = MAX( MAX( node->minX - pos.x, pos.x - node->maxX ), 0.0f );
+		float dy = MAX( MAX( node->minY - pos.y, pos.y - node->maxY ), 0.0f );
+		if( ( ( dx * dx ) + ( dy * dy ) ) > ( closestDist * closestDist ) ) {
+			continue;
+		}
+
+		if( node->firstChild >= 0 ) {
+			stack[stackSize++] = node->firstChild + 1;
+			stack[stackSize++] = node->firstChild;
+			continue;
+		}
+
+		for( int i = node->firstIndex; i < ( node->firstIndex + node->count ); ++i ) {
+			int idx = bvh->sbIndices[i];
+			Collider* current = bvhCollider( bvh, idx );
+			if( ( current->type != CT_CIRCLE ) && ( current->type != CT_AABB ) && ( current->type != CT_LINE_SEGMENT ) ) {
+				continue;
+			}
+
+			float dist = collision_Distance( current, &pos );
+			if( ( dist >= 0.0f ) && ( dist <= closestDist ) ) {
+				closestDist = dist;
+				closestIdx = idx;
+			}
+		}
+	}
+
+	if( ( closestIdx >= 0 ) && ( outDist != NULL ) ) {
+		(*outDist) = closestDist;
+	}
+
+	return closestIdx;
+}
+
+/*
+Same as collision_IsPointInsideComplexPolygon, but the polygon is defined by a hierarchy built from a collection of
+ line segment colliders, one per edge. Only the edges to the left of the point at it's height are tested.
+*/
+bool collision_BVHIsPointInsidePolygon( ColliderBVH* bvh, Vector2* pos )
+{
+	assert( bvh != NULL );
+	assert( pos != NULL );
+
+	bool oddNodes = false;
+
+	if( sb_Count( bvh->sbNodes ) == 0 ) {
+		return false;
+	}
+
+	int stack[BVH_MAX_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while( stackSize > 0 ) {
+		BVHNode* node = &( bvh->sbNodes[stack[--stackSize]] );
+
+		// we trace a ray along the positive x-axis, so anything entirely to the right or not at the same height can be skipped
+		if( ( pos->y < node->minY ) || ( pos->y > node->maxY ) || ( node->minX > pos->x ) ) {
+			continue;
+		}
+
+		if( node->firstChild >= 0 ) {
+			stack[stackSize++] = node->firstChild + 1;
+			stack[stackSize++] = node->firstChild;
+			continue;
+		}
+
+		for( int i = node->firstIndex; i < ( node->firstIndex + node->count ); ++i ) {
+			Collider* current = bvhCollider( bvh, bvh->sbIndices[i] );
+			if( current->type != CT_LINE_SEGMENT ) {
+				continue;
+			}
+
+			Vector2* pi = &( current->lineSegment.posOne );
+			Vector2* pj = &( current->lineSegment.posTwo );
+			if( ( ( ( pi->y < pos->y ) && ( pj->y >= pos->y ) ) ||
+				  ( ( pj->y < pos->y ) && ( pi->y >= pos->y ) ) ) &&
+				( ( pi->x <= pos->x ) || ( pj->x <= pos->x ) ) ) {
+
+				float t = ( pos->y - pi->y ) / ( pj->y - pi->y );
+				float x = pi->x + ( t * ( pj->x - pi->x ) );
+				oddNodes ^= ( x < pos->x );
+			}
+		}
+	}
+
+	return oddNodes;
+}
+
+/*
+Same as collision_PolygonDistance, but the polygon is defined by a hierarchy built from a collection of line segment
+ colliders, one per edge. Returns a negative number if there were any problems.
+*/
+float collision_BVHPolygonDistance( ColliderBVH* bvh, Vector2* pos )
+{
+	assert( bvh != NULL );
+	assert( pos != NULL );
+
+	float dist;
+	if( collision_BVHClosest( bvh, *pos, FLT_MAX, &dist ) < 0 ) {
+		return -1.0f;
+	}
+	return dist;
+}
+
+// Fills outEdges with a line segment collider for each edge of the polygon, outEdges must have room for numPts colliders.
+void collision_CreatePolygonEdges( Vector2* polygon, size_t numPts, Collider* outEdges )
+{
+	assert( polygon != NULL );
+	assert( outEdges != NULL );
+
+	size_t j = numPts - 1;
+	for( size_t i = 0; i < numPts; ++i ) {
+		outEdges[i].type = CT_LINE_SEGMENT;
+		outEdges[i].lineSegment.posOne = polygon[i];
+		outEdges[i].lineSegment.posTwo = polygon[j];
+		j = i;
+	}
+}
+
+float collision_PolygonDistance( Vector2* pos, Vector2* polygon, size_t numPts )
+{
+	assert( pos != NULL );
+	assert( polygon != NULL );
+
+	if( numPts < 2 ) {
+		return -1.0f;
+	}
+
+	float closestSqDist = FLT_MAX;
+	size_t j = numPts - 1;
+	for( size_t i = 0; i < numPts; ++i ) {
+		closestSqDist = MIN( closestSqDist, sqDistPointSegment( &( polygon[i] ), &( polygon[j] ), pos ) );
+		j = i;
+	}
+
+	return sqrtf( closestSqDist );
+}
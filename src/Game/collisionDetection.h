@@ -60,6 +60,20 @@ typedef struct {
 	int count;
 } ColliderCollection;
 
+// Structure of arrays versions of the circle and AABB colliders, used with the batched collision checks.
+typedef struct {
+	float* centerX;
+	float* centerY;
+	float* radius;
+} ColliderCircleBatch;
+
+typedef struct {
+	float* centerX;
+	float* centerY;
+	float* halfWidth;
+	float* halfHeight;
+} ColliderAABBBatch;
+
 typedef void(*CollisionResponse)( int firstColliderIdx, int secondColliderIdx, Vector2 separation );
 
 /*
@@ -69,6 +83,20 @@ Finds the separation needed for c1 to move and not overlap c2.
 */
 int collision_GetSeparation( Collider* c1, Collider* c2, Vector2* outSeparation );
 
+/*
+Batched collision checks, uses SIMD when available to test multiple pairs at once.
+ The collision_Batch* versions test primary[i] against fixed[i], the collision_*Batch versions test a single primary
+ collider against every fixed[i]. For every i in [0,count) the separation needed for the primary to stop overlapping
+ is put into outSeparations[i] and whether they overlapped into outHits[i]. The separation is zero if they don't overlap.
+ Returns the number of overlapping pairs. The results match what collision_GetSeparation would give for each pair.
+*/
+int collision_BatchCirclevCircle( const ColliderCircleBatch* primary, const ColliderCircleBatch* fixed, int count, Vector2* outSeparations, bool* outHits );
+int collision_BatchAABBvAABB( const ColliderAABBBatch* primary, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits );
+int collision_BatchCirclevAABB( const ColliderCircleBatch* primary, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits );
+int collision_CirclevCircleBatch( const ColliderCircle* primary, const ColliderCircleBatch* fixed, int count, Vector2* outSeparations, bool* outHits );
+int collision_AABBvAABBBatch( const ColliderAABB* primary, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits );
+int collision_CirclevAABBBatch( const ColliderCircle* primary, const ColliderAABBBatch* fixed, int count, Vector2* outSeparations, bool* outHits );
+
 // just test to see if the mainCollider intersects any entries in the collection
 bool collision_Test( Collider* mainCollider, ColliderCollection collection );
 
@@ -82,15 +110,32 @@ void collision_Detect( Collider* mainCollider, ColliderCollection collection, Co
 Finds all the collisions between every collider in firstCollectin and secondCollection.
  The indices passed to the response function match the collection, firstColliderIdx is the index in firstCollection
  and secondColliderIdx is the index in the secondCollection.
+ Larger collections use a sweep and prune broad phase, responses are still called in order of firstColliderIdx
+ and then secondColliderIdx. Responses can move the colliders, anything moved is checked again so it'll find the same
+ collisions as testing every pair in order would.
 */
 void collision_DetectAll( ColliderCollection firstCollection, ColliderCollection secondCollection, CollisionResponse response );
 
 /*
 Finds all the collision between every collider inside the collection.
- The indices passed to the response function match the collection.
+ The indices passed to the response function match the collection, with firstColliderIdx < secondColliderIdx.
+ Uses the same broad phase and response ordering as collision_DetectAll.
 */
 void collision_DetectAllInternal( ColliderCollection collection, CollisionResponse response );
 
+/*
+Parallel versions of collision_DetectAll and collision_DetectAllInternal. The collision checks are split up across
+ the job queue, the responses are all called from the calling thread after the checks are done, in the same order
+ as the serial versions. Every pair is tested against the positions the colliders had when this was called and only
+ then are the responses called, whatever the size of the collections, so unlike the serial versions a response that
+ moves or deactivates a collider won't change which responses are called until the next call. The colliders must not
+ be modified by anything else until these return.
+ All the working memory for these and the serial versions is per call, so they can be used from multiple threads at
+ once, including from inside jobs, as long as each call has its own collections.
+*/
+void collision_DetectAllParallel( ColliderCollection firstCollection, ColliderCollection secondCollection, CollisionResponse response );
+void collision_DetectAllInternalParallel( ColliderCollection collection, CollisionResponse response );
+
 /*
 Finds if the specified line segment hits anything in the list. Returns 1 if it did, 0 otherwise. Puts the
  collision point into out, if out is NULL it'll exit once it detects any collision instead of finding the first.
@@ -99,7 +144,9 @@ int collision_RayCast( Vector2 start, Vector2 end, ColliderCollection collection
 
 /*
 Finds the closest distance from the position to the collider, useful when you want the distance to object but not it's center.
- Returns a negative number if there were any problems.
+ Returns a negative number if there were any problems. Works with circles, AABBs, and line segments.
+ To find the closest of many colliders use collision_BVHClosest, for the closest edge of a polygon use collision_PolygonDistance
+ or collision_BVHPolygonDistance.
 */
 float collision_Distance( Collider* collider, Vector2* position );
 
@@ -123,6 +170,91 @@ bool collision_LineCollision( Vector2* l0p0, Vector2* l0p1, Vector2* l1p0, Vecto
 
 // Checks to see if the passed in point is inside the complex polygon defined by the list of points sbPolygon.
 //  sbPolygon must be a stretchy buffer.
+//  Tests every edge, for large polygons that are queried often use collision_BVHIsPointInsidePolygon.
 bool collision_IsPointInsideComplexPolygon( Vector2* pos, Vector2* polygon, size_t numPoints );
 
+/*
+Bounding volume hierarchy over a collider collection, used to speed up queries against large sets of colliders that
+ don't change much. Zero initialize before the first build.
+ Half-spaces have no bounds so they're kept separately and tested by every query.
+*/
+typedef struct {
+	float minX, minY;
+	float maxX, maxY;
+	int firstChild; // index of the first child node, the second is right after it, -1 if this is a leaf
+	int firstIndex; // where the colliders under this node start in sbIndices
+	int count;
+} BVHNode;
+
+typedef struct {
+	ColliderCollection collection;
+	BVHNode* sbNodes;
+	int* sbIndices; // indices into the collection, the colliders under each node are contiguous
+	int* sbUnbounded;
+} ColliderBVH;
+
+/*
+Builds the hierarchy for all the colliders in the collection. The collection has to stay valid while the hierarchy is in use.
+ If colliders are moved or resized call collision_BVHRefit, if any change type or the collection changes size it has to be rebuilt.
+ Returns 0 on success.
+*/
+int collision_BVHBuild( ColliderBVH* bvh, ColliderCollection collection );
+
+// Updates the bounds of every node after the colliders have moved, much quicker than rebuilding but the tree quality will degrade
+void collision_BVHRefit( ColliderBVH* bvh );
+
+void collision_BVHDestroy( ColliderBVH* bvh );
+
+/*
+Same as collision_RayCast but only visits the colliders whose bounds the line segment passes through.
+ Returns the index of the collider that was hit first, or -1 if nothing was hit. Puts the collision point into
+ outPos if it isn't NULL. If stopAtFirst is true it'll return as soon as anything is hit instead of finding the closest,
+ which is all that's needed for line of sight checks.
+*/
+int collision_BVHRayCast( ColliderBVH* bvh, Vector2 start, Vector2 end, bool stopAtFirst, Vector2* outPos );
+
+/*
+Finds all the colliders that overlap the box defined by min and max and pushes their indices onto the stretchy buffer sbOutIndices.
+ Returns the number of indices added.
+*/
+int collision_BVHQueryAABB( ColliderBVH* bvh, Vector2 min, Vector2 max, int** sbOutIndices );
+
+/*
+Finds all the colliders that contain pos and pushes their indices onto the stretchy buffer sbOutIndices.
+ Returns the number of indices added.
+*/
+int collision_BVHQueryPoint( ColliderBVH* bvh, Vector2 pos, int** sbOutIndices );
+
+/*
+Finds the collider closest to pos using collision_Distance, anything further away than maxDist is ignored.
+ Only circles, AABBs, and line segments are tested since they're the only ones collision_Distance supports.
+ Returns the index of the closest collider, or -1 if there are none within maxDist. Puts the distance into outDist if it isn't NULL.
+*/
+int collision_BVHClosest( ColliderBVH* bvh, Vector2 pos, float maxDist, float* outDist );
+
+/*
+Same as collision_IsPointInsideComplexPolygon, but the polygon is defined by a hierarchy built from a collection of
+ line segment colliders, one per edge.
+*/
+bool collision_BVHIsPointInsidePolygon( ColliderBVH* bvh, Vector2* pos );
+
+/*
+Same as collision_PolygonDistance, but the polygon is defined by a hierarchy built from a collection of line segment
+ colliders, one per edge. Returns a negative number if there were any problems.
+*/
+float collision_BVHPolygonDistance( ColliderBVH* bvh, Vector2* pos );
+
+/*
+Fills outEdges with a line segment collider for each edge of the polygon, outEdges must have room for numPoints colliders.
+ Build a hierarchy over them with collision_BVHBuild to use with collision_BVHIsPointInsidePolygon and
+ collision_BVHPolygonDistance. If the points change the edges have to be created again and the hierarchy refit.
+*/
+void collision_CreatePolygonEdges( Vector2* polygon, size_t numPoints, Collider* outEdges );
+
+/*
+Finds the distance from pos to the closest edge of the polygon by testing every edge.
+ Returns a negative number if there were any problems.
+*/
+float collision_PolygonDistance( Vector2* pos, Vector2* polygon, size_t numPoints );
+
 #endif
@@ -23,6 +23,7 @@
 #include "world.h"
 
 #include "UI/text.h"
+#include "UI/glyphCache.h"
 #include "Input/input.h"
 
 #include "System/gameTime.h"
@@ -39,6 +40,8 @@
 #include "Graphics/glPlatform.h"
 
 #include "System/jobQueue.h"
+#include "System/assetManager.h"
+#include "Utils/containerBenchmarks.h"
 
 #define DESIRED_WORLD_WIDTH 800
 #define DESIRED_WORLD_HEIGHT 600
@@ -84,8 +87,13 @@ int getWindowRefreshRate( SDL_Window* w )
 
 void cleanUp( void )
 {
+	asset_CleanUp( );
 	jq_ShutDown( );
 
+	// after the job queue has waited for its threads so no rasterizations are running, before the window so the page
+	//  textures can be unloaded
+	glyphCache_CleanUp( );
+
 	SDL_DestroyWindow( window );
 	window = NULL;
 
@@ -156,6 +164,13 @@ int unalignedAccess( void )
 #pragma warning( pop )
 }
 
+// leave a core for the main thread, it'll help process jobs when it's waiting on them
+static int startJobQueue( void )
+{
+	int numWorkers = SDL_GetCPUCount( ) - 1;
+	return jq_Initialize( (uint8_t)MAX( 1, MIN( numWorkers, 16 ) ) );
+}
+
 int initEverything( void )
 {
 #ifndef _DEBUG
@@ -180,6 +195,17 @@ int initEverything( void )
 	llog( LOG_INFO, "SDL successfully initialized." );
 	atexit( cleanUp );
 
+	// the job queue is started for the whole game here, before anything else is set up, anything that uses jobs (the
+	//  parallel collision detection, threaded asset loading, spine updates, font generation) relies on this. if it
+	//  fails to start the game won't run
+	if( startJobQueue( ) < 0 ) {
+		llog( LOG_ERROR, "Unable to initialize the job queue." );
+		return -1;
+	}
+	// spread out bursts of finished jobs instead of having them all hit one frame
+	jq_SetMainThreadJobBudget( 2000 );
+	llog( LOG_INFO, "Job queue successfully initialized." );
+
 	// set up opengl
 	//  try opening and parsing the config file
 	int majorVersion;
@@ -416,6 +442,8 @@ void mainLoop( void* v )
 	Uint64 mainJobsTimer = gt_StartTimer( );
 	// process all the jobs we need the main thread for, using this reduces the need for synchronization
 	jq_ProcessMainThreadJobs( );
+	// bind any assets that have finished loading, limited so they're spread out over multiple frames
+	asset_ProcessUploads( );
 	float mainJobsTimerSec = gt_StopTimer( mainJobsTimer );
 
 	Uint64 renderTimer = gt_StartTimer( );
@@ -443,6 +471,90 @@ void mainLoop( void* v )
 	//llog( priority, "%smain: %.4f", ( mainTimerSec >= 0.02f ) ? "!!! " : "", mainTimerSec );
 }
 
+// sets up what the benchmarks need, without a window or anything else the game uses
+//  returns < 0 if there was a problem
+static int initHeadless( void )
+{
+	mem_Init( 64 * 1024 * 1024 );
+
+	SDL_SetMainReady( );
+	if( SDL_Init( SDL_INIT_TIMER ) != 0 ) {
+		llog( LOG_ERROR, "%s", SDL_GetError( ) );
+		mem_CleanUp( );
+		return -1;
+	}
+
+	return 0;
+}
+
+static void cleanUpHeadless( void )
+{
+	SDL_Quit( );
+	mem_CleanUp( );
+}
+
+// runs the mixer without a window or audio device, used for regression testing and benchmarking the mixer
+//  usage: -mixbench <seconds> <voices> [output.wav] [stream.ogg]
+static int runMixerBenchmark( int argc, char** argv )
+{
+	if( initHeadless( ) < 0 ) {
+		return 1;
+	}
+
+	if( snd_InitOffline( 1 ) < 0 ) {
+		cleanUpHeadless( );
+		return 1;
+	}
+
+	float seconds = (float)SDL_atof( argv[2] );
+	int numVoices = SDL_atoi( argv[3] );
+	const char* outFile = ( argc > 4 ) ? argv[4] : NULL;
+	const char* streamFile = ( argc > 5 ) ? argv[5] : NULL;
+
+	int result = snd_RunMixerBenchmark( outFile, seconds, numVoices, streamFile, NULL );
+
+	snd_CleanUp( );
+	cleanUpHeadless( );
+
+	return ( result == 0 ) ? 0 : 1;
+}
+
+// runs the container micro-benchmarks and exits, doesn't need a window or any other systems
+//  usage: -containerbench [scale]
+static int runContainerBenchmark( int argc, char** argv )
+{
+	if( initHeadless( ) < 0 ) {
+		return 1;
+	}
+
+	containers_RunBenchmarks( ( argc > 2 ) ? SDL_atoi( argv[2] ) : 1 );
+
+	cleanUpHeadless( );
+
+	return 0;
+}
+
+// times generating the signed distance fields for a font and exits, doesn't need a window
+//  usage: -sdfbench <font.ttf> [iterations]
+static int runSDFBenchmark( int argc, char** argv )
+{
+	if( initHeadless( ) < 0 ) {
+		return 1;
+	}
+
+	if( startJobQueue( ) < 0 ) {
+		cleanUpHeadless( );
+		return 1;
+	}
+
+	int result = txt_RunSDFBenchmark( argv[2], ( argc > 3 ) ? MAX( 1, SDL_atoi( argv[3] ) ) : 10 );
+
+	jq_ShutDown( );
+	cleanUpHeadless( );
+
+	return ( result == 0 ) ? 0 : 1;
+}
+
 #include "Utils/hashMap.h"
 int main( int argc, char** argv )
 {
@@ -454,6 +566,18 @@ int main( int argc, char** argv )
 
 	SDL_LogSetAllPriority( SDL_LOG_PRIORITY_VERBOSE );
 
+	if( ( argc >= 4 ) && ( SDL_strcmp( argv[1], "-mixbench" ) == 0 ) ) {
+		return runMixerBenchmark( argc, argv );
+	}
+
+	if( ( argc >= 2 ) && ( SDL_strcmp( argv[1], "-containerbench" ) == 0 ) ) {
+		return runContainerBenchmark( argc, argv );
+	}
+
+	if( ( argc >= 3 ) && ( SDL_strcmp( argv[1], "-sdfbench" ) == 0 ) ) {
+		return runSDFBenchmark( argc, argv );
+	}
+
 	if( initEverything( ) < 0 ) {
 		return 1;
 	}
@@ -1,90 +1,469 @@
 #include "particles.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
 #include "Graphics/images.h"
-#include "Graphics/color.h"
+#include "Graphics/graphics.h"
+#include "Graphics/triRendering.h"
 #include "Math/mathUtil.h"
-
+#include "Math/simd.h"
+#include "System/memory.h"
+#include "System/platformLog.h"
 #include "System/systems.h"
+#include "Utils/stretchyBuffer.h"
+#include "Utils/idSet.h"
 
-#include <string.h>
+/*
+Particles are stored per emitter as a structure of arrays so updating them is a straight run over each value, which lets
+ the integration be done four particles at a time. Dead particles are removed in a separate pass afterwards, which
+ preserves the order so the draw order of overlapping particles doesn't jump around when one dies.
+Particles are drawn directly through the triangle renderer instead of creating a draw instruction for each one.
+*/
+
+// each of these is an array of floats in the particle pool
+enum {
+	PS_POS_X,
+	PS_POS_Y,
+	PS_VEL_X,
+	PS_VEL_Y,
+	PS_GRAVITY_X, // per particle so loose particles with different gravity can share an emitter
+	PS_GRAVITY_Y,
+	PS_ROT,
+	PS_ROT_SPEED,
+	PS_AGE,
+	PS_LIFE_TIME,
+	PS_FADE_START,
+	// the values when the last draw was set up, these are interpolated to the current values when rendering
+	PS_RENDER_POS_X,
+	PS_RENDER_POS_Y,
+	PS_RENDER_ROT,
+	PS_RENDER_AGE,
+	NUM_PARTICLE_STREAMS
+};
+
+// the curves are baked into tables so drawing doesn't have to search through the keys for every particle
+#define CURVE_SAMPLES 64
+
+#define LOOSE_EMITTER_CAPACITY 4096
+#define INITIAL_MAX_EMITTERS 64
+
+typedef struct {
+	ParticleEmitterHandle handle;
+	bool inUse;
+	bool active;
+	bool dying; // destroyed but waiting for the particles to die
+	bool isLoose; // used for particles_Spawn( ), destroyed once all of its particles have died
+
+	ParticleEmitterDef def;
+	bool hasAlpha;
+
+	Vector2 lastSpawnPos;
+	Vector2 pos;
+	float spawnAcc;
+
+	int count;
+	int capacity;
+	float* streams[NUM_PARTICLE_STREAMS];
+
+	Color colorCurve[CURVE_SAMPLES];
+	float scaleCurve[CURVE_SAMPLES];
+} ParticleEmitter;
 
 static int systemID = -1;
+static ParticleEmitter* sbEmitters = NULL; // indexed by the index of the handle
+static IDSet emitterIDs;
+static bool renderSnapshotNeeded = true;
 
-struct Particle {
-	Vector2 currRenderPos;
-	Vector2 futureRenderPos;
-	Vector2 gravity;
-	Vector2 velocity;
-	float lifeTime;
-	float lifeElapsed;
-	float fadeStart;
-	Color currColor;
-	Color futureColor;
-	float currScale;
-	float futureScale;
-	float rotRad;
-	int image;
-	char depth;
-	unsigned int camFlags;
-};
+static void bakeCurves( ParticleEmitter* emitter )
+{
+	const ParticleEmitterDef* def = &( emitter->def );
+
+	for( int i = 0; i < CURVE_SAMPLES; ++i ) {
+		float t = (float)i / (float)( CURVE_SAMPLES - 1 );
 
-#define MAX_NUM_PARTICLES 512
+		if( def->numColorKeys <= 0 ) {
+			emitter->colorCurve[i] = CLR_WHITE;
+		} else if( t <= def->colorKeys[0].t ) {
+			emitter->colorCurve[i] = def->colorKeys[0].color;
+		} else {
+			int k = 0;
+			while( ( k < ( def->numColorKeys - 1 ) ) && ( t > def->colorKeys[k + 1].t ) ) {
+				++k;
+			}
 
-int lastParticle;
-static struct Particle particles[MAX_NUM_PARTICLES];
+			if( k >= ( def->numColorKeys - 1 ) ) {
+				emitter->colorCurve[i] = def->colorKeys[k].color;
+			} else {
+				float keyT = inverseLerp( def->colorKeys[k].t, def->colorKeys[k + 1].t, t );
+				clr_Lerp( &( def->colorKeys[k].color ), &( def->colorKeys[k + 1].color ), keyT, &( emitter->colorCurve[i] ) );
+			}
+		}
 
-void physicsTick( float dt )
+		if( def->numScaleKeys <= 0 ) {
+			emitter->scaleCurve[i] = 1.0f;
+		} else if( t <= def->scaleKeys[0].t ) {
+			emitter->scaleCurve[i] = def->scaleKeys[0].scale;
+		} else {
+			int k = 0;
+			while( ( k < ( def->numScaleKeys - 1 ) ) && ( t > def->scaleKeys[k + 1].t ) ) {
+				++k;
+			}
+
+			if( k >= ( def->numScaleKeys - 1 ) ) {
+				emitter->scaleCurve[i] = def->scaleKeys[k].scale;
+			} else {
+				float keyT = inverseLerp( def->scaleKeys[k].t, def->scaleKeys[k + 1].t, t );
+				emitter->scaleCurve[i] = lerp( def->scaleKeys[k].scale, def->scaleKeys[k + 1].scale, keyT );
+			}
+		}
+	}
+
+	emitter->hasAlpha = ( def->fadeStart < 1.0f );
+	for( int i = 0; ( i < def->numColorKeys ) && !emitter->hasAlpha; ++i ) {
+		emitter->hasAlpha = ( def->colorKeys[i].color.a < 1.0f );
+	}
+}
+
+static ParticleEmitter* createEmitter( const ParticleEmitterDef* def, Vector2 pos, bool isLoose )
 {
-	int i;
-	float fadeAmt;
+	assert( def != NULL );
 
-	/* update the positions of all the particles */
-	for( i = 0; i <= lastParticle; ++i ) {
-		particles[i].lifeElapsed += dt;
+	if( emitterIDs.sbIDData == NULL ) {
+		idSet_Init( &emitterIDs, INITIAL_MAX_EMITTERS );
+	}
 
-		fadeAmt = inverseLerp( particles[i].fadeStart, particles[i].lifeTime, particles[i].lifeElapsed );
-		particles[i].futureColor.a = lerp( 1.0f, 0.0f, fadeAmt );
-		particles[i].futureScale = lerp( 1.0f, 0.0f, fadeAmt );
+	ParticleEmitterHandle handle = idSet_ClaimID( &emitterIDs );
+	if( handle == INVALID_PARTICLE_EMITTER_HANDLE ) {
+		size_t newMax = sb_Count( emitterIDs.sbIDData ) * 2;
+		if( newMax > UINT16_MAX ) {
+			newMax = UINT16_MAX;
+		}
+		idSet_IncreaseMaximum( &emitterIDs, newMax );
+		handle = idSet_ClaimID( &emitterIDs );
+		if( handle == INVALID_PARTICLE_EMITTER_HANDLE ) {
+			llog( LOG_ERROR, "Unable to create handle for emitter." );
+			return NULL;
+		}
+	}
 
-		particles[i].currRenderPos = particles[i].futureRenderPos;
-		vec2_AddScaled( &particles[i].velocity, &particles[i].gravity, dt, &particles[i].velocity );
-		vec2_AddScaled( &particles[i].futureRenderPos, &particles[i].velocity, dt, &particles[i].futureRenderPos );
+	int capacity = MAX( 1, def->maxParticles );
+	float* data = mem_Allocate( sizeof( float ) * NUM_PARTICLE_STREAMS * capacity );
+	if( data == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate particles for emitter." );
+		idSet_ReleaseID( &emitterIDs, handle );
+		return NULL;
 	}
 
-	/* destroy all the dead particles, we won't worry about preserving order but should do some tests to see
-	    if doing so will make it more efficient */
-	for( i = 0; i <= lastParticle; ++i ) {
-		if( particles[i].lifeElapsed >= particles[i].lifeTime ) {
-			particles[i] = particles[lastParticle];
-			--lastParticle;
-			--i;
+	uint16_t idx = idSet_GetIndex( handle );
+	if( idx >= sb_Count( sbEmitters ) ) {
+		size_t oldCount = sb_Count( sbEmitters );
+		sb_Add( sbEmitters, ( idx + 1 ) - oldCount );
+		memset( sbEmitters + oldCount, 0, sizeof( sbEmitters[0] ) * ( sb_Count( sbEmitters ) - oldCount ) );
+	}
+
+	ParticleEmitter* emitter = &( sbEmitters[idx] );
+	memset( emitter, 0, sizeof( ParticleEmitter ) );
+	emitter->handle = handle;
+	emitter->inUse = true;
+	emitter->active = true;
+	emitter->isLoose = isLoose;
+	emitter->def = *def;
+	emitter->def.numColorKeys = MIN( emitter->def.numColorKeys, PARTICLE_MAX_CURVE_KEYS );
+	emitter->def.numScaleKeys = MIN( emitter->def.numScaleKeys, PARTICLE_MAX_CURVE_KEYS );
+	emitter->pos = pos;
+	emitter->lastSpawnPos = pos;
+	emitter->capacity = capacity;
+	for( int s = 0; s < NUM_PARTICLE_STREAMS; ++s ) {
+		emitter->streams[s] = data + ( s * capacity );
+	}
+
+	bakeCurves( emitter );
+
+	return emitter;
+}
+
+static void destroyEmitter( ParticleEmitter* emitter )
+{
+	idSet_ReleaseID( &emitterIDs, emitter->handle );
+	mem_Release( emitter->streams[0] );
+	memset( emitter, 0, sizeof( ParticleEmitter ) );
+}
+
+static ParticleEmitter* getEmitter( ParticleEmitterHandle handle )
+{
+	if( ( emitterIDs.sbIDData == NULL ) || !idSet_IsIDValid( &emitterIDs, handle ) ) {
+		return NULL;
+	}
+	return &( sbEmitters[idSet_GetIndex( handle )] );
+}
+
+// returns the index of the new particle, or -1 if the emitter is full
+static int addParticle( ParticleEmitter* emitter, Vector2 pos, Vector2 vel, Vector2 gravity, float rot, float rotSpeed, float lifeTime, float fadeStart )
+{
+	if( emitter->count >= emitter->capacity ) {
+		return -1;
+	}
+
+	int i = emitter->count;
+	++emitter->count;
+
+	float** s = emitter->streams;
+	s[PS_POS_X][i] = s[PS_RENDER_POS_X][i] = pos.x;
+	s[PS_POS_Y][i] = s[PS_RENDER_POS_Y][i] = pos.y;
+	s[PS_VEL_X][i] = vel.x;
+	s[PS_VEL_Y][i] = vel.y;
+	s[PS_GRAVITY_X][i] = gravity.x;
+	s[PS_GRAVITY_Y][i] = gravity.y;
+	s[PS_ROT][i] = s[PS_RENDER_ROT][i] = rot;
+	s[PS_ROT_SPEED][i] = rotSpeed;
+	s[PS_AGE][i] = s[PS_RENDER_AGE][i] = 0.0f;
+	s[PS_LIFE_TIME][i] = MAX( lifeTime, 0.0001f );
+	s[PS_FADE_START][i] = clamp( 0.0f, 1.0f, fadeStart );
+
+	// fading brings the alpha down, so it has to be drawn as transparent
+	if( s[PS_FADE_START][i] < 1.0f ) {
+		emitter->hasAlpha = true;
+	}
+
+	return i;
+}
+
+static void spawnFromDef( ParticleEmitter* emitter, Vector2 pos )
+{
+	const ParticleEmitterDef* def = &( emitter->def );
+
+	Vector2 spawnPos = pos;
+	if( def->spawnRadius > 0.0f ) {
+		// sqrt so the particles are spread evenly over the area instead of bunching in the middle
+		float dist = def->spawnRadius * sqrtf( randFloat( 0.0f, 1.0f ) );
+		float angle = randFloat( 0.0f, M_TWO_PI_F );
+		spawnPos.x += cosf( angle ) * dist;
+		spawnPos.y += sinf( angle ) * dist;
+	}
+
+	float angle = def->direction + randFloat( -def->spread, def->spread );
+	float speed = randFloat( def->minSpeed, def->maxSpeed );
+	Vector2 vel = vec2( cosf( angle ) * speed, sinf( angle ) * speed );
+
+	addParticle( emitter, spawnPos, vel, def->gravity,
+		randFloat( def->minRotation, def->maxRotation ), randFloat( def->minRotationSpeed, def->maxRotationSpeed ),
+		randFloat( def->minLifeTime, def->maxLifeTime ), def->fadeStart );
+}
+
+// moves all the particles forward by dt
+static void integrate( ParticleEmitter* emitter, float dt )
+{
+	float* posX = emitter->streams[PS_POS_X];
+	float* posY = emitter->streams[PS_POS_Y];
+	float* velX = emitter->streams[PS_VEL_X];
+	float* velY = emitter->streams[PS_VEL_Y];
+	const float* gravityX = emitter->streams[PS_GRAVITY_X];
+	const float* gravityY = emitter->streams[PS_GRAVITY_Y];
+	float* rot = emitter->streams[PS_ROT];
+	const float* rotSpeed = emitter->streams[PS_ROT_SPEED];
+	float* age = emitter->streams[PS_AGE];
+
+	float dragScale = MAX( 0.0f, 1.0f - ( emitter->def.drag * dt ) );
+	int count = emitter->count;
+
+	int i = 0;
+#if SIMD_WIDTH > 0
+	simd4f dtV = simd4f_Set1( dt );
+	simd4f dragV = simd4f_Set1( dragScale );
+	for( ; ( i + 4 ) <= count; i += 4 ) {
+		simd4f vx = simd4f_Mul( simd4f_Add( simd4f_Load( velX + i ), simd4f_Mul( simd4f_Load( gravityX + i ), dtV ) ), dragV );
+		simd4f vy = simd4f_Mul( simd4f_Add( simd4f_Load( velY + i ), simd4f_Mul( simd4f_Load( gravityY + i ), dtV ) ), dragV );
+		simd4f_Store( velX + i, vx );
+		simd4f_Store( velY + i, vy );
+		simd4f_Store( posX + i, simd4f_Add( simd4f_Load( posX + i ), simd4f_Mul( vx, dtV ) ) );
+		simd4f_Store( posY + i, simd4f_Add( simd4f_Load( posY + i ), simd4f_Mul( vy, dtV ) ) );
+		simd4f_Store( rot + i, simd4f_Add( simd4f_Load( rot + i ), simd4f_Mul( simd4f_Load( rotSpeed + i ), dtV ) ) );
+		simd4f_Store( age + i, simd4f_Add( simd4f_Load( age + i ), dtV ) );
+	}
+#endif
+
+	for( ; i < count; ++i ) {
+		velX[i] = ( velX[i] + ( gravityX[i] * dt ) ) * dragScale;
+		velY[i] = ( velY[i] + ( gravityY[i] * dt ) ) * dragScale;
+		posX[i] += velX[i] * dt;
+		posY[i] += velY[i] * dt;
+		rot[i] += rotSpeed[i] * dt;
+		age[i] += dt;
+	}
+}
+
+// removes all the particles that have lived out their life time
+static void removeDead( ParticleEmitter* emitter )
+{
+	const float* age = emitter->streams[PS_AGE];
+	const float* lifeTime = emitter->streams[PS_LIFE_TIME];
+	int count = emitter->count;
+
+	// find the first dead particle, most of the time most of the particles are still alive so skip over them quickly
+	int first = 0;
+#if SIMD_WIDTH > 0
+	for( ; ( first + 4 ) <= count; first += 4 ) {
+		if( simd4f_MoveMask( simd4f_CmpGE( simd4f_Load( age + first ), simd4f_Load( lifeTime + first ) ) ) != 0 ) {
+			break;
 		}
 	}
+#endif
+	while( ( first < count ) && ( age[first] < lifeTime[first] ) ) {
+		++first;
+	}
+
+	if( first >= count ) {
+		return;
+	}
+
+	// move all the living particles after that down
+	int write = first;
+	for( int read = first + 1; read < count; ++read ) {
+		if( age[read] < lifeTime[read] ) {
+			for( int s = 0; s < NUM_PARTICLE_STREAMS; ++s ) {
+				emitter->streams[s][write] = emitter->streams[s][read];
+			}
+			++write;
+		}
+	}
+
+	emitter->count = write;
 }
 
-void draw( void )
+static void snapshotRenderValues( ParticleEmitter* emitter )
 {
-	for( int i = 0; i <= lastParticle; ++i ) {
-		/*img_Draw_s( particles[i].image, particles[i].camFlags, particles[i].currRenderPos, particles[i].futureRenderPos,
-			particles[i].currScale, particles[i].futureScale, particles[i].layer ); //*/
-		/*img_Draw_s_r( particles[i].image, particles[i].camFlags, particles[i].currRenderPos, particles[i].futureRenderPos,
-			particles[i].currScale, particles[i].futureScale, particles[i].rotRad, particles[i].rotRad, particles[i].depth );//*/
+	size_t size = sizeof( float ) * emitter->count;
+	memcpy( emitter->streams[PS_RENDER_POS_X], emitter->streams[PS_POS_X], size );
+	memcpy( emitter->streams[PS_RENDER_POS_Y], emitter->streams[PS_POS_Y], size );
+	memcpy( emitter->streams[PS_RENDER_ROT], emitter->streams[PS_ROT], size );
+	memcpy( emitter->streams[PS_RENDER_AGE], emitter->streams[PS_AGE], size );
+}
+
+static void physicsTick( float dt )
+{
+	for( size_t e = 0; e < sb_Count( sbEmitters ); ++e ) {
+		ParticleEmitter* emitter = &( sbEmitters[e] );
+		if( !emitter->inUse ) continue;
+
+		// the first tick after the draw is set up is where the values we're interpolating from are
+		if( renderSnapshotNeeded ) {
+			snapshotRenderValues( emitter );
+		}
+
+		integrate( emitter, dt );
+		removeDead( emitter );
+
+		if( emitter->active && !emitter->dying && ( emitter->def.spawnRate > 0.0f ) ) {
+			emitter->spawnAcc += emitter->def.spawnRate * dt;
+			int toSpawn = (int)emitter->spawnAcc;
+			emitter->spawnAcc -= (float)toSpawn;
+
+			// spread the spawns out along the path the emitter moved so fast moving emitters don't leave clumps
+			for( int i = 0; i < toSpawn; ++i ) {
+				Vector2 spawnPos;
+				vec2_Lerp( &( emitter->lastSpawnPos ), &( emitter->pos ), (float)( i + 1 ) / (float)toSpawn, &spawnPos );
+				spawnFromDef( emitter, spawnPos );
+			}
+		}
+		emitter->lastSpawnPos = emitter->pos;
+
+		// loose emitters are created again as needed, so they don't hold onto their memory once they're empty
+		if( ( emitter->dying || emitter->isLoose ) && ( emitter->count <= 0 ) ) {
+			destroyEmitter( emitter );
+		}
+	}
+
+	renderSnapshotNeeded = false;
+}
+
+static void onClearDrawCommands( void )
+{
+	renderSnapshotNeeded = true;
+}
+
+static void drawEmitter( ParticleEmitter* emitter, float t )
+{
+	ImageQuadData quad;
+	if( img_GetQuadData( emitter->def.image, &quad ) < 0 ) {
+		return;
+	}
+
+	Vector2 uvs[4];
+	if( quad.rotated ) {
+		uvs[0] = vec2( quad.uvMax.x, quad.uvMin.y );
+		uvs[1] = quad.uvMin;
+		uvs[2] = quad.uvMax;
+		uvs[3] = vec2( quad.uvMin.x, quad.uvMax.y );
+	} else {
+		uvs[0] = quad.uvMin;
+		uvs[1] = vec2( quad.uvMin.x, quad.uvMax.y );
+		uvs[2] = vec2( quad.uvMax.x, quad.uvMin.y );
+		uvs[3] = quad.uvMax;
+	}
+
+	// corners of the unscaled quad, relative to the particle position
+	Vector2 corners[4];
+	corners[0] = vec2( ( quad.size.x * -0.5f ) + quad.offset.x, ( quad.size.y * -0.5f ) + quad.offset.y );
+	corners[1] = vec2( ( quad.size.x * -0.5f ) + quad.offset.x, ( quad.size.y * 0.5f ) + quad.offset.y );
+	corners[2] = vec2( ( quad.size.x * 0.5f ) + quad.offset.x, ( quad.size.y * -0.5f ) + quad.offset.y );
+	corners[3] = vec2( ( quad.size.x * 0.5f ) + quad.offset.x, ( quad.size.y * 0.5f ) + quad.offset.y );
+
+	TriType type = ( quad.transparent || emitter->hasAlpha ) ? TT_TRANSPARENT : TT_SOLID;
+
+	float** s = emitter->streams;
+	for( int i = 0; i < emitter->count; ++i ) {
+		float x = lerp( s[PS_RENDER_POS_X][i], s[PS_POS_X][i], t );
+		float y = lerp( s[PS_RENDER_POS_Y][i], s[PS_POS_Y][i], t );
+		float rot = lerp( s[PS_RENDER_ROT][i], s[PS_ROT][i], t );
+		float lifeT = clamp( 0.0f, 1.0f, lerp( s[PS_RENDER_AGE][i], s[PS_AGE][i], t ) / s[PS_LIFE_TIME][i] );
+
+		float fade = 1.0f;
+		if( lifeT > s[PS_FADE_START][i] ) {
+			fade = 1.0f - inverseLerp( s[PS_FADE_START][i], 1.0f, lifeT );
+		}
+
+		int sample = (int)( lifeT * (float)( CURVE_SAMPLES - 1 ) + 0.5f );
+		Color col = emitter->colorCurve[sample];
+		col.a *= fade;
+		float scale = emitter->scaleCurve[sample] * fade;
 
-		int drawID = img_CreateDraw( particles[i].image, particles[i].camFlags,
-			particles[i].currRenderPos, particles[i].futureRenderPos, particles[i].depth );
-		img_SetDrawScale( drawID, particles[i].currScale, particles[i].futureScale );
-		img_SetDrawRotation( drawID, particles[i].rotRad, particles[i].rotRad );
+		float cosRot = cosf( rot ) * scale;
+		float sinRot = sinf( rot ) * scale;
 
-		particles[i].currRenderPos = particles[i].futureRenderPos;
-		particles[i].currColor = particles[i].futureColor;
-		particles[i].currScale = particles[i].futureScale;
+		TriVert verts[4];
+		for( int c = 0; c < 4; ++c ) {
+			verts[c].pos.x = x + ( corners[c].x * cosRot ) - ( corners[c].y * sinRot );
+			verts[c].pos.y = y + ( corners[c].x * sinRot ) + ( corners[c].y * cosRot );
+			verts[c].uv = uvs[c];
+			verts[c].col = col;
+		}
+
+		triRenderer_Add( verts[0], verts[1], verts[2], quad.shaderType, quad.textureObj, 0.0f,
+			-1, emitter->def.camFlags, emitter->def.depth, type );
+		triRenderer_Add( verts[1], verts[2], verts[3], quad.shaderType, quad.textureObj, 0.0f,
+			-1, emitter->def.camFlags, emitter->def.depth, type );
+	}
+}
+
+static void drawParticles( float t )
+{
+	for( size_t e = 0; e < sb_Count( sbEmitters ); ++e ) {
+		if( !sbEmitters[e].inUse ) continue;
+		drawEmitter( &( sbEmitters[e] ), t );
 	}
 }
 
 int particles_Init( void )
 {
-	lastParticle = -1;
+	renderSnapshotNeeded = true;
 
-	systemID = sys_Register( NULL, NULL, draw, physicsTick );
+	systemID = sys_Register( NULL, NULL, NULL, physicsTick );
+	if( systemID >= 0 ) {
+		gfx_AddDrawTrisFunc( drawParticles );
+		gfx_AddClearCommand( onClearDrawCommands );
+	}
 
 	return systemID;
 }
@@ -93,35 +472,124 @@ void particles_CleanUp( void )
 {
 	if( systemID >= 0 ) {
 		sys_UnRegister( systemID );
+		gfx_RemoveDrawTrisFunc( drawParticles );
+		gfx_RemoveClearCommand( onClearDrawCommands );
 		systemID = -1;
 	}
+
+	for( size_t i = 0; i < sb_Count( sbEmitters ); ++i ) {
+		if( sbEmitters[i].inUse ) {
+			destroyEmitter( &( sbEmitters[i] ) );
+		}
+	}
+	sb_Release( sbEmitters );
+	idSet_Destroy( &emitterIDs );
 }
 
 void particles_Spawn( Vector2 startPos, Vector2 startVel, Vector2 gravity, float rotRad,
 	float lifeTime, float fadeStart, int image, unsigned int camFlags, char layer )
 {
-	if( lastParticle >= ( MAX_NUM_PARTICLES - 1 ) ) {
-		return;
+	ParticleEmitter* emitter = NULL;
+	for( size_t i = 0; ( i < sb_Count( sbEmitters ) ) && ( emitter == NULL ); ++i ) {
+		ParticleEmitter* existing = &( sbEmitters[i] );
+		if( existing->inUse && existing->isLoose && ( existing->def.image == image ) && ( existing->def.camFlags == camFlags ) &&
+				( existing->def.depth == layer ) ) {
+			emitter = existing;
+		}
+	}
+
+	if( emitter == NULL ) {
+		ParticleEmitterDef def;
+		particles_DefaultEmitterDef( &def );
+		def.image = image;
+		def.camFlags = camFlags;
+		def.depth = layer;
+		def.maxParticles = LOOSE_EMITTER_CAPACITY;
+		def.spawnRate = 0.0f;
+
+		emitter = createEmitter( &def, startPos, true );
+		if( emitter == NULL ) {
+			return;
+		}
+	}
+
+	lifeTime = MAX( lifeTime, 0.0001f );
+	addParticle( emitter, startPos, startVel, gravity, rotRad, 0.0f, lifeTime, MIN( fadeStart, lifeTime ) / lifeTime );
+}
+
+void particles_DefaultEmitterDef( ParticleEmitterDef* outDef )
+{
+	assert( outDef != NULL );
+
+	memset( outDef, 0, sizeof( ParticleEmitterDef ) );
+	outDef->image = -1;
+	outDef->camFlags = 1;
+	outDef->maxParticles = 1024;
+	outDef->spawnRate = 60.0f;
+	outDef->minLifeTime = 1.0f;
+	outDef->maxLifeTime = 1.0f;
+	outDef->spread = M_PI_F;
+	outDef->minSpeed = 50.0f;
+	outDef->maxSpeed = 50.0f;
+	outDef->fadeStart = 1.0f;
+}
+
+ParticleEmitterHandle particles_CreateEmitter( const ParticleEmitterDef* def, Vector2 pos )
+{
+	assert( def != NULL );
+
+	ParticleEmitter* emitter = createEmitter( def, pos, false );
+	if( emitter == NULL ) {
+		return INVALID_PARTICLE_EMITTER_HANDLE;
+	}
+
+	particles_Burst( emitter->handle, def->initialBurst );
+	return emitter->handle;
+}
+
+void particles_DestroyEmitter( ParticleEmitterHandle handle, bool killParticles )
+{
+	ParticleEmitter* emitter = getEmitter( handle );
+	if( emitter == NULL ) return;
+
+	if( killParticles || ( emitter->count <= 0 ) ) {
+		destroyEmitter( emitter );
+	} else {
+		emitter->dying = true;
 	}
+}
 
-	++lastParticle;
-	particles[lastParticle].currRenderPos = startPos;
-	particles[lastParticle].futureRenderPos = startPos;
-	particles[lastParticle].velocity = startVel;
-	particles[lastParticle].gravity = gravity;
-	particles[lastParticle].lifeTime = lifeTime;
-	particles[lastParticle].fadeStart = MIN( fadeStart, lifeTime );
-	particles[lastParticle].lifeElapsed = 0;
-	particles[lastParticle].image = image;
-	particles[lastParticle].depth = layer;
-	particles[lastParticle].camFlags = camFlags;
+void particles_SetEmitterPosition( ParticleEmitterHandle handle, Vector2 pos )
+{
+	ParticleEmitter* emitter = getEmitter( handle );
+	if( emitter == NULL ) return;
 
-	particles[lastParticle].currColor.r = particles[lastParticle].futureColor.r = 1.0f;
-	particles[lastParticle].currColor.g = particles[lastParticle].futureColor.g = 1.0f;
-	particles[lastParticle].currColor.b = particles[lastParticle].futureColor.b = 1.0f;
-	particles[lastParticle].currColor.a = particles[lastParticle].futureColor.a = 1.0f;
+	emitter->pos = pos;
+}
 
-	particles[lastParticle].currScale = particles[lastParticle].futureScale = 1.0f;
+void particles_SetEmitterActive( ParticleEmitterHandle handle, bool active )
+{
+	ParticleEmitter* emitter = getEmitter( handle );
+	if( emitter == NULL ) return;
 
-	particles[lastParticle].rotRad = rotRad;
-}
\ No newline at end of file
+	emitter->active = active;
+}
+
+void particles_Burst( ParticleEmitterHandle handle, int count )
+{
+	ParticleEmitter* emitter = getEmitter( handle );
+	if( ( emitter == NULL ) || emitter->dying ) return;
+
+	count = MIN( count, emitter->capacity - emitter->count );
+	for( int i = 0; i < count; ++i ) {
+		spawnFromDef( emitter, emitter->pos );
+	}
+}
+
+int particles_GetEmitterParticleCount( ParticleEmitterHandle handle )
+{
+	ParticleEmitter* emitter = getEmitter( handle );
+	if( emitter == NULL ) return 0;
+
+	return emitter->count;
+}
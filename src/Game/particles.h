@@ -1,11 +1,95 @@
 #ifndef ENGINE_PARTICLES_H
 #define ENGINE_PARTICLES_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "Math/vector2.h"
+#include "Graphics/color.h"
+
+#define PARTICLE_MAX_CURVE_KEYS 8
+
+// emitters are referenced by handles, once an emitter is destroyed its handle will never be valid again
+typedef uint32_t ParticleEmitterHandle;
+#define INVALID_PARTICLE_EMITTER_HANDLE 0
+
+// keys are sorted by t, which goes from 0 at the start of a particles life to 1 at the end of it
+typedef struct {
+	float t;
+	Color color;
+} ParticleColorKey;
+
+typedef struct {
+	float t;
+	float scale;
+} ParticleScaleKey;
+
+/*
+Describes how an emitter spawns and updates its particles. Use particles_DefaultEmitterDef( ) to get a definition with
+ reasonable values and then set what's needed. All the particles of an emitter share the same image, so they're drawn
+ as one run of quads.
+*/
+typedef struct {
+	int image;
+	uint32_t camFlags;
+	int8_t depth;
+
+	int maxParticles; // the most particles the emitter can have alive at once
+	float spawnRate; // particles per second, 0 if the emitter only spawns through particles_Burst( )
+	int initialBurst; // number of particles spawned when the emitter is created
+
+	float minLifeTime;
+	float maxLifeTime;
+
+	float direction; // in radians
+	float spread; // in radians, particles leave in the range direction +/- spread
+	float minSpeed;
+	float maxSpeed;
+	float spawnRadius; // particles are spawned in a circle of this radius around the emitter
+
+	Vector2 gravity;
+	float drag; // fraction of the velocity lost per second
+
+	float minRotation;
+	float maxRotation;
+	float minRotationSpeed;
+	float maxRotationSpeed;
+
+	float fadeStart; // fraction of the life time at which the particle starts fading out the alpha and scale
+
+	// if there are no keys the color is white and the scale is one
+	ParticleColorKey colorKeys[PARTICLE_MAX_CURVE_KEYS];
+	int numColorKeys;
+	ParticleScaleKey scaleKeys[PARTICLE_MAX_CURVE_KEYS];
+	int numScaleKeys;
+} ParticleEmitterDef;
 
 int particles_Init( void );
 void particles_CleanUp( void );
+
+// spawns a single particle, these are grouped into internal emitters based on the image, camera flags, and layer
 void particles_Spawn( Vector2 startPos, Vector2 startVel, Vector2 gravity, float rotRad,
 	float lifeTime, float fadeStart, int image, unsigned int camFlags, char layer );
 
+void particles_DefaultEmitterDef( ParticleEmitterDef* outDef );
+
+// creates an emitter at the position, returns the handle of the emitter or INVALID_PARTICLE_EMITTER_HANDLE if there was a problem
+ParticleEmitterHandle particles_CreateEmitter( const ParticleEmitterDef* def, Vector2 pos );
+
+// if killParticles is false the emitter stops spawning and is destroyed once all of its particles have died
+//  the functions below ignore handles to emitters that have been destroyed
+void particles_DestroyEmitter( ParticleEmitterHandle emitter, bool killParticles );
+
+// particles spawned over the next tick will be spread along the path from the old position to the new one
+void particles_SetEmitterPosition( ParticleEmitterHandle emitter, Vector2 pos );
+
+// stops or resumes spawning from the spawn rate, bursts still work while the emitter is inactive
+void particles_SetEmitterActive( ParticleEmitterHandle emitter, bool active );
+
+// immediately spawns count particles
+void particles_Burst( ParticleEmitterHandle emitter, int count );
+
+// returns the number of particles the emitter currently has alive
+int particles_GetEmitterParticleCount( ParticleEmitterHandle emitter );
+
 #endif /* inclusion guard */
@@ -16,6 +16,7 @@
 #include "Utils\helpers.h"
 #include "Utils\cfgFile.h"
 #include "System\jobQueue.h"
+#include "System\gameTime.h"
 
 #define MAX_SAMPLES 256
 #define MAX_PLAYING_SOUNDS 32
@@ -95,6 +96,8 @@ static float masterVolume = 1.0f;
 
 static float testTimePassed = 0.0f;
 
+static Uint64 mixedVoiceSamples = 0; // total samples mixed across all voices and streams, used for measuring mixer throughput
+
 #define STREAM_READ_BUFFER_SIZE ( STREAMING_BUFFER_SAMPLES * WORKING_CHANNELS * sizeof( short ) )
 static short streamReadBuffer[STREAM_READ_BUFFER_SIZE];
 static float* sbStreamWorkingBuffer = NULL;
@@ -133,7 +136,8 @@ void mixerCallback( void* userdata, Uint8* streamData, int len )
 		//  changing the speed at which we move through the array
 		bool soundDone = false;
 		float volume = snd->volume * sbSoundGroups[snd->group].volume * masterVolume;
-		for( int s = 0; ( s < numSamples ) && !soundDone; ++s ) {
+		int s;
+		for( s = 0; ( s < numSamples ) && !soundDone; ++s ) {
 
 			int streamIdx = ( s * WORKING_CHANNELS );
 
@@ -160,6 +164,8 @@ void mixerCallback( void* userdata, Uint8* streamData, int len )
 			}
 		}
 
+		mixedVoiceSamples += (Uint64)s;
+
 		if( soundDone ) {
 			idSet_ReleaseID( &playingIDSet, id ); // this doesn't invalidate the id for the loop
 		}
@@ -226,6 +232,7 @@ void mixerCallback( void* userdata, Uint8* streamData, int len )
 				workingBuffer[streamIdx+1] += sbStreamWorkingBuffer[workingIdx + 1] * volume;
 			}
 		}
+		mixedVoiceSamples += (Uint64)samplesGotten;
 	}
 #endif
 
@@ -304,28 +311,52 @@ clean_up:
 }
 
 typedef struct {
-	const char* fileName;
 	Uint8 desiredChannels;
 	bool loops;
-	int* outID;
+} SampleLoadParams;
+
+typedef struct {
+	char* fileName;
+	SampleLoadParams params;
 	SDL_AudioCVT loadConverter;
 } ThreadedSoundLoadData;
 
-static void cleanUpThreadedSoundLoadData( ThreadedSoundLoadData* data )
+static int sampleAssetType = -1;
+
+static void* createSampleLoad( const char* fileName, const void* params )
 {
-	mem_Release( data->loadConverter.buf );
-	data->loadConverter.buf = NULL;
+	ThreadedSoundLoadData* loadData = mem_Allocate( sizeof( ThreadedSoundLoadData ) );
+	if( loadData == NULL ) {
+		llog( LOG_ERROR, "Unable to allocated data struct for threaded loading of sound sample" );
+		return NULL;
+	}
 
-	mem_Release( data );
+	size_t fileNameSize = SDL_strlen( fileName ) + 1;
+	loadData->fileName = mem_Allocate( fileNameSize );
+	if( loadData->fileName == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate file name for threaded loading of sound sample" );
+		mem_Release( loadData );
+		return NULL;
+	}
+	SDL_strlcpy( loadData->fileName, fileName, fileNameSize );
+
+	loadData->params = *( (const SampleLoadParams*)params );
+	loadData->loadConverter.buf = NULL;
+
+	return loadData;
 }
 
-static void bindSampleJob( void* data )
+static void destroySampleLoad( void* data )
 {
-	if( data == NULL ) {
-		llog( LOG_ERROR, "NULL data passed into loadSampleJob!" );
-		return;
-	}
+	ThreadedSoundLoadData* loadData = (ThreadedSoundLoadData*)data;
 
+	mem_Release( loadData->loadConverter.buf );
+	mem_Release( loadData->fileName );
+	mem_Release( loadData );
+}
+
+static int bindSampleJob( void* data )
+{
 	ThreadedSoundLoadData* loadData = (ThreadedSoundLoadData*)data;
 
 	int newIdx = -1;
@@ -337,31 +368,27 @@ static void bindSampleJob( void* data )
 
 	if( newIdx < 0 ) {
 		llog( LOG_ERROR, "Unable to find free space for sample." );
-		goto clean_up;
+		return -1;
 	}
 
-	// store it
-	samples[newIdx].data = mem_Allocate( loadData->loadConverter.len_cvt );
-
-	memcpy( samples[newIdx].data, loadData->loadConverter.buf, loadData->loadConverter.len_cvt );
-
-	samples[newIdx].numChannels = loadData->desiredChannels;
-	samples[newIdx].numSamples = loadData->loadConverter.len_cvt / ( loadData->desiredChannels * ( ( SDL_AUDIO_MASK_BITSIZE & WORKING_FORMAT ) / 8 ) );
-	samples[newIdx].loops = loadData->loops;
+	// take the converted buffer instead of copying it, it was allocated with room for the conversion so trim it down
+	float* sampleData = mem_Resize( loadData->loadConverter.buf, loadData->loadConverter.len_cvt );
+	if( sampleData == NULL ) {
+		llog( LOG_ERROR, "Unable to resize converted sample." );
+		return -1;
+	}
+	samples[newIdx].data = sampleData;
+	loadData->loadConverter.buf = NULL;
 
-	(*(loadData->outID)) = newIdx;
+	samples[newIdx].numChannels = loadData->params.desiredChannels;
+	samples[newIdx].numSamples = loadData->loadConverter.len_cvt / ( loadData->params.desiredChannels * ( ( SDL_AUDIO_MASK_BITSIZE & WORKING_FORMAT ) / 8 ) );
+	samples[newIdx].loops = loadData->params.loops;
 
-clean_up:
-	cleanUpThreadedSoundLoadData( loadData );
+	return newIdx;
 }
 
-static void loadSampleJob( void* data )
+static bool loadSampleJob( void* data )
 {
-	if( data == NULL ) {
-		llog( LOG_ERROR, "NULL data passed into loadSampleJob!" );
-		return;
-	}
-
 	ThreadedSoundLoadData* loadData = (ThreadedSoundLoadData*)data;
 
 	// read the entire file into memory and decode it
@@ -372,65 +399,77 @@ static void loadSampleJob( void* data )
 
 	if( numSamples < 0 ) {
 		llog( LOG_ERROR, "Error decoding sound sample %s", loadData->fileName );
-		goto error;
+		return false;
 	}
 
 	// convert it
 	if( SDL_BuildAudioCVT( &( loadData->loadConverter ),
 		AUDIO_S16, (Uint8)channels, rate,
-		WORKING_FORMAT, loadData->desiredChannels, WORKING_RATE ) < 0 ) {
+		WORKING_FORMAT, loadData->params.desiredChannels, WORKING_RATE ) < 0 ) {
 		llog( LOG_ERROR, "Unable to create converter for sound." );
-		goto error;
+		mem_Release( buffer );
+		return false;
 	}
 
 	loadData->loadConverter.len = numSamples * channels * sizeof( buffer[0] );
-	size_t totLen = loadData->loadConverter.len * loadData->loadConverter.len_mult;
 	if( loadData->loadConverter.len_mult > 1 ) {
-		buffer = mem_Resize( buffer, loadData->loadConverter.len * loadData->loadConverter.len_mult ); // need to make sure there's enough room
-		if( buffer == NULL ) {
+		short* resized = mem_Resize( buffer, loadData->loadConverter.len * loadData->loadConverter.len_mult ); // need to make sure there's enough room
+		if( resized == NULL ) {
 			llog( LOG_ERROR, "Unable to allocate more memory for converting." );
-			goto error;
+			mem_Release( buffer );
+			return false;
 		}
+		buffer = resized;
 	}
 	loadData->loadConverter.buf = (Uint8*)buffer;
 
 	SDL_ConvertAudio( &( loadData->loadConverter ) );
 
-	jq_AddMainThreadJob( bindSampleJob, (void*)loadData );
+	return true;
+}
 
-	return;
+// Registers samples with the asset manager the first time it's needed.
+static int getSampleAssetType( void )
+{
+	if( sampleAssetType < 0 ) {
+		AssetLoader loader;
+		loader.create = createSampleLoad;
+		loader.load = loadSampleJob;
+		loader.bind = bindSampleJob;
+		loader.destroy = destroySampleLoad;
+		loader.unload = snd_UnloadSample;
+		loader.paramsSize = sizeof( SampleLoadParams );
+		loader.usesGPU = false;
+		sampleAssetType = asset_RegisterType( &loader );
+	}
 
-error:
-	cleanUpThreadedSoundLoadData( loadData );
+	return sampleAssetType;
 }
 
-void snd_ThreadedLoadSample( const char* fileName, Uint8 desiredChannels, bool loops, int* outID )
+// Requests the sample be loaded and decoded on a job thread. Use asset_Get with the handle to get the sample id, it
+//  will be -1 until the sample is ready. Release the handle with asset_Release when it's no longer needed.
+AssetHandle snd_ThreadedLoadSample( const char* fileName, Uint8 desiredChannels, bool loops, AssetPriority priority )
 {
 	assert( ( desiredChannels >= 1 ) && ( desiredChannels <= 2 ) );
-	assert( outID != NULL );
-
-	(*outID) = -1;
+	assert( fileName != NULL );
 
-	ThreadedSoundLoadData* loadData = mem_Allocate( sizeof( ThreadedSoundLoadData ) );
-	if( loadData == NULL ) {
-		llog( LOG_ERROR, "Unable to allocated data struct for threaded loading of sound sample" );
-		return;
+	int type = getSampleAssetType( );
+	if( type < 0 ) {
+		return INVALID_ASSET_HANDLE;
 	}
 
-	loadData->fileName = fileName;
-	loadData->desiredChannels = desiredChannels;
-	loadData->loops = loops;
-	loadData->outID = outID;
-	loadData->loadConverter.buf = NULL;
+	// zeroed so the padding doesn't stop duplicate requests from being found
+	SampleLoadParams params;
+	SDL_memset( &params, 0, sizeof( params ) );
+	params.desiredChannels = desiredChannels;
+	params.loops = loops;
 
-	jq_AddJob( loadSampleJob, (void*)loadData );
+	return asset_Request( type, fileName, &params, priority );
 }
 
-/* Sets up the SDL mixer. Returns 0 on success. */
-int snd_Init( unsigned int numGroups )
+// clears out all the sample and stream storage and creates the data used by the mixer, used with or without an audio device
+static int setupMixer( unsigned int numGroups, Uint16 bufferSamples, Uint8 bufferChannels )
 {
-	assert( numGroups > 0 );
-
 	// clear out the samples storage
 	SDL_memset( samples, 0, ARRAY_SIZE( samples ) * sizeof( samples[0] ) );
 	for( int i = 0; i < MAX_STREAMING_SOUNDS; ++i ) {
@@ -439,6 +478,36 @@ int snd_Init( unsigned int numGroups )
 		streamingSounds[i].playing = false;
 	}
 
+	if( idSet_Init( &playingIDSet, MAX_PLAYING_SOUNDS ) != 0 ) {
+		llog( LOG_CRITICAL, "Failed to create playing sounds id set."  );
+		return -1;
+	}
+
+	workingBufferSize = bufferSamples * bufferChannels * ( ( SDL_AUDIO_MASK_BITSIZE & WORKING_FORMAT ) / 8 );
+
+	SDL_LockAudioDevice( devID );
+	workingBuffer = mem_Allocate( workingBufferSize );
+	SDL_UnlockAudioDevice( devID );
+	if( workingBuffer == NULL ) {
+		llog( LOG_CRITICAL, "Failed to create audio working buffer." );
+		return -1;
+	}
+
+	sb_Add( sbSoundGroups, numGroups );
+	for( size_t i = 0; i < sb_Count( sbSoundGroups ); ++i ) {
+		sbSoundGroups[i].volume = 1.0f;
+	}
+
+	mixedVoiceSamples = 0;
+
+	return 0;
+}
+
+/* Sets up the SDL mixer. Returns 0 on success. */
+int snd_Init( unsigned int numGroups )
+{
+	assert( numGroups > 0 );
+
 	SDL_AudioSpec desired;
 	SDL_memset( &desired, 0, sizeof( desired ) );
 	desired.freq = WORKING_RATE;
@@ -448,11 +517,6 @@ int snd_Init( unsigned int numGroups )
 	desired.callback = mixerCallback;
 	desired.userdata = NULL;
 
-	if( idSet_Init( &playingIDSet, MAX_PLAYING_SOUNDS ) != 0 ) {
-		llog( LOG_CRITICAL, "Failed to create playing sounds id set."  );
-		return -1;
-	}
-
 	// sending 0 will cause SDL to convert everything automatically
 	devID = SDL_OpenAudioDevice( NULL, 0, &desired, NULL, 0 );
 
@@ -460,25 +524,13 @@ int snd_Init( unsigned int numGroups )
 		llog( LOG_CRITICAL, "Failed to open audio device: %s", SDL_GetError( ) );
 		return -1;
 	}
-	SDL_PauseAudioDevice( devID, 0 );
 
 	workingSilence = desired.silence;
 
-	workingBufferSize = desired.samples * desired.channels * ( ( SDL_AUDIO_MASK_BITSIZE & WORKING_FORMAT ) / 8 );
-
-	SDL_LockAudioDevice( devID );
-	workingBuffer = mem_Allocate( workingBufferSize );
-	SDL_UnlockAudioDevice( devID );
-	if( workingBuffer == NULL ) {
-		llog( LOG_CRITICAL, "Failed to create audio working buffer." );
+	if( setupMixer( numGroups, desired.samples, desired.channels ) != 0 ) {
 		return -1;
 	}
 
-	sb_Add( sbSoundGroups, numGroups );
-	for( size_t i = 0; i < sb_Count( sbSoundGroups ); ++i ) {
-		sbSoundGroups[i].volume = 1.0f;
-	}
-
 	// load the master volume
 	soundCfgFile = cfg_OpenFile( "snd.cfg" );
 	if( soundCfgFile != NULL ) {
@@ -489,6 +541,28 @@ int snd_Init( unsigned int numGroups )
 		masterVolume = 1.0f;
 	}
 
+	// don't start the callback until everything it uses has been created
+	SDL_PauseAudioDevice( devID, 0 );
+
+	return 0;
+}
+
+// Sets up the mixer without opening an audio device, the mixer is then only advanced by calling snd_RenderOffline.
+//  The master volume isn't loaded from the config file so the output only depends on what is played.
+int snd_InitOffline( unsigned int numGroups )
+{
+	assert( numGroups > 0 );
+
+	devID = 0;
+	workingSilence = 0;
+
+	if( setupMixer( numGroups, AUDIO_SAMPLES, WORKING_CHANNELS ) != 0 ) {
+		return -1;
+	}
+
+	soundCfgFile = NULL;
+	masterVolume = 1.0f;
+
 	return 0;
 }
 
@@ -777,4 +851,194 @@ void snd_UnloadStream( int streamID )
 		SDL_FreeAudioStream( streamingSounds[streamID].sdlStream );
 		streamingSounds[streamID].sdlStream = NULL;
 	} SDL_UnlockAudioDevice( devID );
-}
\ No newline at end of file
+}
+//***** Offline rendering
+static void writeWavHeader( SDL_RWops* rw, Uint32 dataSize )
+{
+	Uint16 bytesPerSample = ( SDL_AUDIO_MASK_BITSIZE & WORKING_FORMAT ) / 8;
+
+	SDL_RWwrite( rw, "RIFF", 1, 4 );
+	SDL_WriteLE32( rw, 36 + dataSize );
+	SDL_RWwrite( rw, "WAVE", 1, 4 );
+
+	SDL_RWwrite( rw, "fmt ", 1, 4 );
+	SDL_WriteLE32( rw, 16 );
+	SDL_WriteLE16( rw, 3 ); // WAVE_FORMAT_IEEE_FLOAT
+	SDL_WriteLE16( rw, WORKING_CHANNELS );
+	SDL_WriteLE32( rw, WORKING_RATE );
+	SDL_WriteLE32( rw, WORKING_RATE * WORKING_CHANNELS * bytesPerSample );
+	SDL_WriteLE16( rw, WORKING_CHANNELS * bytesPerSample );
+	SDL_WriteLE16( rw, bytesPerSample * 8 );
+
+	SDL_RWwrite( rw, "data", 1, 4 );
+	SDL_WriteLE32( rw, dataSize );
+}
+
+// Runs the mixer for the number of seconds passed in as fast as possible, writing the output to a wav file.
+//  fileName - where to write the 32-bit float stereo wav, if NULL then nothing is written
+//  script - called before each block of samples is mixed so sounds can be started and stopped at specific times, can be NULL
+//  outStats - filled with timing information about the mixing, can be NULL
+// Must be used after snd_InitOffline. Returns 0 on success.
+int snd_RenderOffline( const char* fileName, float seconds, SoundRenderScript script, void* scriptData, SoundRenderStats* outStats )
+{
+	assert( seconds >= 0.0f );
+
+	if( ( workingBuffer == NULL ) || ( devID != 0 ) ) {
+		llog( LOG_ERROR, "Offline rendering requires the mixer to be set up with snd_InitOffline." );
+		return -1;
+	}
+
+	int bytesPerSample = ( SDL_AUDIO_MASK_BITSIZE & WORKING_FORMAT ) / 8;
+	int blockSamples = workingBufferSize / ( WORKING_CHANNELS * bytesPerSample );
+	int totalSamples = (int)( seconds * WORKING_RATE );
+
+	Uint8* blockData = mem_Allocate( workingBufferSize );
+	if( blockData == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate block for offline rendering." );
+		return -1;
+	}
+
+	SDL_RWops* rw = NULL;
+	if( fileName != NULL ) {
+		rw = SDL_RWFromFile( fileName, "wb" );
+		if( rw == NULL ) {
+			llog( LOG_ERROR, "Unable to open %s for writing rendered audio: %s", fileName, SDL_GetError( ) );
+			mem_Release( blockData );
+			return -1;
+		}
+		writeWavHeader( rw, (Uint32)( totalSamples * WORKING_CHANNELS * bytesPerSample ) );
+	}
+
+	Uint64 startVoiceSamples = mixedVoiceSamples;
+	float mixTime = 0.0f;
+	int block = 0;
+	for( int rendered = 0; rendered < totalSamples; rendered += blockSamples ) {
+		if( script != NULL ) {
+			script( block, (float)rendered / (float)WORKING_RATE, scriptData );
+		}
+
+		Uint64 timer = gt_StartTimer( );
+		mixerCallback( NULL, blockData, workingBufferSize );
+		mixTime += gt_StopTimer( timer );
+
+		// the working format is native floats, all the platforms we support are little endian so they can be written directly
+		if( rw != NULL ) {
+			int samplesToWrite = MIN( blockSamples, totalSamples - rendered );
+			SDL_RWwrite( rw, blockData, WORKING_CHANNELS * bytesPerSample, samplesToWrite );
+		}
+
+		++block;
+	}
+
+	if( rw != NULL ) {
+		SDL_RWclose( rw );
+	}
+	mem_Release( blockData );
+
+	if( outStats != NULL ) {
+		outStats->secondsRendered = (float)totalSamples / (float)WORKING_RATE;
+		outStats->secondsMixing = mixTime;
+		outStats->voiceSamplesMixed = mixedVoiceSamples - startVoiceSamples;
+		outStats->voiceSamplesPerSecond = ( mixTime > 0.0f ) ? ( (double)outStats->voiceSamplesMixed / (double)mixTime ) : 0.0;
+	}
+
+	return 0;
+}
+
+// creates a looping mono sine wave sample, gives the benchmark something to play without needing any files
+static int createToneSample( float frequency )
+{
+	int newIdx = -1;
+	for( int i = 0; ( i < ARRAY_SIZE( samples ) ) && ( newIdx < 0 ); ++i ) {
+		if( samples[i].data == NULL ) {
+			newIdx = i;
+		}
+	}
+
+	if( newIdx < 0 ) {
+		llog( LOG_ERROR, "Unable to find free space for sample." );
+		return -1;
+	}
+
+	// one second of data, so any frequency that's a whole number will loop cleanly
+	samples[newIdx].data = mem_Allocate( WORKING_RATE * sizeof( samples[newIdx].data[0] ) );
+	if( samples[newIdx].data == NULL ) {
+		llog( LOG_ERROR, "Unable to allocate tone sample." );
+		return -1;
+	}
+
+	for( int s = 0; s < WORKING_RATE; ++s ) {
+		samples[newIdx].data[s] = sinf( ( (float)s / (float)WORKING_RATE ) * frequency * M_TWO_PI_F );
+	}
+
+	samples[newIdx].numChannels = 1;
+	samples[newIdx].numSamples = WORKING_RATE;
+	samples[newIdx].loops = true;
+
+	return newIdx;
+}
+
+typedef struct {
+	int sample;
+	int numVoices;
+	int stream;
+} MixerBenchmarkScript;
+
+static void mixerBenchmarkScript( int block, float time, void* data )
+{
+	MixerBenchmarkScript* bench = (MixerBenchmarkScript*)data;
+
+	// every voice is started on the first block and kept going, they're spread across pitches and pans so
+	//  all the paths through the mixer get used
+	if( block == 0 ) {
+		for( int i = 0; i < bench->numVoices; ++i ) {
+			float t = ( bench->numVoices > 1 ) ? ( (float)i / (float)( bench->numVoices - 1 ) ) : 0.5f;
+			snd_Play( bench->sample, 0.5f / (float)bench->numVoices, lerp( 0.5f, 2.0f, t ), lerp( -1.0f, 1.0f, t ), 0 );
+		}
+
+		if( bench->stream >= 0 ) {
+			snd_PlayStreaming( bench->stream, 0.5f, 0.0f );
+		}
+	}
+}
+
+// Renders a fixed set of voices, and optionally a stream, through the mixer and logs the throughput.
+//  Uses a generated tone so the output will be the same between runs, which lets the output file be compared
+//  against previous renders. Must be used after snd_InitOffline. Returns 0 on success.
+int snd_RunMixerBenchmark( const char* outFileName, float seconds, int numVoices, const char* streamFileName, SoundRenderStats* outStats )
+{
+	MixerBenchmarkScript bench;
+
+	bench.numVoices = MIN( numVoices, MAX_PLAYING_SOUNDS );
+	bench.sample = createToneSample( 440.0f );
+	if( bench.sample < 0 ) {
+		return -1;
+	}
+
+	bench.stream = -1;
+	if( streamFileName != NULL ) {
+		bench.stream = snd_LoadStreaming( streamFileName, true, 0 );
+	}
+
+	SoundRenderStats stats;
+	int result = snd_RenderOffline( outFileName, seconds, mixerBenchmarkScript, &bench, &stats );
+
+	if( result == 0 ) {
+		llog( LOG_INFO, "Mixer benchmark: %i voices, stream: %s", bench.numVoices, ( bench.stream >= 0 ) ? "yes" : "no" );
+		llog( LOG_INFO, "  rendered %.2f seconds of audio in %.4f seconds", stats.secondsRendered, stats.secondsMixing );
+		llog( LOG_INFO, "  %llu voice samples mixed, %.0f voice samples per second", (unsigned long long)stats.voiceSamplesMixed, stats.voiceSamplesPerSecond );
+		if( outStats != NULL ) {
+			(*outStats) = stats;
+		}
+	}
+
+	for( EntityID id = idSet_GetFirstValidID( &playingIDSet ); id != INVALID_ENTITY_ID; id = idSet_GetNextValidID( &playingIDSet, id ) ) {
+		snd_Stop( id );
+	}
+	if( bench.stream >= 0 ) {
+		snd_UnloadStream( bench.stream );
+	}
+	snd_UnloadSample( bench.sample );
+
+	return result;
+}
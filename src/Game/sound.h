@@ -5,10 +5,14 @@
 #include <SDL_types.h>
 
 #include "Utils\idSet.h"
+#include "System\assetManager.h"
 
 // Sets up the SDL mixer. Returns 0 on success.
 int snd_Init( unsigned int numGroups );
 
+// Sets up the mixer without an audio device, used for rendering sounds out to a file. Returns 0 on success.
+int snd_InitOffline( unsigned int numGroups );
+
 // Shuts down SDL mixer.
 void snd_CleanUp( );
 
@@ -23,7 +27,9 @@ void snd_SetVolume( float volume, unsigned int group );
 
 //***** Loaded all at once
 int snd_LoadSample( const char* fileName, Uint8 desiredChannels, bool loops );
-void snd_ThreadedLoadSample( const char* fileName, Uint8 desiredChannels, bool loops, int* outID );
+// Requests the sample be loaded and decoded on a job thread. Use asset_Get with the handle to get the sample id, it
+//  will be -1 until the sample is ready. Release the handle with asset_Release when it's no longer needed.
+AssetHandle snd_ThreadedLoadSample( const char* fileName, Uint8 desiredChannels, bool loops, AssetPriority priority );
 
 // Returns an id that can be used to change the volume and pitch
 //  volume - how loud the sound will be, in the range [0,1], 0 being off, 1 being loudest
@@ -48,4 +54,23 @@ void snd_ChangeStreamVolume( int streamID, float volume );
 void snd_ChangeStreamPan( int streamID, float pan );
 void snd_UnloadStream( int streamID );
 
+//***** Offline rendering
+// Called before each block of samples is mixed, used to start and stop sounds at specific times.
+typedef void (*SoundRenderScript)( int block, float time, void* data );
+
+typedef struct {
+	float secondsRendered;
+	float secondsMixing; // time spent in the mixer, doesn't include writing to the file
+	Uint64 voiceSamplesMixed; // sum of the samples mixed for every voice and stream
+	double voiceSamplesPerSecond;
+} SoundRenderStats;
+
+// Runs the mixer as fast as possible and writes seconds worth of output to a 32-bit float stereo wav file.
+//  Requires snd_InitOffline. fileName, script, and outStats can all be NULL. Returns 0 on success.
+int snd_RenderOffline( const char* fileName, float seconds, SoundRenderScript script, void* scriptData, SoundRenderStats* outStats );
+
+// Renders a set number of generated voices, and an optional looping stream, and logs the mixer throughput.
+//  Requires snd_InitOffline. outFileName and streamFileName can be NULL. Returns 0 on success.
+int snd_RunMixerBenchmark( const char* outFileName, float seconds, int numVoices, const char* streamFileName, SoundRenderStats* outStats );
+
 #endif
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <Windows.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_FAILURE_USERMSG
@@ -10,18 +12,52 @@
 #include <stb_image_write.h>
 
 #include "edtaa3func.c"
+#include "../Game/Utils/distanceTransform.c"
+#include "../Tools/toolThreads.h"
 
 #define MIN( a, b ) ( ( a ) < ( b ) ? ( a ) : ( b ) )
 #define MAX( a, b ) ( ( a ) > ( b ) ? ( a ) : ( b ) )
 
 #define IDX( x, y, w, p, e ) ( ( p ) + ( ( e ) * ( ( x ) + ( ( y ) * ( w ) ) ) ) )
 
+// how much the value changes for each pixel away from the edge, the field saturates at 128 / DIST_SCALE pixels
+#define DIST_SCALE 16.0
+
+// anything further than this from a pixel can't change its value, so each tile is processed with this much of the
+//  image around it, which gives the same result as processing the whole image at once
+#define TILE_APRON ( (int)( 128.0 / DIST_SCALE ) + 2 )
+
 // TODO:
 //  - Better image handling, stb_image is good but we could use a more capable library for this
 //  - Handle non-monochrome images
 //  - More sizing options
 //  - Single channel mask image to better handle transparent images
 
+// the image is split into tiles that are processed on worker threads, only the alpha of the source and the output are
+//  ever stored for the whole image so large images don't need much more memory than the output itself
+
+typedef struct {
+	uint8_t* alpha; // of the source image
+	int width;
+	int height;
+	int addX;
+	int addY;
+
+	uint8_t* out; // RGBA
+	int outWidth;
+	int outHeight;
+
+	int tilesX;
+	int tilesY;
+	volatile LONG failed;
+} SDFImage;
+
+int tileSize = 256;
+int numThreads = 0;
+bool useFastTransform = false;
+
+SDFImage currentImage;
+
 // returns if strToTest ends with strValue
 bool endsWith( const char* strToTest, const char* strValue )
 {
@@ -41,6 +77,290 @@ bool endsWith( const char* strToTest, const char* strValue )
 	return true;
 }
 
+// gets the alpha of the source image at the position in the output image, anything outside the source is clear
+uint8_t getSourceAlpha( int x, int y )
+{
+	x -= currentImage.addX;
+	y -= currentImage.addY;
+	if( ( x < 0 ) || ( y < 0 ) || ( x >= currentImage.width ) || ( y >= currentImage.height ) ) {
+		return 0;
+	}
+	return currentImage.alpha[x + ( y * currentImage.width )];
+}
+
+void writeOutput( int x, int y, double value )
+{
+	// merge inside and outside and convert to an image
+	value = 128 + ( value * DIST_SCALE );
+	value = MAX( value, 0.0 );
+	value = MIN( value, 255.0 );
+
+	int imgIdx = IDX( x, y, currentImage.outWidth, 0, 4 );
+	currentImage.out[imgIdx + 0] = 255;
+	currentImage.out[imgIdx + 1] = 255;
+	currentImage.out[imgIdx + 2] = 255;
+	currentImage.out[imgIdx + 3] = 255 - (unsigned char)value;
+}
+
+// anti-aliased euclidean distance transform, uses the alpha of the edge pixels to find where the edge is within them
+bool processTileAA( int regionX, int regionY, int regionW, int regionH, int tileX, int tileY, int tileW, int tileH )
+{
+	bool success = false;
+	size_t count = (size_t)regionW * regionH;
+
+	double* dblImg = malloc( sizeof( double ) * count );
+	double* outside = malloc( sizeof( double ) * count );
+	double* inside = malloc( sizeof( double ) * count );
+	double* xGradients = malloc( sizeof( double ) * count );
+	double* yGradients = malloc( sizeof( double ) * count );
+	short* xDists = malloc( sizeof( short ) * count );
+	short* yDists = malloc( sizeof( short ) * count );
+	if( ( dblImg == NULL ) || ( outside == NULL ) || ( inside == NULL ) || ( xGradients == NULL ) || ( yGradients == NULL ) ||
+		( xDists == NULL ) || ( yDists == NULL ) ) {
+		goto clean_up;
+	}
+
+	//  map it into the range [0, 1]
+	for( int y = 0; y < regionH; ++y ) {
+		for( int x = 0; x < regionW; ++x ) {
+			dblImg[x + ( y * regionW )] = getSourceAlpha( regionX + x, regionY + y ) / 255.0;
+		}
+	}
+
+	//  compute outside
+	computegradient( dblImg, regionW, regionH, xGradients, yGradients );
+	edtaa3( dblImg, xGradients, yGradients, regionW, regionH, xDists, yDists, outside );
+
+	//  compute inside
+	for( size_t i = 0; i < count; ++i ) {
+		dblImg[i] = 1.0 - dblImg[i];
+	}
+	computegradient( dblImg, regionW, regionH, xGradients, yGradients );
+	edtaa3( dblImg, xGradients, yGradients, regionW, regionH, xDists, yDists, inside );
+
+	for( int y = tileY; y < ( tileY + tileH ); ++y ) {
+		for( int x = tileX; x < ( tileX + tileW ); ++x ) {
+			size_t i = (size_t)( x - regionX ) + ( (size_t)( y - regionY ) * regionW );
+			writeOutput( x, y, MAX( outside[i], 0.0 ) - MAX( inside[i], 0.0 ) );
+		}
+	}
+
+	success = true;
+
+clean_up:
+	free( dblImg );
+	free( outside );
+	free( inside );
+	free( xGradients );
+	free( yGradients );
+	free( xDists );
+	free( yDists );
+
+	return success;
+}
+
+// separable exact euclidean distance transform, the alpha is used as coverage to place the edge within partially
+//  covered pixels, it's much faster
+bool processTileFast( int regionX, int regionY, int regionW, int regionH, int tileX, int tileY, int tileW, int tileH )
+{
+	size_t count = (size_t)regionW * regionH;
+	uint8_t* coverage = malloc( count * 2 );
+	void* workspace = malloc( edt_SDFWorkspaceSize( regionW, regionH ) );
+	if( ( coverage == NULL ) || ( workspace == NULL ) ) {
+		free( coverage );
+		free( workspace );
+		return false;
+	}
+	uint8_t* sdf = coverage + count;
+
+	for( int y = 0; y < regionH; ++y ) {
+		for( int x = 0; x < regionW; ++x ) {
+			coverage[x + ( y * regionW )] = getSourceAlpha( regionX + x, regionY + y );
+		}
+	}
+
+	// distance increases going inside, so the edge is at 127 to match the anti-aliased version
+	edt_CreateSDF( coverage, regionW, regionH, 127, (float)DIST_SCALE, sdf, regionW, workspace );
+
+	for( int y = tileY; y < ( tileY + tileH ); ++y ) {
+		for( int x = tileX; x < ( tileX + tileW ); ++x ) {
+			int imgIdx = IDX( x, y, currentImage.outWidth, 0, 4 );
+			currentImage.out[imgIdx + 0] = 255;
+			currentImage.out[imgIdx + 1] = 255;
+			currentImage.out[imgIdx + 2] = 255;
+			currentImage.out[imgIdx + 3] = sdf[( x - regionX ) + ( ( y - regionY ) * regionW )];
+		}
+	}
+
+	free( coverage );
+	free( workspace );
+
+	return true;
+}
+
+void processTile( size_t tileIdx )
+{
+	int tileX = (int)( tileIdx % currentImage.tilesX ) * tileSize;
+	int tileY = (int)( tileIdx / currentImage.tilesX ) * tileSize;
+	int tileW = MIN( tileSize, currentImage.outWidth - tileX );
+	int tileH = MIN( tileSize, currentImage.outHeight - tileY );
+
+	// the region is the tile and everything around it that can effect it
+	int regionX = MAX( tileX - TILE_APRON, 0 );
+	int regionY = MAX( tileY - TILE_APRON, 0 );
+	int regionW = MIN( tileX + tileW + TILE_APRON, currentImage.outWidth ) - regionX;
+	int regionH = MIN( tileY + tileH + TILE_APRON, currentImage.outHeight ) - regionY;
+
+	bool success;
+	if( useFastTransform ) {
+		success = processTileFast( regionX, regionY, regionW, regionH, tileX, tileY, tileW, tileH );
+	} else {
+		success = processTileAA( regionX, regionY, regionW, regionH, tileX, tileY, tileW, tileH );
+	}
+
+	if( !success ) {
+		InterlockedIncrement( &( currentImage.failed ) );
+	}
+}
+
+int generateSDF( const char* inputFilePath, const char* outputFilePath, int addX, int addY )
+{
+	int ret = 0;
+	unsigned char* loadedImage = NULL;
+
+	memset( &currentImage, 0, sizeof( currentImage ) );
+
+	// load the image
+	int w;
+	int h;
+	int comp;
+	loadedImage = stbi_load( inputFilePath, &w, &h, &comp, 4 );
+	if( loadedImage == NULL ) {
+		fprintf( stderr, "Unable to load image file %s: %s\n", inputFilePath, stbi_failure_reason( ) );
+		ret = 3;
+		goto clean_up;
+	}
+
+	// only the alpha is used, so keep that and unload the image
+	currentImage.width = w;
+	currentImage.height = h;
+	currentImage.alpha = malloc( sizeof( uint8_t ) * w * h );
+	if( currentImage.alpha == NULL ) {
+		fprintf( stderr, "Unable to allocate memory for %s.\n", inputFilePath );
+		ret = 2;
+		goto clean_up;
+	}
+	for( int i = 0; i < ( w * h ); ++i ) {
+		currentImage.alpha[i] = loadedImage[( i * 4 ) + 3];
+	}
+	stbi_image_free( loadedImage );
+	loadedImage = NULL;
+
+	// expand the image by the desired amount
+	currentImage.addX = addX;
+	currentImage.addY = addY;
+	currentImage.outWidth = w + ( 2 * addX );
+	currentImage.outHeight = h + ( 2 * addY );
+	currentImage.out = malloc( sizeof( unsigned char ) * 4 * currentImage.outWidth * currentImage.outHeight );
+	if( currentImage.out == NULL ) {
+		fprintf( stderr, "Unable to allocate memory for %s.\n", outputFilePath );
+		ret = 2;
+		goto clean_up;
+	}
+
+	// create the sdf
+	currentImage.tilesX = ( currentImage.outWidth + tileSize - 1 ) / tileSize;
+	currentImage.tilesY = ( currentImage.outHeight + tileSize - 1 ) / tileSize;
+	runOnWorkers( processTile, (size_t)currentImage.tilesX * currentImage.tilesY, numThreads );
+
+	if( currentImage.failed > 0 ) {
+		fprintf( stderr, "Unable to allocate memory to process %s.\n", inputFilePath );
+		ret = 2;
+		goto clean_up;
+	}
+
+	// save out image
+	if( stbi_write_png( outputFilePath, currentImage.outWidth, currentImage.outHeight, 4, currentImage.out, 0 ) == 0 ) {
+		fprintf( stderr, "Unable to save image file %s.\n", outputFilePath );
+		ret = 4;
+		goto clean_up;
+	}
+
+	fprintf( stdout, "SDF image %s created.\n", outputFilePath );
+
+clean_up:
+
+	free( currentImage.alpha );
+	free( currentImage.out );
+	stbi_image_free( loadedImage );
+	memset( &currentImage, 0, sizeof( currentImage ) );
+
+	return ret;
+}
+
+// generates an sdf for every file in the input directory, writing them to the output directory with the same name
+int generateDirectory( const char* inputDirectory, const char* outputDirectory, int addX, int addY )
+{
+	int ret = 0;
+
+	char* searchPath = malloc( sizeof( char ) * strlen( inputDirectory ) + 3 );
+	strcpy( searchPath, inputDirectory );
+	strcat( searchPath, "\\*" );
+
+	WIN32_FIND_DATAA findFileData;
+	HANDLE dirIterHandle = FindFirstFileA( (LPCSTR)searchPath, &findFileData );
+	if( dirIterHandle == INVALID_HANDLE_VALUE ) {
+		fprintf( stderr, "Unable to open directory %s, error: %d\n", inputDirectory, GetLastError( ) );
+		ret = 5;
+		goto clean_up;
+	}
+
+	int numCreated = 0;
+	int numFailed = 0;
+	do {
+		if( findFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) {
+			continue;
+		}
+
+		char* inputPath = malloc( strlen( inputDirectory ) + 1 + strlen( findFileData.cFileName ) + 1 );
+		strcpy( inputPath, inputDirectory );
+		strcat( inputPath, "\\" );
+		strcat( inputPath, findFileData.cFileName );
+
+		// always write out a png, replacing whatever extension it had
+		char* outputPath = malloc( strlen( outputDirectory ) + 1 + strlen( findFileData.cFileName ) + 4 + 1 );
+		strcpy( outputPath, outputDirectory );
+		strcat( outputPath, "\\" );
+		strcat( outputPath, findFileData.cFileName );
+		char* extension = strrchr( outputPath + strlen( outputDirectory ) + 1, '.' );
+		if( extension != NULL ) {
+			(*extension) = 0;
+		}
+		strcat( outputPath, ".png" );
+
+		if( generateSDF( inputPath, outputPath, addX, addY ) == 0 ) {
+			++numCreated;
+		} else {
+			++numFailed;
+		}
+
+		free( outputPath );
+		free( inputPath );
+	} while( FindNextFileA( dirIterHandle, &findFileData ) != 0 );
+
+	FindClose( dirIterHandle );
+
+	fprintf( stdout, "%i SDF images created, %i failed.\n", numCreated, numFailed );
+	if( numFailed > 0 ) {
+		ret = 6;
+	}
+
+clean_up:
+	free( searchPath );
+
+	return ret;
+}
+
 int main( int argc, char** argv )
 {
 	// check to see if the output path is a .png file, if it isn't then append .png to the end
@@ -48,25 +368,22 @@ int main( int argc, char** argv )
 
 	char* inputFilePath = NULL;
 	char* outputFilePath = NULL;
+	char* inputDirectory = NULL;
+	char* outputDirectory = NULL;
 	int ret = 0;
 	int addX = 0;
 	int addY = 0;
 
-	unsigned char* loadedImage = NULL;
-	double* dblImg = NULL;
-	double* outside = NULL;
-	double* inside = NULL;
-	double* xGradients = NULL;
-	double* yGradients = NULL;
-	short* xDists = NULL;
-	short* yDists = NULL;
-	unsigned char* expandedImage = NULL;
-
 	for( int i = 1; i < argc; ++i ) {
 		if( strcmp( "-h", argv[i] ) == 0 ) {
 			fprintf( stdout, "Used to generate a monochrome signed distance field from an image.\n" );
 			fprintf( stdout, "Will create a four channel PNG with the alpha set to the distance, where 128 is on the edge.\n" );
 			fprintf( stdout, "Useage: SDFImageGenerator -xa x -ya y source_file output_file\n" );
+			fprintf( stdout, "    or: SDFImageGenerator -xa x -ya y -d source_directory output_directory\n" );
+			fprintf( stdout, "-d to create an SDF for every image in source_directory, they're written to output_directory as pngs with the same names.\n" );
+			fprintf( stdout, "-fast to use a separable distance transform instead of the anti-aliased one, the edges are a little less accurate but it's much faster.\n" );
+			fprintf( stdout, "-tile to set the size of the tiles the image is split into. Defaults to 256.\n" );
+			fprintf( stdout, "-t to set the number of worker threads to start. The main thread works as well, so -t N has N + 1 threads working. Defaults to the number of processors.\n" );
 		} else if( strcmp( "-xa", argv[i] ) == 0 ) {
 			// add to x size
 			++i;
@@ -87,6 +404,28 @@ int main( int argc, char** argv )
 			} else {
 				addY = strtol( argv[i], NULL, 10 );
 			}
+		} else if( strcmp( "-d", argv[i] ) == 0 ) {
+			i += 2;
+			if( i >= argc ) {
+				fprintf( stderr, "-d needs a source and output directory." );
+				ret = 5;
+				goto clean_up;
+			} else {
+				inputDirectory = argv[i - 1];
+				outputDirectory = argv[i];
+			}
+		} else if( strcmp( "-fast", argv[i] ) == 0 ) {
+			useFastTransform = true;
+		} else if( strcmp( "-tile", argv[i] ) == 0 ) {
+			++i;
+			if( i < argc ) {
+				tileSize = MAX( strtol( argv[i], NULL, 10 ), 16 );
+			}
+		} else if( strcmp( "-t", argv[i] ) == 0 ) {
+			++i;
+			if( i < argc ) {
+				numThreads = strtol( argv[i], NULL, 10 );
+			}
 		} else {
 			// one of the files to use
 			if( inputFilePath == NULL ) {
@@ -109,103 +448,28 @@ int main( int argc, char** argv )
 		}
 	}
 
-	// load the image
-	int w;
-	int h;
-	int comp;
-	loadedImage = stbi_load( inputFilePath, &w, &h, &comp, 4 );
-	if( loadedImage == NULL ) {
-		fprintf( stderr, "Unable to load image file: %s\n", stbi_failure_reason( ) );
-		ret = 3;
-		goto clean_up;
-	}
-
-	// expand the image by the desired amount
-	int ew = w + ( 2 * addX );
-	int eh = h + ( 2 * addY );
-	expandedImage = malloc( sizeof( unsigned char ) * 4 * ew * eh );
-	memset( expandedImage, 0, sizeof( unsigned char ) * 4 * ew * eh );
-
-	for( int y = 0; y < h; ++y ) {
-		for( int x = 0; x < w; ++x ) {
-			for( int e = 0; e < 4; ++e ) {
-				expandedImage[IDX( x + addX, y + addY, ew, e, 4 )] = loadedImage[IDX( x, y, w, e, 4 )];
-			}
-		}
-	}
-
-	// unload the image
-	stbi_image_free( loadedImage );
-	loadedImage = NULL;
-
-	// create the sdf
-	//  first make it the image doubles
-	dblImg = malloc( sizeof( double ) * ew * eh );
-	outside = malloc( sizeof( double ) * ew * eh );
-	inside = malloc( sizeof( double ) * ew * eh );
-	xGradients = malloc( sizeof( double ) * ew * eh );
-	yGradients = malloc( sizeof( double ) * ew * eh );
-	xDists = malloc( sizeof( short ) * ew * eh );
-	yDists = malloc( sizeof( short ) * ew * eh );
-
-	//  map it into the range [0, 1]
-	for( int i = 0; i < ( ew * eh ); ++i ) {
-		dblImg[i] = expandedImage[( i * 4 ) + 3] / 255.0;
+	if( numThreads <= 0 ) {
+		SYSTEM_INFO sysInfo;
+		GetSystemInfo( &sysInfo );
+		numThreads = (int)sysInfo.dwNumberOfProcessors;
 	}
 
-	//  compute outside
-	computegradient( dblImg, ew, eh, xGradients, yGradients );
-	edtaa3( dblImg, xGradients, yGradients, ew, eh, xDists, yDists, outside );
-	for( int i = 0; i < ( ew * eh ); ++i ) {
-		outside[i] = MAX( outside[i], 0.0 );
+	if( inputDirectory != NULL ) {
+		ret = generateDirectory( inputDirectory, outputDirectory, addX, addY );
 	}
 
-	//  compute inside
-	for( int i = 0; i < ( ew * eh ); ++i ) {
-		dblImg[i] = 1.0 - dblImg[i];
-	}
-	computegradient( dblImg, ew, eh, xGradients, yGradients );
-	edtaa3( dblImg, xGradients, yGradients, ew, eh, xDists, yDists, inside );
-	for( int i = 0; i < ( ew * eh ); ++i ) {
-		inside[i] = MAX( inside[i], 0.0 );
-	}
-
-	//  merge inside and outside and convert to an image, we'll resuse the loadedImage data
-	for( int i = 0; i < ( ew * eh ); ++i ) {
-		int imgIdx = i * 4;
-		expandedImage[imgIdx + 0] = 255;
-		expandedImage[imgIdx + 1] = 255;
-		expandedImage[imgIdx + 2] = 255;
-
-		outside[i] -= inside[i];
-		outside[i] = 128 + ( outside[i] * 16 );
-		outside[i] = MAX( outside[i], 0.0 );
-		outside[i] = MIN( outside[i], 255.0 );
-
-		expandedImage[imgIdx + 3] = 255 - (unsigned char)outside[i];
-	}
-
-	// save out image
-	if( stbi_write_png( outputFilePath, ew, eh, 4, expandedImage, 0 ) == 0 ) {
-		fprintf( stderr, "Unable to save image file.\n" );
-		ret = 4;
-		goto clean_up;
+	if( ( ret == 0 ) && ( inputFilePath != NULL ) ) {
+		if( outputFilePath == NULL ) {
+			fprintf( stderr, "No output file supplied." );
+			ret = 1;
+			goto clean_up;
+		}
+		ret = generateSDF( inputFilePath, outputFilePath, addX, addY );
 	}
 
-	fprintf( stdout, "SDF image created.\n" );
-
 clean_up:
 
-	free( dblImg );
-	free( outside );
-	free( inside );
-	free( xGradients );
-	free( yGradients );
-	free( xDists );
-	free( yDists );
 	free( outputFilePath );
-	free( expandedImage );
-	stbi_image_free( loadedImage );
 
 	return ret;
-}
\ No newline at end of file
+}
@@ -1,9 +1,8 @@
 #include <stdio.h>
 #include <Windows.h>
 #include <stdbool.h>
-
-#define STB_RECT_PACK_IMPLEMENTATION
-#include <stb_rect_pack.h>
+#include <stdint.h>
+#include <limits.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_FAILURE_USERMSG
@@ -13,74 +12,105 @@
 #include <stb_image_write.h>
 
 #include "stretchyBuffer.h"
+#include "../Game/Graphics/spriteSheetFormat.h"
+#include "../Tools/toolThreads.h"
 
 // simple command line program to generate sprite sheets for Xturos, uses the nothings library for most everything
 //  interface: SpriteSheetGenerator outputName -f fileToAdd -d directoryToAdd
 // -f and -d can be used numerous times
 
+// images are loaded and pages written on worker threads, each sprite has the clear border around it trimmed off, sprites
+//  with the same pixels are only stored once, and everything is packed using maxrects, rotating sprites if they fit
+//  better that way. if everything won't fit on one page of the maximum size more pages are created.
+// the original size and where the trimmed part was in it are stored, so in the game img_GetSize( ) still gives the
+//  untrimmed size and the sprite is drawn where it was.
 
 typedef struct {
 	char* filePath;
+	const char* name; // points into filePath
+
+	// set when the image is loaded
+	bool loaded;
+	uint8_t* pixels; // only what's left after trimming
+	int sourceW;
+	int sourceH;
+	int trimX;
+	int trimY;
+	int w;
+	int h;
+	uint64_t hash;
+	int duplicateOf; // index of the sprite with the same pixels, -1 if it's unique
+
+	// set when the sprite is packed
+	int page;
+	int x;
+	int y;
+	bool rotated;
 } SpriteInfo;
 
+typedef struct {
+	int x, y, w, h;
+} Rect;
+
+typedef struct {
+	int width;
+	int height;
+	uint8_t* pixels;
+	char* fileName;
+} Page;
 
 int paddingX = 1;
 int paddingY = 1;
+int maxPageSize = 2048;
+int numThreads = 0;
+bool allowRotation = true;
+bool trimSprites = true;
+bool incremental = false;
 
-stbrp_rect* sbRects = NULL;
 SpriteInfo* sbSpriteInfos = NULL;
+Page* sbPages = NULL;
 
-// returns a new string, you will have to free() it yourself
-char* getFileName( char* filePath )
+// FNV-1a, used for finding duplicate sprites and if anything has changed since the last time the sheet was generated
+uint64_t hashBytes( uint64_t hash, const void* data, size_t size )
 {
-	assert( filePath != NULL );
-
-	// find the last '\' in filePath
-	size_t len = strlen( filePath );
-	size_t start = len;
-	while( ( start > 0 ) && !( ( filePath[start] == '\\' ) || ( filePath[start] == '/' ) ) ) {
-		--start;
-	}
-
-	if( ( filePath[start] == '\\' ) || ( filePath[start] == '/' ) ) {
-		++start;
+	const uint8_t* bytes = (const uint8_t*)data;
+	for( size_t i = 0; i < size; ++i ) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
 	}
+	return hash;
+}
 
-	size_t nameLen = ( len - start );
-	char* fileName = malloc( sizeof( char ) * ( nameLen + 1 ) );
-	memset( fileName, 0, nameLen + 1 );
+#define HASH_START 0xCBF29CE484222325ULL
 
-	strncpy( fileName, filePath + start, nameLen );
+const char* getFileName( const char* filePath )
+{
+	const char* back = strrchr( filePath, '\\' );
+	const char* forward = strrchr( filePath, '/' );
+	const char* sep = ( back > forward ) ? back : forward;
+	return ( sep != NULL ) ? ( sep + 1 ) : filePath;
+}
 
-	return fileName;	
+// returns a new string, you will have to free() it yourself
+char* appendToName( const char* base, const char* append )
+{
+	char* result = malloc( strlen( base ) + strlen( append ) + 1 );
+	strcpy( result, base );
+	strcat( result, append );
+	return result;
 }
 
 void addFile( char* filePath )
 {
-	// get just the file name without the path included
 	SpriteInfo newSpriteInfo;
-	
-	newSpriteInfo.filePath = filePath;
+	memset( &newSpriteInfo, 0, sizeof( newSpriteInfo ) );
+
 	newSpriteInfo.filePath = malloc( sizeof( char ) * ( strlen( filePath ) + 1 ) );
 	strcpy( newSpriteInfo.filePath, filePath );
+	newSpriteInfo.name = getFileName( newSpriteInfo.filePath );
+	newSpriteInfo.duplicateOf = -1;
 
-	// attempt to open the file to make sure it's an image, as well was getting the width and height
-	int w, h, comp;
-	unsigned char* data = stbi_load( newSpriteInfo.filePath, &w, &h, &comp, 4 );
-	if( data == NULL ) {
-		fprintf( stderr, "File %s is probably not an image: %s", newSpriteInfo.filePath, stbi_failure_reason( ) );
-		free( newSpriteInfo.filePath );
-		return;
-	}
-	stbi_image_free( data );
-
-	stbrp_rect newRect;
-	newRect.w = w + paddingX;
-	newRect.h = h + paddingY;
-	newRect.id = sb_Count( sbSpriteInfos );
-	newRect.was_packed = 0;
-
-	sb_Push( sbRects, newRect );
+	// the image is loaded later along with everything else
 	sb_Push( sbSpriteInfos, newSpriteInfo );
 }
 
@@ -112,10 +142,121 @@ void addDirectory( char* directoryPath )
 		}
 	} while( FindNextFileA( dirIterHandle, &findFileData ) != 0 );
 
+	FindClose( dirIterHandle );
+
 clean_up:
 	free( searchPath );
 }
 
+// loads the image and trims off the clear border, if the whole image is clear a single clear pixel is kept
+void loadSprite( size_t idx )
+{
+	SpriteInfo* sprite = &( sbSpriteInfos[idx] );
+
+	int w, h, comp;
+	uint8_t* data = stbi_load( sprite->filePath, &w, &h, &comp, 4 );
+	if( data == NULL ) {
+		fprintf( stderr, "File %s is probably not an image: %s\n", sprite->filePath, stbi_failure_reason( ) );
+		return;
+	}
+
+	int minX = 0;
+	int minY = 0;
+	int maxX = w - 1;
+	int maxY = h - 1;
+	if( trimSprites ) {
+		minX = w;
+		minY = h;
+		maxX = -1;
+		maxY = -1;
+		for( int y = 0; y < h; ++y ) {
+			const uint8_t* row = data + ( (size_t)y * w * 4 );
+			for( int x = 0; x < w; ++x ) {
+				if( row[( x * 4 ) + 3] != 0 ) {
+					if( x < minX ) minX = x;
+					if( x > maxX ) maxX = x;
+					if( y < minY ) minY = y;
+					if( y > maxY ) maxY = y;
+				}
+			}
+		}
+
+		if( maxX < 0 ) {
+			minX = minY = maxX = maxY = 0;
+		}
+	}
+
+	sprite->sourceW = w;
+	sprite->sourceH = h;
+	sprite->trimX = minX;
+	sprite->trimY = minY;
+	sprite->w = maxX - minX + 1;
+	sprite->h = maxY - minY + 1;
+
+	size_t rowSize = (size_t)sprite->w * 4;
+	sprite->pixels = malloc( rowSize * sprite->h );
+	for( int r = 0; r < sprite->h; ++r ) {
+		memcpy( sprite->pixels + ( rowSize * r ), data + ( ( ( (size_t)( minY + r ) * w ) + minX ) * 4 ), rowSize );
+	}
+	stbi_image_free( data );
+
+	if( trimSprites && ( sprite->w == 1 ) && ( sprite->h == 1 ) && ( sprite->pixels[3] == 0 ) ) {
+		memset( sprite->pixels, 0, 4 );
+	}
+
+	sprite->hash = hashBytes( HASH_START, &( sprite->w ), sizeof( sprite->w ) );
+	sprite->hash = hashBytes( sprite->hash, &( sprite->h ), sizeof( sprite->h ) );
+	sprite->hash = hashBytes( sprite->hash, sprite->pixels, rowSize * sprite->h );
+
+	sprite->loaded = true;
+}
+
+int compareSpritesByHash( const void* left, const void* right )
+{
+	const SpriteInfo* leftSprite = &( sbSpriteInfos[*(const int*)left] );
+	const SpriteInfo* rightSprite = &( sbSpriteInfos[*(const int*)right] );
+	if( leftSprite->hash != rightSprite->hash ) {
+		return ( leftSprite->hash < rightSprite->hash ) ? -1 : 1;
+	}
+	return ( *(const int*)left ) - ( *(const int*)right );
+}
+
+// any sprites with exactly the same pixels use the first one in the sheet
+void findDuplicates( void )
+{
+	int* sbOrder = NULL;
+	for( int i = 0; i < (int)sb_Count( sbSpriteInfos ); ++i ) {
+		if( sbSpriteInfos[i].loaded ) {
+			sb_Push( sbOrder, i );
+		}
+	}
+	qsort( sbOrder, sb_Count( sbOrder ), sizeof( sbOrder[0] ), compareSpritesByHash );
+
+	int numDuplicates = 0;
+	for( size_t i = 0; i < sb_Count( sbOrder ); ++i ) {
+		SpriteInfo* sprite = &( sbSpriteInfos[sbOrder[i]] );
+		for( size_t j = i; j > 0; --j ) {
+			SpriteInfo* other = &( sbSpriteInfos[sbOrder[j - 1]] );
+			if( other->hash != sprite->hash ) {
+				break;
+			}
+
+			if( ( other->duplicateOf < 0 ) && ( other->w == sprite->w ) && ( other->h == sprite->h ) &&
+				( memcmp( other->pixels, sprite->pixels, (size_t)sprite->w * sprite->h * 4 ) == 0 ) ) {
+				sprite->duplicateOf = sbOrder[j - 1];
+				++numDuplicates;
+				break;
+			}
+		}
+	}
+
+	if( numDuplicates > 0 ) {
+		printf( "found %i duplicate sprites\n", numDuplicates );
+	}
+
+	sb_Release( sbOrder );
+}
+
 int nextHighestPowerOfTwo( int v )
 {
 	v += ( v == 0 ); // fixes case where v == 0 returns 0
@@ -133,21 +274,481 @@ int nextHighestPowerOfTwo( int v )
 	return v;
 }
 
-void insertImage( uint8_t* imageData, int imgWidth, int imgHeight, size_t rectIdx )
+// maxrects bin packing, keeps track of all the largest free rectangles and places each new rectangle where it leaves
+//  the shortest side of the free space it goes in smallest
+Rect* sbFreeRects = NULL;
+Rect* sbNewFreeRects = NULL;
+
+void mr_Init( int width, int height )
+{
+	sb_Clear( sbFreeRects );
+	Rect all = { 0, 0, width, height };
+	sb_Push( sbFreeRects, all );
+}
+
+// the padding is always on the right and bottom, even if the sprite is rotated
+bool mr_FindPosition( int w, int h, Rect* outRect, bool* outRotated )
 {
-	int w, h, comp;
-	uint8_t* data = stbi_load( sbSpriteInfos[sbRects[rectIdx].id].filePath, &w, &h, &comp, 4 );
+	int bestShort = INT_MAX;
+	int bestLong = INT_MAX;
+	bool found = false;
+
+	for( size_t i = 0; i < sb_Count( sbFreeRects ); ++i ) {
+		Rect* freeRect = &( sbFreeRects[i] );
+		for( int rotate = 0; rotate < ( allowRotation ? 2 : 1 ); ++rotate ) {
+			int placeW = ( rotate ? h : w ) + paddingX;
+			int placeH = ( rotate ? w : h ) + paddingY;
+			if( ( placeW > freeRect->w ) || ( placeH > freeRect->h ) ) {
+				continue;
+			}
+
+			int leftoverX = freeRect->w - placeW;
+			int leftoverY = freeRect->h - placeH;
+			int shortSide = ( leftoverX < leftoverY ) ? leftoverX : leftoverY;
+			int longSide = ( leftoverX > leftoverY ) ? leftoverX : leftoverY;
+			if( ( shortSide < bestShort ) || ( ( shortSide == bestShort ) && ( longSide < bestLong ) ) ) {
+				outRect->x = freeRect->x;
+				outRect->y = freeRect->y;
+				outRect->w = placeW;
+				outRect->h = placeH;
+				(*outRotated) = ( rotate != 0 );
+				bestShort = shortSide;
+				bestLong = longSide;
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+bool rectContains( const Rect* outer, const Rect* inner )
+{
+	return ( inner->x >= outer->x ) && ( inner->y >= outer->y ) &&
+		( ( inner->x + inner->w ) <= ( outer->x + outer->w ) ) && ( ( inner->y + inner->h ) <= ( outer->y + outer->h ) );
+}
 
-	int x = sbRects[rectIdx].x;
-	int y = sbRects[rectIdx].y;
+void mr_Place( const Rect* used )
+{
+	// split every free rectangle the new one overlaps into the parts that are still free
+	sb_Clear( sbNewFreeRects );
+	for( size_t i = 0; i < sb_Count( sbFreeRects ); ++i ) {
+		Rect freeRect = sbFreeRects[i];
+		if( ( used->x >= ( freeRect.x + freeRect.w ) ) || ( ( used->x + used->w ) <= freeRect.x ) ||
+			( used->y >= ( freeRect.y + freeRect.h ) ) || ( ( used->y + used->h ) <= freeRect.y ) ) {
+			sb_Push( sbNewFreeRects, freeRect );
+			continue;
+		}
 
-	// copy each row
-	for( int r = 0; r < h; ++r ) {
-		uint8_t* base = imageData + ( ( x + ( imgWidth * ( r + y ) ) ) * 4 );
-		memcpy( base, data + ( w * r * 4 ), 4 * w );
+		Rect part;
+		if( used->x > freeRect.x ) {
+			part = freeRect;
+			part.w = used->x - freeRect.x;
+			sb_Push( sbNewFreeRects, part );
+		}
+		if( ( used->x + used->w ) < ( freeRect.x + freeRect.w ) ) {
+			part = freeRect;
+			part.x = used->x + used->w;
+			part.w = ( freeRect.x + freeRect.w ) - part.x;
+			sb_Push( sbNewFreeRects, part );
+		}
+		if( used->y > freeRect.y ) {
+			part = freeRect;
+			part.h = used->y - freeRect.y;
+			sb_Push( sbNewFreeRects, part );
+		}
+		if( ( used->y + used->h ) < ( freeRect.y + freeRect.h ) ) {
+			part = freeRect;
+			part.y = used->y + used->h;
+			part.h = ( freeRect.y + freeRect.h ) - part.y;
+			sb_Push( sbNewFreeRects, part );
+		}
+	}
+
+	// get rid of any free rectangles that are inside other ones
+	sb_Clear( sbFreeRects );
+	for( size_t i = 0; i < sb_Count( sbNewFreeRects ); ++i ) {
+		bool contained = false;
+		for( size_t j = 0; ( j < sb_Count( sbNewFreeRects ) ) && !contained; ++j ) {
+			if( ( i != j ) && rectContains( &( sbNewFreeRects[j] ), &( sbNewFreeRects[i] ) ) ) {
+				// if they're the same keep the first one
+				contained = ( j < i ) || !rectContains( &( sbNewFreeRects[i] ), &( sbNewFreeRects[j] ) );
+			}
+		}
+
+		if( !contained ) {
+			sb_Push( sbFreeRects, sbNewFreeRects[i] );
+		}
 	}
 }
 
+// packs as many of the sprites as it can into a page of the given size, returns how many were packed
+int packPage( int* sbToPack, int width, int height, int page )
+{
+	mr_Init( width, height );
+
+	int numPacked = 0;
+	for( size_t i = 0; i < sb_Count( sbToPack ); ++i ) {
+		SpriteInfo* sprite = &( sbSpriteInfos[sbToPack[i]] );
+		sprite->page = -1;
+
+		Rect placed;
+		bool rotated;
+		if( !mr_FindPosition( sprite->w, sprite->h, &placed, &rotated ) ) {
+			continue;
+		}
+
+		mr_Place( &placed );
+		sprite->page = page;
+		sprite->x = placed.x;
+		sprite->y = placed.y;
+		sprite->rotated = rotated;
+		++numPacked;
+	}
+
+	return numPacked;
+}
+
+int compareSpritesBySize( const void* left, const void* right )
+{
+	const SpriteInfo* leftSprite = &( sbSpriteInfos[*(const int*)left] );
+	const SpriteInfo* rightSprite = &( sbSpriteInfos[*(const int*)right] );
+
+	int leftMax = max( leftSprite->w, leftSprite->h );
+	int rightMax = max( rightSprite->w, rightSprite->h );
+	if( leftMax != rightMax ) {
+		return rightMax - leftMax;
+	}
+
+	int leftArea = leftSprite->w * leftSprite->h;
+	int rightArea = rightSprite->w * rightSprite->h;
+	if( leftArea != rightArea ) {
+		return rightArea - leftArea;
+	}
+
+	return ( *(const int*)left ) - ( *(const int*)right );
+}
+
+// packs all the unique sprites into as few pages as possible, each page is the smallest power of two that will hold
+//  everything left or the maximum size if nothing will
+int packSprites( void )
+{
+	int* sbRemaining = NULL;
+	int* sbLeftOver = NULL;
+	for( int i = 0; i < (int)sb_Count( sbSpriteInfos ); ++i ) {
+		SpriteInfo* sprite = &( sbSpriteInfos[i] );
+		if( !sprite->loaded || ( sprite->duplicateOf >= 0 ) ) {
+			continue;
+		}
+
+		if( ( ( sprite->w + paddingX ) > maxPageSize ) || ( ( sprite->h + paddingY ) > maxPageSize ) ) {
+			if( !allowRotation || ( ( sprite->h + paddingX ) > maxPageSize ) || ( ( sprite->w + paddingY ) > maxPageSize ) ) {
+				fprintf( stderr, "Sprite %s is too large to fit on a page: %i x %i\n", sprite->filePath, sprite->w, sprite->h );
+				sb_Release( sbRemaining );
+				return -1;
+			}
+		}
+		sb_Push( sbRemaining, i );
+	}
+	qsort( sbRemaining, sb_Count( sbRemaining ), sizeof( sbRemaining[0] ), compareSpritesBySize );
+
+	int page = 0;
+	while( sb_Count( sbRemaining ) > 0 ) {
+		// for the starting size we'll find the largest along each dimension and choose the next highest power of 2
+		int maxW = 1;
+		int maxH = 1;
+		for( size_t i = 0; i < sb_Count( sbRemaining ); ++i ) {
+			SpriteInfo* sprite = &( sbSpriteInfos[sbRemaining[i]] );
+			maxW = max( maxW, sprite->w + paddingX );
+			maxH = max( maxH, sprite->h + paddingY );
+		}
+
+		int width = min( nextHighestPowerOfTwo( maxW - 1 ), maxPageSize );
+		int height = min( nextHighestPowerOfTwo( maxH - 1 ), maxPageSize );
+
+		// if not everything was packed increase the lowest of the width and height to the next power of 2, when we
+		//  hit the maximum size whatever didn't fit goes on to the next page
+		int numPacked;
+		while( ( numPacked = packPage( sbRemaining, width, height, page ) ) < (int)sb_Count( sbRemaining ) ) {
+			if( ( width >= maxPageSize ) && ( height >= maxPageSize ) ) {
+				break;
+			}
+
+			if( ( ( width < height ) && ( width < maxPageSize ) ) || ( height >= maxPageSize ) ) {
+				width = min( width << 1, maxPageSize );
+			} else {
+				height = min( height << 1, maxPageSize );
+			}
+		}
+
+		if( numPacked == 0 ) {
+			fprintf( stderr, "Unable to pack any sprites on page %i\n", page );
+			sb_Release( sbRemaining );
+			sb_Release( sbLeftOver );
+			return -1;
+		}
+
+		printf( "page %i is %i x %i with %i sprites\n", page, width, height, numPacked );
+
+		Page newPage;
+		memset( &newPage, 0, sizeof( newPage ) );
+		newPage.width = width;
+		newPage.height = height;
+		sb_Push( sbPages, newPage );
+
+		sb_Clear( sbLeftOver );
+		for( size_t i = 0; i < sb_Count( sbRemaining ); ++i ) {
+			if( sbSpriteInfos[sbRemaining[i]].page < 0 ) {
+				sb_Push( sbLeftOver, sbRemaining[i] );
+			}
+		}
+
+		int* temp = sbRemaining;
+		sbRemaining = sbLeftOver;
+		sbLeftOver = temp;
+
+		++page;
+	}
+
+	sb_Release( sbRemaining );
+	sb_Release( sbLeftOver );
+
+	// duplicates use whatever they're the same as
+	for( size_t i = 0; i < sb_Count( sbSpriteInfos ); ++i ) {
+		SpriteInfo* sprite = &( sbSpriteInfos[i] );
+		if( sprite->loaded && ( sprite->duplicateOf >= 0 ) ) {
+			SpriteInfo* original = &( sbSpriteInfos[sprite->duplicateOf] );
+			sprite->page = original->page;
+			sprite->x = original->x;
+			sprite->y = original->y;
+			sprite->rotated = original->rotated;
+		}
+	}
+
+	return 0;
+}
+
+// copies all the sprites on the page into it and writes it out
+void writePage( size_t pageIdx )
+{
+	Page* page = &( sbPages[pageIdx] );
+
+	size_t imgSize = sizeof( uint8_t ) * 4 * page->width * page->height;
+	page->pixels = malloc( imgSize );
+	memset( page->pixels, 0, imgSize );
+
+	for( size_t i = 0; i < sb_Count( sbSpriteInfos ); ++i ) {
+		SpriteInfo* sprite = &( sbSpriteInfos[i] );
+		if( !sprite->loaded || ( sprite->duplicateOf >= 0 ) || ( sprite->page != (int)pageIdx ) ) {
+			continue;
+		}
+
+		if( sprite->rotated ) {
+			// rotated 90 degrees clockwise, so the left column of the sprite becomes the top row
+			for( int r = 0; r < sprite->h; ++r ) {
+				int destX = sprite->x + ( sprite->h - 1 - r );
+				for( int c = 0; c < sprite->w; ++c ) {
+					uint8_t* dest = page->pixels + ( ( destX + ( (size_t)page->width * ( sprite->y + c ) ) ) * 4 );
+					memcpy( dest, sprite->pixels + ( ( ( (size_t)r * sprite->w ) + c ) * 4 ), 4 );
+				}
+			}
+		} else {
+			// copy each row
+			for( int r = 0; r < sprite->h; ++r ) {
+				uint8_t* base = page->pixels + ( ( sprite->x + ( (size_t)page->width * ( r + sprite->y ) ) ) * 4 );
+				memcpy( base, sprite->pixels + ( (size_t)sprite->w * r * 4 ), 4 * sprite->w );
+			}
+		}
+	}
+
+	if( stbi_write_png( page->fileName, page->width, page->height, 4, page->pixels, 0 ) == 0 ) {
+		fprintf( stderr, "Unable to write %s\n", page->fileName );
+	}
+
+	free( page->pixels );
+	page->pixels = NULL;
+}
+
+// the rect the sprite uses in its page, if it's rotated this is the rotated size
+void getPageRect( const SpriteInfo* sprite, Rect* outRect )
+{
+	outRect->x = sprite->x;
+	outRect->y = sprite->y;
+	outRect->w = sprite->rotated ? sprite->h : sprite->w;
+	outRect->h = sprite->rotated ? sprite->w : sprite->h;
+}
+
+int compareSpritesByPage( const void* left, const void* right )
+{
+	const SpriteInfo* leftSprite = &( sbSpriteInfos[*(const int*)left] );
+	const SpriteInfo* rightSprite = &( sbSpriteInfos[*(const int*)right] );
+	if( leftSprite->page != rightSprite->page ) {
+		return leftSprite->page - rightSprite->page;
+	}
+	return ( *(const int*)left ) - ( *(const int*)right );
+}
+
+int writeDefinitions( const char* outputName, int* sbOrder )
+{
+	int ret = 0;
+
+	/*
+	Format for layout text:
+	3
+	number of pages
+	pageImageFileName
+	repeat above line for every page
+	spriteName page x y w h trimX trimY sourceW sourceH rotated
+	repeat above line for every sprite in the sheet
+	*/
+	char* layoutFileName = appendToName( outputName, ".ss" );
+
+	FILE* layoutFile = fopen( layoutFileName, "w" );
+	if( layoutFile != NULL ) {
+		fprintf( layoutFile, "%i\n%i", SPRITE_SHEET_TEXT_VERSION, (int)sb_Count( sbPages ) );
+		for( size_t i = 0; i < sb_Count( sbPages ); ++i ) {
+			fprintf( layoutFile, "\n%s", getFileName( sbPages[i].fileName ) );
+		}
+		for( size_t i = 0; i < sb_Count( sbOrder ); ++i ) {
+			SpriteInfo* sprite = &( sbSpriteInfos[sbOrder[i]] );
+			Rect rect;
+			getPageRect( sprite, &rect );
+			fprintf( layoutFile, "\n%s %i %i %i %i %i %i %i %i %i %i", sprite->name, sprite->page, rect.x, rect.y, rect.w, rect.h,
+				sprite->trimX, sprite->trimY, sprite->sourceW, sprite->sourceH, sprite->rotated ? 1 : 0 );
+		}
+		fclose( layoutFile );
+	} else {
+		fprintf( stderr, "Unable to open %s for writing\n", layoutFileName );
+		ret = -1;
+	}
+
+	// write out the binary index, the strings are the page file names followed by all the sprite names
+	char* indexFileName = appendToName( outputName, SPRITE_SHEET_INDEX_EXTENSION );
+
+	SpriteSheetIndexHeader indexHeader;
+	indexHeader.magic = SPRITE_SHEET_INDEX_MAGIC;
+	indexHeader.version = SPRITE_SHEET_INDEX_VERSION;
+	indexHeader.numPages = (uint32_t)sb_Count( sbPages );
+	indexHeader.numSprites = (uint32_t)sb_Count( sbOrder );
+
+	uint32_t stringsSize = 0;
+	SpriteSheetIndexPage* indexPages = malloc( sizeof( SpriteSheetIndexPage ) * ( sb_Count( sbPages ) + 1 ) );
+	for( size_t i = 0; i < sb_Count( sbPages ); ++i ) {
+		indexPages[i].imageNameOffset = stringsSize;
+		stringsSize += (uint32_t)( strlen( getFileName( sbPages[i].fileName ) ) + 1 );
+	}
+
+	SpriteSheetIndexRect* indexRects = malloc( sizeof( SpriteSheetIndexRect ) * ( sb_Count( sbOrder ) + 1 ) );
+	for( size_t i = 0; i < sb_Count( sbOrder ); ++i ) {
+		SpriteInfo* sprite = &( sbSpriteInfos[sbOrder[i]] );
+		Rect rect;
+		getPageRect( sprite, &rect );
+
+		indexRects[i].nameOffset = stringsSize;
+		indexRects[i].page = (uint32_t)sprite->page;
+		indexRects[i].flags = sprite->rotated ? SSRF_ROTATED : 0;
+		indexRects[i].x = rect.x;
+		indexRects[i].y = rect.y;
+		indexRects[i].w = rect.w;
+		indexRects[i].h = rect.h;
+		indexRects[i].trimX = sprite->trimX;
+		indexRects[i].trimY = sprite->trimY;
+		indexRects[i].sourceW = sprite->sourceW;
+		indexRects[i].sourceH = sprite->sourceH;
+		stringsSize += (uint32_t)( strlen( sprite->name ) + 1 );
+	}
+	indexHeader.stringsSize = stringsSize;
+
+	FILE* indexFile = fopen( indexFileName, "wb" );
+	if( indexFile != NULL ) {
+		fwrite( &indexHeader, sizeof( indexHeader ), 1, indexFile );
+		fwrite( indexPages, sizeof( SpriteSheetIndexPage ), sb_Count( sbPages ), indexFile );
+		fwrite( indexRects, sizeof( SpriteSheetIndexRect ), sb_Count( sbOrder ), indexFile );
+		for( size_t i = 0; i < sb_Count( sbPages ); ++i ) {
+			const char* pageName = getFileName( sbPages[i].fileName );
+			fwrite( pageName, strlen( pageName ) + 1, 1, indexFile );
+		}
+		for( size_t i = 0; i < sb_Count( sbOrder ); ++i ) {
+			const char* spriteName = sbSpriteInfos[sbOrder[i]].name;
+			fwrite( spriteName, strlen( spriteName ) + 1, 1, indexFile );
+		}
+		fclose( indexFile );
+	} else {
+		fprintf( stderr, "Unable to open %s for writing\n", indexFileName );
+		ret = -1;
+	}
+
+	free( indexRects );
+	free( indexPages );
+	free( indexFileName );
+	free( layoutFileName );
+
+	return ret;
+}
+
+// hash of the settings and the name, size, and modification time of every input, if it matches what was stored the
+//  last time the sheet was generated nothing has changed
+uint64_t getInputsHash( void )
+{
+	uint64_t hash = HASH_START;
+
+	int settings[] = { SPRITE_SHEET_INDEX_VERSION, paddingX, paddingY, maxPageSize, allowRotation, trimSprites };
+	hash = hashBytes( hash, settings, sizeof( settings ) );
+
+	for( size_t i = 0; i < sb_Count( sbSpriteInfos ); ++i ) {
+		const char* filePath = sbSpriteInfos[i].filePath;
+		hash = hashBytes( hash, filePath, strlen( filePath ) + 1 );
+
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if( GetFileAttributesExA( filePath, GetFileExInfoStandard, &attributes ) ) {
+			hash = hashBytes( hash, &( attributes.nFileSizeHigh ), sizeof( attributes.nFileSizeHigh ) );
+			hash = hashBytes( hash, &( attributes.nFileSizeLow ), sizeof( attributes.nFileSizeLow ) );
+			hash = hashBytes( hash, &( attributes.ftLastWriteTime ), sizeof( attributes.ftLastWriteTime ) );
+		}
+	}
+
+	return hash;
+}
+
+bool fileExists( const char* fileName )
+{
+	return GetFileAttributesA( fileName ) != INVALID_FILE_ATTRIBUTES;
+}
+
+// checks the stored hash and that the outputs are still there
+bool isUpToDate( const char* outputName, const char* hashFileName, uint64_t inputsHash )
+{
+	FILE* hashFile = fopen( hashFileName, "r" );
+	if( hashFile == NULL ) {
+		return false;
+	}
+
+	unsigned long long storedHash = 0;
+	int numPages = 0;
+	bool matches = ( fscanf( hashFile, "%llx %i", &storedHash, &numPages ) == 2 ) && ( storedHash == inputsHash ) && ( numPages > 0 );
+	fclose( hashFile );
+
+	char* layoutFileName = appendToName( outputName, ".ss" );
+	char* indexFileName = appendToName( outputName, SPRITE_SHEET_INDEX_EXTENSION );
+	matches = matches && fileExists( layoutFileName ) && fileExists( indexFileName );
+	free( indexFileName );
+	free( layoutFileName );
+
+	for( int i = 0; ( i < numPages ) && matches; ++i ) {
+		char pageSuffix[32];
+		if( numPages == 1 ) {
+			strcpy( pageSuffix, ".png" );
+		} else {
+			sprintf( pageSuffix, "_%i.png", i );
+		}
+		char* pageFileName = appendToName( outputName, pageSuffix );
+		matches = fileExists( pageFileName );
+		free( pageFileName );
+	}
+
+	return matches;
+}
+
 int main( int argc, char** argv )
 {
 	int ret = 0;
@@ -161,14 +762,19 @@ int main( int argc, char** argv )
 	for( int i = 1; i < argc; ++i ) {
 		if( strcmp( argv[i], "-h" ) == 0 ) {
 			fprintf( stdout, "Used to generate a sprite sheet.\n" );
-			fprintf( stdout, "Will create two files, a png and ss file. The ss file will define the sprite sheet, listing the name, position and size of all the sprites. The png will have the actual images.\n" );
+			fprintf( stdout, "Will create a png for each page, and ss and ssb files. The ss file will define the sprite sheet, listing the pages and the name, position, size, trimming, and rotation of all the sprites. The pngs will have the actual images.\n" );
 			fprintf( stdout, "This will accept any number of files to include. You can also include all the files in a directory.\n" );
 			fprintf( stdout, "Useage: SpriteSheetGenerator outname -xp 1 -yp 1 -f file_to_include -d directory_to_include\n" );
-			fprintf( stdout, "Generates outname.ss and outname.png.\n" );
+			fprintf( stdout, "Generates outname.ss, outname.ssb, and outname.png, or outname_0.png, outname_1.png, etc. if it needs more than one page. The ssb file is a binary version of the ss file that's faster to load.\n" );
 			fprintf( stdout, "-f to add a file to process.\n" );
 			fprintf( stdout, "-d to add all the files in a directory.\n" );
 			fprintf( stdout, "-xp to set the padding on the x dimension. Defaults to 1.\n" );
 			fprintf( stdout, "-yp to set the padding on the y dimension. Defaults to 1.\n" );
+			fprintf( stdout, "-max to set the largest a page can be. Defaults to 2048.\n" );
+			fprintf( stdout, "-t to set the number of threads to use. Defaults to the number of processors.\n" );
+			fprintf( stdout, "-norot to never rotate sprites.\n" );
+			fprintf( stdout, "-notrim to keep the clear borders around sprites.\n" );
+			fprintf( stdout, "-i to only generate the sheet if the images or settings have changed since the last time.\n" );
 		} else if( strcmp( argv[i], "-f" ) == 0 ) {
 			++i;
 			if( i < argc ) {
@@ -186,95 +792,103 @@ int main( int argc, char** argv )
 				if( paddingX < 0 ) paddingX = 0;
 			}
 		} else if( strcmp( argv[i], "-yp" ) == 0 ) {
-			paddingY = atoi( argv[i] );
-			if( paddingY < 0 ) paddingY = 0;
+			++i;
+			if( i < argc ) {
+				paddingY = atoi( argv[i] );
+				if( paddingY < 0 ) paddingY = 0;
+			}
+		} else if( strcmp( argv[i], "-max" ) == 0 ) {
+			++i;
+			if( i < argc ) {
+				maxPageSize = nextHighestPowerOfTwo( atoi( argv[i] ) - 1 );
+			}
+		} else if( strcmp( argv[i], "-t" ) == 0 ) {
+			++i;
+			if( i < argc ) {
+				numThreads = atoi( argv[i] );
+			}
+		} else if( strcmp( argv[i], "-norot" ) == 0 ) {
+			allowRotation = false;
+		} else if( strcmp( argv[i], "-notrim" ) == 0 ) {
+			trimSprites = false;
+		} else if( strcmp( argv[i], "-i" ) == 0 ) {
+			incremental = true;
 		} else {
 			outputName = argv[i];
 		}
 	}
 
-	stbrp_context rpContext;
-
-	// for the starting size we'll find the largest along each dimension and choose the
-	//  next highest power of 2
-	int maxW = -1;
-	int maxH = -1;
-	for( size_t i = 0; i < sb_Count( sbRects ); ++i ) {
-		if( sbRects[i].w > maxW ) {
-			maxW = sbRects[i].w;
-		}
+	if( outputName == NULL ) {
+		fprintf( stderr, "No output name given\n" );
+		return -1;
+	}
 
-		if( sbRects[i].h > maxH ) {
-			maxH = sbRects[i].h;
-		}
+	if( numThreads <= 0 ) {
+		SYSTEM_INFO sysInfo;
+		GetSystemInfo( &sysInfo );
+		numThreads = (int)sysInfo.dwNumberOfProcessors;
 	}
 
-	int width = nextHighestPowerOfTwo( maxW );
-	int height = nextHighestPowerOfTwo( maxH );
-	bool increaseWidth = true;
+	char* hashFileName = appendToName( outputName, ".sshash" );
+	uint64_t inputsHash = getInputsHash( );
+	if( incremental && isUpToDate( outputName, hashFileName, inputsHash ) ) {
+		printf( "%s is up to date\n", outputName );
+		goto clean_up;
+	}
 
-	// while not everything is packed attempt to pack, if not everything was packed increase the lowest
-	//  of the width and height to the next power of 2
-	// not optimal, but packing is NP-hard and this isn't meant to run real time
-	int success = 0;
-	stbrp_node* sbNodes = NULL;
-	do {
-		printf( "trying %i x %i\n", width, height );
-		sb_Clear( sbNodes );
-		sb_Add( sbNodes, width );
+	runOnWorkers( loadSprite, sb_Count( sbSpriteInfos ), numThreads );
+	findDuplicates( );
 
-		stbrp_init_target( &rpContext, width, height, sbNodes, sb_Count( sbNodes ) );
-		success = stbrp_pack_rects( &rpContext, sbRects, sb_Count( sbRects ) );
+	if( packSprites( ) < 0 ) {
+		ret = -1;
+		goto clean_up;
+	}
 
-		if( !success ) {
-			if( width < height ) {
-				width = width << 1;
-			} else {
-				height = height << 1;
-			}
+	// every sprite should now be packed, create the pages and the sprite sheet files
+	for( size_t i = 0; i < sb_Count( sbPages ); ++i ) {
+		char pageSuffix[32];
+		if( sb_Count( sbPages ) == 1 ) {
+			strcpy( pageSuffix, ".png" );
+		} else {
+			sprintf( pageSuffix, "_%i.png", (int)i );
 		}
-	} while( !success );
-	sb_Release( sbNodes );
-
-	// every rectangle should now be packed, create the image and the sprite sheet files
-
-	// first create the image
-	size_t imgSize = sizeof( uint8_t ) * 4 * width * height;
-	uint8_t* imageData = malloc( imgSize );
-	memset( imageData, 0, imgSize );
-	for( size_t i = 0; i < sb_Count( sbRects ); ++i ) {
-		insertImage( imageData, width, height, i );
+		sbPages[i].fileName = appendToName( outputName, pageSuffix );
 	}
-	char* imageFileName = malloc( sizeof( char ) * strlen( outputName ) + 4 + 1 );
-	strcpy( imageFileName, outputName );
-	strcat( imageFileName, ".png" );
+	runOnWorkers( writePage, sb_Count( sbPages ), numThreads );
 
-	stbi_write_png( imageFileName, width, height, 4, imageData, 0 );
+	// the sprites have to be grouped by page
+	int* sbOrder = NULL;
+	for( int i = 0; i < (int)sb_Count( sbSpriteInfos ); ++i ) {
+		if( sbSpriteInfos[i].loaded ) {
+			sb_Push( sbOrder, i );
+		}
+	}
+	qsort( sbOrder, sb_Count( sbOrder ), sizeof( sbOrder[0] ), compareSpritesByPage );
 
-	/*
-	Format for layout text:
-	2
-	imageFileName
-	spriteName x y w h
-	repeat above line for every sprite in the sheet
-	*/
-	char* layoutFileName = malloc( sizeof( char ) * strlen( outputName ) + 3 + 1 );
-	strcpy( layoutFileName, outputName );
-	strcat( layoutFileName, ".ss" );
+	ret = writeDefinitions( outputName, sbOrder );
+	sb_Release( sbOrder );
 
-	FILE* layoutFile = fopen( layoutFileName, "w" );
-	char* fileName = strrchr( imageFileName, '\\' );
-	if( fileName ) ++fileName;
-	fprintf( layoutFile, "2\n%s", fileName );
-	for( size_t i = 0; i < sb_Count( sbRects ); ++i ) {
-		fileName = strrchr( sbSpriteInfos[sbRects[i].id].filePath, '\\' );
-		if( fileName ) ++fileName;
-		fprintf( layoutFile, "\n%s %i %i %i %i", fileName, sbRects[i].x, sbRects[i].y, sbRects[i].w - paddingX, sbRects[i].h - paddingY );
+	if( ret >= 0 ) {
+		FILE* hashFile = fopen( hashFileName, "w" );
+		if( hashFile != NULL ) {
+			fprintf( hashFile, "%llx %i\n", (unsigned long long)inputsHash, (int)sb_Count( sbPages ) );
+			fclose( hashFile );
+		}
 	}
-	fclose( layoutFile );
 
-	free( layoutFileName );
-	free( imageFileName );
+clean_up:
+	for( size_t i = 0; i < sb_Count( sbPages ); ++i ) {
+		free( sbPages[i].fileName );
+	}
+	sb_Release( sbPages );
+	for( size_t i = 0; i < sb_Count( sbSpriteInfos ); ++i ) {
+		free( sbSpriteInfos[i].filePath );
+		free( sbSpriteInfos[i].pixels );
+	}
+	sb_Release( sbSpriteInfos );
+	sb_Release( sbFreeRects );
+	sb_Release( sbNewFreeRects );
+	free( hashFileName );
 
 	return ret;
-}
\ No newline at end of file
+}
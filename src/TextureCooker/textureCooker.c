@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_FAILURE_USERMSG
+#include <stb_image.h>
+
+#include "../Game/Graphics/cookedTextureFormat.h"
+#include "../Game/Graphics/spriteSheetFormat.h"
+
+// simple command line program to turn images into cooked textures the game can upload without decoding
+//  interface: TextureCooker -nomips -mips -rle image ...
+// writes a .ctex next to each image, if there's a sprite sheet definition (.ss) with the same name the image is a sprite
+//  sheet, which don't get mips unless -mips is used since the smaller levels bleed neighbouring sprites into each other
+
+bool createMips = true;
+bool sheetMips = false;
+bool compressRows = false;
+
+typedef struct {
+	int width;
+	int height;
+	uint8_t* texels; // as they'll be stored in the file
+	uint8_t* stored; // compressed rows if we're compressing, otherwise the same as texels
+	size_t storedSize;
+} Mip;
+
+// returns a new string with the extension of fileName replaced, you will have to free() it yourself
+char* replaceExtension( const char* fileName, const char* extension )
+{
+	size_t baseLen = strlen( fileName );
+	for( size_t i = baseLen; i > 0; --i ) {
+		char c = fileName[i - 1];
+		if( c == '.' ) {
+			baseLen = i - 1;
+			break;
+		}
+		if( ( c == '/' ) || ( c == '\\' ) ) {
+			break;
+		}
+	}
+
+	char* newName = malloc( baseLen + strlen( extension ) + 1 );
+	memcpy( newName, fileName, baseLen );
+	strcpy( newName + baseLen, extension );
+	return newName;
+}
+
+// whether the image is one of the pages of a sprite sheet definition, false if the definition doesn't exist
+bool isSpriteSheetPage( const char* fileName, const char* imageName )
+{
+	FILE* file = fopen( fileName, "r" );
+	if( file == NULL ) {
+		return false;
+	}
+
+	// format version 2 only has one page
+	// format version 3
+	//  number of pages
+	//  image file name for each page
+	// where the sprites are comes from the sprite sheet's own index, so the pages are all we need to look at
+	char line[512];
+	int version = 0;
+	bool isPage = false;
+	if( fgets( line, sizeof( line ), file ) != NULL ) {
+		version = atoi( line );
+	}
+
+	if( version >= SPRITE_SHEET_TEXT_VERSION ) {
+		int numPages = 0;
+		if( fgets( line, sizeof( line ), file ) != NULL ) {
+			numPages = atoi( line );
+		}
+
+		for( int i = 0; ( i < numPages ) && !isPage; ++i ) {
+			if( fgets( line, sizeof( line ), file ) == NULL ) {
+				break;
+			}
+			line[strcspn( line, "\r\n" )] = 0;
+			isPage = ( strcmp( line, imageName ) == 0 );
+		}
+	} else {
+		isPage = true;
+	}
+
+	fclose( file );
+	return isPage;
+}
+
+bool isTranslucent( const uint8_t* texels, int width, int height )
+{
+	size_t count = (size_t)width * (size_t)height;
+	for( size_t i = 0; i < count; ++i ) {
+		uint8_t a = texels[( i * 4 ) + 3];
+		if( ( a > 0x00 ) && ( a < 0xFF ) ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint8_t toByte( float f )
+{
+	f = floorf( f + 0.5f );
+	if( f < 0.0f ) return 0;
+	if( f > 255.0f ) return 255;
+	return (uint8_t)f;
+}
+
+// converts premultiplied colors into what we're storing
+void storeTexels( const float* premultiplied, size_t count, uint8_t* out )
+{
+	for( size_t i = 0; i < count; ++i ) {
+		const float* in = premultiplied + ( i * 4 );
+		float a = in[3];
+		out[( i * 4 ) + 3] = toByte( a );
+		for( int c = 0; c < 3; ++c ) {
+			out[( i * 4 ) + c] = ( a > 0.0f ) ? toByte( ( in[c] * 255.0f ) / a ) : 0;
+		}
+	}
+}
+
+// creates all the mips, the smaller mips are filtered with premultiplied colors so clear pixels don't bleed into the
+//  solid ones
+int createMipChain( const uint8_t* image, int width, int height, bool withMips, Mip* outMips )
+{
+	size_t count = (size_t)width * (size_t)height;
+	float* current = malloc( sizeof( float ) * 4 * count );
+	for( size_t i = 0; i < count; ++i ) {
+		float a = (float)image[( i * 4 ) + 3];
+		for( int c = 0; c < 3; ++c ) {
+			current[( i * 4 ) + c] = ( (float)image[( i * 4 ) + c] * a ) / 255.0f;
+		}
+		current[( i * 4 ) + 3] = a;
+	}
+
+	int numMips = 0;
+	int mipWidth = width;
+	int mipHeight = height;
+	for( ;; ) {
+		Mip* mip = &( outMips[numMips] );
+		mip->width = mipWidth;
+		mip->height = mipHeight;
+		mip->texels = malloc( (size_t)mipWidth * (size_t)mipHeight * 4 );
+		if( numMips == 0 ) {
+			// keep the original exactly
+			memcpy( mip->texels, image, count * 4 );
+		} else {
+			storeTexels( current, (size_t)mipWidth * (size_t)mipHeight, mip->texels );
+		}
+		++numMips;
+
+		if( !withMips || ( numMips >= COOKED_TEXTURE_MAX_MIPS ) || ( ( mipWidth == 1 ) && ( mipHeight == 1 ) ) ) {
+			break;
+		}
+
+		// box filter down to the next level
+		int nextWidth = ( mipWidth > 1 ) ? ( mipWidth / 2 ) : 1;
+		int nextHeight = ( mipHeight > 1 ) ? ( mipHeight / 2 ) : 1;
+		float* next = malloc( sizeof( float ) * 4 * (size_t)nextWidth * (size_t)nextHeight );
+		for( int y = 0; y < nextHeight; ++y ) {
+			int y0 = y * 2;
+			int y1 = ( ( y0 + 1 ) < mipHeight ) ? ( y0 + 1 ) : y0;
+			for( int x = 0; x < nextWidth; ++x ) {
+				int x0 = x * 2;
+				int x1 = ( ( x0 + 1 ) < mipWidth ) ? ( x0 + 1 ) : x0;
+				for( int c = 0; c < 4; ++c ) {
+					float sum = current[( ( x0 + ( y0 * mipWidth ) ) * 4 ) + c] + current[( ( x1 + ( y0 * mipWidth ) ) * 4 ) + c] +
+						current[( ( x0 + ( y1 * mipWidth ) ) * 4 ) + c] + current[( ( x1 + ( y1 * mipWidth ) ) * 4 ) + c];
+					next[( ( x + ( y * nextWidth ) ) * 4 ) + c] = sum * 0.25f;
+				}
+			}
+		}
+
+		free( current );
+		current = next;
+		mipWidth = nextWidth;
+		mipHeight = nextHeight;
+	}
+
+	free( current );
+	return numMips;
+}
+
+// run length encodes a row, see cookedTextureFormat.h, returns the number of bytes written
+size_t compressRow( const uint8_t* row, int width, uint8_t* out )
+{
+	size_t written = 0;
+	int i = 0;
+	while( i < width ) {
+		int run = 1;
+		while( ( ( i + run ) < width ) && ( run < 128 ) && ( memcmp( row + ( ( i + run ) * 4 ), row + ( i * 4 ), 4 ) == 0 ) ) {
+			++run;
+		}
+
+		if( run > 1 ) {
+			out[written++] = (uint8_t)( 0x80 | ( run - 1 ) );
+			memcpy( out + written, row + ( i * 4 ), 4 );
+			written += 4;
+			i += run;
+		} else {
+			// copy pixels as is until we hit the start of a run
+			int start = i;
+			int count = 0;
+			while( ( i < width ) && ( count < 128 ) ) {
+				if( ( count > 0 ) && ( ( i + 1 ) < width ) && ( memcmp( row + ( ( i + 1 ) * 4 ), row + ( i * 4 ), 4 ) == 0 ) ) {
+					break;
+				}
+				++i;
+				++count;
+			}
+			out[written++] = (uint8_t)( count - 1 );
+			memcpy( out + written, row + ( start * 4 ), (size_t)count * 4 );
+			written += (size_t)count * 4;
+		}
+	}
+
+	return written;
+}
+
+// compresses all the mips, returns false if it doesn't make them any smaller
+bool compressMips( Mip* mips, int numMips )
+{
+	size_t rawTotal = 0;
+	size_t compressedTotal = 0;
+	for( int i = 0; i < numMips; ++i ) {
+		size_t rawSize = (size_t)mips[i].width * (size_t)mips[i].height * 4;
+		rawTotal += rawSize;
+
+		// worst case is a control byte for every pixel
+		mips[i].stored = malloc( rawSize + ( (size_t)mips[i].width * (size_t)mips[i].height ) );
+		mips[i].storedSize = 0;
+		for( int r = 0; r < mips[i].height; ++r ) {
+			mips[i].storedSize += compressRow( mips[i].texels + ( (size_t)r * mips[i].width * 4 ), mips[i].width, mips[i].stored + mips[i].storedSize );
+		}
+		compressedTotal += mips[i].storedSize;
+	}
+
+	if( compressedTotal < rawTotal ) {
+		return true;
+	}
+
+	for( int i = 0; i < numMips; ++i ) {
+		free( mips[i].stored );
+		mips[i].stored = mips[i].texels;
+		mips[i].storedSize = (size_t)mips[i].width * (size_t)mips[i].height * 4;
+	}
+	return false;
+}
+
+void writePadding( FILE* file, size_t amount )
+{
+	uint8_t zero = 0;
+	for( size_t i = 0; i < amount; ++i ) {
+		fwrite( &zero, 1, 1, file );
+	}
+}
+
+int cookImage( const char* fileName )
+{
+	int ret = 0;
+	uint8_t* image = NULL;
+	bool isSheet = false;
+	Mip mips[COOKED_TEXTURE_MAX_MIPS];
+	int numMips = 0;
+	char* outputName = NULL;
+	char* sheetName = NULL;
+	FILE* outFile = NULL;
+
+	memset( mips, 0, sizeof( mips ) );
+
+	int width, height, comp;
+	image = stbi_load( fileName, &width, &height, &comp, 4 );
+	if( image == NULL ) {
+		fprintf( stderr, "Unable to load image %s: %s\n", fileName, stbi_failure_reason( ) );
+		ret = -1;
+		goto clean_up;
+	}
+
+	if( ( width > COOKED_TEXTURE_MAX_SIZE ) || ( height > COOKED_TEXTURE_MAX_SIZE ) ) {
+		fprintf( stderr, "Image %s is too large: %i x %i\n", fileName, width, height );
+		ret = -1;
+		goto clean_up;
+	}
+
+	// if the sprite sheet needed more than one page they're named sheet_0.png, sheet_1.png, etc.
+	const char* imageName = fileName;
+	for( const char* c = fileName; *c != 0; ++c ) {
+		if( ( *c == '/' ) || ( *c == '\\' ) ) {
+			imageName = c + 1;
+		}
+	}
+
+	sheetName = replaceExtension( fileName, ".ss" );
+	isSheet = isSpriteSheetPage( sheetName, imageName );
+	if( !isSheet ) {
+		char* pageSeparator = strrchr( sheetName, '_' );
+		size_t numDigits = ( pageSeparator != NULL ) ? strspn( pageSeparator + 1, "0123456789" ) : 0;
+		if( ( numDigits > 0 ) && ( pageSeparator > ( sheetName + ( imageName - fileName ) ) ) && ( strcmp( pageSeparator + 1 + numDigits, ".ss" ) == 0 ) ) {
+			strcpy( pageSeparator, ".ss" );
+			isSheet = isSpriteSheetPage( sheetName, imageName );
+		}
+	}
+
+	CookedTextureHeader header;
+	header.magic = COOKED_TEXTURE_MAGIC;
+	header.version = COOKED_TEXTURE_VERSION;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	header.flags = 0;
+	if( isTranslucent( image, width, height ) ) {
+		header.flags |= CTF_TRANSPARENT;
+	}
+
+	numMips = createMipChain( image, width, height, createMips && ( !isSheet || sheetMips ), mips );
+	header.numMips = (uint32_t)numMips;
+
+	if( compressRows && compressMips( mips, numMips ) ) {
+		header.flags |= CTF_ROW_COMPRESSED;
+	} else if( !compressRows ) {
+		for( int i = 0; i < numMips; ++i ) {
+			mips[i].stored = mips[i].texels;
+			mips[i].storedSize = (size_t)mips[i].width * (size_t)mips[i].height * 4;
+		}
+	}
+
+	size_t headerSize = sizeof( CookedTextureHeader ) + ( sizeof( CookedTextureMip ) * numMips );
+	size_t dataStart = ( headerSize + COOKED_TEXTURE_DATA_ALIGNMENT - 1 ) & ~(size_t)( COOKED_TEXTURE_DATA_ALIGNMENT - 1 );
+
+	outputName = replaceExtension( fileName, COOKED_TEXTURE_EXTENSION );
+	outFile = fopen( outputName, "wb" );
+	if( outFile == NULL ) {
+		fprintf( stderr, "Unable to open %s for writing\n", outputName );
+		ret = -1;
+		goto clean_up;
+	}
+
+	fwrite( &header, sizeof( header ), 1, outFile );
+
+	size_t offset = dataStart;
+	for( int i = 0; i < numMips; ++i ) {
+		CookedTextureMip mip;
+		mip.width = (uint32_t)mips[i].width;
+		mip.height = (uint32_t)mips[i].height;
+		mip.offset = (uint32_t)offset;
+		mip.size = (uint32_t)mips[i].storedSize;
+		fwrite( &mip, sizeof( mip ), 1, outFile );
+
+		// keep each mip aligned
+		offset += ( mips[i].storedSize + COOKED_TEXTURE_DATA_ALIGNMENT - 1 ) & ~(size_t)( COOKED_TEXTURE_DATA_ALIGNMENT - 1 );
+	}
+
+	writePadding( outFile, dataStart - headerSize );
+
+	for( int i = 0; i < numMips; ++i ) {
+		fwrite( mips[i].stored, mips[i].storedSize, 1, outFile );
+		size_t aligned = ( mips[i].storedSize + COOKED_TEXTURE_DATA_ALIGNMENT - 1 ) & ~(size_t)( COOKED_TEXTURE_DATA_ALIGNMENT - 1 );
+		writePadding( outFile, aligned - mips[i].storedSize );
+	}
+
+	printf( "%s -> %s: %i x %i, %i mips%s%s\n", fileName, outputName, width, height, numMips, isSheet ? ", sprite sheet" : "",
+		( header.flags & CTF_ROW_COMPRESSED ) ? ", compressed" : "" );
+
+clean_up:
+	if( outFile != NULL ) {
+		fclose( outFile );
+	}
+	for( int i = 0; i < numMips; ++i ) {
+		if( mips[i].stored != mips[i].texels ) {
+			free( mips[i].stored );
+		}
+		free( mips[i].texels );
+	}
+	free( sheetName );
+	free( outputName );
+	stbi_image_free( image );
+
+	return ret;
+}
+
+int main( int argc, char** argv )
+{
+	int ret = 0;
+
+	// options apply to every image after them
+	for( int i = 1; i < argc; ++i ) {
+		if( strcmp( argv[i], "-h" ) == 0 ) {
+			fprintf( stdout, "Used to cook images into textures that can be loaded without decoding.\n" );
+			fprintf( stdout, "Creates a ctex file next to each image. If there's an ss file with the same name it's treated as a sprite sheet.\n" );
+			fprintf( stdout, "Useage: TextureCooker -nomips -mips -rle image_to_cook image_to_cook\n" );
+			fprintf( stdout, "-nomips to only store the full size image.\n" );
+			fprintf( stdout, "-mips to also create mips for sprite sheets, which don't get them by default.\n" );
+			fprintf( stdout, "-rle to run length encode each row, only used if it makes the file smaller.\n" );
+		} else if( strcmp( argv[i], "-nomips" ) == 0 ) {
+			createMips = false;
+		} else if( strcmp( argv[i], "-mips" ) == 0 ) {
+			createMips = true;
+			sheetMips = true;
+		} else if( strcmp( argv[i], "-rle" ) == 0 ) {
+			compressRows = true;
+		} else if( cookImage( argv[i] ) < 0 ) {
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,50 @@
+#include "toolThreads.h"
+
+#include <stdlib.h>
+#include <Windows.h>
+
+static WorkProc currentWork = NULL;
+static size_t currentWorkCount = 0;
+static volatile LONG nextWorkIdx = 0;
+
+static DWORD WINAPI workerThread( LPVOID param )
+{
+	(void)param;
+
+	LONG idx;
+	while( ( idx = InterlockedIncrement( &nextWorkIdx ) - 1 ) < (LONG)currentWorkCount ) {
+		currentWork( (size_t)idx );
+	}
+
+	return 0;
+}
+
+void runOnWorkers( WorkProc work, size_t count, int maxThreads )
+{
+	currentWork = work;
+	currentWorkCount = count;
+	nextWorkIdx = 0;
+
+	int threadCount = maxThreads;
+	if( (size_t)threadCount > count ) {
+		threadCount = (int)count;
+	}
+
+	HANDLE* threads = malloc( sizeof( HANDLE ) * ( threadCount + 1 ) );
+	int started = 0;
+	for( int i = 0; i < threadCount; ++i ) {
+		threads[started] = CreateThread( NULL, 0, workerThread, NULL, 0, NULL );
+		if( threads[started] != NULL ) {
+			++started;
+		}
+	}
+
+	// this thread helps out too, and if no threads could be started it does everything
+	workerThread( NULL );
+
+	for( int i = 0; i < started; ++i ) {
+		WaitForSingleObject( threads[i], INFINITE );
+		CloseHandle( threads[i] );
+	}
+	free( threads );
+}
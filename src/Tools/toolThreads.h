@@ -0,0 +1,14 @@
+#ifndef TOOL_THREADS_H
+#define TOOL_THREADS_H
+
+#include <stddef.h>
+
+// simple thread pool shared by the command line tools
+
+// runs the work proc for each index on all the worker threads
+typedef void (*WorkProc)( size_t idx );
+
+// starts up to maxThreads threads, the calling thread works as well so up to maxThreads + 1 run at once
+void runOnWorkers( WorkProc work, size_t count, int maxThreads );
+
+#endif /* inclusion guard */
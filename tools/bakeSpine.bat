@@ -0,0 +1,53 @@
+@echo off
+rem Bakes every Spine json skeleton under a directory into the binary .skel format that spine_LoadTemplate prefers.
+rem  Only json files with a matching .atlas are baked. A hash of the json is stored next to it in a .skel.hash file and
+rem  the skeleton is only exported again when the json has changed. The game loads the json instead if it's newer than
+rem  the .skel, so run this after editing skeletons.
+rem  Uses the Spine command line interface, set SPINE_EXE if Spine isn't installed in the default location and set
+rem  SPINE_VERSION to the editor version that matches the spine-c runtime being used.
+rem Usage: bakeSpine.bat <directory>
+
+setlocal EnableDelayedExpansion
+
+if "%~1"=="" (
+	echo Usage: %~nx0 ^<directory^>
+	exit /b 1
+)
+
+if not defined SPINE_EXE set "SPINE_EXE=C:\Program Files\Spine\Spine.com"
+set "VERSION_ARG="
+if defined SPINE_VERSION set "VERSION_ARG=-u %SPINE_VERSION%"
+
+set /a baked=0
+set /a skipped=0
+set /a failed=0
+
+for /r "%~1" %%f in (*.json) do (
+	if exist "%%~dpnf.atlas" (
+		set "hash="
+		for /f "skip=1 delims=" %%h in ('certutil -hashfile "%%f" SHA1') do if not defined hash set "hash=%%h"
+
+		set "oldHash="
+		if exist "%%~dpnf.skel" if exist "%%~dpnf.skel.hash" set /p oldHash=<"%%~dpnf.skel.hash"
+
+		if "!hash!"=="!oldHash!" (
+			rem the json was touched without changing, update the time on the export so the game doesn't think it's stale
+			copy /b "%%~dpnf.skel"+,, "%%~dpnf.skel" >nul
+			set /a skipped+=1
+		) else (
+			echo Baking %%f
+			"%SPINE_EXE%" !VERSION_ARG! -i "%%f" -o "%%~dpf" -e binary
+			if errorlevel 1 (
+				echo Unable to bake %%f
+				set /a failed+=1
+			) else (
+				>"%%~dpnf.skel.hash" echo !hash!
+				set /a baked+=1
+			)
+		)
+	)
+)
+
+echo Baked %baked%, up to date %skipped%, failed %failed%
+if %failed% gtr 0 exit /b 1
+exit /b 0